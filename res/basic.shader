@@ -1,9 +1,10 @@
 #shader vertex
 #version 450 core
 layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 offset; // per instance; (0, 0) while the attribute is disabled
 
 void main(){
-gl_Position = position;
+gl_Position = position + vec4(offset, 0.0, 0.0);
 }
 #shader fragment
 #version 450 core
@@ -0,0 +1,22 @@
+#shader vertex
+#version 450 core
+layout(location = 0) in vec4 position;
+
+out vec2 v_TexCoord;
+
+void main(){
+gl_Position = position;
+v_TexCoord = position.xy * 0.5 + 0.5;
+}
+#shader fragment
+#version 450 core
+layout(location = 0) out vec4 color;
+
+in vec2 v_TexCoord;
+
+uniform vec4 u_Color;
+uniform sampler2D u_Texture;
+
+void main(){
+    color = vec4(u_Color.rgb * texture(u_Texture, v_TexCoord).r, 1.0);
+}
@@ -0,0 +1,58 @@
+#include <GL/glew.h>
+#include <cstring>
+#include "StreamingTexture.h"
+#include "Renderer.h"
+
+StreamingTexture::StreamingTexture(unsigned int width, unsigned int height)
+    : m_Width(width), m_Height(height), m_Next(0), m_Pending(false) {
+    glSafeCall(glGenTextures(1, &m_Renderer_ID));
+    this->Bind();
+    glSafeCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    glSafeCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    glSafeCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    glSafeCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    glSafeCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, nullptr));
+
+    unsigned int bytes = width * height * sizeof(float);
+    glSafeCall(glGenBuffers(2, m_PixelBuffers));
+    for (unsigned int buffer : m_PixelBuffers) {
+        glSafeCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer));
+        glSafeCall(glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW));
+    }
+    glSafeCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+}
+
+StreamingTexture::~StreamingTexture() {
+    glSafeCall(glDeleteBuffers(2, m_PixelBuffers));
+    glSafeCall(glDeleteTextures(1, &m_Renderer_ID));
+}
+
+void StreamingTexture::Bind(unsigned int slot) {
+    glSafeCall(glActiveTexture(GL_TEXTURE0 + slot));
+    glSafeCall(glBindTexture(GL_TEXTURE_2D, m_Renderer_ID));
+}
+
+void StreamingTexture::Unbind() {
+    glSafeCall(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+void StreamingTexture::Update(const float* data) {
+    unsigned int bytes = m_Width * m_Height * sizeof(float);
+    this->Bind();
+    if (m_Pending) {
+        // with a pixel buffer bound the pointer is an offset and the copy is queued on the GPU
+        glSafeCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_PixelBuffers[1 - m_Next]));
+        glSafeCall(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_Width, m_Height, GL_RED, GL_FLOAT, nullptr));
+    }
+    glSafeCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_PixelBuffers[m_Next]));
+    // orphaning hands the driver fresh storage, so mapping doesn't wait on a copy still reading the old one
+    glSafeCall(glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW));
+    glSafeCall(void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (mapped) {
+        std::memcpy(mapped, data, bytes);
+        glSafeCall(glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+        m_Pending = true;
+        m_Next = 1 - m_Next;
+    }
+    glSafeCall(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+}
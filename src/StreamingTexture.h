@@ -0,0 +1,21 @@
+#pragma once
+
+// Single channel float texture that gets new contents every frame. Uploads go
+// through two pixel buffers in turn: a frame is written into one while the
+// GPU copies the previous frame out of the other, so neither the CPU write nor
+// the copy has to wait for the other. What's shown lags the data by a frame.
+class StreamingTexture {
+private:
+	unsigned int m_Renderer_ID;
+	unsigned int m_PixelBuffers[2];
+	unsigned int m_Width, m_Height;
+	unsigned int m_Next; // pixel buffer the next Update writes into
+	bool m_Pending; // the other pixel buffer holds a frame not yet copied into the texture
+public:
+	StreamingTexture(unsigned int width, unsigned int height);
+	~StreamingTexture(); // destructor
+
+	void Bind(unsigned int slot = 0);
+	void Unbind();
+	void Update(const float* data); // width * height floats, row 0 at the bottom
+};
@@ -2,10 +2,10 @@
 #include "VertexBuffer.h"
 #include "Renderer.h"
 
-VertexBuffer::VertexBuffer(const void* data, unsigned int size) {
+VertexBuffer::VertexBuffer(const void* data, unsigned int size, bool dynamic) {
     glSafeCall(glGenBuffers(1, &m_Renderer_ID)); // generate buffer and then get id for buffer
     this->Bind();
-    glSafeCall(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW)); // fill bound buffer with data 
+    glSafeCall(glBufferData(GL_ARRAY_BUFFER, size, data, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW)); // fill bound buffer with data 
 }
 
 VertexBuffer::~VertexBuffer() {
@@ -17,3 +17,7 @@ void VertexBuffer::Bind() {
 void VertexBuffer::Unbind(){
     glSafeCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
 }
+void VertexBuffer::Update(const void* data, unsigned int size, unsigned int offset) {
+    this->Bind();
+    glSafeCall(glBufferSubData(GL_ARRAY_BUFFER, offset, size, data));
+}
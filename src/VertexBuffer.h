@@ -5,11 +5,12 @@ class VertexBuffer {
 private:
 	unsigned int m_Renderer_ID;
 public:
-	VertexBuffer(const void* data, unsigned int size);
+	VertexBuffer(const void* data, unsigned int size, bool dynamic = false);
 	~VertexBuffer(); // destructor
 
 	void Bind();
 	void Unbind();
+	void Update(const void* data, unsigned int size, unsigned int offset = 0); // overwrite part of the buffer in place
 };
 
 
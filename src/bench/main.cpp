@@ -0,0 +1,198 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include "../physics/Cpu.h"
+#include "../physics/Scenes.h"
+#include "../physics/SoftBody.h"
+#include "../numerics/SparseMatrix.h"
+#include "../numerics/Preconditioners.h"
+#include "../numerics/ConjugateGradient.h"
+#include "../numerics/Minres.h"
+
+// Sparse kernel benchmark: times the matrix-vector product of every storage
+// format on every SIMD level the CPU has, then the Krylov solvers with each
+// preconditioner. Usage: bench [--size n] [--threads N] [--simd scalar|avx2|avx512|all]
+//                              [--repeat N] [--resolution N]
+// The matrices are the 7 point Laplacian on an n^3 grid and the stiffness
+// systems of the soft body cube and beam scenes at --resolution, which are
+// also run as 3 x 3 and 2 x 2 block matrices. A product counts 2 flops per
+// stored value; its bytes are the stored values and indices plus one read of
+// x and one write of y, so GB/s is a lower bound on the achieved bandwidth.
+struct BenchOptions {
+    unsigned int size = 64;
+    unsigned int threads = 0;
+    int simd = -1; // -1 runs every level
+    unsigned int repeat = 50;
+    unsigned int resolution = 0; // 0 keeps the scene defaults
+};
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cout << "missing value for " << arg << std::endl;
+            return false;
+        }
+        const char* value = argv[++i];
+        if (std::strcmp(arg, "--size") == 0)
+            options.size = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--threads") == 0)
+            options.threads = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--simd") == 0)
+            options.simd = std::strcmp(value, "scalar") == 0 ? (int) SimdLevel::Scalar :
+                std::strcmp(value, "avx2") == 0 ? (int) SimdLevel::AVX2 :
+                std::strcmp(value, "avx512") == 0 ? (int) SimdLevel::AVX512 : -1;
+        else if (std::strcmp(arg, "--repeat") == 0)
+            options.repeat = std::max((unsigned int) std::strtoul(value, nullptr, 10), 1u);
+        else if (std::strcmp(arg, "--resolution") == 0)
+            options.resolution = (unsigned int) std::strtoul(value, nullptr, 10);
+        else {
+            std::cout << "unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static void buildLaplacian(CsrMatrix& matrix, unsigned int n) {
+    std::vector<uint32_t> rowOffsets(1, 0), columns;
+    columns.reserve((size_t) n * n * n * 7);
+    for (unsigned int k = 0; k < n; k++) {
+        for (unsigned int j = 0; j < n; j++) {
+            for (unsigned int i = 0; i < n; i++) {
+                uint32_t row = (k * n + j) * n + i;
+                if (k > 0) columns.push_back(row - n * n);
+                if (j > 0) columns.push_back(row - n);
+                if (i > 0) columns.push_back(row - 1);
+                columns.push_back(row);
+                if (i + 1 < n) columns.push_back(row + 1);
+                if (j + 1 < n) columns.push_back(row + n);
+                if (k + 1 < n) columns.push_back(row + n * n);
+                rowOffsets.push_back((uint32_t) columns.size());
+            }
+        }
+    }
+    matrix.setPattern(n * n * n, rowOffsets, columns);
+    float* values = matrix.getValues();
+    for (unsigned int row = 0; row < n * n * n; row++) {
+        for (uint32_t k = rowOffsets[row]; k < rowOffsets[row + 1]; k++)
+            values[k] = columns[k] == row ? 6.0f : -1.0f;
+    }
+}
+
+// one implicit step so the matrix holds real values
+static void buildStiffness(SoftBody& body, CsrMatrix& matrix, ThreadPool& pool) {
+    body.step(1.0f / 60.0f, pool);
+    const CsrMatrix& source = body.getMatrix();
+    std::vector<uint32_t> rowOffsets(source.getRowOffsets(), source.getRowOffsets() + source.getRows() + 1);
+    std::vector<uint32_t> columns(source.getColumnIndices(), source.getColumnIndices() + source.getNonZeroCount());
+    matrix.setPattern(source.getRows(), rowOffsets, columns);
+    std::copy(source.getValues(), source.getValues() + source.getNonZeroCount(), matrix.getValues());
+}
+
+static void benchMultiply(const char* name, const SparseMatrix& matrix, const BenchOptions& options, ThreadPool& pool) {
+    unsigned int rows = matrix.getRows();
+    std::vector<float> x(rows), y(rows);
+    for (unsigned int i = 0; i < rows; i++)
+        x[i] = std::sin(0.37f * i);
+    double bytes = (double) matrix.getStoredBytes() + 2.0 * rows * sizeof(float);
+    double flops = 2.0 * matrix.getNonZeroCount();
+
+    SimdLevel detected = detectSimdLevel();
+    for (int level = (int) SimdLevel::Scalar; level <= (int) detected; level++) {
+        if (options.simd >= 0 && level != options.simd)
+            continue;
+        setSimdLevel((SimdLevel) level);
+        matrix.multiply(x.data(), y.data(), pool); // warm the caches
+        std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < options.repeat; i++)
+            matrix.multiply(x.data(), y.data(), pool);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count() / options.repeat;
+        std::cout << std::left << std::setw(10) << name << std::setw(7) << matrix.getName() << std::setw(9) << simdLevelName((SimdLevel) level)
+            << std::right << std::setw(10) << rows << std::setw(11) << matrix.getNonZeroCount()
+            << std::setw(10) << std::fixed << std::setprecision(3) << 1000.0 * seconds
+            << std::setw(9) << std::setprecision(2) << flops / seconds * 1e-9
+            << std::setw(9) << bytes / seconds * 1e-9 << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+    setSimdLevel(detected);
+}
+
+static void benchSolvers(const char* name, const SparseMatrix& matrix, unsigned int blockSize, ThreadPool& pool) {
+    unsigned int rows = matrix.getRows();
+    std::vector<float> b(rows), x(rows);
+    for (unsigned int i = 0; i < rows; i++)
+        b[i] = 1.0f + 0.1f * std::sin(0.1f * i);
+
+    const PreconditionerType types[] = { PreconditionerType::Jacobi, PreconditionerType::BlockJacobi, PreconditionerType::IncompleteCholesky };
+    for (PreconditionerType type : types) {
+        std::unique_ptr<Preconditioner> preconditioner = createPreconditioner(type, blockSize);
+        std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+        preconditioner->setup(matrix, pool);
+        double setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+        ConjugateGradient cg;
+        cg.setTolerance(1e-5f, 2000);
+        std::fill(x.begin(), x.end(), 0.0f);
+        timeStart = std::chrono::steady_clock::now();
+        cg.solve(matrix, *preconditioner, b.data(), x.data(), pool);
+        double cgSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+        Minres minres;
+        minres.setTolerance(1e-5f, 2000);
+        std::fill(x.begin(), x.end(), 0.0f);
+        timeStart = std::chrono::steady_clock::now();
+        minres.solve(matrix, *preconditioner, b.data(), x.data(), pool);
+        double minresSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+        std::cout << std::left << std::setw(10) << name << std::setw(7) << matrix.getName() << std::setw(15) << preconditioner->getName()
+            << std::right << std::fixed << std::setprecision(3) << std::setw(10) << 1000.0 * setupSeconds
+            << std::setw(8) << cg.getIterations() << std::setw(10) << 1000.0 * cgSeconds
+            << std::setw(8) << minres.getIterations() << std::setw(10) << 1000.0 * minresSeconds << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+        return -1;
+    ThreadPool pool(options.threads);
+
+    CsrMatrix laplacian;
+    buildLaplacian(laplacian, options.size);
+    SoftBody cubes, beams;
+    setupSoftBodyScene(cubes, 4, options.resolution ? options.resolution : 12);
+    setupBeamScene(beams, 4, options.resolution ? options.resolution : 160);
+    CsrMatrix cubeMatrix, beamMatrix;
+    buildStiffness(cubes, cubeMatrix, pool);
+    buildStiffness(beams, beamMatrix, pool);
+    BsrMatrix cubeBlocks, beamBlocks;
+    cubeBlocks.assign(cubeMatrix, 3);
+    beamBlocks.assign(beamMatrix, 2);
+
+    std::cout << "simd:    " << simdLevelName(getSimdLevel()) << std::endl;
+    std::cout << "threads: " << pool.getThreadCount() << std::endl;
+    std::cout << "repeat:  " << options.repeat << std::endl << std::endl;
+    std::cout << "matrix    format simd           rows   nonzeros        ms   GFLOP/s     GB/s" << std::endl;
+    benchMultiply("laplacian", laplacian, options, pool);
+    benchMultiply("cubes", cubeMatrix, options, pool);
+    benchMultiply("cubes", cubeBlocks, options, pool);
+    benchMultiply("beams", beamMatrix, options, pool);
+    benchMultiply("beams", beamBlocks, options, pool);
+
+    std::cout << std::endl << "matrix    format preconditioner  setup ms  cg its     cg ms  mr its     mr ms" << std::endl;
+    benchSolvers("laplacian", laplacian, 3, pool);
+    benchSolvers("cubes", cubeMatrix, 3, pool);
+    benchSolvers("cubes", cubeBlocks, 3, pool);
+    benchSolvers("beams", beamMatrix, 2, pool);
+    benchSolvers("beams", beamBlocks, 2, pool);
+    return 0;
+}
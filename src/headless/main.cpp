@@ -0,0 +1,570 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include "../physics/PhysicsWorld.h"
+#include "../physics/Cpu.h"
+#include "../physics/Scenes.h"
+#include "../physics/BarnesHut.h"
+#include "../physics/FastMultipole.h"
+#include "../physics/ParticleMesh.h"
+#include "../physics/SphFluid.h"
+#include "../physics/GridFluid.h"
+#include "../physics/XpbdSystem.h"
+#include "../physics/SoftBody.h"
+#include "../physics/MolecularDynamics.h"
+#include "../physics/DemSystem.h"
+#include "../physics/NBodySystem.h"
+#include "../physics/FieldSystem.h"
+
+// Headless driver: runs the simulation with no window or GL context and reports
+// throughput. Usage: headless [--steps N] [--bodies N] [--dt seconds] [--seed N]
+//                             [--integrator euler|verlet] [--simd scalar|avx2|avx512]
+//                             [--threads N] [--broadphase none|grid|tree|sap] [--radius r] [--sort steps]
+//                             [--solver sequential|colored|islands] [--iterations N] [--warm on|off]
+//                             [--sleep on|off] [--scene box|disk|charges|periodic|dam|slosh|smoke|cloth|ropes|soft|beams|lj|morse|hopper|cluster|orbits]
+//                             [--forces none|direct|bh|fmm|pm] [--theta t] [--order p]
+//                             [--grid n] [--assignment cic|tsc] [--sheets N] [--resolution N] [--substeps N]
+//                             [--precond jacobi|block|ic0] [--skin s] [--table on|off]
+//                             [--contact hertz|spring] [--nbody hermite|leapfrog|rk45] [--blocks on|off]
+//                             [--binaries N] [--accuracy eta] [--tolerance t]
+//                             [--scheme explicit|semi|verlet|rk4] [--dims 2|3] [--field point|harmonic|uniform]
+//                             [--precision single|mixed|both]
+// The fluid scenes dam and slosh run an SphFluid instead of the world, with
+// --bodies particles and [--sph wcsph|dfsph]. The smoke scene runs a
+// GridFluid of --grid cells a side. The cloth and ropes scenes run an
+// XpbdSystem with --sheets sheets (or ropes) of --resolution particles a side.
+// The soft and beams scenes run a SoftBody of --sheets cubes (or beams) with
+// --resolution cells a side (along the length), preconditioned by --precond.
+// The lj and morse scenes run MolecularDynamics on about --bodies atoms with
+// Verlet lists of --skin, in reduced units (--dt 0.005 is one time step),
+// with --table on evaluating the pair law from a spline table of itself.
+// The hopper scene runs a DemSystem of about --bodies grains with --contact
+// forces and Verlet lists of --skin radii (0.5 unless given).
+// The cluster scene runs an NBodySystem of --bodies stars, --binaries pairs of
+// them bound in tight binaries, with the --nbody integrator and block time
+// steps of --dt divided by powers of two (--blocks off gives every star the
+// smallest step), sized by --accuracy; rk45 instead takes adaptive steps
+// shared by every star, each within --tolerance.
+// The orbits scene runs a FieldSystem of --bodies test particles around a point
+// mass (or in a --field harmonic trap or uniform pull) in --dims dimensions,
+// stepped by the --scheme preset of the templated step kernels, in float or
+// (--precision mixed) double arithmetic on the float state; --precision both
+// runs the same scene in each and reports both.
+struct HeadlessOptions {
+    unsigned long long steps = 10000;
+    unsigned int bodies = 10000;
+    float dt = 1.0f / 120.0f;
+    unsigned int seed = 1;
+    Integrator integrator = Integrator::SemiImplicitEuler;
+    unsigned int threads = 0;
+    BroadphaseType broadphase = BroadphaseType::UniformGrid;
+    float radius = 0.01f;
+    unsigned int sortInterval = 0;
+    SolverMode solver = SolverMode::Colored;
+    unsigned int iterations = 8;
+    bool warmStart = true;
+    bool sleep = true;
+    std::string scene = "box";
+    int forces = -1; // -1 keeps what the scene picked
+    float theta = 0.5f;
+    unsigned int order = 4;
+    unsigned int grid = 64;
+    MeshAssignment assignment = MeshAssignment::TriangularShapedCloud;
+    SphSolver sph = SphSolver::DivergenceFree;
+    unsigned int sheets = 12;
+    unsigned int resolution = 0; // 0 lets the scene pick
+    unsigned int substeps = 10;
+    PreconditionerType preconditioner = PreconditionerType::IncompleteCholesky;
+    float skin = -1.0f; // below 0 keeps each scene's default
+    bool table = false;
+    ContactModel contact = ContactModel::HertzMindlin;
+    NBodyIntegrator nbody = NBodyIntegrator::Hermite;
+    bool blocks = true;
+    unsigned int binaries = 50;
+    double accuracy = 0.02;
+    double tolerance = 1e-10;
+    StepScheme scheme = StepScheme::VelocityVerlet;
+    unsigned int dimensions = 2;
+    FieldLaw field = FieldLaw::PointMass;
+    StatePrecision precision = StatePrecision::Single;
+    bool bothPrecisions = false;
+};
+
+static bool parseOptions(int argc, char** argv, HeadlessOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cout << "missing value for " << arg << std::endl;
+            return false;
+        }
+        const char* value = argv[++i];
+        if (std::strcmp(arg, "--steps") == 0)
+            options.steps = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--bodies") == 0)
+            options.bodies = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--dt") == 0)
+            options.dt = std::strtof(value, nullptr);
+        else if (std::strcmp(arg, "--seed") == 0)
+            options.seed = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--integrator") == 0)
+            options.integrator = std::strcmp(value, "verlet") == 0 ? Integrator::VelocityVerlet : Integrator::SemiImplicitEuler;
+        else if (std::strcmp(arg, "--simd") == 0) {
+            if (std::strcmp(value, "scalar") == 0)
+                setSimdLevel(SimdLevel::Scalar);
+            else if (std::strcmp(value, "avx2") == 0)
+                setSimdLevel(SimdLevel::AVX2);
+            else
+                setSimdLevel(SimdLevel::AVX512);
+        }
+        else if (std::strcmp(arg, "--threads") == 0)
+            options.threads = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--broadphase") == 0)
+            options.broadphase = std::strcmp(value, "none") == 0 ? BroadphaseType::None :
+                std::strcmp(value, "tree") == 0 ? BroadphaseType::DynamicTree :
+                std::strcmp(value, "sap") == 0 ? BroadphaseType::SweepAndPrune : BroadphaseType::UniformGrid;
+        else if (std::strcmp(arg, "--radius") == 0)
+            options.radius = std::strtof(value, nullptr);
+        else if (std::strcmp(arg, "--sort") == 0)
+            options.sortInterval = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--solver") == 0)
+            options.solver = std::strcmp(value, "sequential") == 0 ? SolverMode::Sequential :
+                std::strcmp(value, "islands") == 0 ? SolverMode::Islands : SolverMode::Colored;
+        else if (std::strcmp(arg, "--iterations") == 0)
+            options.iterations = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--warm") == 0)
+            options.warmStart = std::strcmp(value, "off") != 0;
+        else if (std::strcmp(arg, "--sleep") == 0)
+            options.sleep = std::strcmp(value, "off") != 0;
+        else if (std::strcmp(arg, "--scene") == 0)
+            options.scene = value;
+        else if (std::strcmp(arg, "--forces") == 0)
+            options.forces = (int) (std::strcmp(value, "direct") == 0 ? ForceType::Direct :
+                std::strcmp(value, "bh") == 0 ? ForceType::BarnesHut :
+                std::strcmp(value, "fmm") == 0 ? ForceType::FastMultipole :
+                std::strcmp(value, "pm") == 0 ? ForceType::ParticleMesh : ForceType::None);
+        else if (std::strcmp(arg, "--theta") == 0)
+            options.theta = std::strtof(value, nullptr);
+        else if (std::strcmp(arg, "--order") == 0)
+            options.order = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--grid") == 0)
+            options.grid = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--assignment") == 0)
+            options.assignment = std::strcmp(value, "cic") == 0 ? MeshAssignment::CloudInCell : MeshAssignment::TriangularShapedCloud;
+        else if (std::strcmp(arg, "--sph") == 0)
+            options.sph = std::strcmp(value, "wcsph") == 0 ? SphSolver::WeaklyCompressible : SphSolver::DivergenceFree;
+        else if (std::strcmp(arg, "--sheets") == 0)
+            options.sheets = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--resolution") == 0)
+            options.resolution = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--substeps") == 0)
+            options.substeps = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--precond") == 0)
+            options.preconditioner = std::strcmp(value, "jacobi") == 0 ? PreconditionerType::Jacobi :
+                std::strcmp(value, "block") == 0 ? PreconditionerType::BlockJacobi : PreconditionerType::IncompleteCholesky;
+        else if (std::strcmp(arg, "--skin") == 0)
+            options.skin = std::strtof(value, nullptr);
+        else if (std::strcmp(arg, "--contact") == 0)
+            options.contact = std::strcmp(value, "spring") == 0 ? ContactModel::SpringDashpot : ContactModel::HertzMindlin;
+        else if (std::strcmp(arg, "--nbody") == 0)
+            options.nbody = std::strcmp(value, "leapfrog") == 0 ? NBodyIntegrator::Leapfrog :
+                std::strcmp(value, "rk45") == 0 ? NBodyIntegrator::DormandPrince : NBodyIntegrator::Hermite;
+        else if (std::strcmp(arg, "--blocks") == 0)
+            options.blocks = std::strcmp(value, "off") != 0;
+        else if (std::strcmp(arg, "--binaries") == 0)
+            options.binaries = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--accuracy") == 0)
+            options.accuracy = std::strtod(value, nullptr);
+        else if (std::strcmp(arg, "--tolerance") == 0)
+            options.tolerance = std::strtod(value, nullptr);
+        else if (std::strcmp(arg, "--scheme") == 0)
+            options.scheme = std::strcmp(value, "explicit") == 0 ? StepScheme::ExplicitEuler :
+                std::strcmp(value, "semi") == 0 ? StepScheme::SemiImplicitEuler :
+                std::strcmp(value, "rk4") == 0 ? StepScheme::RungeKutta4 : StepScheme::VelocityVerlet;
+        else if (std::strcmp(arg, "--dims") == 0)
+            options.dimensions = (unsigned int) std::strtoul(value, nullptr, 10);
+        else if (std::strcmp(arg, "--field") == 0)
+            options.field = std::strcmp(value, "harmonic") == 0 ? FieldLaw::Harmonic :
+                std::strcmp(value, "uniform") == 0 ? FieldLaw::Uniform : FieldLaw::PointMass;
+        else if (std::strcmp(arg, "--precision") == 0) {
+            options.precision = std::strcmp(value, "mixed") == 0 ? StatePrecision::Mixed : StatePrecision::Single;
+            options.bothPrecisions = std::strcmp(value, "both") == 0;
+        }
+        else if (std::strcmp(arg, "--table") == 0)
+            options.table = std::strcmp(value, "on") == 0;
+        else {
+            std::cout << "unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static int runFluid(const HeadlessOptions& options) {
+    ThreadPool pool(options.threads);
+    SphFluid fluid;
+    fluid.setSolver(options.sph);
+    if (options.scene == "slosh")
+        setupSloshing(fluid, options.bodies);
+    else
+        setupDamBreak(fluid, options.bodies);
+
+    std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+    unsigned long long substeps = 0;
+    for (unsigned long long i = 0; i < options.steps; i++) {
+        fluid.step(options.dt, pool);
+        substeps += fluid.getSubsteps();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+    double density = 0.0;
+    for (float rho : fluid.getDensity())
+        density += rho;
+    std::cout << "simd:            " << simdLevelName(getSimdLevel()) << std::endl;
+    std::cout << "threads:         " << pool.getThreadCount() << std::endl;
+    std::cout << "solver:          " << (fluid.getSolver() == SphSolver::WeaklyCompressible ? "wcsph" : "dfsph") << std::endl;
+    std::cout << "particles:       " << fluid.getParticleCount() << std::endl;
+    std::cout << "neighbors:       " << fluid.getNeighborCount() / (double) std::max(fluid.getParticleCount(), 1u) << " per particle" << std::endl;
+    std::cout << "mean density:    " << density / std::max(fluid.getParticleCount(), 1u) << std::endl;
+    std::cout << "substeps:        " << substeps << std::endl;
+    if (fluid.getSolver() == SphSolver::DivergenceFree) {
+        std::cout << "density iters:   " << fluid.getDensityIterations() << " (last substep)" << std::endl;
+        std::cout << "divergence iters: " << fluid.getDivergenceIterations() << " (last substep)" << std::endl;
+    }
+    std::cout << "steps:           " << fluid.getStepCount() << std::endl;
+    std::cout << "seconds:         " << seconds << std::endl;
+    std::cout << "steps/s:         " << options.steps / seconds << std::endl;
+    std::cout << "particle-substeps/s: " << substeps * (double) fluid.getParticleCount() / seconds << std::endl;
+    return 0;
+}
+
+static int runSmoke(const HeadlessOptions& options) {
+    ThreadPool pool(options.threads);
+    GridFluid fluid;
+    fluid.resize(options.grid);
+
+    std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+    unsigned long long cycles = 0;
+    for (unsigned long long i = 0; i < options.steps; i++) {
+        fluid.step(options.dt, pool);
+        cycles += fluid.getPressureSolver().getCycles();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+    std::cout << "threads:         " << pool.getThreadCount() << std::endl;
+    std::cout << "grid:            " << fluid.getSize() << " x " << fluid.getSize() << std::endl;
+    std::cout << "levels:          " << fluid.getPressureSolver().getLevelCount() << std::endl;
+    std::cout << "v-cycles/step:   " << cycles / (double) std::max(options.steps, 1ull) << std::endl;
+    std::cout << "residual:        " << fluid.getPressureSolver().getResidual() << " (last step)" << std::endl;
+    std::cout << "steps:           " << fluid.getStepCount() << std::endl;
+    std::cout << "seconds:         " << seconds << std::endl;
+    std::cout << "steps/s:         " << options.steps / seconds << std::endl;
+    return 0;
+}
+
+static int runCloth(const HeadlessOptions& options) {
+    ThreadPool pool(options.threads);
+    XpbdSystem cloth;
+    cloth.setSubsteps(options.substeps);
+    if (options.scene == "ropes")
+        setupRopeScene(cloth, options.sheets, options.resolution ? options.resolution : 64);
+    else
+        setupClothScene(cloth, options.sheets, options.resolution ? options.resolution : 100);
+
+    std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < options.steps; i++)
+        cloth.step(options.dt, pool);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+    std::cout << "simd:            " << simdLevelName(getSimdLevel()) << std::endl;
+    std::cout << "threads:         " << pool.getThreadCount() << std::endl;
+    std::cout << "particles:       " << cloth.getParticleCount() << std::endl;
+    std::cout << "constraints:     " << cloth.getConstraintCount() << std::endl;
+    std::cout << "batches:         " << cloth.getBatchCount() << std::endl;
+    std::cout << "substeps:        " << cloth.getSubsteps() << std::endl;
+    std::cout << "steps:           " << cloth.getStepCount() << std::endl;
+    std::cout << "seconds:         " << seconds << std::endl;
+    std::cout << "steps/s:         " << options.steps / seconds << std::endl;
+    std::cout << "ms/step:         " << 1000.0 * seconds / std::max(options.steps, 1ull) << std::endl;
+    return 0;
+}
+
+static int runSoftBody(const HeadlessOptions& options) {
+    ThreadPool pool(options.threads);
+    SoftBody body;
+    if (options.scene == "beams")
+        setupBeamScene(body, options.sheets, options.resolution ? options.resolution : 40);
+    else
+        setupSoftBodyScene(body, options.sheets, options.resolution ? options.resolution : 6);
+    body.setPreconditioner(options.preconditioner);
+
+    std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+    unsigned long long iterations = 0;
+    for (unsigned long long i = 0; i < options.steps; i++) {
+        body.step(options.dt, pool);
+        iterations += body.getSolver().getIterations();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+    std::cout << "threads:         " << pool.getThreadCount() << std::endl;
+    std::cout << "nodes:           " << body.getNodeCount() << std::endl;
+    std::cout << "elements:        " << body.getElementCount() << (body.getDimension() == 2 ? " triangles" : " tetrahedra") << std::endl;
+    std::cout << "nonzeros:        " << body.getMatrix().getNonZeroCount() << std::endl;
+    std::cout << "preconditioner:  " << body.getPreconditioner().getName() << std::endl;
+    std::cout << "cg iters/step:   " << iterations / (double) std::max(options.steps, 1ull) << std::endl;
+    std::cout << "residual:        " << body.getSolver().getResidual() << " (last step)" << std::endl;
+    std::cout << "steps:           " << body.getStepCount() << std::endl;
+    std::cout << "seconds:         " << seconds << std::endl;
+    std::cout << "steps/s:         " << options.steps / seconds << std::endl;
+    return 0;
+}
+
+static int runMolecular(const HeadlessOptions& options) {
+    ThreadPool pool(options.threads);
+    MolecularDynamics md;
+    setupMolecularScene(md, options.bodies, options.scene == "morse" ? PairPotential::Morse : PairPotential::LennardJones, options.seed);
+    if (options.skin >= 0.0f)
+        md.setSkin(options.skin);
+    md.setTabulation(options.table);
+
+    md.step(options.dt, pool);
+    double startEnergy = md.getPotentialEnergy() + md.getKineticEnergy();
+    unsigned int startRebuilds = md.getRebuilds();
+    std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+    unsigned long long substeps = 0;
+    for (unsigned long long i = 0; i < options.steps; i++) {
+        md.step(options.dt, pool);
+        substeps += md.getSubsteps();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+    double count = std::max(md.getParticleCount(), 1u);
+    double energy = md.getPotentialEnergy() + md.getKineticEnergy();
+    std::cout << "simd:            " << simdLevelName(getSimdLevel()) << std::endl;
+    std::cout << "threads:         " << pool.getThreadCount() << std::endl;
+    std::cout << "potential:       " << (md.getPotential() == PairPotential::Morse ? "morse" : "lennard-jones") << std::endl;
+    if (md.isTabulated()) {
+        const PairTable& table = md.getTable();
+        std::cout << "table:           " << table.getSegments() << " segments, " << table.getBytes() / 1024 << " KiB, max error force "
+            << table.getError().force << " (r " << table.getError().forceRadius << ") energy "
+            << table.getError().energy << " (r " << table.getError().energyRadius << ")" << std::endl;
+    }
+    std::cout << "atoms:           " << md.getParticleCount() << std::endl;
+    std::cout << "box:             " << md.getBox().length[0] << std::endl;
+    std::cout << "neighbors:       " << md.getNeighborCount() / count << " per atom (cutoff " << md.getCutoff() << " + skin " << md.getSkin() << ")" << std::endl;
+    std::cout << "list rebuilds:   " << md.getRebuilds() - startRebuilds << " in " << substeps << " substeps" << std::endl;
+    std::cout << "temperature:     " << md.getTemperature() << std::endl;
+    std::cout << "energy/atom:     " << energy / count << " (drift " << (energy - startEnergy) / count << ")" << std::endl;
+    std::cout << "steps:           " << md.getStepCount() << std::endl;
+    std::cout << "seconds:         " << seconds << std::endl;
+    std::cout << "steps/s:         " << options.steps / seconds << std::endl;
+    std::cout << "atom-substeps/s: " << substeps * count / seconds << std::endl;
+    return 0;
+}
+
+static int runGranular(const HeadlessOptions& options) {
+    ThreadPool pool(options.threads);
+    DemSystem dem;
+    setupHopperScene(dem, options.bodies, options.contact, options.seed);
+    if (options.skin >= 0.0f)
+        dem.setSkin(options.skin);
+    // grains below the lowest hopper wall have been discharged
+    float outlet = dem.getBox()[1];
+    for (const DemWall& wall : dem.getWalls())
+        outlet = std::min(outlet, wall.bottom);
+
+    std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+    unsigned long long substeps = 0;
+    for (unsigned long long i = 0; i < options.steps; i++) {
+        dem.step(options.dt, pool);
+        substeps += dem.getSubsteps();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+    const ParticleStore& particles = dem.getParticles();
+    unsigned int discharged = 0;
+    for (size_t i = 0; i < particles.size(); i++)
+        discharged += particles.py[i] < outlet ? 1 : 0;
+    double count = std::max(dem.getParticleCount(), 1u);
+    std::cout << "threads:         " << pool.getThreadCount() << std::endl;
+    std::cout << "contact model:   " << (dem.getModel() == ContactModel::HertzMindlin ? "hertz-mindlin" : "spring-dashpot") << std::endl;
+    std::cout << "grains:          " << dem.getParticleCount() << " (radius " << (particles.size() ? particles.radius[0] : 0.0f) << ")" << std::endl;
+    std::cout << "time step:       " << dem.getTimeStep() << " (" << substeps << " substeps)" << std::endl;
+    std::cout << "neighbors:       " << dem.getNeighborCount() / count << " per grain" << std::endl;
+    std::cout << "contacts:        " << 2.0 * dem.getContactCount() / count << " per grain" << std::endl;
+    std::cout << "contact table:   " << dem.getContactTableBytes() / (1024.0 * 1024.0) << " MiB (" << dem.getContactTableBytes() / count << " bytes per grain)" << std::endl;
+    std::cout << "list rebuilds:   " << dem.getRebuilds() << std::endl;
+    std::cout << "discharged:      " << discharged << " (" << 100.0 * discharged / count << "%)" << std::endl;
+    std::cout << "kinetic energy:  " << dem.getKineticEnergy() << std::endl;
+    std::cout << "steps:           " << dem.getStepCount() << std::endl;
+    std::cout << "seconds:         " << seconds << std::endl;
+    std::cout << "steps/s:         " << options.steps / seconds << std::endl;
+    std::cout << "grain-substeps/s: " << substeps * count / seconds << std::endl;
+    return 0;
+}
+
+static int runCluster(const HeadlessOptions& options) {
+    ThreadPool pool(options.threads);
+    NBodySystem nbody;
+    setupClusterScene(nbody, options.bodies, options.binaries, options.seed);
+    nbody.setIntegrator(options.nbody);
+    nbody.setBlockSteps(options.blocks);
+    nbody.setAccuracy(options.accuracy);
+    nbody.setTolerance(options.tolerance);
+    double energyStart = nbody.computeEnergy(pool);
+
+    std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < options.steps; i++)
+        nbody.step(options.dt, pool);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+    double energyEnd = nbody.computeEnergy(pool);
+    std::cout << "simd:            " << simdLevelName(getSimdLevel()) << std::endl;
+    std::cout << "threads:         " << pool.getThreadCount() << std::endl;
+    bool adaptive = nbody.getIntegrator() == NBodyIntegrator::DormandPrince;
+    std::cout << "integrator:      " << (adaptive ? "rk45 (adaptive shared step)" :
+        nbody.getIntegrator() == NBodyIntegrator::Hermite ? "hermite" : "leapfrog")
+        << (adaptive ? "" : nbody.getBlockSteps() ? " (block steps)" : " (shared step)") << std::endl;
+    std::cout << "bodies:          " << nbody.size() << " (" << std::min(options.binaries, options.bodies / 2) << " binaries)" << std::endl;
+    if (adaptive) {
+        const DormandPrince& rk = nbody.getAdaptive();
+        std::cout << "rk steps:        " << rk.getAccepted() << " accepted, " << rk.getRejected() << " rejected, next " << rk.getStep() << std::endl;
+    }
+    else {
+        std::cout << "levels:          ";
+        for (unsigned int level = 0; level <= NBodySystem::MaxLevel; level++) {
+            if (nbody.getLevelCount(level))
+                std::cout << level << ":" << nbody.getLevelCount(level) << " ";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "energy error:    " << (energyEnd - energyStart) / std::fabs(energyStart) << std::endl;
+    std::cout << "force events:    " << nbody.getEventCount() << std::endl;
+    std::cout << "evaluations:     " << nbody.getEvaluations() << " (" << nbody.getEvaluations() / (double) nbody.size() << " per body)" << std::endl;
+    if (!adaptive)
+        std::cout << "shared step:     " << nbody.getSharedEvaluations() << " evaluations at the deepest level of each block" << std::endl;
+    std::cout << "steps:           " << nbody.getStepCount() << std::endl;
+    std::cout << "seconds:         " << seconds << std::endl;
+    std::cout << "steps/s:         " << options.steps / seconds << std::endl;
+    std::cout << "interactions/s:  " << nbody.getEvaluations() * (double) nbody.size() / seconds << std::endl;
+    return 0;
+}
+
+static void runOrbits(const HeadlessOptions& options, StatePrecision precision, ThreadPool& pool) {
+    FieldSystem field;
+    setupOrbitScene(field, options.bodies, options.scheme, options.dimensions, options.seed);
+    if (options.field != field.getLaw() || precision != field.getPrecision())
+        field.configure(field.getScheme(), field.getDimensions(), options.field, field.getParameters(), precision);
+    double energyStart = field.computeEnergy(pool);
+
+    std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < options.steps; i++)
+        field.step(options.dt, pool);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+    double energyEnd = field.computeEnergy(pool);
+    static const char* schemes[] = { "explicit euler", "semi-implicit euler", "velocity verlet", "rk4" };
+    static const char* laws[] = { "uniform", "point mass", "harmonic" };
+    static const char* precisions[] = { "single", "mixed" };
+    std::cout << "kernel:          " << schemes[(int) field.getScheme()] << ", " << field.getDimensions() << "d, "
+        << laws[(int) field.getLaw()] << ", " << precisions[(int) field.getPrecision()] << " precision" << std::endl;
+    std::cout << "particles:       " << field.getParticles().size() << std::endl;
+    std::cout << "energy error:    " << (energyEnd - energyStart) / std::fabs(energyStart) << std::endl;
+    std::cout << "steps:           " << field.getStepCount() << std::endl;
+    std::cout << "seconds:         " << seconds << std::endl;
+    std::cout << "steps/s:         " << options.steps / seconds << std::endl;
+    std::cout << "particle-steps/s: " << options.steps * (double) field.getParticles().size() / seconds << std::endl;
+}
+
+static int runOrbits(const HeadlessOptions& options) {
+    ThreadPool pool(options.threads);
+    std::cout << "threads:         " << pool.getThreadCount() << std::endl;
+    if (options.bothPrecisions) {
+        runOrbits(options, StatePrecision::Single, pool);
+        std::cout << std::endl;
+        runOrbits(options, StatePrecision::Mixed, pool);
+    }
+    else
+        runOrbits(options, options.precision, pool);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    HeadlessOptions options;
+    if (!parseOptions(argc, argv, options))
+        return -1;
+    if (options.scene == "dam" || options.scene == "slosh")
+        return runFluid(options);
+    if (options.scene == "smoke")
+        return runSmoke(options);
+    if (options.scene == "cloth" || options.scene == "ropes")
+        return runCloth(options);
+    if (options.scene == "soft" || options.scene == "beams")
+        return runSoftBody(options);
+    if (options.scene == "lj" || options.scene == "morse")
+        return runMolecular(options);
+    if (options.scene == "hopper")
+        return runGranular(options);
+    if (options.scene == "cluster")
+        return runCluster(options);
+    if (options.scene == "orbits")
+        return runOrbits(options);
+
+    PhysicsWorld world;
+    world.setKeepPreviousState(false);
+    world.setIntegrator(options.integrator);
+    world.setThreadCount(options.threads);
+    world.setBroadphase(options.broadphase);
+    world.setSortInterval(options.sortInterval);
+    world.setSolverMode(options.solver);
+    world.setSolverIterations(options.iterations);
+    world.setWarmStarting(options.warmStart);
+    world.setSleeping(options.sleep);
+    if (options.scene == "disk")
+        setupDiskScene(world, options.bodies, options.seed);
+    else if (options.scene == "charges")
+        setupChargeScene(world, options.bodies, options.seed);
+    else if (options.scene == "periodic")
+        setupPeriodicScene(world, options.bodies, options.grid, options.seed);
+    else
+        setupBoxScene(world, options.bodies, options.radius, options.seed);
+    if (options.forces >= 0)
+        world.setForces((ForceType) options.forces);
+    if (BarnesHut* tree = dynamic_cast<BarnesHut*>(world.getForces()))
+        tree->setOpeningAngle(options.theta);
+    if (FastMultipole* fmm = dynamic_cast<FastMultipole*>(world.getForces())) {
+        fmm->setOpeningAngle(options.theta);
+        fmm->setOrder(options.order);
+    }
+    if (ParticleMesh* mesh = dynamic_cast<ParticleMesh*>(world.getForces())) {
+        mesh->setGridSize(options.grid);
+        mesh->setAssignment(options.assignment);
+    }
+
+    std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < options.steps; i++)
+        world.step(options.dt);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - timeStart).count();
+
+    std::cout << "simd:            " << simdLevelName(getSimdLevel()) << std::endl;
+    std::cout << "threads:         " << world.getThreadPool().getThreadCount() << std::endl;
+    if (world.getBroadphase()) {
+        std::cout << "broadphase:      " << world.getBroadphase()->getName() << std::endl;
+        std::cout << "pairs:           " << world.getPairs().size() << std::endl;
+        std::cout << "contacts:        " << world.getContacts().size() << std::endl;
+        std::cout << "solver batches:  " << world.getSolver().getBatchCount() << std::endl;
+        std::cout << "islands:         " << world.getIslands().getIslandCount() << std::endl;
+        std::cout << "sleeping:        " << world.getIslands().getSleepingCount() << std::endl;
+    }
+    if (world.getForces())
+        std::cout << "forces:          " << world.getForces()->getName() << std::endl;
+    std::cout << "bodies:          " << world.getBodyCount() << std::endl;
+    std::cout << "steps:           " << world.getStepCount() << std::endl;
+    std::cout << "seconds:         " << seconds << std::endl;
+    std::cout << "steps/s:         " << options.steps / seconds << std::endl;
+    std::cout << "body-steps/s:    " << options.steps * (double) world.getBodyCount() / seconds << std::endl;
+    return 0;
+}
@@ -5,9 +5,24 @@
 #include <stdlib.h>
 #include <sstream>
 #include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
 #include "Renderer.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
+#include "StreamingTexture.h"
+#include "physics/PhysicsWorld.h"
+#include "physics/FixedTimestep.h"
+#include "physics/Scenes.h"
+#include "physics/SphFluid.h"
+#include "physics/GridFluid.h"
+#include "physics/XpbdSystem.h"
+#include "physics/SoftBody.h"
+#include "physics/MolecularDynamics.h"
+#include "physics/DemSystem.h"
+#include "physics/NBodySystem.h"
+#include "physics/FieldSystem.h"
 
 struct shaderResource {
     std::string vertexSrc;
@@ -41,6 +56,16 @@ static shaderResource readShaders(std::string filepath) {
 
 
 
+// writes the corners of a box centered on (x, y) in the same order as the original square
+static void fillQuad(float* verticies, float x, float y, float halfWidth, float halfHeight) {
+    float left = x - halfWidth, right = x + halfWidth;
+    float bottom = y - halfHeight, top = y + halfHeight;
+    verticies[0] = right; verticies[1] = top;
+    verticies[2] = left;  verticies[3] = bottom;
+    verticies[4] = right; verticies[5] = bottom;
+    verticies[6] = left;  verticies[7] = top;
+}
+
 static unsigned int CompileShader(unsigned int type, const std::string& source){
     unsigned int id = glCreateShader(type); // create shader and return id 
     const char* src = source.c_str();
@@ -82,7 +107,327 @@ static unsigned int createShader(const std::string& vertexShader, const std::str
     return program;
 }
 
-int main(void)
+// Frame loop shared by every scene: each frame steps the simulation as many
+// fixed steps as the wall clock owes, through step(dt), draws with draw() and
+// shows the frames of the last second in the window title.
+template<typename Step, typename Draw>
+static void runLoop(GLFWwindow* window, FixedTimestep& timestep, Step&& step, Draw&& draw) {
+    std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point lastFrame = timeStart;
+    int fps = 0;
+    while (!glfwWindowShouldClose(window)) {
+        fps++;
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        unsigned int steps = timestep.advance(std::chrono::duration<double>(now - lastFrame).count());
+        lastFrame = now;
+        for (unsigned int i = 0; i < steps; i++)
+            step(timestep.getDt());
+        draw();
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - timeStart).count() > 1000) {
+            glfwSetWindowTitle(window, std::to_string(fps).c_str());
+            timeStart = std::chrono::steady_clock::now();
+            fps = 0;
+        }
+    }
+}
+
+// Particle scenes drawn as points: one point vertex drawn instanced, each
+// instance offset by its particle's clip space xy from a second buffer that is
+// rewritten in place every frame through position(i, xy). The points are
+// pointSize wide in clip space, and never less than a pixel.
+template<typename Step, typename Position>
+static void runPoints(GLFWwindow* window, FixedTimestep& timestep, unsigned int particleCount,
+                      float red, float green, float blue, float pointSize, Step&& step, Position&& position) {
+    std::vector<float> offsets(2 * (size_t) particleCount);
+    unsigned int offsetBytes = (unsigned int) (offsets.size() * sizeof(float));
+    const float point[] = { 0.0f, 0.0f };
+
+    unsigned int vao;
+    glSafeCall(glGenVertexArrays(1, &vao));
+    glSafeCall(glBindVertexArray(vao));
+
+    VertexBuffer pointBuffer(point, sizeof(point));
+    glSafeCall(glEnableVertexAttribArray(0));
+    glSafeCall(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0));
+
+    VertexBuffer offsetBuffer(offsets.data(), offsetBytes, true);
+    glSafeCall(glEnableVertexAttribArray(1));
+    glSafeCall(glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0));
+    glSafeCall(glVertexAttribDivisor(1, 1)); // advance once per instance, not per vertex
+
+    shaderResource shaderSource = readShaders("res/basic.shader");
+    glSafeCall(unsigned int shader = createShader(shaderSource.vertexSrc, shaderSource.fragmentSrc));
+    glSafeCall(glUseProgram(shader));
+    glSafeCall(int uniformId = glGetUniformLocation(shader, "u_Color"));
+    glSafeCall(glUniform4f(uniformId, red, green, blue, 1.0f));
+
+    runLoop(window, timestep, step, [&]() {
+        for (unsigned int i = 0; i < particleCount; i++)
+            position(i, &offsets[2 * (size_t) i]);
+        offsetBuffer.Update(offsets.data(), offsetBytes);
+
+        // clip space is 2 units across the shorter side of the window
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        glSafeCall(glPointSize(std::max(1.0f, 0.5f * pointSize * std::min(width, height))));
+        glSafeCall(glDrawArraysInstanced(GL_POINTS, 0, 1, particleCount));
+    });
+    glDeleteShader(shader);
+}
+
+// Fluid scenes: the tank is 2 wide and tall, which is exactly clip space seen
+// from the front.
+static void runFluid(GLFWwindow* window, const std::string& scene, unsigned int count) {
+    ThreadPool pool;
+    SphFluid fluid;
+    if (scene == "slosh")
+        setupSloshing(fluid, count);
+    else
+        setupDamBreak(fluid, count);
+    FixedTimestep timestep(1.0f / 60.0f, 2);
+
+    const ParticleStore& particles = fluid.getParticles();
+    runPoints(window, timestep, fluid.getParticleCount(), 0.2f, 0.5f, 1.0f, fluid.getSpacing(), [&](float dt) {
+        fluid.step(dt, pool);
+    }, [&](unsigned int i, float* xy) {
+        xy[0] = particles.px[i];
+        xy[1] = particles.py[i];
+    });
+}
+
+// Molecular dynamics drawn like the fluid scenes, the periodic box seen along
+// z and stretched over the window. Every 1/60 s advances four MD time steps.
+// The atoms are re-sorted whenever the neighbor lists are rebuilt, which is
+// why the whole offset buffer is rewritten every frame.
+static void runMolecular(GLFWwindow* window, const std::string& scene, unsigned int count) {
+    ThreadPool pool;
+    MolecularDynamics md;
+    setupMolecularScene(md, count, scene == "morse" ? PairPotential::Morse : PairPotential::LennardJones, 1);
+    FixedTimestep timestep(1.0f / 60.0f, 2);
+    float boxScale = 2.0f / md.getBox().length[0];
+
+    const ParticleStore& particles = md.getParticles();
+    runPoints(window, timestep, md.getParticleCount(), 1.0f, 0.6f, 0.2f, 2.0f * particles.radius[0] * boxScale, [&](float) {
+        md.step(4.0f * md.getTimeStep(), pool);
+    }, [&](unsigned int i, float* xy) {
+        xy[0] = particles.px[i] * boxScale - 1.0f;
+        xy[1] = particles.py[i] * boxScale - 1.0f;
+    });
+}
+
+// Granular hopper drawn like the fluid scenes, the box seen from the front with
+// its height over the window. Every 1/60 s advances 1/60 s of flow, in as many
+// substeps as the contacts need.
+static void runGranular(GLFWwindow* window, unsigned int count) {
+    ThreadPool pool;
+    DemSystem dem;
+    setupHopperScene(dem, count, ContactModel::HertzMindlin, 1);
+    FixedTimestep timestep(1.0f / 60.0f, 2);
+    float boxScale = 2.0f / dem.getBox()[1];
+    float boxLeft = -0.5f * dem.getBox()[0] * boxScale;
+
+    const ParticleStore& particles = dem.getParticles();
+    runPoints(window, timestep, dem.getParticleCount(), 0.9f, 0.8f, 0.5f, 2.0f * particles.radius[0] * boxScale, [&](float dt) {
+        dem.step(dt, pool);
+    }, [&](unsigned int i, float* xy) {
+        xy[0] = particles.px[i] * boxScale + boxLeft;
+        xy[1] = particles.py[i] * boxScale - 1.0f;
+    });
+}
+
+// Star cluster seen down the z axis, the half-mass radius about a fifth of the
+// window and every star about two pixels of the default window. Every fixed
+// 1/60 s tick is one block of 1/60 time units: the tightest binaries step a
+// thousand times inside it while most stars take one or two.
+static void runCluster(GLFWwindow* window, unsigned int count) {
+    ThreadPool pool;
+    NBodySystem nbody;
+    setupClusterScene(nbody, count, count / 20, 1);
+    FixedTimestep timestep(1.0f / 60.0f, 2);
+    const float viewScale = 0.5f;
+
+    runPoints(window, timestep, (unsigned int) nbody.size(), 1.0f, 0.95f, 0.8f, 0.01f, [&](float dt) {
+        nbody.step(dt, pool);
+    }, [&](unsigned int i, float* xy) {
+        xy[0] = (float) nbody.getX()[i] * viewScale;
+        xy[1] = (float) nbody.getY()[i] * viewScale;
+    });
+}
+
+// Test particles around a point mass, drawn straight from their positions:
+// the vertex attribute takes as many components as the system has dimensions
+// and the instance offset stays at its default of zero. In 3d z only tilts the
+// view, there is no depth test.
+static void runOrbits(GLFWwindow* window, unsigned int count, unsigned int dimensions) {
+    ThreadPool pool;
+    FieldSystem field;
+    setupOrbitScene(field, count, StepScheme::VelocityVerlet, dimensions, 1);
+    FixedTimestep timestep(1.0f / 120.0f, 4);
+    dimensions = field.getDimensions();
+
+    const ParticleStore& particles = field.getParticles();
+    unsigned int particleCount = (unsigned int) particles.size();
+    std::vector<float> positions(dimensions * (size_t) particleCount);
+    unsigned int positionBytes = (unsigned int) (positions.size() * sizeof(float));
+
+    unsigned int vao;
+    glSafeCall(glGenVertexArrays(1, &vao));
+    glSafeCall(glBindVertexArray(vao));
+
+    VertexBuffer positionBuffer(positions.data(), positionBytes, true);
+    glSafeCall(glEnableVertexAttribArray(0));
+    glSafeCall(glVertexAttribPointer(0, dimensions, GL_FLOAT, GL_FALSE, dimensions * sizeof(float), 0));
+
+    shaderResource shaderSource = readShaders("res/basic.shader");
+    glSafeCall(unsigned int shader = createShader(shaderSource.vertexSrc, shaderSource.fragmentSrc));
+    glSafeCall(glUseProgram(shader));
+    glSafeCall(int uniformId = glGetUniformLocation(shader, "u_Color"));
+    glSafeCall(glUniform4f(uniformId, 0.7f, 0.85f, 1.0f, 1.0f));
+    glSafeCall(glPointSize(1.0f));
+
+    runLoop(window, timestep, [&](float dt) {
+        field.step(dt, pool);
+    }, [&]() {
+        const float* p[3] = { particles.px.data(), particles.py.data(), particles.pz.data() };
+        for (unsigned int i = 0; i < particleCount; i++) {
+            for (unsigned int d = 0; d < dimensions; d++)
+                positions[dimensions * (size_t) i + d] = p[d][i];
+        }
+        positionBuffer.Update(positions.data(), positionBytes);
+        glSafeCall(glDrawArrays(GL_POINTS, 0, particleCount));
+    });
+    glDeleteShader(shader);
+}
+
+// Smoke on an n x n grid drawn as one textured quad over the window; the
+// texture is streamed through pixel buffers so the upload never stalls the loop.
+static void runSmoke(GLFWwindow* window, unsigned int size) {
+    ThreadPool pool;
+    GridFluid fluid;
+    fluid.resize(size);
+    FixedTimestep timestep(1.0f / 60.0f, 2);
+
+    const float corners[] = { -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f };
+    const unsigned int indicies[] = { 0, 1, 2, 2, 3, 0 };
+
+    unsigned int vao;
+    glSafeCall(glGenVertexArrays(1, &vao));
+    glSafeCall(glBindVertexArray(vao));
+    VertexBuffer vb(corners, sizeof(corners));
+    glSafeCall(glEnableVertexAttribArray(0));
+    glSafeCall(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0));
+    IndexBuffer ib(indicies, 6);
+
+    StreamingTexture texture(fluid.getSize(), fluid.getSize());
+    shaderResource shaderSource = readShaders("res/texture.shader");
+    glSafeCall(unsigned int shader = createShader(shaderSource.vertexSrc, shaderSource.fragmentSrc));
+    glSafeCall(glUseProgram(shader));
+    glSafeCall(glUniform1i(glGetUniformLocation(shader, "u_Texture"), 0));
+    glSafeCall(glUniform4f(glGetUniformLocation(shader, "u_Color"), 0.9f, 0.9f, 1.0f, 1.0f));
+
+    runLoop(window, timestep, [&](float dt) {
+        fluid.step(dt, pool);
+    }, [&]() {
+        texture.Update(fluid.getDensity().data());
+        glSafeCall(glDrawElements(GL_TRIANGLES, ib.getCount(), GL_UNSIGNED_INT, nullptr));
+    });
+    glDeleteShader(shader);
+}
+
+// Cloth and ropes drawn as lines seen from the front; the edge list never
+// changes, so only the vertex buffer is rewritten in place every frame.
+static void runCloth(GLFWwindow* window, const std::string& scene, unsigned int count) {
+    ThreadPool pool;
+    XpbdSystem cloth;
+    if (scene == "ropes")
+        setupRopeScene(cloth, count, 64);
+    else
+        setupClothScene(cloth, count, 100);
+    FixedTimestep timestep(1.0f / 60.0f, 2);
+
+    unsigned int particleCount = cloth.getParticleCount();
+    std::vector<float> verticies(2 * (size_t) particleCount);
+    unsigned int vertexBytes = (unsigned int) (verticies.size() * sizeof(float));
+
+    unsigned int vao;
+    glSafeCall(glGenVertexArrays(1, &vao));
+    glSafeCall(glBindVertexArray(vao));
+    VertexBuffer vb(verticies.data(), vertexBytes, true);
+    glSafeCall(glEnableVertexAttribArray(0));
+    glSafeCall(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0));
+    IndexBuffer ib(cloth.getLines().data(), (unsigned int) cloth.getLines().size());
+
+    shaderResource shaderSource = readShaders("res/basic.shader");
+    glSafeCall(unsigned int shader = createShader(shaderSource.vertexSrc, shaderSource.fragmentSrc));
+    glSafeCall(glUseProgram(shader));
+    glSafeCall(glUniform4f(glGetUniformLocation(shader, "u_Color"), 0.9f, 0.6f, 0.3f, 1.0f));
+
+    runLoop(window, timestep, [&](float dt) {
+        cloth.step(dt, pool);
+    }, [&]() {
+        const float* x = cloth.getX().data();
+        const float* y = cloth.getY().data();
+        for (unsigned int i = 0; i < particleCount; i++) {
+            verticies[2 * (size_t) i] = x[i];
+            verticies[2 * (size_t) i + 1] = y[i];
+        }
+        vb.Update(verticies.data(), vertexBytes);
+        glSafeCall(glDrawElements(GL_LINES, ib.getCount(), GL_UNSIGNED_INT, nullptr));
+    });
+    glDeleteShader(shader);
+}
+
+// Soft bodies drawn as their element edges seen from the front, like cloth.
+static void runSoftBody(GLFWwindow* window, const std::string& scene, unsigned int count) {
+    ThreadPool pool;
+    SoftBody body;
+    if (scene == "beams")
+        setupBeamScene(body, count, 40);
+    else
+        setupSoftBodyScene(body, count, 6);
+    FixedTimestep timestep(1.0f / 60.0f, 2);
+
+    unsigned int nodeCount = body.getNodeCount();
+    std::vector<float> verticies(2 * (size_t) nodeCount);
+    unsigned int vertexBytes = (unsigned int) (verticies.size() * sizeof(float));
+
+    unsigned int vao;
+    glSafeCall(glGenVertexArrays(1, &vao));
+    glSafeCall(glBindVertexArray(vao));
+    VertexBuffer vb(verticies.data(), vertexBytes, true);
+    glSafeCall(glEnableVertexAttribArray(0));
+    glSafeCall(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0));
+    IndexBuffer ib(body.getLines().data(), (unsigned int) body.getLines().size());
+
+    shaderResource shaderSource = readShaders("res/basic.shader");
+    glSafeCall(unsigned int shader = createShader(shaderSource.vertexSrc, shaderSource.fragmentSrc));
+    glSafeCall(glUseProgram(shader));
+    glSafeCall(glUniform4f(glGetUniformLocation(shader, "u_Color"), 0.8f, 0.3f, 0.5f, 1.0f));
+
+    runLoop(window, timestep, [&](float dt) {
+        body.step(dt, pool);
+    }, [&]() {
+        const float* x = body.getX().data();
+        const float* y = body.getY().data();
+        for (unsigned int i = 0; i < nodeCount; i++) {
+            verticies[2 * (size_t) i] = x[i];
+            verticies[2 * (size_t) i + 1] = y[i];
+        }
+        vb.Update(verticies.data(), vertexBytes);
+        glSafeCall(glDrawElements(GL_LINES, ib.getCount(), GL_UNSIGNED_INT, nullptr));
+    });
+    glDeleteShader(shader);
+}
+
+// usage: "Physics Sim" [square | disk [bodies] | dam [particles] | slosh [particles] | smoke [grid size]
+//                       | cloth [sheets] | ropes [ropes] | soft [cubes] | beams [beams] | lj [atoms] | morse [atoms]
+//                       | hopper [grains] | cluster [stars] | orbits [particles [2 | 3]]]
+int main(int argc, char** argv)
 {
     GLFWwindow* window;
     
@@ -111,28 +456,79 @@ int main(void)
     }
      
     std::cout << glGetString(GL_VERSION) << std::endl;
+    std::string scene = argc > 1 ? argv[1] : "square";
+    if (scene == "dam" || scene == "slosh") {
+        runFluid(window, scene, argc > 2 ? (unsigned int) std::strtoul(argv[2], nullptr, 10) : 20000);
+        glfwTerminate();
+        return 0;
+    }
+    if (scene == "smoke") {
+        runSmoke(window, argc > 2 ? (unsigned int) std::strtoul(argv[2], nullptr, 10) : 256);
+        glfwTerminate();
+        return 0;
+    }
+    if (scene == "cloth" || scene == "ropes") {
+        runCloth(window, scene, argc > 2 ? (unsigned int) std::strtoul(argv[2], nullptr, 10) : 12);
+        glfwTerminate();
+        return 0;
+    }
+    if (scene == "hopper") {
+        runGranular(window, argc > 2 ? (unsigned int) std::strtoul(argv[2], nullptr, 10) : 20000);
+        glfwTerminate();
+        return 0;
+    }
+    if (scene == "cluster") {
+        runCluster(window, argc > 2 ? (unsigned int) std::strtoul(argv[2], nullptr, 10) : 1000);
+        glfwTerminate();
+        return 0;
+    }
+    if (scene == "orbits") {
+        runOrbits(window, argc > 2 ? (unsigned int) std::strtoul(argv[2], nullptr, 10) : 100000,
+            argc > 3 ? (unsigned int) std::strtoul(argv[3], nullptr, 10) : 2);
+        glfwTerminate();
+        return 0;
+    }
+    if (scene == "lj" || scene == "morse") {
+        runMolecular(window, scene, argc > 2 ? (unsigned int) std::strtoul(argv[2], nullptr, 10) : 4000);
+        glfwTerminate();
+        return 0;
+    }
+    if (scene == "soft" || scene == "beams") {
+        runSoftBody(window, scene, argc > 2 ? (unsigned int) std::strtoul(argv[2], nullptr, 10) : 4);
+        glfwTerminate();
+        return 0;
+    }
     {
-        float verticies[8] = {
-             0.0f, 1.0f,
-            -1.0f, 0.0f,
-             0.0f, 0.0f, 
-            -1.0f, 1.0f 
-        };
-    
-        unsigned int indicies[] = {
-            1, 2, 0,
-            1, 0, 3
-        };
+        PhysicsWorld world;
+        if (scene == "disk")
+            setupDiskScene(world, argc > 2 ? (unsigned int) std::strtoul(argv[2], nullptr, 10) : 20000, 1);
+        else
+            world.addBody({ -0.5f, 0.5f, 0.0f, 0.4f, 0.0f, 0.0f, 0.5f, 1.0f });
+        FixedTimestep timestep(1.0f / 120.0f, 8);
+
+        // one quad per body, seen from above with z dropped
+        unsigned int bodyCount = world.getBodyCount();
+        std::vector<float> verticies(8 * (size_t) bodyCount);
+        std::vector<unsigned int> indicies(6 * (size_t) bodyCount);
+        const unsigned int quad[] = { 1, 2, 0, 1, 0, 3 };
+        for (unsigned int i = 0; i < bodyCount; i++) {
+            float halfSize = world.getParticles().radius[i];
+            fillQuad(&verticies[8 * (size_t) i], world.getParticles().px[i], world.getParticles().py[i], halfSize, halfSize);
+            for (int k = 0; k < 6; k++)
+                indicies[6 * (size_t) i + k] = 4 * i + quad[k];
+        }
+        unsigned int vertexBytes = (unsigned int) (verticies.size() * sizeof(float));
+
         unsigned int vao; // vertex array object
         glSafeCall(glGenVertexArrays(1, &vao)); // get id for vertex array
         glSafeCall(glBindVertexArray(vao)); // bind vertex array 
     
-        VertexBuffer vb(verticies, sizeof(verticies));
+        VertexBuffer vb(verticies.data(), vertexBytes, true); // rewritten every frame from the physics state
 
         glSafeCall(glEnableVertexAttribArray(0)); //enable vertex attribute
         glSafeCall(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0));
     
-        IndexBuffer ib(indicies, 6);
+        IndexBuffer ib(indicies.data(), (unsigned int) indicies.size());
 
         shaderResource shaderSource = readShaders("res/basic.shader"); // read from "res/basic.shader" for shaders 
     
@@ -141,39 +537,30 @@ int main(void)
 
         glSafeCall(int uniformId = glGetUniformLocation(shader, "u_Color"));
         glSafeCall(glUniform4f(uniformId, 0.3f, 1.0f, 0.6f, 1.0f));
-        float increment = -0.05f;
+        float increment = -0.025f; // per physics step, so the pulse rate doesn't follow the refresh rate
         float b = 1.0;
-        std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
-        int fps = 0;
-        /* Loop until the user closes the window */
-        while (!glfwWindowShouldClose(window)){
-            fps++;
-            /* Render here */
-            glClear(GL_COLOR_BUFFER_BIT);
+        runLoop(window, timestep, [&](float dt) {
+            world.step(dt);
 
             if (b >= 1)
-                increment = -0.05f;
+                increment = -0.025f;
             else if (b <= 0)
-                increment = 0.05f;
-    
-            b += increment;
-    
-            glSafeCall(glUniform4f(uniformId, 0.3f, 0.6f, b, 1.0f));
+                increment = 0.025f;
 
+            b += increment;
+        }, [&]() {
+            // draw between the last two physics states so motion is smooth at any refresh rate
+            float x, y, z;
+            for (unsigned int i = 0; i < bodyCount; i++) {
+                world.getInterpolatedPosition(i, timestep.getAlpha(), x, y, z);
+                float halfSize = world.getParticles().radius[i];
+                fillQuad(&verticies[8 * (size_t) i], x, y, halfSize, halfSize);
+            }
+            vb.Update(verticies.data(), vertexBytes);
 
+            glSafeCall(glUniform4f(uniformId, 0.3f, 0.6f, b, 1.0f));
             glSafeCall(glDrawElements(GL_TRIANGLES, ib.getCount(), GL_UNSIGNED_INT, nullptr)); // ibo is already bound so we can use nullptr
-    
-            /* Swap front and back buffers */
-            glfwSwapBuffers(window);
-
-            /* Poll for and process events */
-            glfwPollEvents();
-            if(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-timeStart).count() > 1000){
-               glfwSetWindowTitle(window, std::to_string(fps).c_str());
-                timeStart = std::chrono::steady_clock::now();
-                fps = 0;
-            }
-        }
+        });
         glDeleteShader(shader);
     }
     glfwTerminate();
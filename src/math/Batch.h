@@ -0,0 +1,367 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "../physics/Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+#endif
+
+// Batch (structure of arrays) math: FloatxN holds the same quantity for N
+// particles, one per SIMD lane, so a kernel written once against these types
+// runs on one particle (Floatx1), AVX2 (Floatx8) or AVX-512 (Floatx16).
+// Every lane type has the same interface: full and partial loads and stores
+// (first count lanes, the rest load as zero and aren't stored), arithmetic
+// and comparisons into a mask, select, min/max, mulAdd, sqrt, rsqrt, and a
+// horizontal sum.
+//
+// rsqrt starts from the hardware estimate (12 bits, 14 on AVX-512) and takes
+// one Newton step, which is within a few ulp of 1 / sqrt for positive inputs;
+// zero gives a NaN instead of infinity, so soften anything that can be zero.
+//
+// GCC and clang only inline AVX code into functions compiled for AVX, so the
+// Floatx8 and Floatx16 members carry PHYS_TARGET_AVX2 / PHYS_TARGET_AVX512 and
+// may only run where getSimdLevel() allows. Generic code on top of them
+// (kernels templated on the lane type) can't be forced inline
+// outside such a function; instead the kernel that instantiates it is marked
+// PHYS_TARGET_* PHYS_FLATTEN, which inlines the whole tree into it.
+// Unoptimized GCC and clang builds don't flatten, and calls between AVX and
+// non-AVX functions pass the lanes in different places, so kernels only use
+// the AVX lane types where PHYS_BATCH_AVX is defined and stay on Floatx1
+// otherwise.
+#if defined(PHYS_X86) && (defined(__OPTIMIZE__) || !(defined(__GNUC__) || defined(__clang__)))
+#define PHYS_BATCH_AVX 1
+#endif
+
+struct Maskx1 {
+	bool m;
+};
+
+struct Floatx1 {
+	using Mask = Maskx1;
+	static constexpr unsigned int Lanes = 1;
+	float v;
+
+	Floatx1() = default;
+	PHYS_INLINE Floatx1(float s) : v(s) {}
+
+	static PHYS_INLINE Floatx1 load(const float* p) { return p[0]; };
+	static PHYS_INLINE Floatx1 loadPartial(const float* p, size_t count) { return count ? p[0] : 0.0f; };
+	static PHYS_INLINE Mask first(size_t count) { return { count > 0 }; };
+	// from and to float storage: the same as load and store here, double lanes convert
+	static PHYS_INLINE Floatx1 loadFloat(const float* p) { return load(p); };
+	static PHYS_INLINE Floatx1 loadFloatPartial(const float* p, size_t count) { return loadPartial(p, count); };
+	PHYS_INLINE void storeFloat(float* p) const { store(p); };
+	PHYS_INLINE void storeFloatPartial(float* p, size_t count) const { storePartial(p, count); };
+	PHYS_INLINE void store(float* p) const { p[0] = v; };
+	PHYS_INLINE void storePartial(float* p, size_t count) const { if (count) p[0] = v; };
+
+	friend PHYS_INLINE Floatx1 operator+(Floatx1 a, Floatx1 b) { return a.v + b.v; }
+	friend PHYS_INLINE Floatx1 operator-(Floatx1 a, Floatx1 b) { return a.v - b.v; }
+	friend PHYS_INLINE Floatx1 operator*(Floatx1 a, Floatx1 b) { return a.v * b.v; }
+	friend PHYS_INLINE Floatx1 operator/(Floatx1 a, Floatx1 b) { return a.v / b.v; }
+	friend PHYS_INLINE Floatx1 operator-(Floatx1 a) { return -a.v; }
+	friend PHYS_INLINE Mask operator<(Floatx1 a, Floatx1 b) { return { a.v < b.v }; }
+	friend PHYS_INLINE Mask operator<=(Floatx1 a, Floatx1 b) { return { a.v <= b.v }; }
+	friend PHYS_INLINE Mask operator>(Floatx1 a, Floatx1 b) { return { a.v > b.v }; }
+	friend PHYS_INLINE Mask operator>=(Floatx1 a, Floatx1 b) { return { a.v >= b.v }; }
+	friend PHYS_INLINE Mask operator==(Floatx1 a, Floatx1 b) { return { a.v == b.v }; }
+};
+
+PHYS_INLINE Maskx1 operator&(Maskx1 a, Maskx1 b) { return { a.m && b.m }; }
+PHYS_INLINE Maskx1 operator|(Maskx1 a, Maskx1 b) { return { a.m || b.m }; }
+PHYS_INLINE Maskx1 operator~(Maskx1 a) { return { !a.m }; }
+PHYS_INLINE bool any(Maskx1 a) { return a.m; }
+PHYS_INLINE bool all(Maskx1 a) { return a.m; }
+PHYS_INLINE Floatx1 select(Maskx1 mask, Floatx1 a, Floatx1 b) { return mask.m ? a : b; }
+PHYS_INLINE Floatx1 min(Floatx1 a, Floatx1 b) { return a.v < b.v ? a : b; }
+PHYS_INLINE Floatx1 max(Floatx1 a, Floatx1 b) { return a.v > b.v ? a : b; }
+PHYS_INLINE Floatx1 abs(Floatx1 a) { return std::fabs(a.v); }
+PHYS_INLINE Floatx1 mulAdd(Floatx1 a, Floatx1 b, Floatx1 c) { return a.v * b.v + c.v; }
+PHYS_INLINE Floatx1 sqrt(Floatx1 a) { return std::sqrt(a.v); }
+PHYS_INLINE Floatx1 rsqrt(Floatx1 a) { return 1.0f / std::sqrt(a.v); }
+PHYS_INLINE float reduceAdd(Floatx1 a) { return a.v; }
+
+// Double lanes for arithmetic on float storage (mixed precision): loadFloat
+// widens as many floats as there are lanes and storeFloat rounds them back.
+// Same interface as the float lanes; rsqrt is exact, a plain 1 / sqrt except
+// with AVX-512, whose 14 bit estimate reaches double precision in two Newton
+// steps.
+struct Doublex1 {
+	using Mask = Maskx1;
+	static constexpr unsigned int Lanes = 1;
+	double v;
+
+	Doublex1() = default;
+	PHYS_INLINE Doublex1(double s) : v(s) {}
+
+	static PHYS_INLINE Doublex1 load(const double* p) { return p[0]; };
+	static PHYS_INLINE Doublex1 loadPartial(const double* p, size_t count) { return count ? p[0] : 0.0; };
+	static PHYS_INLINE Doublex1 loadFloat(const float* p) { return (double) p[0]; };
+	static PHYS_INLINE Doublex1 loadFloatPartial(const float* p, size_t count) { return count ? (double) p[0] : 0.0; };
+	static PHYS_INLINE Mask first(size_t count) { return { count > 0 }; };
+	PHYS_INLINE void store(double* p) const { p[0] = v; };
+	PHYS_INLINE void storePartial(double* p, size_t count) const { if (count) p[0] = v; };
+	PHYS_INLINE void storeFloat(float* p) const { p[0] = (float) v; };
+	PHYS_INLINE void storeFloatPartial(float* p, size_t count) const { if (count) p[0] = (float) v; };
+
+	friend PHYS_INLINE Doublex1 operator+(Doublex1 a, Doublex1 b) { return a.v + b.v; }
+	friend PHYS_INLINE Doublex1 operator-(Doublex1 a, Doublex1 b) { return a.v - b.v; }
+	friend PHYS_INLINE Doublex1 operator*(Doublex1 a, Doublex1 b) { return a.v * b.v; }
+	friend PHYS_INLINE Doublex1 operator/(Doublex1 a, Doublex1 b) { return a.v / b.v; }
+	friend PHYS_INLINE Doublex1 operator-(Doublex1 a) { return -a.v; }
+	friend PHYS_INLINE Mask operator<(Doublex1 a, Doublex1 b) { return { a.v < b.v }; }
+	friend PHYS_INLINE Mask operator<=(Doublex1 a, Doublex1 b) { return { a.v <= b.v }; }
+	friend PHYS_INLINE Mask operator>(Doublex1 a, Doublex1 b) { return { a.v > b.v }; }
+	friend PHYS_INLINE Mask operator>=(Doublex1 a, Doublex1 b) { return { a.v >= b.v }; }
+	friend PHYS_INLINE Mask operator==(Doublex1 a, Doublex1 b) { return { a.v == b.v }; }
+};
+
+PHYS_INLINE Doublex1 select(Maskx1 mask, Doublex1 a, Doublex1 b) { return mask.m ? a : b; }
+PHYS_INLINE Doublex1 min(Doublex1 a, Doublex1 b) { return a.v < b.v ? a : b; }
+PHYS_INLINE Doublex1 max(Doublex1 a, Doublex1 b) { return a.v > b.v ? a : b; }
+PHYS_INLINE Doublex1 abs(Doublex1 a) { return std::fabs(a.v); }
+PHYS_INLINE Doublex1 mulAdd(Doublex1 a, Doublex1 b, Doublex1 c) { return a.v * b.v + c.v; }
+PHYS_INLINE Doublex1 sqrt(Doublex1 a) { return std::sqrt(a.v); }
+PHYS_INLINE Doublex1 rsqrt(Doublex1 a) { return 1.0 / std::sqrt(a.v); }
+PHYS_INLINE double reduceAdd(Doublex1 a) { return a.v; }
+
+#if defined(PHYS_X86)
+
+// lanes below the count are on: load 8 entries starting at 8 - count
+alignas(32) inline constexpr int32_t BatchRamp[16] = { -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+struct Maskx8 {
+	__m256 m;
+};
+
+struct Floatx8 {
+	using Mask = Maskx8;
+	static constexpr unsigned int Lanes = 8;
+	__m256 v;
+
+	Floatx8() = default;
+	PHYS_TARGET_AVX2 inline Floatx8(float s) : v(_mm256_set1_ps(s)) {}
+	PHYS_TARGET_AVX2 inline Floatx8(__m256 v) : v(v) {}
+
+	static PHYS_TARGET_AVX2 inline Floatx8 load(const float* p) { return _mm256_loadu_ps(p); };
+	static PHYS_TARGET_AVX2 inline Floatx8 loadPartial(const float* p, size_t count) { return _mm256_maskload_ps(p, _mm256_castps_si256(first(count).m)); };
+	static PHYS_TARGET_AVX2 inline Mask first(size_t count) {
+		return { _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*) (BatchRamp + 8 - (count < 8 ? count : 8)))) };
+	};
+	// from and to float storage: the same as load and store here, double lanes convert
+	static PHYS_TARGET_AVX2 inline Floatx8 loadFloat(const float* p) { return load(p); };
+	static PHYS_TARGET_AVX2 inline Floatx8 loadFloatPartial(const float* p, size_t count) { return loadPartial(p, count); };
+	PHYS_TARGET_AVX2 inline void storeFloat(float* p) const { store(p); };
+	PHYS_TARGET_AVX2 inline void storeFloatPartial(float* p, size_t count) const { storePartial(p, count); };
+	PHYS_TARGET_AVX2 inline void store(float* p) const { _mm256_storeu_ps(p, v); };
+	PHYS_TARGET_AVX2 inline void storePartial(float* p, size_t count) const { _mm256_maskstore_ps(p, _mm256_castps_si256(first(count).m), v); };
+
+	friend PHYS_TARGET_AVX2 inline Floatx8 operator+(const Floatx8& a, const Floatx8& b) { return _mm256_add_ps(a.v, b.v); }
+	friend PHYS_TARGET_AVX2 inline Floatx8 operator-(const Floatx8& a, const Floatx8& b) { return _mm256_sub_ps(a.v, b.v); }
+	friend PHYS_TARGET_AVX2 inline Floatx8 operator*(const Floatx8& a, const Floatx8& b) { return _mm256_mul_ps(a.v, b.v); }
+	friend PHYS_TARGET_AVX2 inline Floatx8 operator/(const Floatx8& a, const Floatx8& b) { return _mm256_div_ps(a.v, b.v); }
+	friend PHYS_TARGET_AVX2 inline Floatx8 operator-(const Floatx8& a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+	friend PHYS_TARGET_AVX2 inline Mask operator<(const Floatx8& a, const Floatx8& b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+	friend PHYS_TARGET_AVX2 inline Mask operator<=(const Floatx8& a, const Floatx8& b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+	friend PHYS_TARGET_AVX2 inline Mask operator>(const Floatx8& a, const Floatx8& b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+	friend PHYS_TARGET_AVX2 inline Mask operator>=(const Floatx8& a, const Floatx8& b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+	friend PHYS_TARGET_AVX2 inline Mask operator==(const Floatx8& a, const Floatx8& b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ) }; }
+};
+
+PHYS_TARGET_AVX2 inline Maskx8 operator&(const Maskx8& a, const Maskx8& b) { return { _mm256_and_ps(a.m, b.m) }; }
+PHYS_TARGET_AVX2 inline Maskx8 operator|(const Maskx8& a, const Maskx8& b) { return { _mm256_or_ps(a.m, b.m) }; }
+PHYS_TARGET_AVX2 inline Maskx8 operator~(const Maskx8& a) { return { _mm256_xor_ps(a.m, _mm256_castsi256_ps(_mm256_set1_epi32(-1))) }; }
+PHYS_TARGET_AVX2 inline bool any(const Maskx8& a) { return _mm256_movemask_ps(a.m) != 0; }
+PHYS_TARGET_AVX2 inline bool all(const Maskx8& a) { return _mm256_movemask_ps(a.m) == 0xff; }
+PHYS_TARGET_AVX2 inline Floatx8 select(const Maskx8& mask, const Floatx8& a, const Floatx8& b) { return _mm256_blendv_ps(b.v, a.v, mask.m); }
+PHYS_TARGET_AVX2 inline Floatx8 min(const Floatx8& a, const Floatx8& b) { return _mm256_min_ps(a.v, b.v); }
+PHYS_TARGET_AVX2 inline Floatx8 max(const Floatx8& a, const Floatx8& b) { return _mm256_max_ps(a.v, b.v); }
+PHYS_TARGET_AVX2 inline Floatx8 abs(const Floatx8& a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+PHYS_TARGET_AVX2 inline Floatx8 mulAdd(const Floatx8& a, const Floatx8& b, const Floatx8& c) { return _mm256_fmadd_ps(a.v, b.v, c.v); }
+PHYS_TARGET_AVX2 inline Floatx8 sqrt(const Floatx8& a) { return _mm256_sqrt_ps(a.v); }
+PHYS_TARGET_AVX2 inline Floatx8 rsqrt(const Floatx8& a) {
+	__m256 y = _mm256_rsqrt_ps(a.v);
+	__m256 ayy = _mm256_mul_ps(_mm256_mul_ps(a.v, y), y);
+	return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), y), _mm256_sub_ps(_mm256_set1_ps(3.0f), ayy));
+}
+PHYS_TARGET_AVX2 inline float reduceAdd(const Floatx8& a) {
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+	__m128 pairs = _mm_add_ps(half, _mm_movehl_ps(half, half));
+	return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+}
+
+struct Maskx16 {
+	__mmask16 m;
+};
+
+struct Floatx16 {
+	using Mask = Maskx16;
+	static constexpr unsigned int Lanes = 16;
+	__m512 v;
+
+	Floatx16() = default;
+	PHYS_TARGET_AVX512 inline Floatx16(float s) : v(_mm512_set1_ps(s)) {}
+	PHYS_TARGET_AVX512 inline Floatx16(__m512 v) : v(v) {}
+
+	static PHYS_TARGET_AVX512 inline Floatx16 load(const float* p) { return _mm512_loadu_ps(p); };
+	static PHYS_TARGET_AVX512 inline Floatx16 loadPartial(const float* p, size_t count) { return _mm512_maskz_loadu_ps(first(count).m, p); };
+	static PHYS_TARGET_AVX512 inline Mask first(size_t count) {
+		return { (__mmask16) (count < 16 ? (1u << count) - 1 : 0xffffu) };
+	};
+	// from and to float storage: the same as load and store here, double lanes convert
+	static PHYS_TARGET_AVX512 inline Floatx16 loadFloat(const float* p) { return load(p); };
+	static PHYS_TARGET_AVX512 inline Floatx16 loadFloatPartial(const float* p, size_t count) { return loadPartial(p, count); };
+	PHYS_TARGET_AVX512 inline void storeFloat(float* p) const { store(p); };
+	PHYS_TARGET_AVX512 inline void storeFloatPartial(float* p, size_t count) const { storePartial(p, count); };
+	PHYS_TARGET_AVX512 inline void store(float* p) const { _mm512_storeu_ps(p, v); };
+	PHYS_TARGET_AVX512 inline void storePartial(float* p, size_t count) const { _mm512_mask_storeu_ps(p, first(count).m, v); };
+
+	friend PHYS_TARGET_AVX512 inline Floatx16 operator+(const Floatx16& a, const Floatx16& b) { return _mm512_add_ps(a.v, b.v); }
+	friend PHYS_TARGET_AVX512 inline Floatx16 operator-(const Floatx16& a, const Floatx16& b) { return _mm512_sub_ps(a.v, b.v); }
+	friend PHYS_TARGET_AVX512 inline Floatx16 operator*(const Floatx16& a, const Floatx16& b) { return _mm512_mul_ps(a.v, b.v); }
+	friend PHYS_TARGET_AVX512 inline Floatx16 operator/(const Floatx16& a, const Floatx16& b) { return _mm512_div_ps(a.v, b.v); }
+	friend PHYS_TARGET_AVX512 inline Floatx16 operator-(const Floatx16& a) {
+		return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a.v), _mm512_set1_epi32((int) 0x80000000u)));
+	}
+	friend PHYS_TARGET_AVX512 inline Mask operator<(const Floatx16& a, const Floatx16& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ) }; }
+	friend PHYS_TARGET_AVX512 inline Mask operator<=(const Floatx16& a, const Floatx16& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ) }; }
+	friend PHYS_TARGET_AVX512 inline Mask operator>(const Floatx16& a, const Floatx16& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ) }; }
+	friend PHYS_TARGET_AVX512 inline Mask operator>=(const Floatx16& a, const Floatx16& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ) }; }
+	friend PHYS_TARGET_AVX512 inline Mask operator==(const Floatx16& a, const Floatx16& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ) }; }
+};
+
+PHYS_TARGET_AVX512 inline Maskx16 operator&(const Maskx16& a, const Maskx16& b) { return { (__mmask16) (a.m & b.m) }; }
+PHYS_TARGET_AVX512 inline Maskx16 operator|(const Maskx16& a, const Maskx16& b) { return { (__mmask16) (a.m | b.m) }; }
+PHYS_TARGET_AVX512 inline Maskx16 operator~(const Maskx16& a) { return { (__mmask16) ~a.m }; }
+PHYS_TARGET_AVX512 inline bool any(const Maskx16& a) { return a.m != 0; }
+PHYS_TARGET_AVX512 inline bool all(const Maskx16& a) { return a.m == 0xffff; }
+PHYS_TARGET_AVX512 inline Floatx16 select(const Maskx16& mask, const Floatx16& a, const Floatx16& b) { return _mm512_mask_blend_ps(mask.m, b.v, a.v); }
+PHYS_TARGET_AVX512 inline Floatx16 min(const Floatx16& a, const Floatx16& b) { return _mm512_min_ps(a.v, b.v); }
+PHYS_TARGET_AVX512 inline Floatx16 max(const Floatx16& a, const Floatx16& b) { return _mm512_max_ps(a.v, b.v); }
+PHYS_TARGET_AVX512 inline Floatx16 abs(const Floatx16& a) { return _mm512_abs_ps(a.v); }
+PHYS_TARGET_AVX512 inline Floatx16 mulAdd(const Floatx16& a, const Floatx16& b, const Floatx16& c) { return _mm512_fmadd_ps(a.v, b.v, c.v); }
+PHYS_TARGET_AVX512 inline Floatx16 sqrt(const Floatx16& a) { return _mm512_sqrt_ps(a.v); }
+PHYS_TARGET_AVX512 inline Floatx16 rsqrt(const Floatx16& a) {
+	__m512 y = _mm512_rsqrt14_ps(a.v);
+	__m512 ayy = _mm512_mul_ps(_mm512_mul_ps(a.v, y), y);
+	return _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), y), _mm512_sub_ps(_mm512_set1_ps(3.0f), ayy));
+}
+PHYS_TARGET_AVX512 inline float reduceAdd(const Floatx16& a) { return _mm512_reduce_add_ps(a.v); }
+
+// four floats of storage per register, widened
+struct DoubleMaskx4 {
+	__m256d m;
+};
+
+struct Doublex4 {
+	using Mask = DoubleMaskx4;
+	static constexpr unsigned int Lanes = 4;
+	__m256d v;
+
+	Doublex4() = default;
+	PHYS_TARGET_AVX2 inline Doublex4(double s) : v(_mm256_set1_pd(s)) {}
+	PHYS_TARGET_AVX2 inline Doublex4(__m256d v) : v(v) {}
+
+	static PHYS_TARGET_AVX2 inline __m128i floatMask(size_t count) { return _mm_loadu_si128((const __m128i*) (BatchRamp + 8 - (count < 4 ? count : 4))); };
+	static PHYS_TARGET_AVX2 inline Doublex4 load(const double* p) { return _mm256_loadu_pd(p); };
+	static PHYS_TARGET_AVX2 inline Doublex4 loadPartial(const double* p, size_t count) { return _mm256_maskload_pd(p, _mm256_castpd_si256(first(count).m)); };
+	static PHYS_TARGET_AVX2 inline Doublex4 loadFloat(const float* p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); };
+	static PHYS_TARGET_AVX2 inline Doublex4 loadFloatPartial(const float* p, size_t count) { return _mm256_cvtps_pd(_mm_maskload_ps(p, floatMask(count))); };
+	static PHYS_TARGET_AVX2 inline Mask first(size_t count) { return { _mm256_castsi256_pd(_mm256_cvtepi32_epi64(floatMask(count))) }; };
+	PHYS_TARGET_AVX2 inline void store(double* p) const { _mm256_storeu_pd(p, v); };
+	PHYS_TARGET_AVX2 inline void storePartial(double* p, size_t count) const { _mm256_maskstore_pd(p, _mm256_castpd_si256(first(count).m), v); };
+	PHYS_TARGET_AVX2 inline void storeFloat(float* p) const { _mm_storeu_ps(p, _mm256_cvtpd_ps(v)); };
+	PHYS_TARGET_AVX2 inline void storeFloatPartial(float* p, size_t count) const { _mm_maskstore_ps(p, floatMask(count), _mm256_cvtpd_ps(v)); };
+
+	friend PHYS_TARGET_AVX2 inline Doublex4 operator+(const Doublex4& a, const Doublex4& b) { return _mm256_add_pd(a.v, b.v); }
+	friend PHYS_TARGET_AVX2 inline Doublex4 operator-(const Doublex4& a, const Doublex4& b) { return _mm256_sub_pd(a.v, b.v); }
+	friend PHYS_TARGET_AVX2 inline Doublex4 operator*(const Doublex4& a, const Doublex4& b) { return _mm256_mul_pd(a.v, b.v); }
+	friend PHYS_TARGET_AVX2 inline Doublex4 operator/(const Doublex4& a, const Doublex4& b) { return _mm256_div_pd(a.v, b.v); }
+	friend PHYS_TARGET_AVX2 inline Doublex4 operator-(const Doublex4& a) { return _mm256_xor_pd(a.v, _mm256_set1_pd(-0.0)); }
+	friend PHYS_TARGET_AVX2 inline Mask operator<(const Doublex4& a, const Doublex4& b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ) }; }
+	friend PHYS_TARGET_AVX2 inline Mask operator<=(const Doublex4& a, const Doublex4& b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ) }; }
+	friend PHYS_TARGET_AVX2 inline Mask operator>(const Doublex4& a, const Doublex4& b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ) }; }
+	friend PHYS_TARGET_AVX2 inline Mask operator>=(const Doublex4& a, const Doublex4& b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ) }; }
+	friend PHYS_TARGET_AVX2 inline Mask operator==(const Doublex4& a, const Doublex4& b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ) }; }
+};
+
+PHYS_TARGET_AVX2 inline DoubleMaskx4 operator&(const DoubleMaskx4& a, const DoubleMaskx4& b) { return { _mm256_and_pd(a.m, b.m) }; }
+PHYS_TARGET_AVX2 inline DoubleMaskx4 operator|(const DoubleMaskx4& a, const DoubleMaskx4& b) { return { _mm256_or_pd(a.m, b.m) }; }
+PHYS_TARGET_AVX2 inline DoubleMaskx4 operator~(const DoubleMaskx4& a) { return { _mm256_xor_pd(a.m, _mm256_castsi256_pd(_mm256_set1_epi64x(-1))) }; }
+PHYS_TARGET_AVX2 inline bool any(const DoubleMaskx4& a) { return _mm256_movemask_pd(a.m) != 0; }
+PHYS_TARGET_AVX2 inline bool all(const DoubleMaskx4& a) { return _mm256_movemask_pd(a.m) == 0xf; }
+PHYS_TARGET_AVX2 inline Doublex4 select(const DoubleMaskx4& mask, const Doublex4& a, const Doublex4& b) { return _mm256_blendv_pd(b.v, a.v, mask.m); }
+PHYS_TARGET_AVX2 inline Doublex4 min(const Doublex4& a, const Doublex4& b) { return _mm256_min_pd(a.v, b.v); }
+PHYS_TARGET_AVX2 inline Doublex4 max(const Doublex4& a, const Doublex4& b) { return _mm256_max_pd(a.v, b.v); }
+PHYS_TARGET_AVX2 inline Doublex4 abs(const Doublex4& a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v); }
+PHYS_TARGET_AVX2 inline Doublex4 mulAdd(const Doublex4& a, const Doublex4& b, const Doublex4& c) { return _mm256_fmadd_pd(a.v, b.v, c.v); }
+PHYS_TARGET_AVX2 inline Doublex4 sqrt(const Doublex4& a) { return _mm256_sqrt_pd(a.v); }
+PHYS_TARGET_AVX2 inline Doublex4 rsqrt(const Doublex4& a) { return _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(a.v)); }
+PHYS_TARGET_AVX2 inline double reduceAdd(const Doublex4& a) {
+	__m128d half = _mm_add_pd(_mm256_castpd256_pd128(a.v), _mm256_extractf128_pd(a.v, 1));
+	return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+}
+
+// eight floats of storage per register, widened
+struct DoubleMaskx8 {
+	__mmask8 m;
+};
+
+struct Doublex8 {
+	using Mask = DoubleMaskx8;
+	static constexpr unsigned int Lanes = 8;
+	__m512d v;
+
+	Doublex8() = default;
+	PHYS_TARGET_AVX512 inline Doublex8(double s) : v(_mm512_set1_pd(s)) {}
+	PHYS_TARGET_AVX512 inline Doublex8(__m512d v) : v(v) {}
+
+	static PHYS_TARGET_AVX512 inline Doublex8 load(const double* p) { return _mm512_loadu_pd(p); };
+	static PHYS_TARGET_AVX512 inline Doublex8 loadPartial(const double* p, size_t count) { return _mm512_maskz_loadu_pd(first(count).m, p); };
+	static PHYS_TARGET_AVX512 inline Doublex8 loadFloat(const float* p) { return _mm512_cvtps_pd(_mm256_loadu_ps(p)); };
+	static PHYS_TARGET_AVX512 inline Doublex8 loadFloatPartial(const float* p, size_t count) {
+		// masked 512 bit load, AVX-512F has no narrower masked ones
+		return _mm512_cvtps_pd(_mm512_castps512_ps256(_mm512_maskz_loadu_ps((__mmask16) first(count).m, p)));
+	};
+	static PHYS_TARGET_AVX512 inline Mask first(size_t count) { return { (__mmask8) (count < 8 ? (1u << count) - 1 : 0xffu) }; };
+	PHYS_TARGET_AVX512 inline void store(double* p) const { _mm512_storeu_pd(p, v); };
+	PHYS_TARGET_AVX512 inline void storePartial(double* p, size_t count) const { _mm512_mask_storeu_pd(p, first(count).m, v); };
+	PHYS_TARGET_AVX512 inline void storeFloat(float* p) const { _mm256_storeu_ps(p, _mm512_cvtpd_ps(v)); };
+	PHYS_TARGET_AVX512 inline void storeFloatPartial(float* p, size_t count) const {
+		_mm512_mask_storeu_ps(p, (__mmask16) first(count).m, _mm512_castps256_ps512(_mm512_cvtpd_ps(v)));
+	};
+
+	friend PHYS_TARGET_AVX512 inline Doublex8 operator+(const Doublex8& a, const Doublex8& b) { return _mm512_add_pd(a.v, b.v); }
+	friend PHYS_TARGET_AVX512 inline Doublex8 operator-(const Doublex8& a, const Doublex8& b) { return _mm512_sub_pd(a.v, b.v); }
+	friend PHYS_TARGET_AVX512 inline Doublex8 operator*(const Doublex8& a, const Doublex8& b) { return _mm512_mul_pd(a.v, b.v); }
+	friend PHYS_TARGET_AVX512 inline Doublex8 operator/(const Doublex8& a, const Doublex8& b) { return _mm512_div_pd(a.v, b.v); }
+	friend PHYS_TARGET_AVX512 inline Doublex8 operator-(const Doublex8& a) { return _mm512_sub_pd(_mm512_setzero_pd(), a.v); }
+	friend PHYS_TARGET_AVX512 inline Mask operator<(const Doublex8& a, const Doublex8& b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ) }; }
+	friend PHYS_TARGET_AVX512 inline Mask operator<=(const Doublex8& a, const Doublex8& b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_LE_OQ) }; }
+	friend PHYS_TARGET_AVX512 inline Mask operator>(const Doublex8& a, const Doublex8& b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ) }; }
+	friend PHYS_TARGET_AVX512 inline Mask operator>=(const Doublex8& a, const Doublex8& b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_GE_OQ) }; }
+	friend PHYS_TARGET_AVX512 inline Mask operator==(const Doublex8& a, const Doublex8& b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_EQ_OQ) }; }
+};
+
+PHYS_TARGET_AVX512 inline DoubleMaskx8 operator&(const DoubleMaskx8& a, const DoubleMaskx8& b) { return { (__mmask8) (a.m & b.m) }; }
+PHYS_TARGET_AVX512 inline DoubleMaskx8 operator|(const DoubleMaskx8& a, const DoubleMaskx8& b) { return { (__mmask8) (a.m | b.m) }; }
+PHYS_TARGET_AVX512 inline DoubleMaskx8 operator~(const DoubleMaskx8& a) { return { (__mmask8) ~a.m }; }
+PHYS_TARGET_AVX512 inline bool any(const DoubleMaskx8& a) { return a.m != 0; }
+PHYS_TARGET_AVX512 inline bool all(const DoubleMaskx8& a) { return a.m == 0xff; }
+PHYS_TARGET_AVX512 inline Doublex8 select(const DoubleMaskx8& mask, const Doublex8& a, const Doublex8& b) { return _mm512_mask_blend_pd(mask.m, b.v, a.v); }
+PHYS_TARGET_AVX512 inline Doublex8 min(const Doublex8& a, const Doublex8& b) { return _mm512_min_pd(a.v, b.v); }
+PHYS_TARGET_AVX512 inline Doublex8 max(const Doublex8& a, const Doublex8& b) { return _mm512_max_pd(a.v, b.v); }
+PHYS_TARGET_AVX512 inline Doublex8 abs(const Doublex8& a) { return _mm512_abs_pd(a.v); }
+PHYS_TARGET_AVX512 inline Doublex8 mulAdd(const Doublex8& a, const Doublex8& b, const Doublex8& c) { return _mm512_fmadd_pd(a.v, b.v, c.v); }
+PHYS_TARGET_AVX512 inline Doublex8 sqrt(const Doublex8& a) { return _mm512_sqrt_pd(a.v); }
+// 14 bit estimate and two Newton steps, to full double precision
+PHYS_TARGET_AVX512 inline Doublex8 rsqrt(const Doublex8& a) {
+	__m512d half = _mm512_mul_pd(a.v, _mm512_set1_pd(0.5)), threeHalves = _mm512_set1_pd(1.5);
+	__m512d y = _mm512_rsqrt14_pd(a.v);
+	y = _mm512_mul_pd(y, _mm512_fnmadd_pd(half, _mm512_mul_pd(y, y), threeHalves));
+	return _mm512_mul_pd(y, _mm512_fnmadd_pd(half, _mm512_mul_pd(y, y), threeHalves));
+}
+PHYS_TARGET_AVX512 inline double reduceAdd(const Doublex8& a) { return _mm512_reduce_add_pd(a.v); }
+
+#endif
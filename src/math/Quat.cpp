@@ -0,0 +1,50 @@
+#include <cmath>
+#include "Quat.h"
+
+Quat Quat::fromAxisAngle(const Vec3& axis, float angle) {
+    float s = std::sin(0.5f * angle);
+    return Quat(axis.x * s, axis.y * s, axis.z * s, std::cos(0.5f * angle));
+}
+
+Quat Quat::between(const Vec3& from, const Vec3& to) {
+    float c = dot(from, to);
+    if (c < -0.999999f) {
+        // opposite: half a turn about anything perpendicular
+        Vec3 axis = std::fabs(from.x) < 0.9f ? cross(Vec3(1.0f, 0.0f, 0.0f), from) : cross(Vec3(0.0f, 1.0f, 0.0f), from);
+        return fromAxisAngle(normalize(axis), 3.14159265358979f);
+    }
+    Vec3 axis = cross(from, to);
+    return Quat(axis.x, axis.y, axis.z, 1.0f + c).normalized();
+}
+
+Quat Quat::normalized() const {
+    float sq = dot(*this, *this);
+    if (sq == 0.0f)
+        return Quat();
+    float inv = 1.0f / std::sqrt(sq);
+    return Quat(x * inv, y * inv, z * inv, w * inv);
+}
+
+Quat Quat::integrated(const Vec3& angularVelocity, float dt) const {
+    // dq/dt = 1/2 (omega, 0) q
+    Quat spin = Quat(angularVelocity.x, angularVelocity.y, angularVelocity.z, 0.0f) * *this;
+    float h = 0.5f * dt;
+    return Quat(x + spin.x * h, y + spin.y * h, z + spin.z * h, w + spin.w * h).normalized();
+}
+
+Quat slerp(const Quat& a, const Quat& b, float t) {
+    float c = dot(a, b);
+    Quat end = b;
+    if (c < 0.0f) {
+        c = -c;
+        end = Quat(-b.x, -b.y, -b.z, -b.w);
+    }
+    float wa = 1.0f - t, wb = t;
+    if (c < 0.9995f) {
+        // close ones fall back to normalized lerp, the sine below goes to zero
+        float angle = std::acos(c), s = 1.0f / std::sin(angle);
+        wa = std::sin(wa * angle) * s;
+        wb = std::sin(wb * angle) * s;
+    }
+    return Quat(a.x * wa + end.x * wb, a.y * wa + end.y * wb, a.z * wa + end.z * wb, a.w * wa + end.w * wb).normalized();
+}
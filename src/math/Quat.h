@@ -0,0 +1,40 @@
+#pragma once
+#include "Vec.h"
+
+// Rotation quaternion w + xi + yj + zk. Products compose like matrices:
+// (a * b).rotate(v) == a.rotate(b.rotate(v)).
+struct Quat {
+	float x, y, z, w;
+
+	Quat() : x(0.0f), y(0.0f), z(0.0f), w(1.0f) {}
+	Quat(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+
+	// counterclockwise by angle radians about a unit axis
+	static Quat fromAxisAngle(const Vec3& axis, float angle);
+	// shortest arc taking unit vector from onto unit vector to
+	static Quat between(const Vec3& from, const Vec3& to);
+
+	PHYS_INLINE Vec3 vector() const { return Vec3(x, y, z); };
+	PHYS_INLINE Quat conjugate() const { return Quat(-x, -y, -z, w); };
+	PHYS_INLINE Vec3 rotate(const Vec3& v) const {
+		// v + 2 w (q x v) + 2 q x (q x v)
+		Vec3 q = vector();
+		Vec3 t = cross(q, v) * 2.0f;
+		return v + t * w + cross(q, t);
+	};
+
+	Quat normalized() const;
+	// after an angular velocity over dt, first order and renormalized
+	Quat integrated(const Vec3& angularVelocity, float dt) const;
+};
+
+PHYS_INLINE Quat operator*(const Quat& a, const Quat& b) {
+	return Quat(a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z);
+}
+PHYS_INLINE float dot(const Quat& a, const Quat& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+
+// along the shorter arc, t in [0, 1]
+Quat slerp(const Quat& a, const Quat& b, float t);
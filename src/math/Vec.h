@@ -0,0 +1,94 @@
+#pragma once
+#include <cmath>
+#include "../physics/Cpu.h"
+
+// Small float vectors for scalar code: scene setup, rendering, anything that
+// handles one point at a time. Kernels that stream many particles use the
+// batch types in Batch.h instead, which hold one component of several
+// particles per register.
+
+struct Vec2 {
+	float x, y;
+
+	Vec2() : x(0.0f), y(0.0f) {}
+	Vec2(float x, float y) : x(x), y(y) {}
+	explicit Vec2(float s) : x(s), y(s) {}
+
+	PHYS_INLINE float& operator[](int i) { return (&x)[i]; };
+	PHYS_INLINE float operator[](int i) const { return (&x)[i]; };
+	PHYS_INLINE Vec2& operator+=(const Vec2& b) { x += b.x; y += b.y; return *this; };
+	PHYS_INLINE Vec2& operator-=(const Vec2& b) { x -= b.x; y -= b.y; return *this; };
+	PHYS_INLINE Vec2& operator*=(float s) { x *= s; y *= s; return *this; };
+};
+
+struct Vec3 {
+	float x, y, z;
+
+	Vec3() : x(0.0f), y(0.0f), z(0.0f) {}
+	Vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+	explicit Vec3(float s) : x(s), y(s), z(s) {}
+
+	PHYS_INLINE float& operator[](int i) { return (&x)[i]; };
+	PHYS_INLINE float operator[](int i) const { return (&x)[i]; };
+	PHYS_INLINE Vec3& operator+=(const Vec3& b) { x += b.x; y += b.y; z += b.z; return *this; };
+	PHYS_INLINE Vec3& operator-=(const Vec3& b) { x -= b.x; y -= b.y; z -= b.z; return *this; };
+	PHYS_INLINE Vec3& operator*=(float s) { x *= s; y *= s; z *= s; return *this; };
+};
+
+struct Vec4 {
+	float x, y, z, w;
+
+	Vec4() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+	Vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	Vec4(const Vec3& v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+	explicit Vec4(float s) : x(s), y(s), z(s), w(s) {}
+
+	PHYS_INLINE float& operator[](int i) { return (&x)[i]; };
+	PHYS_INLINE float operator[](int i) const { return (&x)[i]; };
+	PHYS_INLINE Vec3 xyz() const { return Vec3(x, y, z); };
+	PHYS_INLINE Vec4& operator+=(const Vec4& b) { x += b.x; y += b.y; z += b.z; w += b.w; return *this; };
+	PHYS_INLINE Vec4& operator-=(const Vec4& b) { x -= b.x; y -= b.y; z -= b.z; w -= b.w; return *this; };
+	PHYS_INLINE Vec4& operator*=(float s) { x *= s; y *= s; z *= s; w *= s; return *this; };
+};
+
+PHYS_INLINE Vec2 operator+(const Vec2& a, const Vec2& b) { return Vec2(a.x + b.x, a.y + b.y); }
+PHYS_INLINE Vec2 operator-(const Vec2& a, const Vec2& b) { return Vec2(a.x - b.x, a.y - b.y); }
+PHYS_INLINE Vec2 operator-(const Vec2& a) { return Vec2(-a.x, -a.y); }
+PHYS_INLINE Vec2 operator*(const Vec2& a, float s) { return Vec2(a.x * s, a.y * s); }
+PHYS_INLINE Vec2 operator*(float s, const Vec2& a) { return Vec2(a.x * s, a.y * s); }
+PHYS_INLINE Vec2 operator*(const Vec2& a, const Vec2& b) { return Vec2(a.x * b.x, a.y * b.y); }
+PHYS_INLINE float dot(const Vec2& a, const Vec2& b) { return a.x * b.x + a.y * b.y; }
+// z of the 3d cross product
+PHYS_INLINE float cross(const Vec2& a, const Vec2& b) { return a.x * b.y - a.y * b.x; }
+// rotated a quarter turn counterclockwise
+PHYS_INLINE Vec2 perpendicular(const Vec2& a) { return Vec2(-a.y, a.x); }
+
+PHYS_INLINE Vec3 operator+(const Vec3& a, const Vec3& b) { return Vec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+PHYS_INLINE Vec3 operator-(const Vec3& a, const Vec3& b) { return Vec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+PHYS_INLINE Vec3 operator-(const Vec3& a) { return Vec3(-a.x, -a.y, -a.z); }
+PHYS_INLINE Vec3 operator*(const Vec3& a, float s) { return Vec3(a.x * s, a.y * s, a.z * s); }
+PHYS_INLINE Vec3 operator*(float s, const Vec3& a) { return Vec3(a.x * s, a.y * s, a.z * s); }
+PHYS_INLINE Vec3 operator*(const Vec3& a, const Vec3& b) { return Vec3(a.x * b.x, a.y * b.y, a.z * b.z); }
+PHYS_INLINE float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+PHYS_INLINE Vec3 cross(const Vec3& a, const Vec3& b) { return Vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+
+PHYS_INLINE Vec4 operator+(const Vec4& a, const Vec4& b) { return Vec4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+PHYS_INLINE Vec4 operator-(const Vec4& a, const Vec4& b) { return Vec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); }
+PHYS_INLINE Vec4 operator-(const Vec4& a) { return Vec4(-a.x, -a.y, -a.z, -a.w); }
+PHYS_INLINE Vec4 operator*(const Vec4& a, float s) { return Vec4(a.x * s, a.y * s, a.z * s, a.w * s); }
+PHYS_INLINE Vec4 operator*(float s, const Vec4& a) { return Vec4(a.x * s, a.y * s, a.z * s, a.w * s); }
+PHYS_INLINE Vec4 operator*(const Vec4& a, const Vec4& b) { return Vec4(a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w); }
+PHYS_INLINE float dot(const Vec4& a, const Vec4& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+
+template<typename V>
+PHYS_INLINE float lengthSq(const V& a) { return dot(a, a); }
+template<typename V>
+PHYS_INLINE float length(const V& a) { return std::sqrt(dot(a, a)); }
+// zero stays zero
+template<typename V>
+PHYS_INLINE V normalize(const V& a) {
+	float sq = dot(a, a);
+	return sq > 0.0f ? a * (1.0f / std::sqrt(sq)) : a;
+}
+template<typename V>
+PHYS_INLINE V lerp(const V& a, const V& b, float t) { return a + (b - a) * t; }
@@ -0,0 +1,72 @@
+#include <cmath>
+#include <algorithm>
+#include "ConjugateGradient.h"
+#include "VectorOps.h"
+
+ConjugateGradient::ConjugateGradient()
+    : m_Tolerance(1e-4f), m_MaxIterations(200), m_Iterations(0), m_Residual(0.0) {
+}
+
+void ConjugateGradient::setTolerance(float tolerance, unsigned int maxIterations) {
+    m_Tolerance = tolerance;
+    m_MaxIterations = maxIterations;
+}
+
+unsigned int ConjugateGradient::solve(const SparseMatrix& matrix, Preconditioner& preconditioner, const float* b, float* x, ThreadPool& pool) {
+    size_t count = matrix.getRows();
+    m_R.resize(count);
+    m_Z.resize(count);
+    m_P.resize(count);
+    m_Q.resize(count);
+    float* r = m_R.data();
+    float* z = m_Z.data();
+    float* p = m_P.data();
+    float* q = m_Q.data();
+
+    matrix.multiply(x, q, pool);
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++)
+            r[i] = b[i] - q[i];
+    });
+    preconditioner.apply(r, z, pool);
+    std::copy(z, z + count, p);
+
+    double bNorm = std::sqrt(blockDot(b, b, count, m_BlockSums, pool));
+    if (bNorm == 0.0)
+        bNorm = 1.0;
+    double rz = blockDot(r, z, count, m_BlockSums, pool);
+    m_Residual = std::sqrt(blockDot(r, r, count, m_BlockSums, pool)) / bNorm;
+    m_Iterations = 0;
+    size_t blocks = (count + DotBlockSize - 1) / DotBlockSize;
+    while (m_Residual > m_Tolerance && m_Iterations < m_MaxIterations) {
+        matrix.multiply(p, q, pool);
+        double pq = blockDot(p, q, count, m_BlockSums, pool);
+        if (pq <= 0.0)
+            break; // not positive definite along p, or converged to round off
+        float alpha = (float) (rz / pq);
+        pool.parallelFor(blocks, [&](size_t first, size_t last, unsigned int) {
+            for (size_t block = first; block < last; block++) {
+                double rr = 0.0;
+                for (size_t i = block * DotBlockSize; i < std::min(count, (block + 1) * DotBlockSize); i++) {
+                    x[i] += alpha * p[i];
+                    r[i] -= alpha * q[i];
+                    rr += (double) r[i] * r[i];
+                }
+                m_BlockSums[block] = rr;
+            }
+        });
+        m_Residual = std::sqrt(sumBlocks(m_BlockSums, count)) / bNorm;
+        m_Iterations++;
+        if (m_Residual <= m_Tolerance)
+            break;
+        preconditioner.apply(r, z, pool);
+        double rzNext = blockDot(r, z, count, m_BlockSums, pool);
+        float beta = (float) (rzNext / rz);
+        rz = rzNext;
+        pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+            for (size_t i = begin; i < end; i++)
+                p[i] = z[i] + beta * p[i];
+        });
+    }
+    return m_Iterations;
+}
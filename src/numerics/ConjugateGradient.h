@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+#include "../physics/AlignedArray.h"
+#include "../physics/ThreadPool.h"
+#include "SparseMatrix.h"
+#include "Preconditioners.h"
+
+// Preconditioned conjugate gradient for symmetric positive definite systems.
+// The work vectors are kept between solves, so once they have grown to the
+// system size a solve doesn't allocate. Dot products are summed in fixed
+// blocks (VectorOps.h), which keeps the iterates independent of the thread
+// count; the residual norm is summed in the same pass that updates x and r.
+class ConjugateGradient {
+private:
+	AlignedArray<float> m_R, m_Z, m_P, m_Q;
+	std::vector<double> m_BlockSums;
+	float m_Tolerance; // on the residual norm relative to the right hand side
+	unsigned int m_MaxIterations;
+	unsigned int m_Iterations;
+	double m_Residual;
+public:
+	ConjugateGradient();
+
+	// Solves A x = b starting from the guess in x, with a preconditioner that
+	// is already set up for the matrix. Returns the iterations taken.
+	unsigned int solve(const SparseMatrix& matrix, Preconditioner& preconditioner, const float* b, float* x, ThreadPool& pool);
+
+	void setTolerance(float tolerance, unsigned int maxIterations);
+
+	inline unsigned int getIterations() const { return m_Iterations; }; // of the last solve
+	inline double getResidual() const { return m_Residual; }; // relative, after the last solve
+};
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "DormandPrince.h"
+#include "RungeKuttaKernels.h"
+
+// Butcher tableau: stage s evaluates at t + c[s] h, from y + h sum a[s][j] k[j];
+// the seventh stage point is the fifth order solution
+static const double c[DormandPrince::Stages] = { 0.0, 1.0 / 5.0, 3.0 / 10.0, 4.0 / 5.0, 8.0 / 9.0, 1.0, 1.0 };
+static const double a[DormandPrince::Stages][DormandPrince::Stages - 1] = {
+    { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
+    { 1.0 / 5.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
+    { 3.0 / 40.0, 9.0 / 40.0, 0.0, 0.0, 0.0, 0.0 },
+    { 44.0 / 45.0, -56.0 / 15.0, 32.0 / 9.0, 0.0, 0.0, 0.0 },
+    { 19372.0 / 6561.0, -25360.0 / 2187.0, 64448.0 / 6561.0, -212.0 / 729.0, 0.0, 0.0 },
+    { 9017.0 / 3168.0, -355.0 / 33.0, 46732.0 / 5247.0, 49.0 / 176.0, -5103.0 / 18656.0, 0.0 },
+    { 35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0 }
+};
+// fifth minus fourth order weights
+static const double e[DormandPrince::Stages] = {
+    71.0 / 57600.0, 0.0, -71.0 / 16695.0, 71.0 / 1920.0, -17253.0 / 339200.0, 22.0 / 525.0, -1.0 / 40.0
+};
+
+DormandPrince::DormandPrince()
+    : m_Absolute(1e-9), m_Relative(1e-9), m_Step(0.0), m_LastError(1e-4), m_FirstSameAsLast(false),
+      m_Steps(0), m_Accepted(0), m_Rejected(0), m_Evaluations(0) {
+}
+
+void DormandPrince::reset() {
+    m_FirstSameAsLast = false;
+    m_Step = 0.0;
+    m_LastError = 1e-4;
+}
+
+void DormandPrince::setTolerance(double absolute, double relative) {
+    m_Absolute = absolute;
+    m_Relative = relative;
+}
+
+// zero weights are dropped, so every stage only reads the vectors it needs
+void DormandPrince::combine(const double* y, unsigned int stage, double h, double* out, ThreadPool& pool) {
+    const double* k[Stages];
+    double weights[Stages];
+    unsigned int used = 0;
+    for (unsigned int j = 0; j < stage; j++) {
+        if (a[stage][j] != 0.0) {
+            k[used] = m_K[j].data();
+            weights[used++] = a[stage][j];
+        }
+    }
+    pool.parallelFor(m_Stage.size(), [&](size_t begin, size_t end, unsigned int) {
+        const double* slice[Stages];
+        for (unsigned int s = 0; s < used; s++)
+            slice[s] = k[s] + begin;
+        combineStages(y + begin, slice, weights, used, h, out + begin, end - begin);
+    });
+}
+
+double DormandPrince::measureError(const double* y, double h, ThreadPool& pool) {
+    const double* k[Stages];
+    double weights[Stages];
+    unsigned int used = 0;
+    for (unsigned int j = 0; j < Stages; j++) {
+        if (e[j] != 0.0) {
+            k[used] = m_K[j].data();
+            weights[used++] = e[j];
+        }
+    }
+    m_ThreadError.assign(pool.getThreadCount(), 0.0);
+    pool.parallelFor(m_Stage.size(), [&](size_t begin, size_t end, unsigned int thread) {
+        const double* slice[Stages];
+        for (unsigned int s = 0; s < used; s++)
+            slice[s] = k[s] + begin;
+        m_ThreadError[thread] = stageError(y + begin, m_Next.data() + begin, slice, weights, used, h,
+            m_Absolute, m_Relative, end - begin);
+    });
+    double error = 0.0;
+    for (double threadError : m_ThreadError) {
+        if (std::isnan(threadError))
+            return threadError;
+        error = std::max(error, threadError);
+    }
+    return error;
+}
+
+unsigned int DormandPrince::integrate(double* y, size_t count, double t, double dt, const Derivative& derivative, ThreadPool& pool) {
+    m_Steps = 0;
+    if (count == 0 || dt <= 0.0)
+        return 0;
+    if (m_Stage.size() != count) {
+        for (AlignedArray<double>& k : m_K)
+            k.resize(count);
+        m_Stage.resize(count);
+        m_Next.resize(count);
+        m_FirstSameAsLast = false;
+    }
+    if (!m_FirstSameAsLast) {
+        derivative(t, y, m_K[0].data());
+        m_Evaluations++;
+        m_FirstSameAsLast = true;
+    }
+    if (m_Step <= 0.0) {
+        // a hundredth of the time the scaled state takes to change by its own size
+        double size = 0.0, rate = 0.0;
+        for (size_t i = 0; i < count; i++) {
+            double scale = m_Absolute + m_Relative * std::fabs(y[i]);
+            size = std::max(size, std::fabs(y[i]) / scale);
+            rate = std::max(rate, std::fabs(m_K[0][i]) / scale);
+        }
+        m_Step = size < 1e-5 || rate < 1e-5 ? 1e-6 * dt : 0.01 * size / rate;
+    }
+
+    const double smallest = 1e-12 * dt; // taken whatever the error, so a step always ends
+    double done = 0.0;
+    bool rejected = false;
+    while (done < dt) {
+        double h = std::max(std::min(m_Step, dt - done), smallest);
+        bool last = dt - done - h < smallest;
+        if (last)
+            h = dt - done;
+        for (unsigned int stage = 1; stage < Stages - 1; stage++) {
+            combine(y, stage, h, m_Stage.data(), pool);
+            derivative(t + done + c[stage] * h, m_Stage.data(), m_K[stage].data());
+        }
+        combine(y, Stages - 1, h, m_Next.data(), pool);
+        derivative(t + done + h, m_Next.data(), m_K[Stages - 1].data());
+        m_Evaluations += Stages - 1;
+
+        double error = measureError(y, h, pool);
+        // PI control: weighing in the last accepted error damps the swings of
+        // the plain err^(-1/5) rule and with them some rejections. NaN fails
+        // every test and shrinks the step.
+        double factor = error > 0.0 ? 0.9 * std::pow(error, -0.17) * std::pow(m_LastError, 0.04) : error == 0.0 ? 5.0 : 0.2;
+        factor = std::min(5.0, std::max(0.2, factor));
+        if (error <= 1.0 || h <= smallest) {
+            std::memcpy(y, m_Next.data(), count * sizeof(double));
+            std::swap(m_K[0], m_K[Stages - 1]);
+            done = last ? dt : done + h;
+            if (rejected)
+                factor = std::min(factor, 1.0);
+            // a last step cut short says little about growing
+            m_Step = last && factor >= 1.0 ? std::max(m_Step, h * factor) : h * factor;
+            m_LastError = std::max(error, 1e-4);
+            m_Steps++;
+            m_Accepted++;
+            rejected = false;
+        }
+        else {
+            m_Step = h * factor;
+            m_Rejected++;
+            rejected = true;
+        }
+    }
+    return m_Steps;
+}
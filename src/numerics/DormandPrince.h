@@ -0,0 +1,54 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include "../physics/AlignedArray.h"
+#include "../physics/ThreadPool.h"
+
+// Dormand-Prince 5(4): explicit Runge-Kutta of order five with an embedded
+// fourth order solution, over a whole state vector (any structure of arrays
+// laid end to end). The step size follows the error estimate: one step is
+// accepted when every entry of the difference between the two solutions is
+// within absolute + relative * |y|, and the next is scaled by a PI controller,
+// at most 5x up or down, so smooth stretches take large steps and one fast
+// entry (two bodies passing close) is enough to shrink them. The last stage is
+// the derivative at the new state and is reused as the first stage of the
+// next step, six evaluations per accepted step. Stage and work vectors are
+// kept between calls, so once they have grown to the state size a step
+// doesn't allocate; the stage sums run across the pool on SIMD kernels.
+class DormandPrince {
+public:
+	static constexpr unsigned int Stages = 7;
+	// dydt = f(t, y), both count long
+	using Derivative = std::function<void(double t, const double* y, double* dydt)>;
+private:
+	AlignedArray<double> m_K[Stages];
+	AlignedArray<double> m_Stage, m_Next;
+	std::vector<double> m_ThreadError;
+	double m_Absolute, m_Relative;
+	double m_Step; // the next step to try, 0 picks one from the first derivative
+	double m_LastError;
+	bool m_FirstSameAsLast; // m_K[0] is the derivative at the current state
+	unsigned int m_Steps; // accepted in the last call
+	unsigned long long m_Accepted, m_Rejected, m_Evaluations;
+
+	void combine(const double* y, unsigned int stage, double h, double* out, ThreadPool& pool);
+	double measureError(const double* y, double h, ThreadPool& pool);
+public:
+	DormandPrince();
+
+	// Advances y, count entries at time t, by exactly dt in as many steps as
+	// the tolerance needs (the last one cut to land on t + dt). Returns the
+	// steps accepted.
+	unsigned int integrate(double* y, size_t count, double t, double dt, const Derivative& derivative, ThreadPool& pool);
+	// the state was changed between calls, so the kept derivative is stale
+	void reset();
+
+	void setTolerance(double absolute, double relative);
+
+	inline double getStep() const { return m_Step; }; // the next step it will try
+	inline double getLastError() const { return m_LastError; }; // of the last accepted step (at least 1e-4), 1 is the tolerance
+	inline unsigned int getSteps() const { return m_Steps; };
+	inline unsigned long long getAccepted() const { return m_Accepted; };
+	inline unsigned long long getRejected() const { return m_Rejected; };
+	inline unsigned long long getEvaluations() const { return m_Evaluations; };
+};
@@ -0,0 +1,106 @@
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include "Minres.h"
+#include "VectorOps.h"
+
+Minres::Minres()
+    : m_Tolerance(1e-4f), m_MaxIterations(200), m_Iterations(0), m_Residual(0.0) {
+}
+
+void Minres::setTolerance(float tolerance, unsigned int maxIterations) {
+    m_Tolerance = tolerance;
+    m_MaxIterations = maxIterations;
+}
+
+unsigned int Minres::solve(const SparseMatrix& matrix, Preconditioner& preconditioner, const float* b, float* x, ThreadPool& pool) {
+    size_t count = matrix.getRows();
+    if (m_R1.size() != count) {
+        AlignedArray<float>* vectors[] = { &m_R1, &m_R2, &m_Y, &m_V, &m_W, &m_W1, &m_W2 };
+        for (AlignedArray<float>* vector : vectors)
+            vector->resize(count);
+    }
+    // the first direction update reads these two with zero weights, they
+    // only have to be finite; everything else is written before it is read
+    m_W.fill(0.0f);
+    m_W2.fill(0.0f);
+
+    // r1 = b - A x, y = M^-1 r1, beta1 = |r1|_M^-1
+    matrix.multiply(x, m_Y.data(), pool);
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            m_R1[i] = b[i] - m_Y[i];
+            m_R2[i] = m_R1[i];
+        }
+    });
+    preconditioner.apply(m_R1.data(), m_Y.data(), pool);
+    double beta1 = blockDot(m_R1.data(), m_Y.data(), count, m_BlockSums, pool);
+    m_Iterations = 0;
+    m_Residual = 0.0;
+    if (!(beta1 > 0.0))
+        return 0;
+    beta1 = std::sqrt(beta1);
+
+    double oldBeta = 0.0, beta = beta1, dbar = 0.0, epsilon = 0.0, phibar = beta1, cs = -1.0, sn = 0.0;
+    m_Residual = 1.0;
+    while (m_Residual > m_Tolerance && m_Iterations < m_MaxIterations) {
+        // Lanczos step: v = y / beta, y = A v - (beta / oldBeta) r1 - (alpha / beta) r2
+        float s = (float) (1.0 / beta);
+        pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+            for (size_t i = begin; i < end; i++)
+                m_V[i] = s * m_Y[i];
+        });
+        matrix.multiply(m_V.data(), m_Y.data(), pool);
+        if (m_Iterations > 0) {
+            float scale = (float) (beta / oldBeta);
+            pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+                for (size_t i = begin; i < end; i++)
+                    m_Y[i] -= scale * m_R1[i];
+            });
+        }
+        double alpha = blockDot(m_V.data(), m_Y.data(), count, m_BlockSums, pool);
+        float scale = (float) (alpha / beta);
+        pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+            for (size_t i = begin; i < end; i++)
+                m_Y[i] -= scale * m_R2[i];
+        });
+        // r1 <- r2, r2 <- y, and y is free again
+        std::swap(m_R1, m_R2);
+        std::swap(m_R2, m_Y);
+        preconditioner.apply(m_R2.data(), m_Y.data(), pool);
+        oldBeta = beta;
+        beta = blockDot(m_R2.data(), m_Y.data(), count, m_BlockSums, pool);
+        if (beta < 0.0)
+            break; // the preconditioner isn't positive definite
+        beta = std::sqrt(beta);
+
+        // apply the previous rotation to the new column and find the next one
+        double oldEpsilon = epsilon;
+        double delta = cs * dbar + sn * alpha;
+        double gbar = sn * dbar - cs * alpha;
+        epsilon = sn * beta;
+        dbar = -cs * beta;
+        double gamma = std::max(std::sqrt(gbar * gbar + beta * beta), 1e-30);
+        cs = gbar / gamma;
+        sn = beta / gamma;
+        double phi = cs * phibar;
+        phibar *= sn;
+
+        // w1 <- w2, w2 <- w, w = (v - epsilon w1 - delta w2) / gamma, x += phi w
+        std::swap(m_W1, m_W2);
+        std::swap(m_W2, m_W);
+        float invGamma = (float) (1.0 / gamma), e = (float) oldEpsilon, d = (float) delta, step = (float) phi;
+        pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+            for (size_t i = begin; i < end; i++) {
+                float w = (m_V[i] - e * m_W1[i] - d * m_W2[i]) * invGamma;
+                m_W[i] = w;
+                x[i] += step * w;
+            }
+        });
+        m_Iterations++;
+        m_Residual = phibar / beta1;
+        if (beta == 0.0)
+            break; // the Krylov space is exhausted, x is exact
+    }
+    return m_Iterations;
+}
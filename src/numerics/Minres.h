@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include "../physics/AlignedArray.h"
+#include "../physics/ThreadPool.h"
+#include "SparseMatrix.h"
+#include "Preconditioners.h"
+
+// Preconditioned MINRES (Paige and Saunders) for symmetric systems that may
+// be indefinite, such as saddle points from constraints; the preconditioner
+// still has to be positive definite. Minimizes the residual over the Krylov
+// space with a three term Lanczos recurrence and Givens rotations, keeping
+// seven vectors that rotate roles by swapping, so iterations don't allocate
+// or copy. The residual it tracks is the preconditioned one.
+class Minres {
+private:
+	AlignedArray<float> m_R1, m_R2, m_Y, m_V, m_W, m_W1, m_W2;
+	std::vector<double> m_BlockSums;
+	float m_Tolerance; // on the preconditioned residual norm relative to the initial one
+	unsigned int m_MaxIterations;
+	unsigned int m_Iterations;
+	double m_Residual;
+public:
+	Minres();
+
+	// Solves A x = b starting from the guess in x, with a preconditioner that
+	// is already set up for the matrix. Returns the iterations taken.
+	unsigned int solve(const SparseMatrix& matrix, Preconditioner& preconditioner, const float* b, float* x, ThreadPool& pool);
+
+	void setTolerance(float tolerance, unsigned int maxIterations);
+
+	inline unsigned int getIterations() const { return m_Iterations; }; // of the last solve
+	inline double getResidual() const { return m_Residual; }; // relative estimate, after the last solve
+};
@@ -0,0 +1,325 @@
+#include <cmath>
+#include <algorithm>
+#include "Preconditioners.h"
+
+std::unique_ptr<Preconditioner> createPreconditioner(PreconditionerType type, unsigned int blockSize) {
+    switch (type) {
+    case PreconditionerType::BlockJacobi:
+        return std::unique_ptr<Preconditioner>(new BlockJacobiPreconditioner(blockSize));
+    case PreconditionerType::IncompleteCholesky:
+        return std::unique_ptr<Preconditioner>(new IncompleteCholesky());
+    default:
+        return std::unique_ptr<Preconditioner>(new JacobiPreconditioner());
+    }
+}
+
+void JacobiPreconditioner::setup(const SparseMatrix& matrix, ThreadPool&) {
+    unsigned int rows = matrix.getRows();
+    m_InvDiagonal.resize(rows);
+    matrix.getDiagonalBlocks(1, m_InvDiagonal.data());
+    for (unsigned int i = 0; i < rows; i++)
+        m_InvDiagonal[i] = m_InvDiagonal[i] != 0.0f ? 1.0f / m_InvDiagonal[i] : 0.0f;
+}
+
+void JacobiPreconditioner::apply(const float* r, float* z, ThreadPool& pool) {
+    const float* invDiagonal = m_InvDiagonal.data();
+    pool.parallelFor(m_InvDiagonal.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++)
+            z[i] = invDiagonal[i] * r[i];
+    });
+}
+
+BlockJacobiPreconditioner::BlockJacobiPreconditioner(unsigned int blockSize)
+    : m_BlockSize(blockSize == 2 ? 2 : 3), m_Rows(0) {
+}
+
+void BlockJacobiPreconditioner::setup(const SparseMatrix& matrix, ThreadPool& pool) {
+    unsigned int b = m_BlockSize;
+    m_Rows = matrix.getRows();
+    unsigned int blocks = m_Rows / b;
+    m_Inverses.resize((size_t) blocks * b * b);
+    matrix.getDiagonalBlocks(b, m_Inverses.data());
+    if (blocks * b < m_Rows) {
+        m_Diagonal.resize(m_Rows);
+        matrix.getDiagonalBlocks(1, m_Diagonal.data());
+    }
+    pool.parallelFor(blocks, [&](size_t first, size_t last, unsigned int) {
+        for (size_t block = first; block < last; block++) {
+            float* m = m_Inverses.data() + block * b * b;
+            if (b == 2) {
+                float det = m[0] * m[3] - m[1] * m[2];
+                if (std::fabs(det) > 1e-30f) {
+                    float inv = 1.0f / det;
+                    float a = m[0];
+                    m[0] = m[3] * inv;
+                    m[1] = -m[1] * inv;
+                    m[2] = -m[2] * inv;
+                    m[3] = a * inv;
+                    continue;
+                }
+            }
+            else {
+                float c[9] = {
+                    m[4] * m[8] - m[5] * m[7], m[2] * m[7] - m[1] * m[8], m[1] * m[5] - m[2] * m[4],
+                    m[5] * m[6] - m[3] * m[8], m[0] * m[8] - m[2] * m[6], m[2] * m[3] - m[0] * m[5],
+                    m[3] * m[7] - m[4] * m[6], m[1] * m[6] - m[0] * m[7], m[0] * m[4] - m[1] * m[3]
+                };
+                float det = m[0] * c[0] + m[1] * c[3] + m[2] * c[6];
+                if (std::fabs(det) > 1e-30f) {
+                    float inv = 1.0f / det;
+                    for (int k = 0; k < 9; k++)
+                        m[k] = c[k] * inv;
+                    continue;
+                }
+            }
+            // singular block, keep just its diagonal
+            for (unsigned int r = 0; r < b; r++) {
+                for (unsigned int k = 0; k < b; k++) {
+                    float& value = m[r * b + k];
+                    value = r == k && value != 0.0f ? 1.0f / value : 0.0f;
+                }
+            }
+        }
+    });
+}
+
+void BlockJacobiPreconditioner::apply(const float* r, float* z, ThreadPool& pool) {
+    unsigned int b = m_BlockSize;
+    unsigned int blocks = m_Rows / b;
+    const float* inverses = m_Inverses.data();
+    pool.parallelFor(blocks, [&](size_t first, size_t last, unsigned int) {
+        for (size_t block = first; block < last; block++) {
+            const float* m = inverses + block * b * b;
+            const float* rb = r + block * b;
+            float* zb = z + block * b;
+            if (b == 2) {
+                zb[0] = m[0] * rb[0] + m[1] * rb[1];
+                zb[1] = m[2] * rb[0] + m[3] * rb[1];
+            }
+            else {
+                zb[0] = m[0] * rb[0] + m[1] * rb[1] + m[2] * rb[2];
+                zb[1] = m[3] * rb[0] + m[4] * rb[1] + m[5] * rb[2];
+                zb[2] = m[6] * rb[0] + m[7] * rb[1] + m[8] * rb[2];
+            }
+        }
+    });
+    for (unsigned int i = blocks * b; i < m_Rows; i++)
+        z[i] = m_Diagonal[i] != 0.0f ? r[i] / m_Diagonal[i] : 0.0f;
+}
+
+IncompleteCholesky::IncompleteCholesky()
+    : m_Rows(0), m_Shift(0.0f), m_Fallback(false) {
+}
+
+// groups rows by level: level(row) = 1 + the highest level among the rows it depends on
+static void buildLevels(unsigned int rows, const std::vector<uint32_t>& offsets, const std::vector<uint32_t>& columns, bool forward,
+    std::vector<uint32_t>& levelRows, std::vector<uint32_t>& levelOffsets) {
+    std::vector<uint32_t> level(rows, 0);
+    uint32_t levelCount = 0;
+    for (unsigned int n = 0; n < rows; n++) {
+        unsigned int i = forward ? n : rows - 1 - n;
+        uint32_t highest = 0;
+        for (uint32_t k = offsets[i]; k < offsets[i + 1]; k++) {
+            if (columns[k] != i)
+                highest = std::max(highest, level[columns[k]] + 1);
+        }
+        level[i] = highest;
+        levelCount = std::max(levelCount, highest + 1);
+    }
+    levelOffsets.assign(levelCount + 1, 0);
+    for (unsigned int i = 0; i < rows; i++)
+        levelOffsets[level[i] + 1]++;
+    for (uint32_t l = 0; l < levelCount; l++)
+        levelOffsets[l + 1] += levelOffsets[l];
+    std::vector<uint32_t> cursor(levelOffsets.begin(), levelOffsets.end() - 1);
+    levelRows.resize(rows);
+    for (unsigned int i = 0; i < rows; i++)
+        levelRows[cursor[level[i]]++] = i;
+}
+
+void IncompleteCholesky::buildPattern(const CsrMatrix& matrix) {
+    m_Rows = matrix.getRows();
+    const uint32_t* offsets = matrix.getRowOffsets();
+    const uint32_t* columns = matrix.getColumnIndices();
+    m_SourceOffsets.assign(offsets, offsets + m_Rows + 1);
+    m_SourceColumns.assign(columns, columns + matrix.getNonZeroCount());
+
+    // lower triangle, with a diagonal even where the matrix has none
+    m_LowerOffsets.assign(1, 0);
+    m_LowerColumns.clear();
+    m_LowerSource.clear();
+    for (unsigned int i = 0; i < m_Rows; i++) {
+        int64_t diagonal = -1;
+        for (uint32_t k = offsets[i]; k < offsets[i + 1] && columns[k] <= i; k++) {
+            if (columns[k] == i) {
+                diagonal = k;
+                break;
+            }
+            m_LowerColumns.push_back(columns[k]);
+            m_LowerSource.push_back(k);
+        }
+        m_LowerColumns.push_back(i);
+        m_LowerSource.push_back(diagonal);
+        m_LowerOffsets.push_back((uint32_t) m_LowerColumns.size());
+    }
+    m_Lower.resize(0);
+    m_Lower.resize(m_LowerColumns.size());
+
+    // transpose: row c of L^T lists the rows of L with an entry in column c,
+    // ascending, so its diagonal comes first
+    std::vector<uint32_t> counts(m_Rows + 1, 0);
+    for (uint32_t column : m_LowerColumns)
+        counts[column + 1]++;
+    for (unsigned int i = 0; i < m_Rows; i++)
+        counts[i + 1] += counts[i];
+    m_UpperOffsets = counts;
+    m_UpperColumns.resize(m_LowerColumns.size());
+    m_UpperEntries.resize(m_LowerColumns.size());
+    for (unsigned int i = 0; i < m_Rows; i++) {
+        for (uint32_t p = m_LowerOffsets[i]; p < m_LowerOffsets[i + 1]; p++) {
+            uint32_t slot = counts[m_LowerColumns[p]]++;
+            m_UpperColumns[slot] = i;
+            m_UpperEntries[slot] = p;
+        }
+    }
+    m_Upper.resize(0);
+    m_Upper.resize(m_UpperColumns.size());
+
+    buildLevels(m_Rows, m_LowerOffsets, m_LowerColumns, true, m_ForwardRows, m_ForwardLevels);
+    buildLevels(m_Rows, m_UpperOffsets, m_UpperColumns, false, m_BackwardRows, m_BackwardLevels);
+    m_Scratch.resize(m_Rows);
+}
+
+// Left looking: L_ic = (A_ic - sum_{j < c} L_ij L_cj) / L_cc over the pattern,
+// L_ii = sqrt(A_ii (1 + shift) - sum_{j < i} L_ij^2). Rows are sorted, so the
+// sums are merges of row i so far with row c.
+bool IncompleteCholesky::factor(const CsrMatrix& matrix, float shift) {
+    const float* values = matrix.getValues();
+    const uint32_t* columns = m_LowerColumns.data();
+    float* lower = m_Lower.data();
+    for (unsigned int i = 0; i < m_Rows; i++) {
+        uint32_t start = m_LowerOffsets[i], end = m_LowerOffsets[i + 1];
+        for (uint32_t p = start; p < end; p++) {
+            uint32_t c = columns[p];
+            double a = m_LowerSource[p] >= 0 ? values[m_LowerSource[p]] : 0.0;
+            double sum = 0.0;
+            if (c == i) {
+                for (uint32_t q = start; q < p; q++)
+                    sum += (double) lower[q] * lower[q];
+                double pivot = a * (1.0 + shift) - sum;
+                if (!(pivot > 0.0))
+                    return false;
+                lower[p] = (float) std::sqrt(pivot);
+                break;
+            }
+            uint32_t q = start, t = m_LowerOffsets[c], last = m_LowerOffsets[c + 1] - 1;
+            while (q < p && t < last) {
+                if (columns[q] == columns[t])
+                    sum += (double) lower[q++] * lower[t++];
+                else if (columns[q] < columns[t])
+                    q++;
+                else
+                    t++;
+            }
+            lower[p] = (float) ((a - sum) / lower[last]);
+        }
+    }
+    return true;
+}
+
+// off the diagonal zero, the diagonal sqrt(|A_ii|) or 1 where it is zero
+void IncompleteCholesky::factorDiagonal(const CsrMatrix& matrix) {
+    const float* values = matrix.getValues();
+    float* lower = m_Lower.data();
+    for (unsigned int i = 0; i < m_Rows; i++) {
+        uint32_t diagonal = m_LowerOffsets[i + 1] - 1;
+        for (uint32_t p = m_LowerOffsets[i]; p < diagonal; p++)
+            lower[p] = 0.0f;
+        float a = m_LowerSource[diagonal] >= 0 ? std::fabs(values[m_LowerSource[diagonal]]) : 0.0f;
+        lower[diagonal] = a > 0.0f ? std::sqrt(a) : 1.0f;
+    }
+}
+
+void IncompleteCholesky::setup(const SparseMatrix& matrix, ThreadPool& pool) {
+    const CsrMatrix* csr = dynamic_cast<const CsrMatrix*>(&matrix);
+    if (!csr) {
+        if (const BsrMatrix* bsr = dynamic_cast<const BsrMatrix*>(&matrix))
+            bsr->toCsr(m_Converted);
+        csr = &m_Converted;
+    }
+    const uint32_t* offsets = csr->getRowOffsets();
+    const uint32_t* columns = csr->getColumnIndices();
+    if (csr->getRows() != m_Rows || csr->getNonZeroCount() != m_SourceColumns.size()
+        || !std::equal(m_SourceOffsets.begin(), m_SourceOffsets.end(), offsets)
+        || !std::equal(m_SourceColumns.begin(), m_SourceColumns.end(), columns))
+        buildPattern(*csr);
+
+    m_Shift = 0.0f;
+    m_Fallback = true;
+    for (unsigned int attempt = 0; attempt <= MaxShiftRetries; attempt++) {
+        if (factor(*csr, m_Shift)) {
+            m_Fallback = false;
+            break;
+        }
+        m_Shift = m_Shift > 0.0f ? 2.0f * m_Shift : 1e-3f;
+    }
+    if (m_Fallback) {
+        m_Shift = 0.0f;
+        factorDiagonal(*csr);
+    }
+    float* upper = m_Upper.data();
+    const float* lower = m_Lower.data();
+    const uint32_t* entries = m_UpperEntries.data();
+    pool.parallelFor(m_Upper.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t k = begin; k < end; k++)
+            upper[k] = lower[entries[k]];
+    });
+}
+
+template<typename F>
+void IncompleteCholesky::forEachLevel(const std::vector<uint32_t>& rows, const std::vector<uint32_t>& levels, ThreadPool& pool, F&& body) {
+    for (size_t level = 0; level + 1 < levels.size(); level++) {
+        uint32_t first = levels[level], count = levels[level + 1] - first;
+        if (count < MinParallelRows) {
+            for (uint32_t n = first; n < first + count; n++)
+                body(rows[n]);
+            continue;
+        }
+        pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+            for (size_t n = begin; n < end; n++)
+                body(rows[first + n]);
+        });
+    }
+}
+
+void IncompleteCholesky::apply(const float* r, float* z, ThreadPool& pool) {
+    // L w = r, then L^T z = w
+    float* w = m_Scratch.data();
+    const float* lower = m_Lower.data();
+    const float* upper = m_Upper.data();
+    auto forward = [&](uint32_t i) {
+        uint32_t start = m_LowerOffsets[i], diagonal = m_LowerOffsets[i + 1] - 1;
+        float sum = r[i];
+        for (uint32_t p = start; p < diagonal; p++)
+            sum -= lower[p] * w[m_LowerColumns[p]];
+        w[i] = sum / lower[diagonal];
+    };
+    auto backward = [&](uint32_t i) {
+        uint32_t diagonal = m_UpperOffsets[i], end = m_UpperOffsets[i + 1];
+        float sum = w[i];
+        for (uint32_t k = diagonal + 1; k < end; k++)
+            sum -= upper[k] * z[m_UpperColumns[k]];
+        z[i] = sum / upper[diagonal];
+    };
+    if (pool.getThreadCount() == 1) {
+        // row order is a valid order too and walks memory linearly; every row
+        // computes the same sum either way
+        for (uint32_t i = 0; i < m_Rows; i++)
+            forward(i);
+        for (uint32_t i = m_Rows; i-- > 0;)
+            backward(i);
+        return;
+    }
+    forEachLevel(m_ForwardRows, m_ForwardLevels, pool, forward);
+    forEachLevel(m_BackwardRows, m_BackwardLevels, pool, backward);
+}
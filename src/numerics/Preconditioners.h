@@ -0,0 +1,106 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "../physics/AlignedArray.h"
+#include "../physics/ThreadPool.h"
+#include "SparseMatrix.h"
+
+enum class PreconditionerType {
+	Jacobi,
+	BlockJacobi,
+	IncompleteCholesky
+};
+
+// Approximate inverse of a symmetric positive definite matrix for the Krylov
+// solvers. setup reads the matrix and has to run again whenever its values
+// change; apply is called every iteration and never allocates.
+class Preconditioner {
+public:
+	virtual ~Preconditioner() {}
+
+	virtual void setup(const SparseMatrix& matrix, ThreadPool& pool) = 0;
+	// z = M^-1 r
+	virtual void apply(const float* r, float* z, ThreadPool& pool) = 0;
+	virtual const char* getName() const = 0;
+};
+
+// blockSize is only used by the block Jacobi preconditioner
+std::unique_ptr<Preconditioner> createPreconditioner(PreconditionerType type, unsigned int blockSize = 3);
+
+// inverse of the diagonal
+class JacobiPreconditioner : public Preconditioner {
+private:
+	AlignedArray<float> m_InvDiagonal;
+public:
+	void setup(const SparseMatrix& matrix, ThreadPool& pool) override;
+	void apply(const float* r, float* z, ThreadPool& pool) override;
+	inline const char* getName() const override { return "jacobi"; };
+};
+
+// Inverse of the 2 x 2 or 3 x 3 diagonal blocks, which for vector valued
+// problems are the couplings between the components of one node. Blocks
+// that don't invert fall back to their diagonal, rows past the last whole
+// block to plain Jacobi.
+class BlockJacobiPreconditioner : public Preconditioner {
+private:
+	unsigned int m_BlockSize;
+	unsigned int m_Rows;
+	AlignedArray<float> m_Inverses; // row major blocks
+	AlignedArray<float> m_Diagonal; // only for the rows past the last block
+public:
+	explicit BlockJacobiPreconditioner(unsigned int blockSize = 3);
+
+	void setup(const SparseMatrix& matrix, ThreadPool& pool) override;
+	void apply(const float* r, float* z, ThreadPool& pool) override;
+	inline const char* getName() const override { return m_BlockSize == 2 ? "block-jacobi2" : "block-jacobi3"; };
+};
+
+// Zero fill incomplete Cholesky, A ~ L L^T with L on the lower triangle of
+// A's pattern. The factorization is serial, left looking with sorted row
+// merges, in double; when a pivot goes non-positive it restarts with the
+// diagonal scaled up by a growing shift (Manteuffel), which succeeds for SPD
+// input. Matrices no shift can fix (a zero or missing diagonal, indefinite
+// saddle point systems) fall back after MaxShiftRetries to L = sqrt(|A_ii|)
+// on the diagonal, a Jacobi preconditioner on |A_ii| that stays positive
+// definite, with 1 for rows whose diagonal is zero. The triangular solves
+// run level scheduled: rows are grouped by the longest chain of dependencies
+// leading to them, and the rows of a level are solved in parallel. The
+// pattern, its transpose and the levels are kept until the matrix pattern
+// changes.
+class IncompleteCholesky : public Preconditioner {
+public:
+	static constexpr unsigned int MinParallelRows = 256; // smaller levels are solved on the calling thread
+	static constexpr unsigned int MaxShiftRetries = 24; // shifts up to 1e-3 * 2^23 before falling back
+private:
+	unsigned int m_Rows;
+	std::vector<uint32_t> m_SourceOffsets, m_SourceColumns; // copy of the matrix pattern it was built for
+	// L by rows, the diagonal last in each row
+	std::vector<uint32_t> m_LowerOffsets, m_LowerColumns;
+	std::vector<int64_t> m_LowerSource; // value position in the matrix, -1 for a missing diagonal
+	AlignedArray<float> m_Lower;
+	// L^T by rows, the diagonal first in each row, as positions into m_Lower
+	std::vector<uint32_t> m_UpperOffsets, m_UpperColumns, m_UpperEntries;
+	AlignedArray<float> m_Upper;
+	std::vector<uint32_t> m_ForwardRows, m_ForwardLevels; // rows grouped by level, level l is [m_ForwardLevels[l], m_ForwardLevels[l + 1])
+	std::vector<uint32_t> m_BackwardRows, m_BackwardLevels;
+	AlignedArray<float> m_Scratch;
+	CsrMatrix m_Converted; // block matrices are factored through a CSR copy
+	float m_Shift; // of the last factorization
+	bool m_Fallback; // the last factorization failed at every shift and is diagonal
+
+	void buildPattern(const CsrMatrix& matrix);
+	bool factor(const CsrMatrix& matrix, float shift);
+	void factorDiagonal(const CsrMatrix& matrix);
+	template<typename F>
+	void forEachLevel(const std::vector<uint32_t>& rows, const std::vector<uint32_t>& levels, ThreadPool& pool, F&& body);
+public:
+	IncompleteCholesky();
+
+	void setup(const SparseMatrix& matrix, ThreadPool& pool) override;
+	void apply(const float* r, float* z, ThreadPool& pool) override;
+	inline const char* getName() const override { return "ic0"; };
+
+	inline float getShift() const { return m_Shift; };
+	inline bool getFallback() const { return m_Fallback; };
+	inline unsigned int getLevelCount() const { return m_ForwardLevels.empty() ? 0 : (unsigned int) m_ForwardLevels.size() - 1; };
+};
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cmath>
+#include "RungeKuttaKernels.h"
+#include "../physics/Cpu.h"
+
+void combineStagesScalar(const double* y, const double* const* k, const double* weights, unsigned int stages,
+    double h, double* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        double sum = 0.0;
+        for (unsigned int s = 0; s < stages; s++)
+            sum += weights[s] * k[s][i];
+        out[i] = y[i] + h * sum;
+    }
+}
+
+double stageErrorScalar(const double* y, const double* next, const double* const* k, const double* weights, unsigned int stages,
+    double h, double absolute, double relative, size_t count) {
+    double largest = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double sum = 0.0;
+        for (unsigned int s = 0; s < stages; s++)
+            sum += weights[s] * k[s][i];
+        double scale = absolute + relative * std::max(std::fabs(y[i]), std::fabs(next[i]));
+        double ratio = std::fabs(h * sum) / scale;
+        if (std::isnan(ratio))
+            return ratio; // std::max would drop it
+        largest = std::max(largest, ratio);
+    }
+    return largest;
+}
+
+void combineStages(const double* y, const double* const* k, const double* weights, unsigned int stages,
+    double h, double* out, size_t count) {
+    switch (getSimdLevel()) {
+#if defined(PHYS_X86)
+    case SimdLevel::AVX512:
+        combineStagesAVX512(y, k, weights, stages, h, out, count);
+        break;
+    case SimdLevel::AVX2:
+        combineStagesAVX2(y, k, weights, stages, h, out, count);
+        break;
+#endif
+    default:
+        combineStagesScalar(y, k, weights, stages, h, out, count);
+    }
+}
+
+double stageError(const double* y, const double* next, const double* const* k, const double* weights, unsigned int stages,
+    double h, double absolute, double relative, size_t count) {
+    switch (getSimdLevel()) {
+#if defined(PHYS_X86)
+    case SimdLevel::AVX512:
+        return stageErrorAVX512(y, next, k, weights, stages, h, absolute, relative, count);
+    case SimdLevel::AVX2:
+        return stageErrorAVX2(y, next, k, weights, stages, h, absolute, relative, count);
+#endif
+    default:
+        return stageErrorScalar(y, next, k, weights, stages, h, absolute, relative, count);
+    }
+}
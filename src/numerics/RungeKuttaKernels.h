@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+
+// Stage arithmetic of an explicit Runge-Kutta step over whole state vectors,
+// where every entry is independent: count can be any slice of the state, so
+// callers split a vector across threads by offsetting every pointer.
+
+// out[i] = y[i] + h * sum over s < stages of weights[s] * k[s][i]
+void combineStages(const double* y, const double* const* k, const double* weights, unsigned int stages,
+	double h, double* out, size_t count);
+
+// Embedded error estimate h * sum over s < stages of weights[s] * k[s][i],
+// returned as the largest ratio to absolute + relative * max(|y[i]|, |next[i]|)
+// over the slice, or NaN when any ratio is NaN so a broken step is never
+// accepted. Dispatches to AVX-512, AVX2 or scalar code at runtime.
+double stageError(const double* y, const double* next, const double* const* k, const double* weights, unsigned int stages,
+	double h, double absolute, double relative, size_t count);
+
+// per instruction set kernels, only call the ones getSimdLevel() allows
+void combineStagesScalar(const double* y, const double* const* k, const double* weights, unsigned int stages,
+	double h, double* out, size_t count);
+void combineStagesAVX2(const double* y, const double* const* k, const double* weights, unsigned int stages,
+	double h, double* out, size_t count);
+void combineStagesAVX512(const double* y, const double* const* k, const double* weights, unsigned int stages,
+	double h, double* out, size_t count);
+double stageErrorScalar(const double* y, const double* next, const double* const* k, const double* weights, unsigned int stages,
+	double h, double absolute, double relative, size_t count);
+double stageErrorAVX2(const double* y, const double* next, const double* const* k, const double* weights, unsigned int stages,
+	double h, double absolute, double relative, size_t count);
+double stageErrorAVX512(const double* y, const double* next, const double* const* k, const double* weights, unsigned int stages,
+	double h, double absolute, double relative, size_t count);
@@ -0,0 +1,58 @@
+#include <cstdint>
+#include <limits>
+#include "RungeKuttaKernels.h"
+#include "../physics/Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+// lanes below the tail length are on
+alignas(32) static const int64_t ramp[8] = { -1, -1, -1, -1, 0, 0, 0, 0 };
+
+PHYS_TARGET_AVX2 void combineStagesAVX2(const double* y, const double* const* k, const double* weights, unsigned int stages,
+    double h, double* out, size_t count) {
+    __m256d step = _mm256_set1_pd(h);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d sum = _mm256_setzero_pd();
+        for (unsigned int s = 0; s < stages; s++)
+            sum = _mm256_fmadd_pd(_mm256_set1_pd(weights[s]), _mm256_loadu_pd(k[s] + i), sum);
+        _mm256_storeu_pd(out + i, _mm256_fmadd_pd(step, sum, _mm256_loadu_pd(y + i)));
+    }
+    if (i < count) {
+        __m256i mask = _mm256_loadu_si256((const __m256i*) (ramp + 4 - (count - i)));
+        __m256d sum = _mm256_setzero_pd();
+        for (unsigned int s = 0; s < stages; s++)
+            sum = _mm256_fmadd_pd(_mm256_set1_pd(weights[s]), _mm256_maskload_pd(k[s] + i, mask), sum);
+        _mm256_maskstore_pd(out + i, mask, _mm256_fmadd_pd(step, sum, _mm256_maskload_pd(y + i, mask)));
+    }
+}
+
+PHYS_TARGET_AVX2 double stageErrorAVX2(const double* y, const double* next, const double* const* k, const double* weights, unsigned int stages,
+    double h, double absolute, double relative, size_t count) {
+    const __m256d signBit = _mm256_set1_pd(-0.0);
+    __m256d step = _mm256_set1_pd(h);
+    __m256d tolerance = _mm256_set1_pd(absolute);
+    __m256d scale = _mm256_set1_pd(relative);
+    __m256d largest = _mm256_setzero_pd();
+    __m256d invalid = _mm256_setzero_pd(); // lanes that saw a NaN ratio, which max_pd drops
+    for (size_t i = 0; i < count; i += 4) {
+        __m256i mask = i + 4 <= count ? _mm256_set1_epi64x(-1) : _mm256_loadu_si256((const __m256i*) (ramp + 4 - (count - i)));
+        __m256d sum = _mm256_setzero_pd();
+        for (unsigned int s = 0; s < stages; s++)
+            sum = _mm256_fmadd_pd(_mm256_set1_pd(weights[s]), _mm256_maskload_pd(k[s] + i, mask), sum);
+        __m256d size = _mm256_max_pd(_mm256_andnot_pd(signBit, _mm256_maskload_pd(y + i, mask)),
+            _mm256_andnot_pd(signBit, _mm256_maskload_pd(next + i, mask)));
+        __m256d error = _mm256_andnot_pd(signBit, _mm256_mul_pd(step, sum));
+        // masked lanes load zeros, and 0 / absolute is cleared in case absolute is 0
+        __m256d ratio = _mm256_and_pd(_mm256_div_pd(error, _mm256_fmadd_pd(scale, size, tolerance)), _mm256_castsi256_pd(mask));
+        invalid = _mm256_or_pd(invalid, _mm256_cmp_pd(ratio, ratio, _CMP_UNORD_Q));
+        largest = _mm256_max_pd(largest, ratio);
+    }
+    if (_mm256_movemask_pd(invalid))
+        return std::numeric_limits<double>::quiet_NaN();
+    __m128d half = _mm_max_pd(_mm256_castpd256_pd128(largest), _mm256_extractf128_pd(largest, 1));
+    half = _mm_max_sd(half, _mm_unpackhi_pd(half, half));
+    return _mm_cvtsd_f64(half);
+}
+
+#endif
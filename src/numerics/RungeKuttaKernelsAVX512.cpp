@@ -0,0 +1,45 @@
+#include <limits>
+#include "RungeKuttaKernels.h"
+#include "../physics/Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+PHYS_TARGET_AVX512 void combineStagesAVX512(const double* y, const double* const* k, const double* weights, unsigned int stages,
+    double h, double* out, size_t count) {
+    __m512d step = _mm512_set1_pd(h);
+    for (size_t i = 0; i < count; i += 8) {
+        size_t left = count - i;
+        __mmask8 lanes = left >= 8 ? (__mmask8) 0xff : (__mmask8) ((1u << left) - 1);
+        __m512d sum = _mm512_setzero_pd();
+        for (unsigned int s = 0; s < stages; s++)
+            sum = _mm512_fmadd_pd(_mm512_set1_pd(weights[s]), _mm512_maskz_loadu_pd(lanes, k[s] + i), sum);
+        _mm512_mask_storeu_pd(out + i, lanes, _mm512_fmadd_pd(step, sum, _mm512_maskz_loadu_pd(lanes, y + i)));
+    }
+}
+
+PHYS_TARGET_AVX512 double stageErrorAVX512(const double* y, const double* next, const double* const* k, const double* weights, unsigned int stages,
+    double h, double absolute, double relative, size_t count) {
+    __m512d step = _mm512_set1_pd(h);
+    __m512d tolerance = _mm512_set1_pd(absolute);
+    __m512d scale = _mm512_set1_pd(relative);
+    __m512d largest = _mm512_setzero_pd();
+    __mmask8 invalid = 0; // lanes that saw a NaN ratio, which max_pd drops
+    for (size_t i = 0; i < count; i += 8) {
+        size_t left = count - i;
+        __mmask8 lanes = left >= 8 ? (__mmask8) 0xff : (__mmask8) ((1u << left) - 1);
+        __m512d sum = _mm512_setzero_pd();
+        for (unsigned int s = 0; s < stages; s++)
+            sum = _mm512_fmadd_pd(_mm512_set1_pd(weights[s]), _mm512_maskz_loadu_pd(lanes, k[s] + i), sum);
+        __m512d size = _mm512_max_pd(_mm512_abs_pd(_mm512_maskz_loadu_pd(lanes, y + i)),
+            _mm512_abs_pd(_mm512_maskz_loadu_pd(lanes, next + i)));
+        __m512d error = _mm512_abs_pd(_mm512_mul_pd(step, sum));
+        __m512d ratio = _mm512_maskz_div_pd(lanes, error, _mm512_fmadd_pd(scale, size, tolerance));
+        invalid |= _mm512_cmp_pd_mask(ratio, ratio, _CMP_UNORD_Q);
+        largest = _mm512_max_pd(largest, ratio);
+    }
+    if (invalid)
+        return std::numeric_limits<double>::quiet_NaN();
+    return _mm512_reduce_max_pd(largest);
+}
+
+#endif
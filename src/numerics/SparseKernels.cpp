@@ -0,0 +1,27 @@
+#include "SparseKernels.h"
+#include "../physics/Cpu.h"
+
+void csrMultiplyRowsScalar(const CsrView& matrix, const float* x, float* y, size_t beginRow, size_t endRow) {
+    for (size_t row = beginRow; row < endRow; row++) {
+        float sum = 0.0f;
+        for (uint32_t k = matrix.rowOffsets[row]; k < matrix.rowOffsets[row + 1]; k++)
+            sum += matrix.values[k] * x[matrix.columnIndices[k]];
+        y[row] = sum;
+    }
+}
+
+void csrMultiplyRows(const CsrView& matrix, const float* x, float* y, size_t beginRow, size_t endRow) {
+    switch (getSimdLevel()) {
+#if defined(PHYS_X86)
+    case SimdLevel::AVX512:
+        csrMultiplyRowsAVX512(matrix, x, y, beginRow, endRow);
+        break;
+    case SimdLevel::AVX2:
+        csrMultiplyRowsAVX2(matrix, x, y, beginRow, endRow);
+        break;
+#endif
+    default:
+        csrMultiplyRowsScalar(matrix, x, y, beginRow, endRow);
+        break;
+    }
+}
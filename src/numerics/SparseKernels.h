@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+struct CsrView {
+	const uint32_t* rowOffsets;
+	const uint32_t* columnIndices;
+	const float* values;
+};
+
+// y[r] = sum over row r of value * x[column] for rows [beginRow, endRow). The
+// SIMD kernels run each row 8 or 16 values at a time with gathers from x and a
+// masked tail, so rows shorter than a vector (7 point stencils) take one
+// masked step. Dispatches to AVX-512, AVX2 or scalar code at runtime.
+void csrMultiplyRows(const CsrView& matrix, const float* x, float* y, size_t beginRow, size_t endRow);
+
+// per instruction set kernels, only call the ones getSimdLevel() allows
+void csrMultiplyRowsScalar(const CsrView& matrix, const float* x, float* y, size_t beginRow, size_t endRow);
+void csrMultiplyRowsAVX2(const CsrView& matrix, const float* x, float* y, size_t beginRow, size_t endRow);
+void csrMultiplyRowsAVX512(const CsrView& matrix, const float* x, float* y, size_t beginRow, size_t endRow);
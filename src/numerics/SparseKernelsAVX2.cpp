@@ -0,0 +1,30 @@
+#include "SparseKernels.h"
+#include "../physics/Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+PHYS_TARGET_AVX2 void csrMultiplyRowsAVX2(const CsrView& matrix, const float* x, float* y, size_t beginRow, size_t endRow) {
+    // lanes below the tail length are on
+    alignas(32) static const int32_t ramp[16] = { -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0 };
+    for (size_t row = beginRow; row < endRow; row++) {
+        uint32_t k = matrix.rowOffsets[row], end = matrix.rowOffsets[row + 1];
+        __m256 sum = _mm256_setzero_ps();
+        for (; k + 8 <= end; k += 8) {
+            __m256i columns = _mm256_loadu_si256((const __m256i*) (matrix.columnIndices + k));
+            sum = _mm256_fmadd_ps(_mm256_loadu_ps(matrix.values + k), _mm256_i32gather_ps(x, columns, 4), sum);
+        }
+        if (k < end) {
+            __m256i mask = _mm256_loadu_si256((const __m256i*) (ramp + 8 - (end - k)));
+            __m256i columns = _mm256_maskload_epi32((const int*) (matrix.columnIndices + k), mask);
+            __m256 values = _mm256_maskload_ps(matrix.values + k, mask);
+            __m256 gathered = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), x, columns, _mm256_castsi256_ps(mask), 4);
+            sum = _mm256_fmadd_ps(values, gathered, sum);
+        }
+        __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+        half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+        half = _mm_add_ss(half, _mm_movehdup_ps(half));
+        y[row] = _mm_cvtss_f32(half);
+    }
+}
+
+#endif
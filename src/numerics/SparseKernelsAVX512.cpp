@@ -0,0 +1,25 @@
+#include "SparseKernels.h"
+#include "../physics/Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+PHYS_TARGET_AVX512 void csrMultiplyRowsAVX512(const CsrView& matrix, const float* x, float* y, size_t beginRow, size_t endRow) {
+    for (size_t row = beginRow; row < endRow; row++) {
+        uint32_t k = matrix.rowOffsets[row], end = matrix.rowOffsets[row + 1];
+        __m512 sum = _mm512_setzero_ps();
+        for (; k + 16 <= end; k += 16) {
+            __m512i columns = _mm512_loadu_si512(matrix.columnIndices + k);
+            sum = _mm512_fmadd_ps(_mm512_loadu_ps(matrix.values + k), _mm512_i32gather_ps(columns, x, 4), sum);
+        }
+        if (k < end) {
+            __mmask16 mask = (__mmask16) ((1u << (end - k)) - 1);
+            __m512i columns = _mm512_maskz_loadu_epi32(mask, matrix.columnIndices + k);
+            __m512 values = _mm512_maskz_loadu_ps(mask, matrix.values + k);
+            __m512 gathered = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, columns, x, 4);
+            sum = _mm512_fmadd_ps(values, gathered, sum);
+        }
+        y[row] = _mm512_reduce_add_ps(sum);
+    }
+}
+
+#endif
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include "SparseMatrix.h"
+#include "SparseKernels.h"
+
+CsrMatrix::CsrMatrix()
+    : m_Rows(0) {
+    m_RowOffsets.push_back(0);
+}
+
+void CsrMatrix::setPattern(unsigned int rows, const std::vector<uint32_t>& rowOffsets, const std::vector<uint32_t>& columnIndices) {
+    m_Rows = rows;
+    m_RowOffsets.resize(0);
+    m_ColumnIndices.resize(0);
+    m_Values.resize(0);
+    for (uint32_t offset : rowOffsets)
+        m_RowOffsets.push_back(offset);
+    for (uint32_t column : columnIndices)
+        m_ColumnIndices.push_back(column);
+    m_Values.resize(columnIndices.size());
+}
+
+long long CsrMatrix::find(unsigned int row, unsigned int column) const {
+    const uint32_t* first = m_ColumnIndices.data() + m_RowOffsets[row];
+    const uint32_t* last = m_ColumnIndices.data() + m_RowOffsets[row + 1];
+    const uint32_t* it = std::lower_bound(first, last, column);
+    if (it == last || *it != column)
+        return -1;
+    return it - m_ColumnIndices.data();
+}
+
+void CsrMatrix::multiply(const float* x, float* y, ThreadPool& pool) const {
+    CsrView view = { m_RowOffsets.data(), m_ColumnIndices.data(), m_Values.data() };
+    pool.parallelFor(m_Rows, [&](size_t begin, size_t end, unsigned int) {
+        csrMultiplyRows(view, x, y, begin, end);
+    });
+}
+
+void CsrMatrix::getDiagonalBlocks(unsigned int blockSize, float* blocks) const {
+    unsigned int count = m_Rows / blockSize;
+    std::fill(blocks, blocks + (size_t) count * blockSize * blockSize, 0.0f);
+    for (unsigned int row = 0; row < count * blockSize; row++) {
+        unsigned int block = row / blockSize, first = block * blockSize;
+        float* out = blocks + ((size_t) block * blockSize + row - first) * blockSize;
+        for (uint32_t k = m_RowOffsets[row]; k < m_RowOffsets[row + 1]; k++) {
+            uint32_t column = m_ColumnIndices[k];
+            if (column >= first && column < first + blockSize)
+                out[column - first] = m_Values[k];
+        }
+    }
+}
+
+BsrMatrix::BsrMatrix()
+    : m_BlockSize(3), m_BlockRows(0) {
+    m_RowOffsets.push_back(0);
+}
+
+void BsrMatrix::setPattern(unsigned int blockSize, unsigned int blockRows, const std::vector<uint32_t>& rowOffsets, const std::vector<uint32_t>& columnIndices) {
+    m_BlockSize = blockSize == 2 ? 2 : 3;
+    m_BlockRows = blockRows;
+    m_RowOffsets.resize(0);
+    m_ColumnIndices.resize(0);
+    m_Values.resize(0);
+    for (uint32_t offset : rowOffsets)
+        m_RowOffsets.push_back(offset);
+    for (uint32_t column : columnIndices)
+        m_ColumnIndices.push_back(column);
+    m_Values.resize(columnIndices.size() * m_BlockSize * m_BlockSize);
+}
+
+void BsrMatrix::assign(const CsrMatrix& csr, unsigned int blockSize) {
+    blockSize = blockSize == 2 ? 2 : 3;
+    unsigned int blockRows = csr.getRows() / blockSize;
+    const uint32_t* offsets = csr.getRowOffsets();
+    const uint32_t* columns = csr.getColumnIndices();
+    const float* values = csr.getValues();
+
+    // a block exists where any of its rows has an entry
+    std::vector<uint32_t> rowOffsets(1, 0), blockColumns;
+    for (unsigned int blockRow = 0; blockRow < blockRows; blockRow++) {
+        size_t first = blockColumns.size();
+        for (unsigned int row = blockRow * blockSize; row < (blockRow + 1) * blockSize; row++) {
+            for (uint32_t k = offsets[row]; k < offsets[row + 1]; k++)
+                blockColumns.push_back(columns[k] / blockSize);
+        }
+        std::sort(blockColumns.begin() + first, blockColumns.end());
+        blockColumns.erase(std::unique(blockColumns.begin() + first, blockColumns.end()), blockColumns.end());
+        rowOffsets.push_back((uint32_t) blockColumns.size());
+    }
+    if (blockSize != m_BlockSize || blockRows != m_BlockRows
+        || !std::equal(rowOffsets.begin(), rowOffsets.end(), m_RowOffsets.data(), m_RowOffsets.data() + m_RowOffsets.size())
+        || !std::equal(blockColumns.begin(), blockColumns.end(), m_ColumnIndices.data(), m_ColumnIndices.data() + m_ColumnIndices.size()))
+        setPattern(blockSize, blockRows, rowOffsets, blockColumns);
+
+    std::fill(m_Values.data(), m_Values.data() + m_Values.size(), 0.0f);
+    for (unsigned int blockRow = 0; blockRow < blockRows; blockRow++) {
+        const uint32_t* first = m_ColumnIndices.data() + m_RowOffsets[blockRow];
+        const uint32_t* last = m_ColumnIndices.data() + m_RowOffsets[blockRow + 1];
+        for (unsigned int r = 0; r < blockSize; r++) {
+            unsigned int row = blockRow * blockSize + r;
+            for (uint32_t k = offsets[row]; k < offsets[row + 1]; k++) {
+                size_t block = std::lower_bound(first, last, columns[k] / blockSize) - m_ColumnIndices.data();
+                m_Values[(block * blockSize + r) * blockSize + columns[k] % blockSize] = values[k];
+            }
+        }
+    }
+}
+
+void BsrMatrix::toCsr(CsrMatrix& csr) const {
+    unsigned int b = m_BlockSize;
+    std::vector<uint32_t> rowOffsets(1, 0), columns;
+    columns.reserve(m_Values.size());
+    for (unsigned int blockRow = 0; blockRow < m_BlockRows; blockRow++) {
+        for (unsigned int r = 0; r < b; r++) {
+            for (uint32_t k = m_RowOffsets[blockRow]; k < m_RowOffsets[blockRow + 1]; k++) {
+                for (unsigned int c = 0; c < b; c++)
+                    columns.push_back(m_ColumnIndices[k] * b + c);
+            }
+            rowOffsets.push_back((uint32_t) columns.size());
+        }
+    }
+    csr.setPattern(getRows(), rowOffsets, columns);
+    float* values = csr.getValues();
+    size_t next = 0;
+    for (unsigned int blockRow = 0; blockRow < m_BlockRows; blockRow++) {
+        for (unsigned int r = 0; r < b; r++) {
+            for (uint32_t k = m_RowOffsets[blockRow]; k < m_RowOffsets[blockRow + 1]; k++) {
+                for (unsigned int c = 0; c < b; c++)
+                    values[next++] = m_Values[((size_t) k * b + r) * b + c];
+            }
+        }
+    }
+}
+
+// fixed size blocks so the compiler unrolls them and keeps y in registers;
+// each block's row products are summed on their own before going into the
+// running sums, so consecutive blocks don't wait on each other
+template<unsigned int B>
+static void bsrMultiplyRows(const uint32_t* offsets, const uint32_t* columns, const float* values, const float* x, float* y, size_t begin, size_t end) {
+    for (size_t blockRow = begin; blockRow < end; blockRow++) {
+        float sum[B] = {};
+        for (uint32_t k = offsets[blockRow]; k < offsets[blockRow + 1]; k++) {
+            const float* block = values + (size_t) k * B * B;
+            const float* xb = x + (size_t) columns[k] * B;
+            float xl[B];
+            for (unsigned int c = 0; c < B; c++)
+                xl[c] = xb[c];
+            for (unsigned int r = 0; r < B; r++) {
+                float product = block[r * B] * xl[0];
+                for (unsigned int c = 1; c < B; c++)
+                    product += block[r * B + c] * xl[c];
+                sum[r] += product;
+            }
+        }
+        for (unsigned int r = 0; r < B; r++)
+            y[blockRow * B + r] = sum[r];
+    }
+}
+
+void BsrMatrix::multiply(const float* x, float* y, ThreadPool& pool) const {
+    pool.parallelFor(m_BlockRows, [&](size_t begin, size_t end, unsigned int) {
+        if (m_BlockSize == 2)
+            bsrMultiplyRows<2>(m_RowOffsets.data(), m_ColumnIndices.data(), m_Values.data(), x, y, begin, end);
+        else
+            bsrMultiplyRows<3>(m_RowOffsets.data(), m_ColumnIndices.data(), m_Values.data(), x, y, begin, end);
+    });
+}
+
+void BsrMatrix::getDiagonalBlocks(unsigned int blockSize, float* blocks) const {
+    unsigned int rows = getRows(), count = rows / blockSize;
+    std::fill(blocks, blocks + (size_t) count * blockSize * blockSize, 0.0f);
+    unsigned int b = m_BlockSize;
+    for (unsigned int blockRow = 0; blockRow < m_BlockRows; blockRow++) {
+        for (uint32_t k = m_RowOffsets[blockRow]; k < m_RowOffsets[blockRow + 1]; k++) {
+            for (unsigned int r = 0; r < b; r++) {
+                for (unsigned int c = 0; c < b; c++) {
+                    unsigned int row = blockRow * b + r, column = m_ColumnIndices[k] * b + c;
+                    if (row / blockSize == column / blockSize && row < count * blockSize)
+                        blocks[((size_t) (row / blockSize) * blockSize + row % blockSize) * blockSize + column % blockSize] = m_Values[((size_t) k * b + r) * b + c];
+                }
+            }
+        }
+    }
+}
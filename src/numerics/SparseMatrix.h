@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "../physics/AlignedArray.h"
+#include "../physics/ThreadPool.h"
+
+// Square sparse matrix as the solvers and preconditioners see it. Patterns are
+// set once and the values rewritten in place as often as needed, so solvers
+// that reassemble every step never reallocate.
+class SparseMatrix {
+public:
+	virtual ~SparseMatrix() {}
+
+	// y = A x, rows split across the pool
+	virtual void multiply(const float* x, float* y, ThreadPool& pool) const = 0;
+	// the rows / blockSize diagonal blocks, each blockSize x blockSize row major;
+	// blockSize 1 is the plain diagonal. Entries outside the pattern are zero.
+	virtual void getDiagonalBlocks(unsigned int blockSize, float* blocks) const = 0;
+	virtual const char* getName() const = 0;
+
+	virtual unsigned int getRows() const = 0;
+	virtual size_t getNonZeroCount() const = 0; // stored values, explicit zeros of blocks included
+	virtual size_t getStoredBytes() const = 0; // values and indices, what one multiply streams
+};
+
+// Compressed sparse row: per row, ascending column indices and their values.
+// The multiply is vectorized with gathers (see SparseKernels.h).
+class CsrMatrix : public SparseMatrix {
+private:
+	unsigned int m_Rows;
+	AlignedArray<uint32_t> m_RowOffsets; // row r is [m_RowOffsets[r], m_RowOffsets[r + 1])
+	AlignedArray<uint32_t> m_ColumnIndices;
+	AlignedArray<float> m_Values;
+public:
+	CsrMatrix();
+
+	// columns within a row must be ascending; values start at zero
+	void setPattern(unsigned int rows, const std::vector<uint32_t>& rowOffsets, const std::vector<uint32_t>& columnIndices);
+	// position of (row, column) in the values, or -1 when it isn't in the pattern
+	long long find(unsigned int row, unsigned int column) const;
+
+	void multiply(const float* x, float* y, ThreadPool& pool) const override;
+	void getDiagonalBlocks(unsigned int blockSize, float* blocks) const override;
+	inline const char* getName() const override { return "csr"; };
+
+	inline float* getValues() { return m_Values.data(); };
+	inline const float* getValues() const { return m_Values.data(); };
+	inline const uint32_t* getRowOffsets() const { return m_RowOffsets.data(); };
+	inline const uint32_t* getColumnIndices() const { return m_ColumnIndices.data(); };
+	inline unsigned int getRows() const override { return m_Rows; };
+	inline size_t getNonZeroCount() const override { return m_Values.size(); };
+	inline size_t getStoredBytes() const override { return m_Values.size() * (sizeof(float) + sizeof(uint32_t)) + m_RowOffsets.size() * sizeof(uint32_t); };
+};
+
+// Block compressed sparse row with 2 x 2 or 3 x 3 blocks, row major within a
+// block. Vector valued problems (elasticity, fluids) couple all components of
+// two nodes at once, so one column index serves a whole block and each x
+// block is loaded once for all its rows.
+class BsrMatrix : public SparseMatrix {
+private:
+	unsigned int m_BlockSize;
+	unsigned int m_BlockRows;
+	AlignedArray<uint32_t> m_RowOffsets; // in blocks
+	AlignedArray<uint32_t> m_ColumnIndices; // block columns
+	AlignedArray<float> m_Values;
+public:
+	BsrMatrix();
+
+	// block columns within a block row must be ascending; values start at zero
+	void setPattern(unsigned int blockSize, unsigned int blockRows, const std::vector<uint32_t>& rowOffsets, const std::vector<uint32_t>& columnIndices);
+	// takes the pattern and values of csr, grouped into blocks; the rows must be
+	// a multiple of blockSize
+	void assign(const CsrMatrix& csr, unsigned int blockSize);
+	// and back, every block stored in full
+	void toCsr(CsrMatrix& csr) const;
+
+	void multiply(const float* x, float* y, ThreadPool& pool) const override;
+	void getDiagonalBlocks(unsigned int blockSize, float* blocks) const override;
+	inline const char* getName() const override { return m_BlockSize == 2 ? "bsr2" : "bsr3"; };
+
+	inline float* getValues() { return m_Values.data(); };
+	inline const float* getValues() const { return m_Values.data(); };
+	inline const uint32_t* getRowOffsets() const { return m_RowOffsets.data(); };
+	inline const uint32_t* getColumnIndices() const { return m_ColumnIndices.data(); };
+	inline unsigned int getBlockSize() const { return m_BlockSize; };
+	inline unsigned int getBlockRows() const { return m_BlockRows; };
+	inline unsigned int getRows() const override { return m_BlockRows * m_BlockSize; };
+	inline size_t getNonZeroCount() const override { return m_Values.size(); };
+	inline size_t getStoredBytes() const override { return m_Values.size() * sizeof(float) + (m_ColumnIndices.size() + m_RowOffsets.size()) * sizeof(uint32_t); };
+};
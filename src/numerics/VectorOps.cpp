@@ -0,0 +1,25 @@
+#include <algorithm>
+#include "VectorOps.h"
+
+double blockDot(const float* a, const float* b, size_t count, std::vector<double>& blockSums, ThreadPool& pool) {
+    size_t blocks = (count + DotBlockSize - 1) / DotBlockSize;
+    if (blockSums.size() < blocks)
+        blockSums.resize(blocks);
+    pool.parallelFor(blocks, [&](size_t first, size_t last, unsigned int) {
+        for (size_t block = first; block < last; block++) {
+            double sum = 0.0;
+            for (size_t i = block * DotBlockSize; i < std::min(count, (block + 1) * DotBlockSize); i++)
+                sum += (double) a[i] * b[i];
+            blockSums[block] = sum;
+        }
+    });
+    return sumBlocks(blockSums, count);
+}
+
+double sumBlocks(const std::vector<double>& blockSums, size_t count) {
+    size_t blocks = (count + DotBlockSize - 1) / DotBlockSize;
+    double total = 0.0;
+    for (size_t block = 0; block < blocks; block++)
+        total += blockSums[block];
+    return total;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <vector>
+#include "../physics/ThreadPool.h"
+
+// Dot products for the iterative solvers. Partial sums are taken over fixed
+// blocks of DotBlockSize entries in double and added in block order, so the
+// result doesn't depend on the thread count. blockSums is caller owned
+// scratch; once it has grown to the vector size no call allocates.
+static constexpr size_t DotBlockSize = 1024;
+
+double blockDot(const float* a, const float* b, size_t count, std::vector<double>& blockSums, ThreadPool& pool);
+// adds up what a blocked pass left in blockSums, one entry per block
+double sumBlocks(const std::vector<double>& blockSums, size_t count);
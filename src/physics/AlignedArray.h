@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Growable array of plain data whose storage starts on a cache line, so SIMD
+// kernels can stream through it without straddling lines at the front.
+template<typename T>
+class AlignedArray {
+	static_assert(std::is_trivially_copyable<T>::value, "AlignedArray only holds plain data");
+private:
+	T* m_Data;
+	size_t m_Size;
+	size_t m_Capacity;
+
+	void reallocate(size_t capacity) {
+		T* data = (T*) ::operator new(capacity * sizeof(T), std::align_val_t(Alignment));
+		if (m_Data) {
+			std::memcpy(data, m_Data, m_Size * sizeof(T));
+			::operator delete(m_Data, std::align_val_t(Alignment));
+		}
+		m_Data = data;
+		m_Capacity = capacity;
+	}
+public:
+	static constexpr size_t Alignment = 64;
+
+	AlignedArray() : m_Data(nullptr), m_Size(0), m_Capacity(0) {}
+	explicit AlignedArray(size_t size) : AlignedArray() { resize(size); }
+	AlignedArray(const AlignedArray& other) : AlignedArray() { *this = other; }
+	AlignedArray(AlignedArray&& other) noexcept : m_Data(other.m_Data), m_Size(other.m_Size), m_Capacity(other.m_Capacity) {
+		other.m_Data = nullptr;
+		other.m_Size = other.m_Capacity = 0;
+	}
+	~AlignedArray() {
+		if (m_Data)
+			::operator delete(m_Data, std::align_val_t(Alignment));
+	}
+
+	AlignedArray& operator=(const AlignedArray& other) {
+		if (this != &other) {
+			m_Size = 0;
+			if (m_Capacity < other.m_Size)
+				reallocate(other.m_Size);
+			std::memcpy(m_Data, other.m_Data, other.m_Size * sizeof(T));
+			m_Size = other.m_Size;
+		}
+		return *this;
+	}
+	AlignedArray& operator=(AlignedArray&& other) noexcept {
+		std::swap(m_Data, other.m_Data);
+		std::swap(m_Size, other.m_Size);
+		std::swap(m_Capacity, other.m_Capacity);
+		return *this;
+	}
+
+	void reserve(size_t capacity) {
+		if (capacity > m_Capacity)
+			reallocate(capacity);
+	}
+	void resize(size_t size) { // new elements are zeroed
+		if (size > m_Capacity)
+			reallocate(size > m_Capacity * 2 ? size : m_Capacity * 2);
+		if (size > m_Size)
+			std::memset((void*) (m_Data + m_Size), 0, (size - m_Size) * sizeof(T));
+		m_Size = size;
+	}
+	void push_back(const T& value) {
+		if (m_Size == m_Capacity)
+			reallocate(m_Capacity ? m_Capacity * 2 : 16);
+		m_Data[m_Size++] = value;
+	}
+	void clear() { m_Size = 0; }
+	void fill(const T& value) {
+		for (size_t i = 0; i < m_Size; i++)
+			m_Data[i] = value;
+	}
+
+	inline T* data() { return m_Data; };
+	inline const T* data() const { return m_Data; };
+	inline size_t size() const { return m_Size; };
+	inline bool empty() const { return m_Size == 0; };
+	inline T& operator[](size_t index) { return m_Data[index]; };
+	inline const T& operator[](size_t index) const { return m_Data[index]; };
+	inline T* begin() { return m_Data; };
+	inline T* end() { return m_Data + m_Size; };
+	inline const T* begin() const { return m_Data; };
+	inline const T* end() const { return m_Data + m_Size; };
+};
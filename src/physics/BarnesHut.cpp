@@ -0,0 +1,96 @@
+#include <cmath>
+#include <algorithm>
+#include "BarnesHut.h"
+#include "FieldKernels.h"
+
+BarnesHut::BarnesHut()
+    : m_Theta(0.5f) {
+}
+
+void BarnesHut::setOpeningAngle(float theta) {
+    m_Theta = theta;
+}
+
+void BarnesHut::computeGroup(ParticleStore& particles, InteractionList& list, uint32_t begin, uint32_t end) const {
+    const std::vector<OctreeNode>& nodes = m_Tree.getNodes();
+    const float* x = m_Tree.getX().data();
+    const float* y = m_Tree.getY().data();
+    const float* z = m_Tree.getZ().data();
+    const float* strength = m_Tree.getStrength().data();
+    float lo[3] = { x[begin], y[begin], z[begin] };
+    float hi[3] = { lo[0], lo[1], lo[2] };
+    for (uint32_t i = begin + 1; i < end; i++) {
+        float p[3] = { x[i], y[i], z[i] };
+        for (int c = 0; c < 3; c++) {
+            lo[c] = std::min(lo[c], p[c]);
+            hi[c] = std::max(hi[c], p[c]);
+        }
+    }
+
+    // a node is far enough when its size over its distance to the nearest point
+    // of the group's box is below theta, which then holds for every particle
+    list.x.clear();
+    list.y.clear();
+    list.z.clear();
+    list.strength.clear();
+    float theta2 = m_Theta * m_Theta;
+    uint32_t nodeCount = (uint32_t) nodes.size();
+    uint32_t index = 0;
+    while (index < nodeCount) {
+        const OctreeNode& node = nodes[index];
+        float d2 = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            float d = std::max(std::max(lo[c] - node.center[c], node.center[c] - hi[c]), 0.0f);
+            d2 += d * d;
+        }
+        if (node.size * node.size < theta2 * d2) {
+            list.x.push_back(node.center[0]);
+            list.y.push_back(node.center[1]);
+            list.z.push_back(node.center[2]);
+            list.strength.push_back(node.strength);
+            index = node.next;
+        }
+        else if (node.isLeaf(index)) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                list.x.push_back(x[i]);
+                list.y.push_back(y[i]);
+                list.z.push_back(z[i]);
+                list.strength.push_back(strength[i]);
+            }
+            index = node.next;
+        }
+        else
+            index++;
+    }
+
+    uint32_t count = end - begin;
+    float forceScale = getForceScale();
+    list.field.resize(3 * GroupSize);
+    list.field.fill(0.0f);
+    FieldSources sources = { list.x.data(), list.y.data(), list.z.data(), list.strength.data(), list.x.size() };
+    FieldTargets targets = { x + begin, y + begin, z + begin,
+                             list.field.data(), list.field.data() + GroupSize, list.field.data() + 2 * GroupSize, count };
+    accumulateField(sources, targets, m_Softening * m_Softening);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t body = m_Tree.getOrder()[begin + i];
+        float scale = forceScale * strength[begin + i];
+        particles.fx[body] += scale * list.field[i];
+        particles.fy[body] += scale * list.field[GroupSize + i];
+        particles.fz[body] += scale * list.field[2 * GroupSize + i];
+    }
+}
+
+void BarnesHut::accumulate(ParticleStore& particles, ThreadPool& pool) {
+    m_Tree.build(particles, getStrengths(particles), pool);
+    if (m_Tree.getNodes().empty())
+        return;
+    m_Lists.resize(pool.getThreadCount());
+    uint32_t count = (uint32_t) particles.size();
+    size_t groups = (count + GroupSize - 1) / GroupSize;
+    pool.parallelFor(groups, [&](size_t first, size_t last, unsigned int t) {
+        for (size_t group = first; group < last; group++) {
+            uint32_t begin = (uint32_t) group * GroupSize;
+            computeGroup(particles, m_Lists[t], begin, std::min(begin + GroupSize, count));
+        }
+    });
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include "ForceProvider.h"
+#include "AlignedArray.h"
+#include "Octree.h"
+
+// Barnes-Hut tree code on the shared Octree. Forces are computed per group of
+// consecutive particles in tree order: one walk gathers the nodes that are far
+// enough from the whole group, with the opening angle theta, plus the particles
+// of the leaves that aren't, and the vectorized field kernel sums that list for
+// every particle of the group. theta = 0 opens every node and gives the direct
+// sum. Nodes are monopoles about their center, so mixed sign charges converge
+// slower than masses.
+class BarnesHut : public ForceProvider {
+public:
+	static constexpr unsigned int GroupSize = 32;
+private:
+	struct InteractionList {
+		AlignedArray<float> x, y, z, strength;
+		AlignedArray<float> field; // 3 * GroupSize
+	};
+
+	float m_Theta;
+	Octree m_Tree;
+	std::vector<InteractionList> m_Lists; // per thread
+
+	void computeGroup(ParticleStore& particles, InteractionList& list, uint32_t begin, uint32_t end) const;
+public:
+	BarnesHut();
+
+	void accumulate(ParticleStore& particles, ThreadPool& pool) override;
+	inline const char* getName() const override { return "barnes-hut"; };
+
+	void setOpeningAngle(float theta);
+	inline float getOpeningAngle() const { return m_Theta; };
+	inline const Octree& getTree() const { return m_Tree; };
+};
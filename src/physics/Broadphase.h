@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+
+struct BodyPair {
+	unsigned int a, b; // a < b
+};
+
+enum class BroadphaseType {
+	None,
+	UniformGrid,
+	DynamicTree,
+	SweepAndPrune
+};
+
+// Finds pairs of bodies whose bounding boxes overlap. Bodies are the particles of
+// a ParticleStore, bounded by a box of half size radius around their position.
+class Broadphase {
+public:
+	virtual ~Broadphase() {}
+
+	// bring the structure up to date with the current positions
+	virtual void update(const ParticleStore& particles, ThreadPool& pool) = 0;
+	// every overlapping pair exactly once, in an order that doesn't depend on the thread count
+	virtual void findPairs(std::vector<BodyPair>& pairs, ThreadPool& pool) = 0;
+	virtual const char* getName() const = 0;
+	// broadphases that predict motion need the step length, the rest ignore it
+	virtual void setTimeStep(float /*dt*/) {}
+};
+
+inline bool boxesOverlap(float ax, float ay, float az, float ar, float bx, float by, float bz, float br) {
+	float r = ar + br;
+	return ax - bx <= r && bx - ax <= r && ay - by <= r && by - ay <= r && az - bz <= r && bz - az <= r;
+}
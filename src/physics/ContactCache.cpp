@@ -0,0 +1,58 @@
+#include "ContactCache.h"
+
+ContactCache::ContactCache()
+    : m_Mask(0), m_Count(0) {
+}
+
+void ContactCache::reset(size_t count) {
+    size_t capacity = 16;
+    while (capacity < count * 2)
+        capacity <<= 1;
+    CachedImpulse empty = { Empty, Empty, Empty, 0.0f, { 0.0f, 0.0f, 0.0f } };
+    m_Slots.assign(capacity, empty);
+    m_Mask = capacity - 1;
+    m_Count = 0;
+}
+
+void ContactCache::clear() {
+    m_Slots.clear();
+    m_Mask = 0;
+    m_Count = 0;
+}
+
+void ContactCache::insert(const CachedImpulse& impulse) {
+    if (m_Slots.empty())
+        reset(1);
+    size_t slot = hash(impulse.a, impulse.b, impulse.feature) & m_Mask;
+    while (m_Slots[slot].a != Empty) {
+        if (m_Slots[slot].a == impulse.a && m_Slots[slot].b == impulse.b && m_Slots[slot].feature == impulse.feature) {
+            m_Slots[slot] = impulse;
+            return;
+        }
+        slot = (slot + 1) & m_Mask;
+    }
+    m_Slots[slot] = impulse;
+    m_Count++;
+    if (m_Count * 2 > m_Slots.size()) {
+        std::vector<CachedImpulse> old;
+        old.swap(m_Slots);
+        reset(m_Count * 2);
+        for (const CachedImpulse& entry : old) {
+            if (entry.a != Empty)
+                insert(entry);
+        }
+    }
+}
+
+const CachedImpulse* ContactCache::find(uint32_t a, uint32_t b, uint32_t feature) const {
+    if (m_Slots.empty())
+        return nullptr;
+    size_t slot = hash(a, b, feature) & m_Mask;
+    while (m_Slots[slot].a != Empty) {
+        const CachedImpulse& entry = m_Slots[slot];
+        if (entry.a == a && entry.b == b && entry.feature == feature)
+            return &entry;
+        slot = (slot + 1) & m_Mask;
+    }
+    return nullptr;
+}
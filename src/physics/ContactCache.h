@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Impulses a contact point ended the step with. Friction is kept as a world
+// space vector because the tangent basis is rebuilt from the new normal.
+struct CachedImpulse {
+	uint32_t a, b, feature;
+	float normal;
+	float friction[3];
+};
+
+// Open addressing hash map from (body a, body b, feature) to the impulses of the
+// last step, with linear probing in a power of two table. It's refilled from
+// scratch every step, so there is no deletion; the table is sized to at most
+// half full when the step starts.
+class ContactCache {
+public:
+	static constexpr uint32_t Empty = 0xffffffffu;
+private:
+	std::vector<CachedImpulse> m_Slots;
+	size_t m_Mask;
+	size_t m_Count;
+
+	static inline size_t hash(uint32_t a, uint32_t b, uint32_t feature) {
+		uint64_t key = ((uint64_t) a << 32 | b) ^ ((uint64_t) feature * 0x9e3779b97f4a7c15ull);
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdull;
+		key ^= key >> 33;
+		return (size_t) key;
+	}
+public:
+	ContactCache();
+
+	// empties the table and makes room for `count` entries
+	void reset(size_t count);
+	void insert(const CachedImpulse& impulse);
+	const CachedImpulse* find(uint32_t a, uint32_t b, uint32_t feature) const;
+	void clear();
+
+	inline size_t size() const { return m_Count; };
+};
@@ -0,0 +1,276 @@
+#include <cmath>
+#include <algorithm>
+#include "ContactSolver.h"
+
+ContactSolver::ContactSolver()
+    : m_OverflowCount(0), m_Mode(SolverMode::Colored), m_Iterations(8), m_WarmStarting(true), m_Friction(0.4f), m_Restitution(0.0f),
+      m_Baumgarte(0.2f), m_Slop(0.005f) {
+}
+
+void ContactSolver::setMode(SolverMode mode) {
+    m_Mode = mode;
+}
+
+void ContactSolver::setIterations(unsigned int iterations) {
+    m_Iterations = iterations;
+}
+
+void ContactSolver::setWarmStarting(bool enabled) {
+    m_WarmStarting = enabled;
+    if (!enabled)
+        m_Cache.clear();
+}
+
+void ContactSolver::clearCache() {
+    m_Cache.clear();
+}
+
+void ContactSolver::setFriction(float friction) {
+    m_Friction = friction;
+}
+
+void ContactSolver::setRestitution(float restitution) {
+    m_Restitution = restitution;
+}
+
+// any two unit vectors perpendicular to n and to each other
+static void tangentBasis(const float n[3], float t1[3], float t2[3]) {
+    if (std::fabs(n[0]) > 0.57735f) {
+        t1[0] = n[1];
+        t1[1] = -n[0];
+        t1[2] = 0.0f;
+    }
+    else {
+        t1[0] = 0.0f;
+        t1[1] = n[2];
+        t1[2] = -n[1];
+    }
+    float length = std::sqrt(t1[0] * t1[0] + t1[1] * t1[1] + t1[2] * t1[2]);
+    t1[0] /= length;
+    t1[1] /= length;
+    t1[2] /= length;
+    t2[0] = n[1] * t1[2] - n[2] * t1[1];
+    t2[1] = n[2] * t1[0] - n[0] * t1[2];
+    t2[2] = n[0] * t1[1] - n[1] * t1[0];
+}
+
+void ContactSolver::prepare(const ParticleStore& particles, const std::vector<Contact>& contacts, float dt,
+                            const std::vector<unsigned int>* islandOffsets) {
+    m_Unordered.resize(contacts.size());
+    for (size_t i = 0; i < contacts.size(); i++) {
+        const Contact& contact = contacts[i];
+        ContactConstraint& c = m_Unordered[i];
+        c.a = contact.a;
+        c.b = contact.b;
+        for (int k = 0; k < 3; k++)
+            c.normal[k] = contact.normal[k];
+        tangentBasis(c.normal, c.tangent[0], c.tangent[1]);
+        c.invMassA = particles.invMass[c.a];
+        c.invMassB = c.b != WorldBody ? particles.invMass[c.b] : 0.0f;
+        float invMassSum = c.invMassA + c.invMassB;
+        c.normalMass = invMassSum > 0.0f ? 1.0f / invMassSum : 0.0f;
+        c.friction = m_Friction;
+        c.feature = contact.feature;
+        c.normalImpulse = 0.0f;
+        c.tangentImpulse[0] = c.tangentImpulse[1] = 0.0f;
+        const CachedImpulse* cached = m_WarmStarting ? m_Cache.find(c.a, c.b, c.feature) : nullptr;
+        if (cached) {
+            // start from where the last step ended, friction projected on the new tangents
+            c.normalImpulse = cached->normal;
+            for (int t = 0; t < 2; t++)
+                c.tangentImpulse[t] = cached->friction[0] * c.tangent[t][0] + cached->friction[1] * c.tangent[t][1] + cached->friction[2] * c.tangent[t][2];
+        }
+
+        c.bias = m_Baumgarte / dt * std::max(contact.depth - m_Slop, 0.0f);
+        float approach = -(particles.vx[c.a] * c.normal[0] + particles.vy[c.a] * c.normal[1] + particles.vz[c.a] * c.normal[2]);
+        if (c.b != WorldBody)
+            approach += particles.vx[c.b] * c.normal[0] + particles.vy[c.b] * c.normal[1] + particles.vz[c.b] * c.normal[2];
+        if (approach < -1.0f) // slow contacts don't bounce so stacks can settle
+            c.bias = std::max(c.bias, -m_Restitution * approach);
+    }
+
+    if (m_Mode == SolverMode::Colored)
+        color(particles.size());
+    else {
+        m_Constraints.swap(m_Unordered);
+        if (m_Mode == SolverMode::Islands && islandOffsets)
+            m_BatchOffsets = *islandOffsets;
+        else
+            m_BatchOffsets.assign({ 0, (unsigned int) m_Constraints.size() });
+        m_OverflowCount = 0;
+    }
+}
+
+void ContactSolver::color(size_t bodyCount) {
+    // greedy, in contact order, so the coloring itself is deterministic
+    m_BodyColors.assign(bodyCount, 0);
+    m_Colors.resize(m_Unordered.size());
+    std::vector<unsigned int> counts(MaxColors + 1, 0);
+    for (size_t i = 0; i < m_Unordered.size(); i++) {
+        const ContactConstraint& c = m_Unordered[i];
+        bool dynamicA = c.invMassA > 0.0f;
+        bool dynamicB = c.invMassB > 0.0f;
+        uint64_t taken = (dynamicA ? m_BodyColors[c.a] : 0) | (dynamicB ? m_BodyColors[c.b] : 0);
+        unsigned int colorIndex = MaxColors;
+        if (~taken != 0) {
+            colorIndex = 0;
+            while (taken & ((uint64_t) 1 << colorIndex))
+                colorIndex++;
+            uint64_t bit = (uint64_t) 1 << colorIndex;
+            if (dynamicA)
+                m_BodyColors[c.a] |= bit;
+            if (dynamicB)
+                m_BodyColors[c.b] |= bit;
+        }
+        m_Colors[i] = (uint8_t) colorIndex;
+        counts[colorIndex]++;
+    }
+
+    // stable counting sort by color; empty colors are dropped from the batch list
+    m_BatchOffsets.clear();
+    std::vector<unsigned int> cursor(MaxColors + 1, 0);
+    unsigned int offset = 0;
+    for (unsigned int colorIndex = 0; colorIndex <= MaxColors; colorIndex++) {
+        cursor[colorIndex] = offset;
+        if (counts[colorIndex] == 0)
+            continue;
+        m_BatchOffsets.push_back(offset);
+        offset += counts[colorIndex];
+    }
+    m_BatchOffsets.push_back(offset);
+    m_OverflowCount = counts[MaxColors];
+    m_Constraints.resize(m_Unordered.size());
+    for (size_t i = 0; i < m_Unordered.size(); i++)
+        m_Constraints[cursor[m_Colors[i]]++] = m_Unordered[i];
+}
+
+void ContactSolver::solveRange(ParticleStore& particles, size_t begin, size_t end) {
+    float* vx = particles.vx.data();
+    float* vy = particles.vy.data();
+    float* vz = particles.vz.data();
+    for (size_t i = begin; i < end; i++) {
+        ContactConstraint& c = m_Constraints[i];
+        float imA = c.invMassA, imB = c.invMassB;
+        float va[3] = { vx[c.a], vy[c.a], vz[c.a] };
+        float vb[3] = { 0.0f, 0.0f, 0.0f };
+        if (c.b != WorldBody) {
+            vb[0] = vx[c.b];
+            vb[1] = vy[c.b];
+            vb[2] = vz[c.b];
+        }
+        float relative[3] = { vb[0] - va[0], vb[1] - va[1], vb[2] - va[2] };
+        float impulse[3];
+
+        // normal: push apart until the separating velocity reaches the bias, never pull
+        float vn = relative[0] * c.normal[0] + relative[1] * c.normal[1] + relative[2] * c.normal[2];
+        float lambda = c.normalMass * (c.bias - vn);
+        float accumulated = std::max(c.normalImpulse + lambda, 0.0f);
+        lambda = accumulated - c.normalImpulse;
+        c.normalImpulse = accumulated;
+        for (int k = 0; k < 3; k++) {
+            impulse[k] = lambda * c.normal[k];
+            relative[k] += impulse[k] * (imA + imB);
+        }
+
+        // friction: cancel sliding, limited by the normal impulse (coulomb cone, per axis)
+        float limit = c.friction * c.normalImpulse;
+        for (int t = 0; t < 2; t++) {
+            const float* tangent = c.tangent[t];
+            float vt = relative[0] * tangent[0] + relative[1] * tangent[1] + relative[2] * tangent[2];
+            float next = std::max(-limit, std::min(limit, c.tangentImpulse[t] - c.normalMass * vt));
+            float delta = next - c.tangentImpulse[t];
+            c.tangentImpulse[t] = next;
+            for (int k = 0; k < 3; k++) {
+                impulse[k] += delta * tangent[k];
+                relative[k] += delta * tangent[k] * (imA + imB);
+            }
+        }
+
+        // static bodies are shared between constraints of a color, never write them
+        if (imA > 0.0f) {
+            vx[c.a] = va[0] - impulse[0] * imA;
+            vy[c.a] = va[1] - impulse[1] * imA;
+            vz[c.a] = va[2] - impulse[2] * imA;
+        }
+        if (imB > 0.0f) {
+            vx[c.b] = vb[0] + impulse[0] * imB;
+            vy[c.b] = vb[1] + impulse[1] * imB;
+            vz[c.b] = vb[2] + impulse[2] * imB;
+        }
+    }
+}
+
+void ContactSolver::warmStartRange(ParticleStore& particles, size_t begin, size_t end) {
+    float* v[3] = { particles.vx.data(), particles.vy.data(), particles.vz.data() };
+    for (size_t i = begin; i < end; i++) {
+        const ContactConstraint& c = m_Constraints[i];
+        float imA = c.invMassA, imB = c.invMassB;
+        for (int k = 0; k < 3; k++) {
+            float impulse = c.normalImpulse * c.normal[k] + c.tangentImpulse[0] * c.tangent[0][k] + c.tangentImpulse[1] * c.tangent[1][k];
+            if (imA > 0.0f)
+                v[k][c.a] -= impulse * imA;
+            if (imB > 0.0f)
+                v[k][c.b] += impulse * imB;
+        }
+    }
+}
+
+void ContactSolver::store() {
+    if (!m_WarmStarting) {
+        m_Cache.clear();
+        return;
+    }
+    m_Cache.reset(m_Constraints.size());
+    for (const ContactConstraint& c : m_Constraints) {
+        CachedImpulse impulse;
+        impulse.a = c.a;
+        impulse.b = c.b;
+        impulse.feature = c.feature;
+        impulse.normal = c.normalImpulse;
+        for (int k = 0; k < 3; k++)
+            impulse.friction[k] = c.tangentImpulse[0] * c.tangent[0][k] + c.tangentImpulse[1] * c.tangent[1][k];
+        m_Cache.insert(impulse);
+    }
+}
+
+void ContactSolver::solve(ParticleStore& particles, ThreadPool& pool) {
+    unsigned int batches = getBatchCount();
+    unsigned int firstPass = m_WarmStarting ? 0 : 1;
+    // pass 0 applies the impulses carried over from the last step, the rest are iterations
+    auto runPass = [&](unsigned int pass, size_t begin, size_t end) {
+        if (pass == 0)
+            warmStartRange(particles, begin, end);
+        else
+            solveRange(particles, begin, end);
+    };
+    if (m_Constraints.empty()) {
+        // nothing to solve
+    }
+    else if (m_Mode == SolverMode::Islands) {
+        pool.parallelFor(batches, [&](size_t first, size_t last, unsigned int) {
+            for (size_t island = first; island < last; island++) {
+                for (unsigned int pass = firstPass; pass <= m_Iterations; pass++)
+                    runPass(pass, m_BatchOffsets[island], m_BatchOffsets[island + 1]);
+            }
+        });
+    }
+    else if (m_Mode == SolverMode::Sequential) {
+        for (unsigned int pass = firstPass; pass <= m_Iterations; pass++)
+            runPass(pass, 0, m_Constraints.size());
+    }
+    else {
+        for (unsigned int pass = firstPass; pass <= m_Iterations; pass++) {
+            for (unsigned int batch = 0; batch < batches; batch++) {
+                size_t begin = m_BatchOffsets[batch], end = m_BatchOffsets[batch + 1];
+                if (batch + 1 == batches && m_OverflowCount > 0) {
+                    runPass(pass, begin, end);
+                    continue;
+                }
+                pool.parallelFor(end - begin, [&](size_t first, size_t last, unsigned int) {
+                    runPass(pass, begin + first, begin + last);
+                });
+            }
+        }
+    }
+    store();
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ParticleStore.h"
+#include "Narrowphase.h"
+#include "ThreadPool.h"
+#include "ContactCache.h"
+
+enum class SolverMode {
+	Sequential, // Gauss-Seidel over the contacts in order, single thread
+	Colored, // contacts split into batches with no shared dynamic body, each batch in parallel
+	Islands // each island solved in order on one thread, islands spread over the threads
+};
+
+struct ContactConstraint {
+	unsigned int a, b;
+	uint32_t feature;
+	float normal[3];
+	float tangent[2][3];
+	float invMassA, invMassB; // 0 for static bodies and the world
+	float normalMass; // 1 / (invMassA + invMassB)
+	float bias; // target separating velocity, pushes overlapping bodies apart
+	float friction;
+	float normalImpulse; // accumulated over the iterations, never negative
+	float tangentImpulse[2];
+};
+
+// Sequential impulse solver for sphere contacts. Particles carry no rotation, so
+// every impulse is linear. In Colored mode the contact graph is greedily colored
+// so no two constraints of a color write the same dynamic body; static bodies
+// are only read, so they don't constrain the coloring. A color is solved in
+// parallel and colors run one after the other, which gives the same result for
+// any thread count. Constraints that don't fit in MaxColors go into a final
+// batch that is solved serially. In Islands mode the contacts come grouped by
+// island and every island runs all its iterations on one thread; islands share
+// no dynamic body, so this is deterministic too and needs no barrier between
+// iterations, but one big pile ends up on a single thread.
+// With warm starting the accumulated impulses of every contact point are kept
+// in a ContactCache keyed by body pair and feature, and the next step starts
+// from them, so resting stacks hold with a handful of iterations.
+class ContactSolver {
+public:
+	static constexpr unsigned int MaxColors = 64;
+private:
+	std::vector<ContactConstraint> m_Constraints; // grouped by color in Colored mode
+	std::vector<ContactConstraint> m_Unordered;
+	std::vector<uint8_t> m_Colors; // per constraint, MaxColors for the overflow batch
+	std::vector<uint64_t> m_BodyColors; // per body, bit c set when a constraint of color c uses it
+	std::vector<unsigned int> m_BatchOffsets; // batch c is [m_BatchOffsets[c], m_BatchOffsets[c + 1])
+	unsigned int m_OverflowCount; // size of the last batch when it holds uncolorable constraints
+	SolverMode m_Mode;
+	unsigned int m_Iterations;
+	bool m_WarmStarting;
+	ContactCache m_Cache; // impulses of the last solve, looked up by prepare
+	float m_Friction;
+	float m_Restitution;
+	float m_Baumgarte; // fraction of the overlap removed per step
+	float m_Slop; // overlap that is allowed to remain, keeps resting contacts from jittering
+
+	void color(size_t bodyCount);
+	void solveRange(ParticleStore& particles, size_t begin, size_t end);
+	void warmStartRange(ParticleStore& particles, size_t begin, size_t end);
+	void store();
+public:
+	ContactSolver();
+
+	// islandOffsets are the contact ranges of the islands, only Islands mode uses them
+	void prepare(const ParticleStore& particles, const std::vector<Contact>& contacts, float dt,
+		const std::vector<unsigned int>* islandOffsets = nullptr);
+	void solve(ParticleStore& particles, ThreadPool& pool);
+
+	void setMode(SolverMode mode);
+	void setIterations(unsigned int iterations);
+	void setWarmStarting(bool enabled);
+	// forgets the cached impulses, needed when body indices change
+	void clearCache();
+	void setFriction(float friction);
+	void setRestitution(float restitution);
+
+	inline SolverMode getMode() const { return m_Mode; };
+	inline unsigned int getIterations() const { return m_Iterations; };
+	inline bool getWarmStarting() const { return m_WarmStarting; };
+	inline const ContactCache& getCache() const { return m_Cache; };
+	inline unsigned int getBatchCount() const { return m_BatchOffsets.empty() ? 0 : (unsigned int) m_BatchOffsets.size() - 1; };
+	inline const std::vector<ContactConstraint>& getConstraints() const { return m_Constraints; };
+};
@@ -0,0 +1,65 @@
+#include "Cpu.h"
+#if defined(_MSC_VER) && defined(PHYS_X86)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static SimdLevel queryCpu() {
+#if !defined(PHYS_X86)
+    return SimdLevel::Scalar;
+#elif defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7)
+        return SimdLevel::Scalar;
+    __cpuid(regs, 1);
+    bool osxsave = (regs[2] & (1 << 27)) != 0;
+    bool fma = (regs[2] & (1 << 12)) != 0;
+    if (!osxsave)
+        return SimdLevel::Scalar;
+    unsigned long long xcr0 = _xgetbv(0);
+    bool osAvx = (xcr0 & 0x6) == 0x6; // xmm and ymm state saved on context switch
+    bool osAvx512 = (xcr0 & 0xe6) == 0xe6; // plus opmask and zmm state
+    __cpuidex(regs, 7, 0);
+    bool avx2 = (regs[1] & (1 << 5)) != 0;
+    bool avx512f = (regs[1] & (1 << 16)) != 0;
+    if (avx512f && avx2 && fma && osAvx512)
+        return SimdLevel::AVX512;
+    if (avx2 && fma && osAvx)
+        return SimdLevel::AVX2;
+    return SimdLevel::Scalar;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdLevel::AVX2;
+    return SimdLevel::Scalar;
+#endif
+}
+
+static SimdLevel s_Active = detectSimdLevel();
+
+SimdLevel detectSimdLevel() {
+    static SimdLevel detected = queryCpu();
+    return detected;
+}
+
+SimdLevel getSimdLevel() {
+    return s_Active;
+}
+
+void setSimdLevel(SimdLevel level) {
+    s_Active = (int) level > (int) detectSimdLevel() ? detectSimdLevel() : level;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX512:
+        return "AVX-512";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PHYS_X86 1
+#endif
+
+// GCC and clang only emit AVX instructions inside functions that ask for them,
+// MSVC allows the intrinsics anywhere. Kernels are only ever called after the
+// runtime check below says the CPU supports them.
+#if defined(__GNUC__) || defined(__clang__)
+#define PHYS_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define PHYS_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#else
+#define PHYS_TARGET_AVX2
+#define PHYS_TARGET_AVX512
+#endif
+
+// for small helpers that templated kernels are built from and that have to
+// disappear into the loop, which -O2 doesn't always do on its own. Helpers
+// that call AVX code can't be forced inline into code built without it; the
+// kernel instantiating them is marked PHYS_FLATTEN instead, which inlines
+// everything it calls.
+#if defined(__GNUC__) || defined(__clang__)
+#define PHYS_INLINE inline __attribute__((always_inline))
+#define PHYS_FLATTEN __attribute__((flatten))
+#else
+#define PHYS_INLINE __forceinline
+#define PHYS_FLATTEN
+#endif
+
+enum class SimdLevel {
+	Scalar = 0,
+	AVX2 = 1, // with FMA
+	AVX512 = 2 // AVX-512F
+};
+
+SimdLevel detectSimdLevel(); // what the CPU and OS support
+SimdLevel getSimdLevel(); // what the kernels dispatch to
+void setSimdLevel(SimdLevel level); // force a lower level, e.g. to compare kernels; clamped to detectSimdLevel()
+const char* simdLevelName(SimdLevel level);
@@ -0,0 +1,486 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "DemSystem.h"
+#include "Integrators.h"
+
+static constexpr float Pi = 3.14159265358979f;
+
+DemSystem::DemSystem()
+    : m_Model(ContactModel::HertzMindlin), m_Stiffness(1000.0f), m_YoungsModulus(1e7f), m_PoissonRatio(0.3f),
+      m_Restitution(0.5f), m_Friction(0.5f), m_WallFriction(0.3f), m_Density(2500.0f),
+      m_Gravity{ 0.0f, -9.81f, 0.0f }, m_Box{ 1.0f, 1.0f, 1.0f }, m_Skin(0.5f), m_TimeStep(0.0f),
+      m_MaxRadius(0.0f), m_MinMass(0.0f), m_MinRadius(0.0f), m_Cells{ 1, 1, 1 }, m_ListsValid(false),
+      m_Substeps(0), m_Rebuilds(0), m_Contacts(0), m_KineticEnergy(0.0), m_StepCount(0) {
+    buildContactWalls();
+}
+
+void DemSystem::buildContactWalls() {
+    m_ContactWalls = {
+        { { 1.0f, 0.0f, 0.0f }, 0.0f, -1e30f, 1e30f }, { { -1.0f, 0.0f, 0.0f }, -m_Box[0], -1e30f, 1e30f },
+        { { 0.0f, 1.0f, 0.0f }, 0.0f, -1e30f, 1e30f }, { { 0.0f, -1.0f, 0.0f }, -m_Box[1], -1e30f, 1e30f },
+        { { 0.0f, 0.0f, 1.0f }, 0.0f, -1e30f, 1e30f }, { { 0.0f, 0.0f, -1.0f }, -m_Box[2], -1e30f, 1e30f } };
+    m_ContactWalls.insert(m_ContactWalls.end(), m_Walls.begin(), m_Walls.end());
+}
+
+unsigned int DemSystem::addParticle(float x, float y, float z, float radius, float vx, float vy, float vz) {
+    float mass = m_Density * 4.0f / 3.0f * Pi * radius * radius * radius;
+    if (m_Particles.size() == 0) {
+        m_MaxRadius = m_MinRadius = radius;
+        m_MinMass = mass;
+    }
+    m_MaxRadius = std::max(m_MaxRadius, radius);
+    m_MinRadius = std::min(m_MinRadius, radius);
+    m_MinMass = std::min(m_MinMass, mass);
+    m_WX.push_back(0.0f);
+    m_WY.push_back(0.0f);
+    m_WZ.push_back(0.0f);
+    m_TX.push_back(0.0f);
+    m_TY.push_back(0.0f);
+    m_TZ.push_back(0.0f);
+    // solid sphere, 2/5 m r^2
+    m_InvInertia.push_back(1.0f / (0.4f * mass * radius * radius));
+    m_ListsValid = false;
+    return m_Particles.add(x, y, z, vx, vy, vz, mass, radius);
+}
+
+void DemSystem::addWall(const DemWall& wall) {
+    m_Walls.push_back(wall);
+    buildContactWalls();
+}
+
+void DemSystem::clear() {
+    m_Particles.clear();
+    AlignedArray<float>* arrays[] = { &m_WX, &m_WY, &m_WZ, &m_TX, &m_TY, &m_TZ, &m_InvInertia };
+    for (AlignedArray<float>* array : arrays)
+        array->resize(0);
+    m_Walls.clear();
+    buildContactWalls();
+    m_NeighborOffsets.resize(0);
+    m_Neighbors.resize(0);
+    m_SpringX.resize(0);
+    m_SpringY.resize(0);
+    m_SpringZ.resize(0);
+    m_MaxRadius = m_MinRadius = m_MinMass = 0.0f;
+    m_ListsValid = false;
+    m_Contacts = 0;
+}
+
+void DemSystem::setModel(ContactModel model) {
+    m_Model = model;
+}
+
+void DemSystem::setStiffness(float stiffness) {
+    m_Stiffness = stiffness;
+}
+
+void DemSystem::setElasticity(float youngsModulus, float poissonRatio) {
+    m_YoungsModulus = youngsModulus;
+    m_PoissonRatio = poissonRatio;
+}
+
+void DemSystem::setRestitution(float restitution) {
+    m_Restitution = std::min(std::max(restitution, 1e-3f), 1.0f);
+}
+
+void DemSystem::setFriction(float friction, float wallFriction) {
+    m_Friction = friction;
+    m_WallFriction = wallFriction;
+}
+
+void DemSystem::setDensity(float density) {
+    m_Density = density;
+}
+
+void DemSystem::setGravity(float x, float y, float z) {
+    m_Gravity[0] = x;
+    m_Gravity[1] = y;
+    m_Gravity[2] = z;
+}
+
+void DemSystem::setBox(float x, float y, float z) {
+    m_Box[0] = x;
+    m_Box[1] = y;
+    m_Box[2] = z;
+    buildContactWalls();
+    m_ListsValid = false;
+}
+
+void DemSystem::setSkin(float skin) {
+    m_Skin = std::max(skin, 0.0f);
+    m_ListsValid = false;
+}
+
+void DemSystem::setTimeStep(float timeStep) {
+    m_TimeStep = timeStep;
+}
+
+float DemSystem::getStableTimeStep() const {
+    if (m_Particles.size() == 0)
+        return 1e-4f;
+    if (m_Model == ContactModel::SpringDashpot)
+        return Pi * std::sqrt(0.5f * m_MinMass / m_Stiffness) / 20.0f;
+    float shearModulus = m_YoungsModulus / (2.0f * (1.0f + m_PoissonRatio));
+    float rayleigh = Pi * m_MinRadius * std::sqrt(m_Density / shearModulus) / (0.1631f * m_PoissonRatio + 0.8766f);
+    return 0.2f * rayleigh;
+}
+
+template<typename F>
+static double sumBlocks(size_t count, std::vector<double>& blockSums, ThreadPool& pool, F&& value) {
+    size_t blocks = (count + DemSystem::BlockSize - 1) / DemSystem::BlockSize;
+    blockSums.assign(blocks, 0.0);
+    pool.parallelFor(blocks, [&](size_t first, size_t last, unsigned int) {
+        for (size_t block = first; block < last; block++) {
+            double sum = 0.0;
+            size_t end = std::min(count, (block + 1) * DemSystem::BlockSize);
+            for (size_t i = block * DemSystem::BlockSize; i < end; i++)
+                sum += value(i);
+            blockSums[block] = sum;
+        }
+    });
+    double total = 0.0;
+    for (double sum : blockSums)
+        total += sum;
+    return total;
+}
+
+float DemSystem::maxDisplacementSq(ThreadPool& pool) {
+    m_ThreadMax.assign(pool.getThreadCount(), 0.0f);
+    pool.parallelFor(m_Particles.size(), [&](size_t begin, size_t end, unsigned int t) {
+        float largest = 0.0f;
+        for (size_t i = begin; i < end; i++) {
+            float dx = m_Particles.px[i] - m_BuildX[i], dy = m_Particles.py[i] - m_BuildY[i], dz = m_Particles.pz[i] - m_BuildZ[i];
+            largest = std::max(largest, dx * dx + dy * dy + dz * dz);
+        }
+        m_ThreadMax[t] = largest;
+    });
+    return *std::max_element(m_ThreadMax.begin(), m_ThreadMax.end());
+}
+
+void DemSystem::buildNeighbors(ThreadPool& pool) {
+    uint32_t count = (uint32_t) m_Particles.size();
+    float skin = m_Skin * m_MaxRadius;
+
+    // the old lists and springs stay around for carrySprings
+    std::swap(m_OldOffsets, m_NeighborOffsets);
+    std::swap(m_OldNeighbors, m_Neighbors);
+    std::swap(m_OldSpringX, m_SpringX);
+    std::swap(m_OldSpringY, m_SpringY);
+    std::swap(m_OldSpringZ, m_SpringZ);
+
+    // cells at least as wide as the longest list range, and no more cells
+    // than about two per particle when the box is mostly empty
+    float width = 2.0f * m_MaxRadius + skin;
+    width = std::max(width, std::cbrt(m_Box[0] * m_Box[1] * m_Box[2] / (2.0f * std::max(count, 1u))));
+    float cellScale[3];
+    for (int axis = 0; axis < 3; axis++) {
+        m_Cells[axis] = std::min(std::max((unsigned int) (m_Box[axis] / width), 1u), 1024u);
+        cellScale[axis] = m_Cells[axis] / m_Box[axis];
+    }
+    uint32_t nx = m_Cells[0], ny = m_Cells[1], nz = m_Cells[2];
+
+    // particles that got outside the walls go in the border cells
+    auto cellOf = [](float x, float scale, uint32_t cells) {
+        return (uint32_t) std::min(std::max(x * scale, 0.0f), (float) (cells - 1));
+    };
+    m_CellKeys.resize(count);
+    m_Order.resize(count);
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            uint32_t cx = cellOf(m_Particles.px[i], cellScale[0], nx);
+            uint32_t cy = cellOf(m_Particles.py[i], cellScale[1], ny);
+            uint32_t cz = cellOf(m_Particles.pz[i], cellScale[2], nz);
+            m_CellKeys[i] = (cz * ny + cy) * nx + cx;
+            m_Order[i] = (uint32_t) i;
+        }
+    });
+    m_Sorter.sort(m_CellKeys, m_Order, pool);
+    m_Particles.permute(m_Order);
+    AlignedArray<float> scratch(count);
+    AlignedArray<float>* arrays[] = { &m_WX, &m_WY, &m_WZ, &m_InvInertia };
+    for (AlignedArray<float>* array : arrays) {
+        for (uint32_t i = 0; i < count; i++)
+            scratch[i] = (*array)[m_Order[i]];
+        std::swap(*array, scratch);
+    }
+    m_NewIndex.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+        m_NewIndex[m_Order[i]] = i;
+
+    uint32_t cellCount = nx * ny * nz;
+    m_CellStart.resize(0);
+    m_CellStart.resize(cellCount + 1);
+    for (uint32_t i = 0; i < count; i++)
+        m_CellStart[m_CellKeys[i] + 1]++;
+    for (uint32_t c = 0; c < cellCount; c++)
+        m_CellStart[c + 1] += m_CellStart[c];
+
+    m_NeighborOffsets.resize(count + 1);
+    m_ThreadNeighbors.resize(pool.getThreadCount());
+    for (AlignedArray<uint32_t>& list : m_ThreadNeighbors)
+        list.clear();
+    const float* p[3] = { m_Particles.px.data(), m_Particles.py.data(), m_Particles.pz.data() };
+    const float* radius = m_Particles.radius.data();
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int t) {
+        AlignedArray<uint32_t>& list = m_ThreadNeighbors[t];
+        for (uint32_t i = (uint32_t) begin; i < end; i++) {
+            size_t before = list.size();
+            uint32_t key = m_CellKeys[i];
+            int cx = (int) (key % nx), cy = (int) (key / nx % ny), cz = (int) (key / (nx * ny));
+            for (int z = std::max(cz - 1, 0); z <= std::min(cz + 1, (int) nz - 1); z++) {
+                for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, (int) ny - 1); y++) {
+                    uint32_t row = ((uint32_t) z * ny + (uint32_t) y) * nx;
+                    uint32_t first = m_CellStart[row + (uint32_t) std::max(cx - 1, 0)];
+                    uint32_t last = m_CellStart[row + (uint32_t) std::min(cx + 1, (int) nx - 1) + 1];
+                    for (uint32_t j = first; j < last; j++) {
+                        float dx = p[0][i] - p[0][j], dy = p[1][i] - p[1][j], dz = p[2][i] - p[2][j];
+                        float range = radius[i] + radius[j] + skin;
+                        if (j != i && dx * dx + dy * dy + dz * dz < range * range)
+                            list.push_back(j);
+                    }
+                }
+            }
+            m_NeighborOffsets[i + 1] = (uint32_t) (list.size() - before);
+        }
+    });
+    m_NeighborOffsets[0] = 0;
+    for (uint32_t i = 0; i < count; i++)
+        m_NeighborOffsets[i + 1] += m_NeighborOffsets[i];
+
+    // the chunks are contiguous and in thread order, so the lists concatenate in particle order
+    std::vector<size_t> starts(m_ThreadNeighbors.size() + 1, 0);
+    for (size_t t = 0; t < m_ThreadNeighbors.size(); t++)
+        starts[t + 1] = starts[t] + m_ThreadNeighbors[t].size();
+    m_Neighbors.resize(starts.back());
+    pool.parallelFor(m_ThreadNeighbors.size(), [&](size_t first, size_t last, unsigned int) {
+        for (size_t t = first; t < last; t++) {
+            if (!m_ThreadNeighbors[t].empty())
+                std::memcpy(m_Neighbors.data() + starts[t], m_ThreadNeighbors[t].data(), m_ThreadNeighbors[t].size() * sizeof(uint32_t));
+        }
+    });
+    carrySprings(pool);
+
+    m_BuildX.resize(count);
+    m_BuildY.resize(count);
+    m_BuildZ.resize(count);
+    std::memcpy(m_BuildX.data(), p[0], count * sizeof(float));
+    std::memcpy(m_BuildY.data(), p[1], count * sizeof(float));
+    std::memcpy(m_BuildZ.data(), p[2], count * sizeof(float));
+    m_ListsValid = true;
+    m_Rebuilds++;
+}
+
+void DemSystem::carrySprings(ThreadPool& pool) {
+    m_SpringX.resize(0);
+    m_SpringY.resize(0);
+    m_SpringZ.resize(0);
+    m_SpringX.resize(m_Neighbors.size());
+    m_SpringY.resize(m_Neighbors.size());
+    m_SpringZ.resize(m_Neighbors.size());
+    // particles added since the last build have no old row
+    uint32_t oldCount = m_OldOffsets.empty() ? 0 : (uint32_t) m_OldOffsets.size() - 1;
+    pool.parallelFor(m_Particles.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            uint32_t old = m_Order[i];
+            if (old >= oldCount)
+                continue;
+            // only the few entries in contact have a spring; each is looked up
+            // in the new row, which still holds every pair within the skin
+            for (uint32_t k = m_OldOffsets[old]; k < m_OldOffsets[old + 1]; k++) {
+                if (m_OldSpringX[k] == 0.0f && m_OldSpringY[k] == 0.0f && m_OldSpringZ[k] == 0.0f)
+                    continue;
+                uint32_t partner = m_NewIndex[m_OldNeighbors[k]];
+                for (uint32_t n = m_NeighborOffsets[i]; n < m_NeighborOffsets[i + 1]; n++) {
+                    if (m_Neighbors[n] == partner) {
+                        m_SpringX[n] = m_OldSpringX[k];
+                        m_SpringY[n] = m_OldSpringY[k];
+                        m_SpringZ[n] = m_OldSpringZ[k];
+                        break;
+                    }
+                }
+            }
+        }
+    });
+}
+
+// normal and tangential stiffness and damping of one contact
+struct ContactCoefficients {
+    float normalForce; // elastic part
+    float normalStiffness, tangentStiffness;
+    float normalDamping, tangentDamping;
+};
+
+void DemSystem::computeForces(float dt, ThreadPool& pool) {
+    float halfSkin = 0.5f * m_Skin * m_MaxRadius;
+    if (!m_ListsValid || halfSkin <= 0.0f || maxDisplacementSq(pool) > halfSkin * halfSkin)
+        buildNeighbors(pool);
+
+    // damping ratio giving the restitution for a linear spring; Hertz-Mindlin
+    // scales it by 2 sqrt(5 / 6) of its local stiffness instead of 2
+    float logRestitution = std::log(m_Restitution);
+    float dampingRatio = -logRestitution / std::sqrt(logRestitution * logRestitution + Pi * Pi);
+    float dampingScale = (m_Model == ContactModel::HertzMindlin ? 2.0f * std::sqrt(5.0f / 6.0f) : 2.0f) * dampingRatio;
+    float effectiveModulus = m_YoungsModulus / (2.0f * (1.0f - m_PoissonRatio * m_PoissonRatio));
+    float effectiveShear = m_YoungsModulus / (4.0f * (2.0f - m_PoissonRatio) * (1.0f + m_PoissonRatio));
+    auto coefficients = [&](float overlap, float effectiveRadius, float effectiveMass) {
+        ContactCoefficients c;
+        if (m_Model == ContactModel::HertzMindlin) {
+            float root = std::sqrt(effectiveRadius * overlap);
+            c.normalStiffness = 2.0f * effectiveModulus * root;
+            c.tangentStiffness = 8.0f * effectiveShear * root;
+            c.normalForce = 2.0f / 3.0f * c.normalStiffness * overlap;
+        }
+        else {
+            c.normalStiffness = m_Stiffness;
+            c.tangentStiffness = 2.0f / 7.0f * m_Stiffness;
+            c.normalForce = m_Stiffness * overlap;
+        }
+        c.normalDamping = dampingScale * std::sqrt(c.normalStiffness * effectiveMass);
+        c.tangentDamping = dampingScale * std::sqrt(c.tangentStiffness * effectiveMass);
+        return c;
+    };
+
+    const std::vector<DemWall>& walls = m_ContactWalls;
+
+    const ParticleStore& ps = m_Particles;
+    m_ThreadContacts.assign(pool.getThreadCount(), 0);
+    pool.parallelFor(ps.size(), [&](size_t begin, size_t end, unsigned int thread) {
+        uint32_t contacts = 0;
+        for (size_t i = begin; i < end; i++) {
+            float xi = ps.px[i], yi = ps.py[i], zi = ps.pz[i];
+            float ri = ps.radius[i];
+            float f[3] = { 0.0f, 0.0f, 0.0f }, torque[3] = { 0.0f, 0.0f, 0.0f };
+            for (uint32_t k = m_NeighborOffsets[i]; k < m_NeighborOffsets[i + 1]; k++) {
+                uint32_t j = m_Neighbors[k];
+                float d[3] = { xi - ps.px[j], yi - ps.py[j], zi - ps.pz[j] };
+                float distSq = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+                float reach = ri + ps.radius[j];
+                if (distSq >= reach * reach || distSq <= 0.0f) {
+                    m_SpringX[k] = m_SpringY[k] = m_SpringZ[k] = 0.0f;
+                    continue;
+                }
+                contacts++;
+                float dist = std::sqrt(distSq);
+                float n[3] = { d[0] / dist, d[1] / dist, d[2] / dist }; // from j to i
+                float overlap = reach - dist;
+
+                // velocity of i's surface relative to j's at the contact point;
+                // j computes exactly the negative of it
+                float spin[3] = { ri * m_WX[i] + ps.radius[j] * m_WX[j], ri * m_WY[i] + ps.radius[j] * m_WY[j], ri * m_WZ[i] + ps.radius[j] * m_WZ[j] };
+                float v[3] = {
+                    (ps.vx[i] - ps.vx[j]) - (spin[1] * n[2] - spin[2] * n[1]),
+                    (ps.vy[i] - ps.vy[j]) - (spin[2] * n[0] - spin[0] * n[2]),
+                    (ps.vz[i] - ps.vz[j]) - (spin[0] * n[1] - spin[1] * n[0]) };
+                float vn = v[0] * n[0] + v[1] * n[1] + v[2] * n[2];
+                float vt[3] = { v[0] - vn * n[0], v[1] - vn * n[1], v[2] - vn * n[2] };
+
+                ContactCoefficients c = coefficients(overlap, ri * ps.radius[j] / reach, 1.0f / (ps.invMass[i] + ps.invMass[j]));
+                float normal = std::max(c.normalForce - c.normalDamping * vn, 0.0f);
+
+                // turn the spring into the tangent plane keeping its length, then stretch it
+                float s[3] = { m_SpringX[k], m_SpringY[k], m_SpringZ[k] };
+                float along = s[0] * n[0] + s[1] * n[1] + s[2] * n[2];
+                float lengthSq = s[0] * s[0] + s[1] * s[1] + s[2] * s[2];
+                for (int axis = 0; axis < 3; axis++)
+                    s[axis] -= along * n[axis];
+                float projectedSq = s[0] * s[0] + s[1] * s[1] + s[2] * s[2];
+                float keep = projectedSq > 0.0f ? std::sqrt(lengthSq / projectedSq) : 0.0f;
+                float ft[3];
+                for (int axis = 0; axis < 3; axis++) {
+                    s[axis] = s[axis] * keep + vt[axis] * dt;
+                    ft[axis] = -c.tangentStiffness * s[axis] - c.tangentDamping * vt[axis];
+                }
+                // sliding: cap at Coulomb and shorten the spring to match
+                float tangentSq = ft[0] * ft[0] + ft[1] * ft[1] + ft[2] * ft[2];
+                float limit = m_Friction * normal;
+                if (tangentSq > limit * limit) {
+                    float scale = limit / std::sqrt(tangentSq);
+                    for (int axis = 0; axis < 3; axis++) {
+                        ft[axis] *= scale;
+                        s[axis] = -(ft[axis] + c.tangentDamping * vt[axis]) / c.tangentStiffness;
+                    }
+                }
+                m_SpringX[k] = s[0];
+                m_SpringY[k] = s[1];
+                m_SpringZ[k] = s[2];
+
+                for (int axis = 0; axis < 3; axis++)
+                    f[axis] += normal * n[axis] + ft[axis];
+                // the contact point is at -ri n, so the torque is ri ft x n
+                torque[0] += ri * (ft[1] * n[2] - ft[2] * n[1]);
+                torque[1] += ri * (ft[2] * n[0] - ft[0] * n[2]);
+                torque[2] += ri * (ft[0] * n[1] - ft[1] * n[0]);
+            }
+
+            for (const DemWall& wall : walls) {
+                if (yi < wall.bottom || yi > wall.top)
+                    continue;
+                const float* n = wall.normal;
+                float overlap = ri - (n[0] * xi + n[1] * yi + n[2] * zi - wall.offset);
+                if (overlap <= 0.0f || overlap >= 2.0f * ri)
+                    continue;
+                float spin[3] = { ri * m_WX[i], ri * m_WY[i], ri * m_WZ[i] };
+                float v[3] = {
+                    ps.vx[i] - (spin[1] * n[2] - spin[2] * n[1]),
+                    ps.vy[i] - (spin[2] * n[0] - spin[0] * n[2]),
+                    ps.vz[i] - (spin[0] * n[1] - spin[1] * n[0]) };
+                float vn = v[0] * n[0] + v[1] * n[1] + v[2] * n[2];
+                float vt[3] = { v[0] - vn * n[0], v[1] - vn * n[1], v[2] - vn * n[2] };
+                ContactCoefficients c = coefficients(overlap, ri, ps.mass[i]);
+                float normal = std::max(c.normalForce - c.normalDamping * vn, 0.0f);
+                // viscous below the Coulomb limit, no spring
+                float slip = std::sqrt(vt[0] * vt[0] + vt[1] * vt[1] + vt[2] * vt[2]);
+                float drag = slip > 0.0f ? std::min(c.tangentDamping, m_WallFriction * normal / slip) : 0.0f;
+                float ft[3] = { -drag * vt[0], -drag * vt[1], -drag * vt[2] };
+                for (int axis = 0; axis < 3; axis++)
+                    f[axis] += normal * n[axis] + ft[axis];
+                torque[0] += ri * (ft[1] * n[2] - ft[2] * n[1]);
+                torque[1] += ri * (ft[2] * n[0] - ft[0] * n[2]);
+                torque[2] += ri * (ft[0] * n[1] - ft[1] * n[0]);
+            }
+
+            m_Particles.fx[i] = f[0];
+            m_Particles.fy[i] = f[1];
+            m_Particles.fz[i] = f[2];
+            m_TX[i] = torque[0];
+            m_TY[i] = torque[1];
+            m_TZ[i] = torque[2];
+        }
+        m_ThreadContacts[thread] += contacts;
+    });
+    uint32_t contacts = 0;
+    for (uint32_t c : m_ThreadContacts)
+        contacts += c;
+    m_Contacts = contacts / 2;
+}
+
+void DemSystem::substep(float dt, ThreadPool& pool) {
+    computeForces(dt, pool);
+    pool.parallelFor(m_Particles.size(), [&](size_t begin, size_t end, unsigned int) {
+        kickDrift(IntegratorArrays(m_Particles, begin, end), dt, dt, m_Gravity);
+        for (size_t i = begin; i < end; i++) {
+            float scale = m_InvInertia[i] * dt;
+            m_WX[i] += m_TX[i] * scale;
+            m_WY[i] += m_TY[i] * scale;
+            m_WZ[i] += m_TZ[i] * scale;
+        }
+    });
+}
+
+void DemSystem::step(float dt, ThreadPool& pool) {
+    if (m_Particles.size() == 0)
+        return;
+    float timeStep = getTimeStep();
+    m_Substeps = std::min((unsigned int) std::ceil(dt / timeStep), MaxSubsteps);
+    m_Substeps = std::max(m_Substeps, 1u);
+    for (unsigned int s = 0; s < m_Substeps; s++)
+        substep(dt / m_Substeps, pool);
+
+    const float* mass = m_Particles.mass.data();
+    const float* v[3] = { m_Particles.vx.data(), m_Particles.vy.data(), m_Particles.vz.data() };
+    m_KineticEnergy = sumBlocks(m_Particles.size(), m_BlockSums, pool, [&](size_t i) {
+        double spin = ((double) m_WX[i] * m_WX[i] + (double) m_WY[i] * m_WY[i] + (double) m_WZ[i] * m_WZ[i]) / m_InvInertia[i];
+        return 0.5 * (mass[i] * ((double) v[0][i] * v[0][i] + (double) v[1][i] * v[1][i] + (double) v[2][i] * v[2][i]) + spin);
+    });
+    m_StepCount++;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+#include "RadixSort.h"
+
+enum class ContactModel {
+	SpringDashpot, // linear normal and tangential springs with viscous damping
+	HertzMindlin // stiffness growing with the square root of the overlap
+};
+
+// Plane wall facing `normal` (unit) through the points where normal . x =
+// offset, touching only particles whose centers are between bottom and top
+// in y, so hopper walls can end at the outlet. Walls are thin: a particle
+// entirely behind one doesn't feel it.
+struct DemWall {
+	float normal[3];
+	float offset;
+	float bottom, top;
+};
+
+// Discrete element granular flow: spheres with radius, mass and spin that only
+// interact through contacts, plus gravity and walls, integrated with
+// semi-implicit Euler in substeps below the contact time. Contacts push along
+// the normal with damping set by the restitution and rub along the tangent
+// through a spring that remembers how far the surfaces have slid since the
+// contact started, capped by Coulomb friction; the spring is rotated into the
+// tangent plane as the pair rolls. Walls rub with plain Coulomb friction and
+// keep no history.
+//
+// Candidates come from Verlet lists of pairs closer than the sum of their
+// radii plus the skin, rebuilt through a cell list once some particle has
+// moved half the skin, and the rebuild sorts the particles by cell. The
+// tangential springs live next to the neighbor entries, 12 bytes per entry,
+// so with a skin of half a radius the table is little more than the
+// contacts themselves; a rebuild carries every active spring over to the new
+// lists through the sorting permutation. Lists hold both directions of every
+// pair and each particle computes and writes only its own forces, torques and
+// springs (owner computes), so there are no atomics and results don't depend
+// on the thread count; the two sides of a contact evaluate mirrored inputs and
+// keep mirrored springs.
+class DemSystem {
+public:
+	static constexpr unsigned int BlockSize = 1024;
+	static constexpr unsigned int MaxSubsteps = 4096;
+private:
+	ParticleStore m_Particles;
+	AlignedArray<float> m_WX, m_WY, m_WZ; // angular velocity
+	AlignedArray<float> m_TX, m_TY, m_TZ; // torque
+	AlignedArray<float> m_InvInertia;
+	AlignedArray<float> m_BuildX, m_BuildY, m_BuildZ; // positions when the lists were built
+	AlignedArray<uint32_t> m_NeighborOffsets, m_Neighbors; // CSR, both directions
+	AlignedArray<float> m_SpringX, m_SpringY, m_SpringZ; // tangential spring per neighbor entry
+	AlignedArray<uint32_t> m_OldOffsets, m_OldNeighbors; // lists before a rebuild, in the old order
+	AlignedArray<float> m_OldSpringX, m_OldSpringY, m_OldSpringZ;
+	AlignedArray<uint32_t> m_NewIndex; // old particle index to sorted index
+	std::vector<AlignedArray<uint32_t>> m_ThreadNeighbors;
+	AlignedArray<uint32_t> m_CellKeys, m_Order;
+	AlignedArray<uint32_t> m_CellStart;
+	RadixSorter m_Sorter;
+	std::vector<double> m_BlockSums;
+	std::vector<float> m_ThreadMax;
+	std::vector<uint32_t> m_ThreadContacts;
+
+	ContactModel m_Model;
+	float m_Stiffness; // spring-dashpot normal stiffness, tangential is 2/7 of it
+	float m_YoungsModulus, m_PoissonRatio; // Hertz-Mindlin
+	float m_Restitution, m_Friction, m_WallFriction;
+	float m_Density;
+	float m_Gravity[3];
+	float m_Box[3]; // walls at 0 and the box size on every axis
+	std::vector<DemWall> m_Walls;
+	std::vector<DemWall> m_ContactWalls; // the box walls, then m_Walls; what the contacts test
+	float m_Skin; // fraction of the largest radius
+	float m_TimeStep; // largest substep, 0 picks one from the contact time
+	float m_MaxRadius, m_MinMass, m_MinRadius;
+	unsigned int m_Cells[3];
+	bool m_ListsValid;
+	unsigned int m_Substeps, m_Rebuilds, m_Contacts;
+	double m_KineticEnergy;
+	unsigned long long m_StepCount;
+
+	float maxDisplacementSq(ThreadPool& pool);
+	void buildContactWalls();
+	void buildNeighbors(ThreadPool& pool);
+	void carrySprings(ThreadPool& pool);
+	void computeForces(float dt, ThreadPool& pool);
+	void substep(float dt, ThreadPool& pool);
+public:
+	DemSystem();
+
+	// mass from the density; starts without spin
+	unsigned int addParticle(float x, float y, float z, float radius, float vx = 0.0f, float vy = 0.0f, float vz = 0.0f);
+	void addWall(const DemWall& wall);
+	void clear();
+	// advances dt in substeps of at most the time step
+	void step(float dt, ThreadPool& pool);
+
+	void setModel(ContactModel model);
+	void setStiffness(float stiffness);
+	void setElasticity(float youngsModulus, float poissonRatio);
+	void setRestitution(float restitution);
+	void setFriction(float friction, float wallFriction);
+	// applies to particles added afterwards
+	void setDensity(float density);
+	void setGravity(float x, float y, float z);
+	void setBox(float x, float y, float z);
+	// as a fraction of the largest radius; 0 rebuilds the lists every substep
+	void setSkin(float skin);
+	// 0 picks getStableTimeStep()
+	void setTimeStep(float timeStep);
+	// a twentieth of the normal contact time of the lightest pair (spring-dashpot),
+	// or a fifth of the Rayleigh time of the smallest particle (Hertz-Mindlin)
+	float getStableTimeStep() const;
+
+	inline const ParticleStore& getParticles() const { return m_Particles; };
+	inline ContactModel getModel() const { return m_Model; };
+	inline const float* getBox() const { return m_Box; };
+	inline const std::vector<DemWall>& getWalls() const { return m_Walls; }; // without the box
+	inline unsigned int getParticleCount() const { return (unsigned int) m_Particles.size(); };
+	inline size_t getNeighborCount() const { return m_Neighbors.size(); };
+	inline unsigned int getContactCount() const { return m_Contacts; }; // touching pairs after the last substep
+	// bytes of neighbor entries and tangential springs
+	inline size_t getContactTableBytes() const { return m_Neighbors.size() * (sizeof(uint32_t) + 3 * sizeof(float)) + m_NeighborOffsets.size() * sizeof(uint32_t); };
+	inline double getKineticEnergy() const { return m_KineticEnergy; };
+	inline float getTimeStep() const { return m_TimeStep > 0.0f ? m_TimeStep : getStableTimeStep(); };
+	inline unsigned int getSubsteps() const { return m_Substeps; }; // of the last step
+	inline unsigned int getRebuilds() const { return m_Rebuilds; };
+	inline unsigned long long getStepCount() const { return m_StepCount; };
+};
@@ -0,0 +1,28 @@
+#include <algorithm>
+#include "DirectSum.h"
+#include "FieldKernels.h"
+
+void DirectSum::accumulate(ParticleStore& particles, ThreadPool& pool) {
+    m_Fields.resize(pool.getThreadCount());
+    const float* strength = getStrengths(particles);
+    FieldSources sources = { particles.px.data(), particles.py.data(), particles.pz.data(), strength, particles.size() };
+    float softeningSq = m_Softening * m_Softening;
+    float forceScale = getForceScale();
+    pool.parallelFor(particles.size(), [&](size_t begin, size_t end, unsigned int t) {
+        AlignedArray<float>& field = m_Fields[t];
+        field.resize(3 * BlockSize);
+        for (size_t block = begin; block < end; block += BlockSize) {
+            size_t count = std::min((size_t) BlockSize, end - block);
+            field.fill(0.0f);
+            FieldTargets targets = { particles.px.data() + block, particles.py.data() + block, particles.pz.data() + block,
+                                     field.data(), field.data() + BlockSize, field.data() + 2 * BlockSize, count };
+            accumulateField(sources, targets, softeningSq);
+            for (size_t i = 0; i < count; i++) {
+                float scale = forceScale * strength[block + i];
+                particles.fx[block + i] += scale * field[i];
+                particles.fy[block + i] += scale * field[BlockSize + i];
+                particles.fz[block + i] += scale * field[2 * BlockSize + i];
+            }
+        }
+    });
+}
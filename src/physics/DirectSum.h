@@ -0,0 +1,15 @@
+#pragma once
+#include <vector>
+#include "ForceProvider.h"
+
+// Exact O(n^2) summation over all pairs. The reference the approximate
+// backends are measured against, and the fastest choice for small scenes.
+class DirectSum : public ForceProvider {
+public:
+	static constexpr unsigned int BlockSize = 64; // targets per kernel call, their field stays in L1
+private:
+	std::vector<AlignedArray<float>> m_Fields; // per thread, 3 * BlockSize
+public:
+	void accumulate(ParticleStore& particles, ThreadPool& pool) override;
+	inline const char* getName() const override { return "direct"; };
+};
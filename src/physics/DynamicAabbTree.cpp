@@ -0,0 +1,204 @@
+#include <algorithm>
+#include "DynamicAabbTree.h"
+
+DynamicAabbTree::DynamicAabbTree()
+    : m_Root(Null), m_FreeList(Null), m_ProxyCount(0) {
+}
+
+void DynamicAabbTree::clear() {
+    m_Nodes.clear();
+    m_Root = Null;
+    m_FreeList = Null;
+    m_ProxyCount = 0;
+}
+
+int DynamicAabbTree::allocateNode() {
+    int node;
+    if (m_FreeList != Null) {
+        node = m_FreeList;
+        m_FreeList = m_Nodes[node].parent;
+    }
+    else {
+        node = (int) m_Nodes.size();
+        m_Nodes.emplace_back();
+    }
+    Node& n = m_Nodes[node];
+    n.parent = n.child1 = n.child2 = Null;
+    n.height = 0;
+    n.body = 0;
+    return node;
+}
+
+void DynamicAabbTree::freeNode(int node) {
+    m_Nodes[node].parent = m_FreeList;
+    m_Nodes[node].height = -1;
+    m_FreeList = node;
+}
+
+int DynamicAabbTree::createProxy(const Aabb& box, unsigned int body) {
+    int proxy = allocateNode();
+    m_Nodes[proxy].box = box;
+    m_Nodes[proxy].body = body;
+    insertLeaf(proxy);
+    m_ProxyCount++;
+    return proxy;
+}
+
+void DynamicAabbTree::destroyProxy(int proxy) {
+    removeLeaf(proxy);
+    freeNode(proxy);
+    m_ProxyCount--;
+}
+
+void DynamicAabbTree::moveProxy(int proxy, const Aabb& box) {
+    removeLeaf(proxy);
+    m_Nodes[proxy].box = box;
+    insertLeaf(proxy);
+}
+
+void DynamicAabbTree::insertLeaf(int leaf) {
+    if (m_Root == Null) {
+        m_Root = leaf;
+        m_Nodes[leaf].parent = Null;
+        return;
+    }
+
+    // descend towards the child whose box grows the least, until making a new
+    // parent right here is cheaper than going further down
+    Aabb leafBox = m_Nodes[leaf].box;
+    int index = m_Root;
+    while (!m_Nodes[index].isLeaf()) {
+        const Node& node = m_Nodes[index];
+        float area = node.box.surfaceArea();
+        float combinedArea = Aabb::merge(node.box, leafBox).surfaceArea();
+        float cost = 2.0f * combinedArea; // new parent for this node and the leaf
+        float inheritance = 2.0f * (combinedArea - area); // every node below grows by this much
+
+        float childCost[2];
+        int children[2] = { node.child1, node.child2 };
+        for (int i = 0; i < 2; i++) {
+            const Node& child = m_Nodes[children[i]];
+            float merged = Aabb::merge(child.box, leafBox).surfaceArea();
+            childCost[i] = (child.isLeaf() ? merged : merged - child.box.surfaceArea()) + inheritance;
+        }
+        if (cost < childCost[0] && cost < childCost[1])
+            break;
+        index = childCost[0] < childCost[1] ? children[0] : children[1];
+    }
+
+    int sibling = index;
+    int oldParent = m_Nodes[sibling].parent;
+    int newParent = allocateNode();
+    m_Nodes[newParent].parent = oldParent;
+    m_Nodes[newParent].box = Aabb::merge(leafBox, m_Nodes[sibling].box);
+    m_Nodes[newParent].height = m_Nodes[sibling].height + 1;
+    m_Nodes[newParent].child1 = sibling;
+    m_Nodes[newParent].child2 = leaf;
+    m_Nodes[sibling].parent = newParent;
+    m_Nodes[leaf].parent = newParent;
+    if (oldParent == Null)
+        m_Root = newParent;
+    else if (m_Nodes[oldParent].child1 == sibling)
+        m_Nodes[oldParent].child1 = newParent;
+    else
+        m_Nodes[oldParent].child2 = newParent;
+
+    fixUpwards(m_Nodes[leaf].parent);
+}
+
+void DynamicAabbTree::removeLeaf(int leaf) {
+    if (leaf == m_Root) {
+        m_Root = Null;
+        return;
+    }
+
+    int parent = m_Nodes[leaf].parent;
+    int grandParent = m_Nodes[parent].parent;
+    int sibling = m_Nodes[parent].child1 == leaf ? m_Nodes[parent].child2 : m_Nodes[parent].child1;
+    freeNode(parent);
+    m_Nodes[sibling].parent = grandParent;
+    if (grandParent == Null) {
+        m_Root = sibling;
+        return;
+    }
+    if (m_Nodes[grandParent].child1 == parent)
+        m_Nodes[grandParent].child1 = sibling;
+    else
+        m_Nodes[grandParent].child2 = sibling;
+    fixUpwards(grandParent);
+}
+
+void DynamicAabbTree::fixUpwards(int index) {
+    while (index != Null) {
+        index = balance(index);
+        Node& node = m_Nodes[index];
+        const Node& child1 = m_Nodes[node.child1];
+        const Node& child2 = m_Nodes[node.child2];
+        node.height = 1 + std::max(child1.height, child2.height);
+        node.box = Aabb::merge(child1.box, child2.box);
+        index = node.parent;
+    }
+}
+
+// Tries swapping one child of a with one of its grandchildren on the other side.
+// Of the four possible swaps it applies the one that shrinks the surface area of
+// the child that changes the most, if any does. Returns the index of the node at
+// a's position, which rotations never change.
+int DynamicAabbTree::balance(int iA) {
+    Node& a = m_Nodes[iA];
+    if (a.isLeaf() || a.height < 2)
+        return iA;
+
+    int iB = a.child1, iC = a.child2;
+    const Node& b = m_Nodes[iB];
+    const Node& c = m_Nodes[iC];
+    float bestGain = 0.0f;
+    int iSmall = Null, iGrand = Null, iHost = Null; // swap iSmall with iGrand, a grandchild under iHost
+    if (!c.isLeaf()) {
+        float area = c.box.surfaceArea();
+        float withoutF = area - Aabb::merge(b.box, m_Nodes[c.child2].box).surfaceArea(); // b <-> f
+        float withoutG = area - Aabb::merge(b.box, m_Nodes[c.child1].box).surfaceArea(); // b <-> g
+        if (withoutF > bestGain) {
+            bestGain = withoutF;
+            iSmall = iB, iGrand = c.child1, iHost = iC;
+        }
+        if (withoutG > bestGain) {
+            bestGain = withoutG;
+            iSmall = iB, iGrand = c.child2, iHost = iC;
+        }
+    }
+    if (!b.isLeaf()) {
+        float area = b.box.surfaceArea();
+        float withoutD = area - Aabb::merge(c.box, m_Nodes[b.child2].box).surfaceArea(); // c <-> d
+        float withoutE = area - Aabb::merge(c.box, m_Nodes[b.child1].box).surfaceArea(); // c <-> e
+        if (withoutD > bestGain) {
+            bestGain = withoutD;
+            iSmall = iC, iGrand = b.child1, iHost = iB;
+        }
+        if (withoutE > bestGain) {
+            bestGain = withoutE;
+            iSmall = iC, iGrand = b.child2, iHost = iB;
+        }
+    }
+    if (iSmall == Null)
+        return iA;
+
+    // iSmall takes iGrand's slot under iHost, iGrand takes iSmall's slot under a
+    Node& host = m_Nodes[iHost];
+    if (a.child1 == iSmall)
+        a.child1 = iGrand;
+    else
+        a.child2 = iGrand;
+    if (host.child1 == iGrand)
+        host.child1 = iSmall;
+    else
+        host.child2 = iSmall;
+    m_Nodes[iGrand].parent = iA;
+    m_Nodes[iSmall].parent = iHost;
+
+    const Node& hostChild1 = m_Nodes[host.child1];
+    const Node& hostChild2 = m_Nodes[host.child2];
+    host.box = Aabb::merge(hostChild1.box, hostChild2.box);
+    host.height = 1 + std::max(hostChild1.height, hostChild2.height);
+    return iA;
+}
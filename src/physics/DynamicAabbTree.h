@@ -0,0 +1,163 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+struct Aabb {
+	float min[3], max[3];
+
+	inline bool contains(const Aabb& other) const {
+		return min[0] <= other.min[0] && min[1] <= other.min[1] && min[2] <= other.min[2] &&
+			other.max[0] <= max[0] && other.max[1] <= max[1] && other.max[2] <= max[2];
+	};
+	inline bool overlaps(const Aabb& other) const {
+		return min[0] <= other.max[0] && other.min[0] <= max[0] &&
+			min[1] <= other.max[1] && other.min[1] <= max[1] &&
+			min[2] <= other.max[2] && other.min[2] <= max[2];
+	};
+	inline float surfaceArea() const {
+		float x = max[0] - min[0], y = max[1] - min[1], z = max[2] - min[2];
+		return 2.0f * (x * y + y * z + z * x);
+	};
+	static inline Aabb merge(const Aabb& a, const Aabb& b) {
+		Aabb out;
+		for (int c = 0; c < 3; c++) {
+			out.min[c] = a.min[c] < b.min[c] ? a.min[c] : b.min[c];
+			out.max[c] = a.max[c] > b.max[c] ? a.max[c] : b.max[c];
+		}
+		return out;
+	};
+};
+
+// Incrementally built bounding volume hierarchy. Leaves are proxies holding an
+// enlarged box and the index of the body they stand for. Inserts descend along
+// the cheapest surface area growth, and every node on the way back up gets a
+// tree rotation when swapping a child with a grandchild makes the boxes smaller,
+// which keeps query cost low no matter the insertion order.
+// Queries walk the tree with a fixed-size stack and only allocate when a
+// badly balanced tree outgrows it.
+class DynamicAabbTree {
+public:
+	static constexpr int Null = -1;
+	static constexpr int MaxStackDepth = 256;
+
+	struct Node {
+		Aabb box;
+		int parent; // next free node while on the free list
+		int child1, child2;
+		int height; // leaves are 0, free nodes -1
+		unsigned int body;
+
+		inline bool isLeaf() const { return child1 == Null; };
+	};
+private:
+	// node stack of a query, on the stack frame until it needs more than MaxStackDepth
+	class QueryStack {
+		int m_Fixed[MaxStackDepth];
+		std::vector<int> m_Spill;
+		int* m_Items;
+		size_t m_Top, m_Capacity;
+
+		void grow() {
+			if (m_Items == m_Fixed)
+				m_Spill.assign(m_Fixed, m_Fixed + m_Top);
+			m_Capacity *= 2;
+			m_Spill.resize(m_Capacity);
+			m_Items = m_Spill.data();
+		};
+	public:
+		QueryStack() : m_Items(m_Fixed), m_Top(0), m_Capacity(MaxStackDepth) {}
+		QueryStack(const QueryStack&) = delete;
+		QueryStack& operator=(const QueryStack&) = delete;
+
+		inline bool empty() const { return m_Top == 0; };
+		inline int pop() { return m_Items[--m_Top]; };
+		inline void push(int node) {
+			if (m_Top == m_Capacity)
+				grow();
+			m_Items[m_Top++] = node;
+		};
+	};
+
+	std::vector<Node> m_Nodes;
+	int m_Root;
+	int m_FreeList;
+	unsigned int m_ProxyCount;
+
+	int allocateNode();
+	void freeNode(int node);
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	int balance(int node);
+	void fixUpwards(int node); // rebalance and refit from node to the root
+public:
+	DynamicAabbTree();
+
+	int createProxy(const Aabb& box, unsigned int body);
+	void destroyProxy(int proxy);
+	void moveProxy(int proxy, const Aabb& box); // replaces the proxy's box and reinserts it
+	void clear();
+
+	inline const Aabb& getBox(int proxy) const { return m_Nodes[proxy].box; };
+	inline unsigned int getBody(int proxy) const { return m_Nodes[proxy].body; };
+	inline int getHeight() const { return m_Root == Null ? 0 : m_Nodes[m_Root].height; };
+	inline unsigned int getProxyCount() const { return m_ProxyCount; };
+
+	// calls fn(body, proxy) for every leaf whose box overlaps box, stops early when fn returns false
+	template<typename F>
+	void queryAabb(const Aabb& box, F&& fn) const {
+		if (m_Root == Null)
+			return;
+		QueryStack stack;
+		stack.push(m_Root);
+		while (!stack.empty()) {
+			const Node& node = m_Nodes[stack.pop()];
+			if (!node.box.overlaps(box))
+				continue;
+			if (node.isLeaf()) {
+				if (!fn(node.body, (int) (&node - m_Nodes.data())))
+					return;
+			}
+			else {
+				stack.push(node.child1);
+				stack.push(node.child2);
+			}
+		}
+	};
+
+	// Walks leaves whose box the ray origin + t * direction enters for t in [0, maxT].
+	// fn(body, proxy, maxT) returns the new maxT, so a hit can clip the rest of the
+	// search; return 0 to stop.
+	template<typename F>
+	void rayCast(const float origin[3], const float direction[3], float maxT, F&& fn) const {
+		if (m_Root == Null)
+			return;
+		float inv[3];
+		for (int c = 0; c < 3; c++)
+			inv[c] = direction[c] != 0.0f ? 1.0f / direction[c] : 1e30f;
+		QueryStack stack;
+		stack.push(m_Root);
+		while (!stack.empty() && maxT > 0.0f) {
+			const Node& node = m_Nodes[stack.pop()];
+			float tEnter = 0.0f, tExit = maxT;
+			for (int c = 0; c < 3 && tEnter <= tExit; c++) {
+				float t0 = (node.box.min[c] - origin[c]) * inv[c];
+				float t1 = (node.box.max[c] - origin[c]) * inv[c];
+				if (t0 > t1) {
+					float t = t0;
+					t0 = t1;
+					t1 = t;
+				}
+				tEnter = t0 > tEnter ? t0 : tEnter;
+				tExit = t1 < tExit ? t1 : tExit;
+			}
+			if (tEnter > tExit)
+				continue;
+			if (node.isLeaf())
+				maxT = fn(node.body, (int) (&node - m_Nodes.data()), maxT);
+			else {
+				stack.push(node.child1);
+				stack.push(node.child2);
+			}
+		}
+	};
+};
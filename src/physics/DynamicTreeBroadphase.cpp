@@ -0,0 +1,97 @@
+#include <algorithm>
+#include "DynamicTreeBroadphase.h"
+
+DynamicTreeBroadphase::DynamicTreeBroadphase(float margin, float predictionSteps, float maxStretch)
+    : m_Margin(margin), m_PredictionSteps(predictionSteps), m_MaxStretch(maxStretch), m_Dt(1.0f / 60.0f) {
+}
+
+void DynamicTreeBroadphase::setTimeStep(float dt) {
+    m_Dt = dt;
+}
+
+Aabb DynamicTreeBroadphase::fatBox(const ParticleStore& particles, unsigned int body) const {
+    float p[3] = { particles.px[body], particles.py[body], particles.pz[body] };
+    float v[3] = { particles.vx[body], particles.vy[body], particles.vz[body] };
+    float r = particles.radius[body] * (1.0f + m_Margin);
+    float limit = particles.radius[body] * m_MaxStretch; // fast small bodies would otherwise overlap everything
+    Aabb box;
+    for (int c = 0; c < 3; c++) {
+        float reach = std::max(-limit, std::min(limit, v[c] * m_Dt * m_PredictionSteps));
+        box.min[c] = p[c] - r + (reach < 0.0f ? reach : 0.0f);
+        box.max[c] = p[c] + r + (reach > 0.0f ? reach : 0.0f);
+    }
+    return box;
+}
+
+void DynamicTreeBroadphase::update(const ParticleStore& particles, ThreadPool& pool) {
+    unsigned int count = (unsigned int) particles.size();
+    while (m_Proxies.size() > count) {
+        m_Tree.destroyProxy(m_Proxies.back());
+        m_Proxies.pop_back();
+    }
+    size_t existing = m_Proxies.size();
+    m_Proxies.resize(count, DynamicAabbTree::Null);
+    m_Moved.assign(count, 0);
+
+    // finding which bodies left their proxy box is read only and runs in parallel
+    pool.parallelFor(existing, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            float r = particles.radius[i];
+            Aabb tight = { { particles.px[i] - r, particles.py[i] - r, particles.pz[i] - r },
+                           { particles.px[i] + r, particles.py[i] + r, particles.pz[i] + r } };
+            if (!m_Tree.getBox(m_Proxies[i]).contains(tight))
+                m_Moved[i] = 1;
+        }
+    });
+    std::fill(m_Moved.begin() + existing, m_Moved.end(), (uint8_t) 1);
+
+    // tree edits are serial, in body order
+    m_MovedBodies.clear();
+    for (unsigned int i = 0; i < count; i++) {
+        if (!m_Moved[i])
+            continue;
+        m_MovedBodies.push_back(i);
+        if (m_Proxies[i] == DynamicAabbTree::Null)
+            m_Proxies[i] = m_Tree.createProxy(fatBox(particles, i), i);
+        else
+            m_Tree.moveProxy(m_Proxies[i], fatBox(particles, i));
+    }
+}
+
+void DynamicTreeBroadphase::findPairs(std::vector<BodyPair>& pairs, ThreadPool& pool) {
+    // pairs between two bodies that kept their proxies can't have changed
+    m_PairKeys.erase(std::remove_if(m_PairKeys.begin(), m_PairKeys.end(), [&](uint64_t key) {
+        return m_Moved[(size_t) (key >> 32)] || m_Moved[(size_t) (key & 0xffffffffu)];
+    }), m_PairKeys.end());
+
+    m_ThreadPairs.resize(pool.getThreadCount());
+    for (std::vector<uint64_t>& local : m_ThreadPairs)
+        local.clear();
+    pool.parallelFor(m_MovedBodies.size(), [&](size_t begin, size_t end, unsigned int t) {
+        std::vector<uint64_t>& local = m_ThreadPairs[t];
+        for (size_t m = begin; m < end; m++) {
+            unsigned int body = m_MovedBodies[m];
+            m_Tree.queryAabb(m_Tree.getBox(m_Proxies[body]), [&](unsigned int other, int) {
+                // two moved bodies find each other twice, keep the one from the lower index
+                if (other != body && !(m_Moved[other] && other < body)) {
+                    uint64_t a = std::min(body, other), b = std::max(body, other);
+                    local.push_back(a << 32 | b);
+                }
+                return true;
+            });
+        }
+    });
+
+    m_Merged.clear();
+    for (const std::vector<uint64_t>& local : m_ThreadPairs)
+        m_Merged.insert(m_Merged.end(), local.begin(), local.end());
+    std::sort(m_Merged.begin(), m_Merged.end());
+    size_t fresh = m_Merged.size();
+    m_Merged.insert(m_Merged.end(), m_PairKeys.begin(), m_PairKeys.end());
+    std::inplace_merge(m_Merged.begin(), m_Merged.begin() + fresh, m_Merged.end());
+    std::swap(m_PairKeys, m_Merged);
+
+    pairs.resize(m_PairKeys.size());
+    for (size_t i = 0; i < m_PairKeys.size(); i++)
+        pairs[i] = { (unsigned int) (m_PairKeys[i] >> 32), (unsigned int) (m_PairKeys[i] & 0xffffffffu) };
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Broadphase.h"
+#include "DynamicAabbTree.h"
+
+// Broadphase on a DynamicAabbTree. Each body's proxy box is its tight box grown
+// by a margin and stretched along its velocity, so the proxy only has to be
+// reinserted once the body leaves it; in a quiet scene most steps touch no tree
+// nodes. Overlapping proxy pairs persist between steps and only pairs of bodies
+// that were reinserted are queried again.
+class DynamicTreeBroadphase : public Broadphase {
+private:
+	DynamicAabbTree m_Tree;
+	std::vector<int> m_Proxies; // per body
+	std::vector<uint8_t> m_Moved; // per body, reinserted in the last update
+	std::vector<unsigned int> m_MovedBodies;
+	std::vector<uint64_t> m_PairKeys; // sorted (a << 32 | b) of overlapping proxies
+	std::vector<uint64_t> m_Merged;
+	std::vector<std::vector<uint64_t>> m_ThreadPairs;
+	float m_Margin; // fraction of the radius added on every side
+	float m_PredictionSteps; // how many steps of motion the box is stretched by
+	float m_MaxStretch; // cap on the stretch, in radii
+	float m_Dt;
+
+	Aabb fatBox(const ParticleStore& particles, unsigned int body) const;
+public:
+	DynamicTreeBroadphase(float margin = 0.1f, float predictionSteps = 4.0f, float maxStretch = 2.0f);
+
+	void update(const ParticleStore& particles, ThreadPool& pool) override;
+	void findPairs(std::vector<BodyPair>& pairs, ThreadPool& pool) override;
+	void setTimeStep(float dt) override;
+	inline const char* getName() const override { return "dynamic aabb tree"; };
+
+	inline const DynamicAabbTree& getTree() const { return m_Tree; };
+	inline size_t getMovedCount() const { return m_MovedBodies.size(); };
+};
@@ -0,0 +1,313 @@
+#include <cmath>
+#include <algorithm>
+#include "FastMultipole.h"
+#include "FieldKernels.h"
+
+FastMultipole::FastMultipole()
+    : m_Order(4), m_Theta(0.5f) {
+    m_Tree.setLeafSize(LeafSize);
+    buildTables();
+}
+
+void FastMultipole::setOrder(unsigned int order) {
+    m_Order = std::min(order, MaxOrder);
+    buildTables();
+}
+
+void FastMultipole::setOpeningAngle(float theta) {
+    m_Theta = theta;
+}
+
+void FastMultipole::buildTables() {
+    int p = (int) m_Order;
+    std::vector<int32_t> lookup((p + 1) * (p + 1) * (p + 1), -1);
+    auto indexOf = [&](int a, int b, int c) {
+        return a < 0 || b < 0 || c < 0 || a + b + c > p ? -1 : lookup[(a * (p + 1) + b) * (p + 1) + c];
+    };
+
+    m_Terms.clear();
+    for (int degree = 0; degree <= p; degree++) {
+        for (int a = degree; a >= 0; a--) {
+            for (int b = degree - a; b >= 0; b--) {
+                int c = degree - a - b;
+                lookup[(a * (p + 1) + b) * (p + 1) + c] = (int32_t) m_Terms.size();
+                Term term;
+                term.power[0] = (uint8_t) a;
+                term.power[1] = (uint8_t) b;
+                term.power[2] = (uint8_t) c;
+                term.axis = a > 0 ? 0 : b > 0 ? 1 : 2;
+                term.factorial = std::tgamma(a + 1.0) * std::tgamma(b + 1.0) * std::tgamma(c + 1.0);
+                m_Terms.push_back(term);
+            }
+        }
+    }
+    for (Term& term : m_Terms) {
+        int power[3] = { term.power[0], term.power[1], term.power[2] };
+        for (int j = 0; j < 3; j++) {
+            int one[3] = { power[0], power[1], power[2] };
+            int two[3] = { power[0], power[1], power[2] };
+            one[j] -= 1;
+            two[j] -= 2;
+            term.minus[j] = indexOf(one[0], one[1], one[2]);
+            term.minus2[j] = indexOf(two[0], two[1], two[2]);
+            // from (r^2 + eps^2) df/dx_i = -x_i f for f = (r^2 + eps^2)^-1/2, differentiated alpha - e_i times
+            term.c1[j] = 2.0 * power[j] - (j == term.axis ? 1.0 : 0.0);
+            term.c2[j] = j == term.axis ? (power[j] - 1.0) * (power[j] - 1.0) : power[j] * (power[j] - 1.0);
+        }
+        term.lower = term.minus[term.axis] < 0 ? 0 : (uint32_t) term.minus[term.axis];
+    }
+
+    m_ShiftTerms.clear();
+    m_TranslationTerms.clear();
+    for (uint32_t alpha = 0; alpha < m_Terms.size(); alpha++) {
+        const Term& a = m_Terms[alpha];
+        for (uint32_t gamma = 0; gamma < m_Terms.size(); gamma++) {
+            const Term& g = m_Terms[gamma];
+            int beta = indexOf(a.power[0] - g.power[0], a.power[1] - g.power[1], a.power[2] - g.power[2]);
+            if (beta >= 0)
+                m_ShiftTerms.push_back({ alpha, (uint32_t) beta, gamma, a.factorial / m_Terms[beta].factorial });
+        }
+    }
+    for (uint32_t beta = 0; beta < m_Terms.size(); beta++) {
+        const Term& b = m_Terms[beta];
+        for (uint32_t alpha = 0; alpha < m_Terms.size(); alpha++) {
+            const Term& a = m_Terms[alpha];
+            int sum = indexOf(a.power[0] + b.power[0], a.power[1] + b.power[1], a.power[2] + b.power[2]);
+            if (sum < 0)
+                continue;
+            double sign = (a.power[0] + a.power[1] + a.power[2]) % 2 ? -1.0 : 1.0;
+            m_TranslationTerms.push_back({ beta, alpha, (uint32_t) sum, sign / b.factorial });
+        }
+    }
+}
+
+// d^alpha / alpha!, or the plain monomials d^alpha
+void FastMultipole::computePowers(const double d[3], double* powers, bool divide) const {
+    powers[0] = 1.0;
+    for (size_t k = 1; k < m_Terms.size(); k++) {
+        const Term& term = m_Terms[k];
+        double value = powers[term.lower] * d[term.axis];
+        powers[k] = divide ? value / term.power[term.axis] : value;
+    }
+}
+
+// all partial derivatives of the softened 1/r up to the expansion order. The
+// softening doesn't change the recurrence, only the squared distance in it.
+void FastMultipole::computeDerivatives(const double r[3], double* derivatives) const {
+    double invR2 = 1.0 / (r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + (double) m_Softening * m_Softening);
+    derivatives[0] = std::sqrt(invR2);
+    for (size_t k = 1; k < m_Terms.size(); k++) {
+        const Term& term = m_Terms[k];
+        double sum = 0.0;
+        for (int j = 0; j < 3; j++) {
+            if (term.minus[j] >= 0)
+                sum += term.c1[j] * r[j] * derivatives[term.minus[j]];
+            if (term.minus2[j] >= 0)
+                sum += term.c2[j] * derivatives[term.minus2[j]];
+        }
+        derivatives[k] = -sum * invR2;
+    }
+}
+
+void FastMultipole::upward(uint32_t index, Workspace& work) {
+    const std::vector<OctreeNode>& nodes = m_Tree.getNodes();
+    const OctreeNode& node = nodes[index];
+    size_t terms = m_Terms.size();
+    double* multipole = &m_Multipoles[index * terms];
+    std::fill(multipole, multipole + terms, 0.0);
+    float radius = 0.0f;
+    if (node.isLeaf(index)) {
+        // P2M
+        const float* x = m_Tree.getX().data();
+        const float* y = m_Tree.getY().data();
+        const float* z = m_Tree.getZ().data();
+        const float* strength = m_Tree.getStrength().data();
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+            double d[3] = { (double) x[i] - node.center[0], (double) y[i] - node.center[1], (double) z[i] - node.center[2] };
+            computePowers(d, work.powers.data(), true);
+            for (size_t k = 0; k < terms; k++)
+                multipole[k] += strength[i] * work.powers[k];
+            radius = std::max(radius, (float) std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+        }
+    }
+    else {
+        // M2M
+        for (uint32_t child = index + 1; child < node.next; child = nodes[child].next) {
+            m_Parents[child] = index;
+            const OctreeNode& c = nodes[child];
+            double d[3] = { (double) c.center[0] - node.center[0], (double) c.center[1] - node.center[1], (double) c.center[2] - node.center[2] };
+            computePowers(d, work.powers.data(), true);
+            const double* source = &m_Multipoles[child * terms];
+            for (const ShiftTerm& shift : m_ShiftTerms)
+                multipole[shift.alpha] += source[shift.beta] * work.powers[shift.gamma];
+            radius = std::max(radius, (float) std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) + m_Radius[child]);
+        }
+    }
+    m_Radius[index] = radius;
+}
+
+// M2L
+void FastMultipole::translate(uint32_t source, uint32_t target, Workspace& work) {
+    const OctreeNode& a = m_Tree.getNodes()[source];
+    const OctreeNode& b = m_Tree.getNodes()[target];
+    double r[3] = { (double) b.center[0] - a.center[0], (double) b.center[1] - a.center[1], (double) b.center[2] - a.center[2] };
+    computeDerivatives(r, work.derivatives.data());
+    size_t terms = m_Terms.size();
+    const double* multipole = &m_Multipoles[source * terms];
+    double* local = &m_Locals[target * terms];
+    for (const TranslationTerm& term : m_TranslationTerms)
+        local[term.local] += term.coefficient * multipole[term.multipole] * work.derivatives[term.derivative];
+}
+
+// every interaction of the targets in the subtree at root with the whole tree
+void FastMultipole::interact(uint32_t root, Workspace& work) {
+    const std::vector<OctreeNode>& nodes = m_Tree.getNodes();
+    FieldSources sources = { m_Tree.getX().data(), m_Tree.getY().data(), m_Tree.getZ().data(), m_Tree.getStrength().data(), 0 };
+    float theta2 = m_Theta * m_Theta;
+    float softeningSq = m_Softening * m_Softening;
+    work.stack.clear();
+    work.stack.push_back({ 0, root });
+    while (!work.stack.empty()) {
+        NodePair pair = work.stack.back();
+        work.stack.pop_back();
+        const OctreeNode& a = nodes[pair.source];
+        const OctreeNode& b = nodes[pair.target];
+        float d2 = 0.0f;
+        for (int c = 0; c < 3; c++)
+            d2 += (b.center[c] - a.center[c]) * (b.center[c] - a.center[c]);
+        float reach = m_Radius[pair.source] + m_Radius[pair.target];
+        if (reach * reach < theta2 * d2) {
+            translate(pair.source, pair.target, work);
+            continue;
+        }
+        bool sourceLeaf = a.isLeaf(pair.source), targetLeaf = b.isLeaf(pair.target);
+        if (sourceLeaf && targetLeaf) {
+            // P2P
+            FieldSources near = sources;
+            near.x += a.first;
+            near.y += a.first;
+            near.z += a.first;
+            near.strength += a.first;
+            near.count = a.count;
+            FieldTargets targets = { m_Tree.getX().data() + b.first, m_Tree.getY().data() + b.first, m_Tree.getZ().data() + b.first,
+                                     m_FieldX.data() + b.first, m_FieldY.data() + b.first, m_FieldZ.data() + b.first, b.count };
+            accumulateField(near, targets, softeningSq);
+        }
+        else if (targetLeaf || (!sourceLeaf && m_Radius[pair.source] >= m_Radius[pair.target])) {
+            for (uint32_t child = pair.source + 1; child < a.next; child = nodes[child].next)
+                work.stack.push_back({ child, pair.target });
+        }
+        else {
+            for (uint32_t child = pair.target + 1; child < b.next; child = nodes[child].next)
+                work.stack.push_back({ pair.source, child });
+        }
+    }
+}
+
+// L2L into every node of the subtree, then L2P at the leaves
+void FastMultipole::downward(uint32_t root, Workspace& work) {
+    const std::vector<OctreeNode>& nodes = m_Tree.getNodes();
+    const float* x = m_Tree.getX().data();
+    const float* y = m_Tree.getY().data();
+    const float* z = m_Tree.getZ().data();
+    size_t terms = m_Terms.size();
+    for (uint32_t index = root; index < nodes[root].next; index++) {
+        const OctreeNode& node = nodes[index];
+        double* local = &m_Locals[index * terms];
+        if (index != root) {
+            const OctreeNode& parent = nodes[m_Parents[index]];
+            double d[3] = { (double) node.center[0] - parent.center[0], (double) node.center[1] - parent.center[1], (double) node.center[2] - parent.center[2] };
+            computePowers(d, work.powers.data(), true);
+            const double* source = &m_Locals[m_Parents[index] * terms];
+            for (const ShiftTerm& shift : m_ShiftTerms)
+                local[shift.beta] += shift.ratio * source[shift.alpha] * work.powers[shift.gamma];
+        }
+        if (!node.isLeaf(index))
+            continue;
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+            double d[3] = { (double) x[i] - node.center[0], (double) y[i] - node.center[1], (double) z[i] - node.center[2] };
+            computePowers(d, work.powers.data(), false);
+            double field[3] = { 0.0, 0.0, 0.0 };
+            for (size_t k = 1; k < terms; k++) {
+                const Term& term = m_Terms[k];
+                for (int j = 0; j < 3; j++) {
+                    if (term.minus[j] >= 0)
+                        field[j] += local[k] * term.power[j] * work.powers[term.minus[j]];
+                }
+            }
+            m_FieldX[i] += (float) field[0];
+            m_FieldY[i] += (float) field[1];
+            m_FieldZ[i] += (float) field[2];
+        }
+    }
+}
+
+void FastMultipole::accumulate(ParticleStore& particles, ThreadPool& pool) {
+    m_Tree.build(particles, getStrengths(particles), pool);
+    const std::vector<OctreeNode>& nodes = m_Tree.getNodes();
+    if (nodes.empty())
+        return;
+    uint32_t nodeCount = (uint32_t) nodes.size();
+    size_t terms = m_Terms.size();
+    m_Multipoles.resize(nodeCount * terms);
+    m_Locals.resize(nodeCount * terms);
+    m_Radius.resize(nodeCount);
+    m_Parents.resize(nodeCount);
+    m_Workspaces.resize(pool.getThreadCount());
+    for (Workspace& work : m_Workspaces) {
+        work.powers.resize(terms);
+        work.derivatives.resize(terms);
+    }
+    size_t count = particles.size();
+    m_FieldX.resize(count);
+    m_FieldY.resize(count);
+    m_FieldZ.resize(count);
+
+    // nodes outside every parallel subtree
+    const std::vector<uint32_t>& roots = m_Tree.getSubtreeRoots();
+    m_TopNodes.clear();
+    size_t subtree = 0;
+    for (uint32_t index = 0; index < nodeCount;) {
+        if (subtree < roots.size() && roots[subtree] == index) {
+            index = nodes[index].next;
+            subtree++;
+        }
+        else
+            m_TopNodes.push_back(index++);
+    }
+
+    pool.parallelFor(roots.size(), [&](size_t begin, size_t end, unsigned int t) {
+        for (size_t s = begin; s < end; s++) {
+            uint32_t root = roots[s];
+            for (uint32_t index = nodes[root].next; index-- > root;)
+                upward(index, m_Workspaces[t]);
+            std::fill(m_Locals.begin() + root * terms, m_Locals.begin() + nodes[root].next * terms, 0.0);
+            const OctreeNode& node = nodes[root];
+            std::fill(m_FieldX.data() + node.first, m_FieldX.data() + node.first + node.count, 0.0f);
+            std::fill(m_FieldY.data() + node.first, m_FieldY.data() + node.first + node.count, 0.0f);
+            std::fill(m_FieldZ.data() + node.first, m_FieldZ.data() + node.first + node.count, 0.0f);
+        }
+    });
+    for (size_t k = m_TopNodes.size(); k-- > 0;)
+        upward(m_TopNodes[k], m_Workspaces[0]);
+
+    pool.parallelFor(roots.size(), [&](size_t begin, size_t end, unsigned int t) {
+        for (size_t s = begin; s < end; s++) {
+            interact(roots[s], m_Workspaces[t]);
+            downward(roots[s], m_Workspaces[t]);
+        }
+    });
+
+    const uint32_t* order = m_Tree.getOrder().data();
+    const float* strength = m_Tree.getStrength().data();
+    float forceScale = getForceScale();
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            uint32_t body = order[i];
+            float scale = forceScale * strength[i];
+            particles.fx[body] += scale * m_FieldX[i];
+            particles.fy[body] += scale * m_FieldY[i];
+            particles.fz[body] += scale * m_FieldZ[i];
+        }
+    });
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ForceProvider.h"
+#include "AlignedArray.h"
+#include "Octree.h"
+
+// Fast multipole method on the shared Octree. Every node carries a multipole
+// and a local expansion of the softened 1/r potential as Cartesian Taylor series up to a
+// configurable order, kept in doubles. The upward pass (P2M, M2M) runs per
+// parallel subtree and then over the top of the tree. The interactions come
+// from a dual tree walk per target subtree: two nodes whose radii sum to less
+// than theta times the distance of their centers interact through M2L, two
+// leaves that don't interact directly with the vectorized field kernel, and
+// otherwise the larger node is split. Each subtree then pushes its locals down
+// (L2L, L2P) on the same thread, so no two tasks write the same node.
+class FastMultipole : public ForceProvider {
+public:
+	static constexpr unsigned int MaxOrder = 12;
+	static constexpr unsigned int LeafSize = 64;
+private:
+	// multi-index alpha of one expansion coefficient, ordered by degree
+	struct Term {
+		uint8_t power[3];
+		uint8_t axis; // first nonzero component
+		uint32_t lower; // alpha - e_axis
+		int32_t minus[3]; // alpha - e_j, -1 if alpha_j == 0
+		int32_t minus2[3]; // alpha - 2 e_j, -1 if alpha_j < 2
+		double c1[3], c2[3]; // derivative recurrence coefficients
+		double factorial; // alpha!
+	};
+	// M2M and L2L: alpha = beta + gamma
+	struct ShiftTerm {
+		uint32_t alpha, beta, gamma;
+		double ratio; // alpha! / beta!
+	};
+	// M2L: local beta gets multipole alpha times derivative alpha + beta
+	struct TranslationTerm {
+		uint32_t local, multipole, derivative;
+		double coefficient; // (-1)^|alpha| / beta!
+	};
+	struct NodePair {
+		uint32_t source, target;
+	};
+	struct Workspace {
+		std::vector<double> powers, derivatives;
+		std::vector<NodePair> stack;
+	};
+
+	unsigned int m_Order;
+	float m_Theta;
+	Octree m_Tree;
+	std::vector<Term> m_Terms;
+	std::vector<ShiftTerm> m_ShiftTerms;
+	std::vector<TranslationTerm> m_TranslationTerms;
+	std::vector<double> m_Multipoles, m_Locals; // m_Terms.size() per node
+	std::vector<float> m_Radius; // per node, distance from the center to its farthest particle
+	std::vector<uint32_t> m_Parents, m_TopNodes;
+	AlignedArray<float> m_FieldX, m_FieldY, m_FieldZ; // tree order
+	std::vector<Workspace> m_Workspaces; // per thread
+
+	void buildTables();
+	void computePowers(const double d[3], double* powers, bool divide) const;
+	void computeDerivatives(const double r[3], double* derivatives) const;
+	void upward(uint32_t index, Workspace& work);
+	void translate(uint32_t source, uint32_t target, Workspace& work);
+	void interact(uint32_t root, Workspace& work);
+	void downward(uint32_t root, Workspace& work);
+public:
+	FastMultipole();
+
+	void accumulate(ParticleStore& particles, ThreadPool& pool) override;
+	inline const char* getName() const override { return "fast-multipole"; };
+
+	// expansion order p, the error falls roughly like theta^(p + 1)
+	void setOrder(unsigned int order);
+	void setOpeningAngle(float theta);
+	inline unsigned int getOrder() const { return m_Order; };
+	inline float getOpeningAngle() const { return m_Theta; };
+	inline const Octree& getTree() const { return m_Tree; };
+};
@@ -0,0 +1,141 @@
+#include <cmath>
+#include "Fft.h"
+
+// std::complex multiplication checks for infinities and NaNs on every call
+static inline FftComplex multiply(FftComplex a, FftComplex b) {
+    return FftComplex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+static inline FftComplex twiddle(unsigned int k, unsigned int n) {
+    double angle = -6.283185307179586 * k / n;
+    return FftComplex((float) std::cos(angle), (float) std::sin(angle));
+}
+
+void FftPlan::init(unsigned int size) {
+    m_Size = size;
+    m_Twiddles.resize(size / 2);
+    for (unsigned int k = 0; k < size / 2; k++)
+        m_Twiddles[k] = twiddle(k, size);
+    unsigned int bits = 0;
+    while ((1u << bits) < size)
+        bits++;
+    m_Reverse.resize(size);
+    for (unsigned int i = 0; i < size; i++) {
+        uint32_t reversed = 0;
+        for (unsigned int b = 0; b < bits; b++)
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        m_Reverse[i] = reversed;
+    }
+}
+
+void FftPlan::transform(FftComplex* data, bool inverse) const {
+    for (unsigned int i = 0; i < m_Size; i++) {
+        if (i < m_Reverse[i])
+            std::swap(data[i], data[m_Reverse[i]]);
+    }
+    for (unsigned int length = 2; length <= m_Size; length *= 2) {
+        unsigned int half = length / 2, step = m_Size / length;
+        for (unsigned int block = 0; block < m_Size; block += length) {
+            for (unsigned int j = 0; j < half; j++) {
+                FftComplex w = m_Twiddles[j * step];
+                if (inverse)
+                    w = std::conj(w);
+                FftComplex u = data[block + j];
+                FftComplex v = multiply(data[block + j + half], w);
+                data[block + j] = u + v;
+                data[block + j + half] = u - v;
+            }
+        }
+    }
+}
+
+void RealFft3d::init(unsigned int size) {
+    m_Size = size;
+    m_Half.init(size / 2);
+    m_Full.init(size);
+    m_RealTwiddles.resize(size / 2 + 1);
+    for (unsigned int k = 0; k <= size / 2; k++)
+        m_RealTwiddles[k] = twiddle(k, size);
+}
+
+// the even and odd samples go in as one half length complex sequence and
+// are split apart again with the conjugate symmetry of real input
+void RealFft3d::forwardRow(const float* row, FftComplex* spectrum, FftComplex* buffer) const {
+    unsigned int half = m_Size / 2;
+    for (unsigned int k = 0; k < half; k++)
+        buffer[k] = FftComplex(row[2 * k], row[2 * k + 1]);
+    m_Half.transform(buffer, false);
+    for (unsigned int k = 0; k <= half; k++) {
+        FftComplex a = buffer[k % half], b = std::conj(buffer[(half - k) % half]);
+        FftComplex even = 0.5f * (a + b);
+        FftComplex odd = FftComplex(0.0f, -0.5f) * (a - b);
+        spectrum[k] = even + multiply(m_RealTwiddles[k], odd);
+    }
+}
+
+void RealFft3d::inverseRow(const FftComplex* spectrum, float* row, FftComplex* buffer) const {
+    unsigned int half = m_Size / 2;
+    for (unsigned int k = 0; k < half; k++) {
+        FftComplex a = spectrum[k], b = std::conj(spectrum[half - k]);
+        FftComplex even = a + b;
+        FftComplex odd = multiply(a - b, std::conj(m_RealTwiddles[k]));
+        buffer[k] = even + FftComplex(-odd.imag(), odd.real());
+    }
+    m_Half.transform(buffer, true);
+    for (unsigned int k = 0; k < half; k++) {
+        row[2 * k] = buffer[k].real();
+        row[2 * k + 1] = buffer[k].imag();
+    }
+}
+
+// transforms the n / 2 + 1 lines that start at base[0..n/2] and step by elementStride
+void RealFft3d::transformLines(FftComplex* base, size_t elementStride, FftComplex* buffer, bool inverse) const {
+    size_t lines = m_Size / 2 + 1;
+    for (size_t e = 0; e < m_Size; e++) {
+        for (size_t l = 0; l < lines; l++)
+            buffer[l * m_Size + e] = base[e * elementStride + l];
+    }
+    for (size_t l = 0; l < lines; l++)
+        m_Full.transform(buffer + l * m_Size, inverse);
+    for (size_t e = 0; e < m_Size; e++) {
+        for (size_t l = 0; l < lines; l++)
+            base[e * elementStride + l] = buffer[l * m_Size + e];
+    }
+}
+
+void RealFft3d::transformColumns(FftComplex* spectrum, bool inverse, ThreadPool& pool) {
+    size_t n = m_Size, rowLength = n / 2 + 1;
+    m_Buffers.resize(pool.getThreadCount());
+    for (AlignedArray<FftComplex>& buffer : m_Buffers)
+        buffer.resize(rowLength * n);
+    // along y one z plane at a time, then along z one y plane at a time
+    pool.parallelFor(n, [&](size_t begin, size_t end, unsigned int t) {
+        for (size_t z = begin; z < end; z++)
+            transformLines(spectrum + z * n * rowLength, rowLength, m_Buffers[t].data(), inverse);
+    });
+    pool.parallelFor(n, [&](size_t begin, size_t end, unsigned int t) {
+        for (size_t y = begin; y < end; y++)
+            transformLines(spectrum + y * rowLength, n * rowLength, m_Buffers[t].data(), inverse);
+    });
+}
+
+void RealFft3d::forward(const float* grid, FftComplex* spectrum, ThreadPool& pool) {
+    size_t n = m_Size, rowLength = n / 2 + 1;
+    m_Buffers.resize(pool.getThreadCount());
+    for (AlignedArray<FftComplex>& buffer : m_Buffers)
+        buffer.resize(rowLength * n);
+    pool.parallelFor(n * n, [&](size_t begin, size_t end, unsigned int t) {
+        for (size_t row = begin; row < end; row++)
+            forwardRow(grid + row * n, spectrum + row * rowLength, m_Buffers[t].data());
+    });
+    transformColumns(spectrum, false, pool);
+}
+
+void RealFft3d::inverse(FftComplex* spectrum, float* grid, ThreadPool& pool) {
+    size_t n = m_Size, rowLength = n / 2 + 1;
+    transformColumns(spectrum, true, pool);
+    pool.parallelFor(n * n, [&](size_t begin, size_t end, unsigned int t) {
+        for (size_t row = begin; row < end; row++)
+            inverseRow(spectrum + row * rowLength, grid + row * n, m_Buffers[t].data());
+    });
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <complex>
+#include <vector>
+#include "AlignedArray.h"
+#include "ThreadPool.h"
+
+typedef std::complex<float> FftComplex;
+
+// Radix-2 complex FFT of one power of two length, in place and unscaled. The
+// twiddles and the bit reversal permutation are built once per length.
+class FftPlan {
+private:
+	unsigned int m_Size;
+	std::vector<FftComplex> m_Twiddles; // e^(-2 pi i k / n) for k < n / 2
+	std::vector<uint32_t> m_Reverse;
+public:
+	FftPlan() : m_Size(0) {}
+
+	void init(unsigned int size);
+	void transform(FftComplex* data, bool inverse) const;
+
+	inline unsigned int getSize() const { return m_Size; };
+};
+
+// Real to complex FFT of an n^3 grid, n a power of two, x fastest. The
+// spectrum keeps the n / 2 + 1 non-negative x frequencies, the others follow
+// from conjugate symmetry, and is laid out [z][y][x] like the grid. Rows along
+// x are done as half length complex transforms. The y and z passes copy a
+// plane's worth of lines into a per thread buffer so every transform runs on
+// contiguous memory. All passes are split over the thread pool. Transforms are
+// unscaled: inverse(forward(grid)) is n^3 times the grid.
+class RealFft3d {
+private:
+	unsigned int m_Size;
+	FftPlan m_Half, m_Full;
+	std::vector<FftComplex> m_RealTwiddles; // e^(-2 pi i k / n) for k <= n / 2
+	std::vector<AlignedArray<FftComplex>> m_Buffers; // per thread
+
+	void forwardRow(const float* row, FftComplex* spectrum, FftComplex* buffer) const;
+	void inverseRow(const FftComplex* spectrum, float* row, FftComplex* buffer) const;
+	void transformLines(FftComplex* base, size_t elementStride, FftComplex* buffer, bool inverse) const;
+	void transformColumns(FftComplex* spectrum, bool inverse, ThreadPool& pool);
+public:
+	RealFft3d() : m_Size(0) {}
+
+	void init(unsigned int size);
+	void forward(const float* grid, FftComplex* spectrum, ThreadPool& pool);
+	// overwrites the spectrum
+	void inverse(FftComplex* spectrum, float* grid, ThreadPool& pool);
+
+	inline unsigned int getSize() const { return m_Size; };
+	inline size_t getSpectrumSize() const { return (size_t) m_Size * m_Size * (m_Size / 2 + 1); };
+};
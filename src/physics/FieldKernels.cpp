@@ -0,0 +1,41 @@
+#include <cmath>
+#include "FieldKernels.h"
+#include "Cpu.h"
+
+void accumulateFieldScalar(const FieldSources& sources, const FieldTargets& targets, float softeningSq) {
+    for (size_t i = 0; i < targets.count; i++) {
+        float tx = targets.x[i], ty = targets.y[i], tz = targets.z[i];
+        float ax = 0.0f, ay = 0.0f, az = 0.0f;
+        for (size_t j = 0; j < sources.count; j++) {
+            float dx = sources.x[j] - tx;
+            float dy = sources.y[j] - ty;
+            float dz = sources.z[j] - tz;
+            float r2 = dx * dx + dy * dy + dz * dz;
+            if (r2 == 0.0f)
+                continue;
+            float inv = 1.0f / std::sqrt(r2 + softeningSq);
+            float s = sources.strength[j] * inv * inv * inv;
+            ax += dx * s;
+            ay += dy * s;
+            az += dz * s;
+        }
+        targets.fieldX[i] += ax;
+        targets.fieldY[i] += ay;
+        targets.fieldZ[i] += az;
+    }
+}
+
+void accumulateField(const FieldSources& sources, const FieldTargets& targets, float softeningSq) {
+    switch (getSimdLevel()) {
+#if defined(PHYS_X86)
+    case SimdLevel::AVX512:
+        accumulateFieldAVX512(sources, targets, softeningSq);
+        break;
+    case SimdLevel::AVX2:
+        accumulateFieldAVX2(sources, targets, softeningSq);
+        break;
+#endif
+    default:
+        accumulateFieldScalar(sources, targets, softeningSq);
+    }
+}
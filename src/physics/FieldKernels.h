@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+
+// Point sources of a 1/r^2 field (masses for gravity), structure of arrays.
+struct FieldSources {
+	const float* x;
+	const float* y;
+	const float* z;
+	const float* strength;
+	size_t count;
+};
+
+// Targets the field is evaluated at and the accumulators it is added to.
+struct FieldTargets {
+	const float* x;
+	const float* y;
+	const float* z;
+	float* fieldX;
+	float* fieldY;
+	float* fieldZ;
+	size_t count;
+};
+
+// field(t) += sum over sources s of strength_s * (s - t) / (|s - t|^2 + softeningSq)^(3/2).
+// Sources at exactly the target position are skipped, so a target may appear in
+// its own source list. Vectorized over the sources; dispatches to AVX-512, AVX2
+// or scalar code at runtime.
+void accumulateField(const FieldSources& sources, const FieldTargets& targets, float softeningSq);
+
+// per instruction set kernels, only call the ones getSimdLevel() allows
+void accumulateFieldScalar(const FieldSources& sources, const FieldTargets& targets, float softeningSq);
+void accumulateFieldAVX2(const FieldSources& sources, const FieldTargets& targets, float softeningSq);
+void accumulateFieldAVX512(const FieldSources& sources, const FieldTargets& targets, float softeningSq);
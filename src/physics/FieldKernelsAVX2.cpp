@@ -0,0 +1,59 @@
+#include "FieldKernels.h"
+#include "Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+static PHYS_TARGET_AVX2 inline float horizontalSum(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+}
+
+// rsqrt is refined with one Newton step, close to full float precision
+PHYS_TARGET_AVX2 void accumulateFieldAVX2(const FieldSources& sources, const FieldTargets& targets, float softeningSq) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 eps = _mm256_set1_ps(softeningSq);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 three = _mm256_set1_ps(3.0f);
+    const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    size_t full = sources.count & ~(size_t) 7;
+    size_t left = sources.count - full;
+    __m256i tailMask = _mm256_cmpgt_epi32(_mm256_set1_epi32((int) left), laneIndex);
+    for (size_t i = 0; i < targets.count; i++) {
+        __m256 tx = _mm256_set1_ps(targets.x[i]);
+        __m256 ty = _mm256_set1_ps(targets.y[i]);
+        __m256 tz = _mm256_set1_ps(targets.z[i]);
+        __m256 ax = zero, ay = zero, az = zero;
+        for (size_t j = 0; j < sources.count; j += 8) {
+            __m256 dx, dy, dz, m;
+            if (j < full) {
+                dx = _mm256_sub_ps(_mm256_loadu_ps(sources.x + j), tx);
+                dy = _mm256_sub_ps(_mm256_loadu_ps(sources.y + j), ty);
+                dz = _mm256_sub_ps(_mm256_loadu_ps(sources.z + j), tz);
+                m = _mm256_loadu_ps(sources.strength + j);
+            }
+            else {
+                // masked lanes load zero strength and add nothing
+                dx = _mm256_sub_ps(_mm256_maskload_ps(sources.x + j, tailMask), tx);
+                dy = _mm256_sub_ps(_mm256_maskload_ps(sources.y + j, tailMask), ty);
+                dz = _mm256_sub_ps(_mm256_maskload_ps(sources.z + j, tailMask), tz);
+                m = _mm256_maskload_ps(sources.strength + j, tailMask);
+            }
+            __m256 r2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dz, dz)));
+            __m256 nonzero = _mm256_cmp_ps(r2, zero, _CMP_GT_OQ);
+            __m256 d2 = _mm256_add_ps(r2, eps);
+            __m256 inv = _mm256_rsqrt_ps(d2);
+            inv = _mm256_mul_ps(_mm256_mul_ps(half, inv), _mm256_fnmadd_ps(_mm256_mul_ps(d2, inv), inv, three));
+            __m256 s = _mm256_and_ps(nonzero, _mm256_mul_ps(m, _mm256_mul_ps(inv, _mm256_mul_ps(inv, inv))));
+            ax = _mm256_fmadd_ps(dx, s, ax);
+            ay = _mm256_fmadd_ps(dy, s, ay);
+            az = _mm256_fmadd_ps(dz, s, az);
+        }
+        targets.fieldX[i] += horizontalSum(ax);
+        targets.fieldY[i] += horizontalSum(ay);
+        targets.fieldZ[i] += horizontalSum(az);
+    }
+}
+
+#endif
@@ -0,0 +1,40 @@
+#include "FieldKernels.h"
+#include "Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+// rsqrt14 plus one Newton step, the tail is handled with a lane mask
+PHYS_TARGET_AVX512 void accumulateFieldAVX512(const FieldSources& sources, const FieldTargets& targets, float softeningSq) {
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 eps = _mm512_set1_ps(softeningSq);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 three = _mm512_set1_ps(3.0f);
+    for (size_t i = 0; i < targets.count; i++) {
+        __m512 tx = _mm512_set1_ps(targets.x[i]);
+        __m512 ty = _mm512_set1_ps(targets.y[i]);
+        __m512 tz = _mm512_set1_ps(targets.z[i]);
+        __m512 ax = zero, ay = zero, az = zero;
+        for (size_t j = 0; j < sources.count; j += 16) {
+            size_t left = sources.count - j;
+            __mmask16 lanes = left >= 16 ? (__mmask16) 0xffff : (__mmask16) ((1u << left) - 1);
+            __m512 dx = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, sources.x + j), tx);
+            __m512 dy = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, sources.y + j), ty);
+            __m512 dz = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, sources.z + j), tz);
+            __m512 m = _mm512_maskz_loadu_ps(lanes, sources.strength + j);
+            __m512 r2 = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dz, dz)));
+            __mmask16 use = _mm512_mask_cmp_ps_mask(lanes, r2, zero, _CMP_GT_OQ);
+            __m512 d2 = _mm512_add_ps(r2, eps);
+            __m512 inv = _mm512_rsqrt14_ps(d2);
+            inv = _mm512_mul_ps(_mm512_mul_ps(half, inv), _mm512_fnmadd_ps(_mm512_mul_ps(d2, inv), inv, three));
+            __m512 s = _mm512_maskz_mul_ps(use, m, _mm512_mul_ps(inv, _mm512_mul_ps(inv, inv)));
+            ax = _mm512_fmadd_ps(dx, s, ax);
+            ay = _mm512_fmadd_ps(dy, s, ay);
+            az = _mm512_fmadd_ps(dz, s, az);
+        }
+        targets.fieldX[i] += _mm512_reduce_add_ps(ax);
+        targets.fieldY[i] += _mm512_reduce_add_ps(ay);
+        targets.fieldZ[i] += _mm512_reduce_add_ps(az);
+    }
+}
+
+#endif
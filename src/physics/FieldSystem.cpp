@@ -0,0 +1,145 @@
+#include <algorithm>
+#include "FieldSystem.h"
+
+template<typename F>
+static double sumBlocks(size_t count, std::vector<double>& blockSums, ThreadPool& pool, F&& value) {
+    size_t blocks = (count + FieldSystem::BlockSize - 1) / FieldSystem::BlockSize;
+    blockSums.assign(blocks, 0.0);
+    pool.parallelFor(blocks, [&](size_t first, size_t last, unsigned int) {
+        for (size_t block = first; block < last; block++) {
+            double sum = 0.0;
+            size_t end = std::min(count, (block + 1) * FieldSystem::BlockSize);
+            for (size_t i = block * FieldSystem::BlockSize; i < end; i++)
+                sum += value(i);
+            blockSums[block] = sum;
+        }
+    });
+    double total = 0.0;
+    for (double sum : blockSums)
+        total += sum;
+    return total;
+}
+
+// origins holds xyz per block when the positions are offsets, or is null
+template<int Dim, typename Law>
+static double fieldEnergy(const ParticleStore& particles, const double* origins, const Law& law,
+    std::vector<double>& blockSums, ThreadPool& pool) {
+    const float* p[3] = { particles.px.data(), particles.py.data(), particles.pz.data() };
+    const float* v[3] = { particles.vx.data(), particles.vy.data(), particles.vz.data() };
+    const float* mass = particles.mass.data();
+    const float* invMass = particles.invMass.data();
+    return sumBlocks(particles.size(), blockSums, pool, [&](size_t i) {
+        Doublex1 x[Dim];
+        double speedSq = 0.0;
+        for (int d = 0; d < Dim; d++) {
+            x[d] = (double) p[d][i] + (origins ? origins[3 * (i / FieldSystem::BlockSize) + d] : 0.0);
+            speedSq += (double) v[d][i] * v[d][i];
+        }
+        double potential = invMass[i] > 0.0f ? law.template potential<Dim>(x).v : 0.0;
+        return mass[i] * (0.5 * speedSq + potential);
+    });
+}
+
+template<int Dim>
+static double fieldEnergy(const ParticleStore& particles, const double* origins, FieldLaw law,
+    const FieldParameters& parameters, std::vector<double>& blockSums, ThreadPool& pool) {
+    switch (law) {
+    case FieldLaw::Uniform:
+        return fieldEnergy<Dim>(particles, origins, UniformField(parameters), blockSums, pool);
+    case FieldLaw::PointMass:
+        return fieldEnergy<Dim>(particles, origins, PointMassField(parameters), blockSums, pool);
+    default:
+        return fieldEnergy<Dim>(particles, origins, HarmonicField(parameters), blockSums, pool);
+    }
+}
+
+FieldSystem::FieldSystem()
+    : m_Scheme(StepScheme::VelocityVerlet), m_Dimensions(2), m_Law(FieldLaw::PointMass),
+      m_Precision(StatePrecision::Single),
+      m_Parameters{ { 0.0f, -9.81f, 0.0f }, 1.0f, 0.01f, 1.0f, 0.0f }, m_Kernel(nullptr), m_StepCount(0) {
+    m_Kernel = selectStepKernel(m_Scheme, m_Dimensions, m_Law, m_Precision);
+}
+
+unsigned int FieldSystem::addParticle(float x, float y, float z, float vx, float vy, float vz, float mass) {
+    if (m_Precision == StatePrecision::Mixed) {
+        if (m_Particles.size() % BlockSize == 0)
+            m_Origins.insert(m_Origins.end(), { (double) x, (double) y, (double) z });
+        const double* origin = &m_Origins[m_Origins.size() - 3];
+        x = (float) (x - origin[0]);
+        y = (float) (y - origin[1]);
+        z = (float) (z - origin[2]);
+    }
+    return m_Particles.add(x, y, z, vx, vy, vz, mass, 0.0f);
+}
+
+void FieldSystem::clear() {
+    m_Particles.clear();
+    m_Origins.clear();
+}
+
+void FieldSystem::reserve(size_t count) {
+    m_Particles.reserve(count);
+    if (m_Precision == StatePrecision::Mixed)
+        m_Origins.reserve(3 * ((count + BlockSize - 1) / BlockSize));
+}
+
+void FieldSystem::configure(StepScheme scheme, unsigned int dimensions, FieldLaw law, const FieldParameters& parameters,
+    StatePrecision precision) {
+    m_Scheme = scheme;
+    m_Dimensions = dimensions == 2 ? 2 : 3;
+    m_Law = law;
+    m_Parameters = parameters;
+    m_Kernel = selectStepKernel(m_Scheme, m_Dimensions, m_Law, precision);
+    if (precision == m_Precision)
+        return;
+    // to offsets from the mean position of each block, or back
+    m_Precision = precision;
+    float* p[3] = { m_Particles.px.data(), m_Particles.py.data(), m_Particles.pz.data() };
+    size_t count = m_Particles.size();
+    if (m_Precision == StatePrecision::Mixed)
+        m_Origins.resize(3 * ((count + BlockSize - 1) / BlockSize));
+    for (size_t block = 0; block * BlockSize < count; block++) {
+        double* origin = &m_Origins[3 * block];
+        size_t first = block * BlockSize, last = std::min(count, first + BlockSize);
+        for (int d = 0; d < 3; d++) {
+            if (m_Precision == StatePrecision::Mixed) {
+                double sum = 0.0;
+                for (size_t i = first; i < last; i++)
+                    sum += p[d][i];
+                origin[d] = sum / (double) (last - first);
+                for (size_t i = first; i < last; i++)
+                    p[d][i] = (float) (p[d][i] - origin[d]);
+            }
+            else {
+                for (size_t i = first; i < last; i++)
+                    p[d][i] = (float) (origin[d] + p[d][i]);
+            }
+        }
+    }
+    if (m_Precision == StatePrecision::Single)
+        m_Origins.clear();
+}
+
+void FieldSystem::step(float dt, ThreadPool& pool) {
+    // one block at a time, each with its own origin
+    size_t count = m_Particles.size();
+    bool offset = m_Precision == StatePrecision::Mixed;
+    pool.parallelFor((count + BlockSize - 1) / BlockSize, [&](size_t first, size_t last, unsigned int) {
+        for (size_t block = first; block < last; block++) {
+            FieldArrays arrays(m_Particles, block * BlockSize, std::min(count, (block + 1) * BlockSize));
+            if (offset) {
+                for (int d = 0; d < 3; d++)
+                    arrays.origin[d] = m_Origins[3 * block + d];
+            }
+            m_Kernel(arrays, dt, m_Parameters);
+        }
+    });
+    m_StepCount++;
+}
+
+double FieldSystem::computeEnergy(ThreadPool& pool) {
+    const double* origins = m_Precision == StatePrecision::Mixed ? m_Origins.data() : nullptr;
+    if (m_Dimensions == 2)
+        return fieldEnergy<2>(m_Particles, origins, m_Law, m_Parameters, m_BlockSums, pool);
+    return fieldEnergy<3>(m_Particles, origins, m_Law, m_Parameters, m_BlockSums, pool);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+#include "StepKernels.h"
+
+// Particles moving independently in an external field (test particles around
+// a point mass, a harmonic trap, a uniform pull), stepped by one preset of the
+// templated step kernels. The scheme, the dimension and the law are fixed by
+// configure when the scene is set up, which resolves them to one function
+// pointer; step only calls that pointer once per block of particles. 2d systems
+// ignore z and the z velocity. The state is stored in floats either way;
+// StatePrecision::Mixed steps it in double lanes, and its stored positions
+// are float offsets from a double origin per block of BlockSize particles:
+// the block's mean position when configure switched to Mixed, or the first
+// particle of a block added later.
+class FieldSystem {
+public:
+	static constexpr unsigned int BlockSize = 1024;
+private:
+	ParticleStore m_Particles;
+	std::vector<double> m_Origins; // xyz per block, empty unless the precision is Mixed
+	std::vector<double> m_BlockSums;
+
+	StepScheme m_Scheme;
+	unsigned int m_Dimensions;
+	FieldLaw m_Law;
+	StatePrecision m_Precision;
+	FieldParameters m_Parameters;
+	StepKernel m_Kernel;
+	unsigned long long m_StepCount;
+public:
+	FieldSystem();
+
+	unsigned int addParticle(float x, float y, float z, float vx, float vy, float vz, float mass = 1.0f);
+	void clear();
+	void reserve(size_t count);
+	// picks the preset and converts the stored positions when the precision
+	// changes; dimensions is 2 or 3
+	void configure(StepScheme scheme, unsigned int dimensions, FieldLaw law, const FieldParameters& parameters,
+		StatePrecision precision = StatePrecision::Single);
+	void step(float dt, ThreadPool& pool);
+	// kinetic plus potential in the field, evaluated and summed in double
+	double computeEnergy(ThreadPool& pool);
+
+	// with Mixed precision the positions are offsets from getOrigin of their block
+	inline const ParticleStore& getParticles() const { return m_Particles; };
+	inline ParticleStore& getParticles() { return m_Particles; };
+	inline const double* getOrigin(size_t block) const { return &m_Origins[3 * block]; };
+	inline StepScheme getScheme() const { return m_Scheme; };
+	inline unsigned int getDimensions() const { return m_Dimensions; };
+	inline FieldLaw getLaw() const { return m_Law; };
+	inline StatePrecision getPrecision() const { return m_Precision; };
+	inline const FieldParameters& getParameters() const { return m_Parameters; };
+	inline unsigned long long getStepCount() const { return m_StepCount; };
+};
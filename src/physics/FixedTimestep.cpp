@@ -0,0 +1,20 @@
+#include "FixedTimestep.h"
+
+FixedTimestep::FixedTimestep(float dt, unsigned int maxSubsteps)
+    : m_Dt(dt), m_MaxSubsteps(maxSubsteps), m_Accumulator(0.0), m_DroppedSteps(0) {
+}
+
+unsigned int FixedTimestep::advance(double frameTime) {
+    if (frameTime > 0.0)
+        m_Accumulator += frameTime;
+
+    unsigned int steps = (unsigned int) (m_Accumulator / m_Dt);
+    m_Accumulator -= steps * (double) m_Dt;
+    if (steps > m_MaxSubsteps) {
+        // drop the backlog instead of trying to catch up; the simulation runs slower
+        // than real time for this frame but the next frame costs the same as this one
+        m_DroppedSteps += steps - m_MaxSubsteps;
+        steps = m_MaxSubsteps;
+    }
+    return steps;
+}
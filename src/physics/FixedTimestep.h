@@ -0,0 +1,20 @@
+#pragma once
+
+// Turns variable frame times into a whole number of fixed-size physics steps.
+// Leftover time stays in the accumulator and is exposed as an interpolation
+// factor so the renderer can blend between the last two physics states.
+class FixedTimestep {
+private:
+	float m_Dt;
+	unsigned int m_MaxSubsteps; // cap per frame so a slow frame can't snowball into slower ones
+	double m_Accumulator;
+	unsigned long long m_DroppedSteps;
+public:
+	FixedTimestep(float dt, unsigned int maxSubsteps);
+
+	unsigned int advance(double frameTime); // returns how many steps to run this frame
+
+	inline float getDt() const { return m_Dt; };
+	inline float getAlpha() const { return (float) (m_Accumulator / m_Dt); };
+	inline unsigned long long getDroppedSteps() const { return m_DroppedSteps; };
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+
+enum class ForceType {
+	None,
+	Direct,
+	BarnesHut,
+	FastMultipole,
+	ParticleMesh
+};
+
+enum class ForceLaw {
+	Gravity, // sources are the masses, like attracts
+	Electrostatic // sources are the charges, like repels
+};
+
+// Long range force between every pair of particles, added to the force
+// accumulators each step. Backends trade accuracy for speed differently but
+// all compute the same softened inverse square law: the field of the source
+// strengths (masses or charges) times the strength of the particle it acts on.
+class ForceProvider {
+protected:
+	ForceLaw m_Law;
+	float m_Constant; // G for gravity, Coulomb's constant for charges
+	float m_Softening; // length added in quadrature to every distance so close encounters stay finite
+
+	inline const float* getStrengths(const ParticleStore& particles) const { return m_Law == ForceLaw::Gravity ? particles.mass.data() : particles.charge.data(); };
+	// force = scale * strength * field
+	inline float getForceScale() const { return m_Law == ForceLaw::Gravity ? m_Constant : -m_Constant; };
+public:
+	ForceProvider() : m_Law(ForceLaw::Gravity), m_Constant(1.0f), m_Softening(0.01f) {}
+	virtual ~ForceProvider() {}
+
+	virtual void accumulate(ParticleStore& particles, ThreadPool& pool) = 0;
+	virtual const char* getName() const = 0;
+
+	inline void setLaw(ForceLaw law) { m_Law = law; };
+	inline void setConstant(float constant) { m_Constant = constant; };
+	inline void setSoftening(float softening) { m_Softening = softening; };
+	inline ForceLaw getLaw() const { return m_Law; };
+	inline float getConstant() const { return m_Constant; };
+	inline float getSoftening() const { return m_Softening; };
+};
@@ -0,0 +1,186 @@
+#include <cmath>
+#include "GridFluid.h"
+
+GridFluid::GridFluid()
+    : m_Size(0), m_CellSize(1.0f), m_Buoyancy(1.0f), m_Dissipation(0.05f),
+      m_EmitterX(0.0f), m_EmitterY(-0.8f), m_EmitterRadius(0.08f), m_EmitterVelocity{ 0.0f, 0.5f }, m_EmitterOn(true),
+      m_StepCount(0) {
+    resize(256);
+}
+
+void GridFluid::resize(unsigned int n) {
+    m_Size = n;
+    m_CellSize = 2.0f / n;
+    size_t faces = (size_t) (n + 1) * n;
+    m_U.resize(0);
+    m_V.resize(0);
+    m_Density.resize(0);
+    m_U.resize(faces);
+    m_V.resize(faces);
+    m_Density.resize((size_t) n * n);
+    m_NewU.resize(faces);
+    m_NewV.resize(faces);
+    m_NewDensity.resize((size_t) n * n);
+    m_Pressure.resize(n);
+}
+
+void GridFluid::setEmitter(float x, float y, float radius, float vx, float vy) {
+    m_EmitterX = x;
+    m_EmitterY = y;
+    m_EmitterRadius = radius;
+    m_EmitterVelocity[0] = vx;
+    m_EmitterVelocity[1] = vy;
+}
+
+void GridFluid::setEmitterEnabled(bool enabled) {
+    m_EmitterOn = enabled;
+}
+
+void GridFluid::setBuoyancy(float buoyancy) {
+    m_Buoyancy = buoyancy;
+}
+
+void GridFluid::setDissipation(float dissipation) {
+    m_Dissipation = dissipation;
+}
+
+void GridFluid::setPressureTolerance(float tolerance, unsigned int maxCycles) {
+    m_Pressure.setTolerance(tolerance, maxCycles);
+}
+
+float GridFluid::sample(const AlignedArray<float>& field, unsigned int width, unsigned int height, float originX, float originY, float x, float y) const {
+    float fx = std::min(std::max(x - originX, 0.0f), (float) (width - 1));
+    float fy = std::min(std::max(y - originY, 0.0f), (float) (height - 1));
+    unsigned int i = std::min((unsigned int) fx, width - 2);
+    unsigned int j = std::min((unsigned int) fy, height - 2);
+    float tx = fx - i, ty = fy - j;
+    const float* row = field.data() + (size_t) j * width + i;
+    float bottom = row[0] + tx * (row[1] - row[0]);
+    float top = row[width] + tx * (row[width + 1] - row[width]);
+    return bottom + ty * (top - bottom);
+}
+
+void GridFluid::traceBack(float x, float y, float dt, float& backX, float& backY) const {
+    unsigned int n = m_Size;
+    float scale = dt / m_CellSize;
+    float u = sample(m_U, n + 1, n, 0.0f, 0.5f, x, y);
+    float v = sample(m_V, n, n + 1, 0.5f, 0.0f, x, y);
+    float midX = x - 0.5f * scale * u, midY = y - 0.5f * scale * v;
+    backX = x - scale * sample(m_U, n + 1, n, 0.0f, 0.5f, midX, midY);
+    backY = y - scale * sample(m_V, n, n + 1, 0.5f, 0.0f, midX, midY);
+}
+
+void GridFluid::emit() {
+    if (!m_EmitterOn)
+        return;
+    unsigned int n = m_Size;
+    // emitter in cell units
+    float cx = (m_EmitterX + 1.0f) / m_CellSize, cy = (m_EmitterY + 1.0f) / m_CellSize;
+    float r = m_EmitterRadius / m_CellSize;
+    int firstX = std::max((int) std::floor(cx - r), 0), lastX = std::min((int) std::ceil(cx + r), (int) n);
+    int firstY = std::max((int) std::floor(cy - r), 0), lastY = std::min((int) std::ceil(cy + r), (int) n);
+    for (int j = firstY; j <= lastY; j++) {
+        for (int i = firstX; i <= lastX; i++) {
+            float dx = i + 0.5f - cx, dy = j + 0.5f - cy;
+            if (i < (int) n && j < (int) n && dx * dx + dy * dy <= r * r)
+                m_Density[(size_t) j * n + i] = 1.0f;
+            dx = i - cx;
+            if (j < (int) n && dx * dx + dy * dy <= r * r)
+                m_U[(size_t) j * (n + 1) + i] = m_EmitterVelocity[0];
+            dx = i + 0.5f - cx;
+            dy = j - cy;
+            if (i < (int) n && dx * dx + dy * dy <= r * r)
+                m_V[(size_t) j * n + i] = m_EmitterVelocity[1];
+        }
+    }
+}
+
+void GridFluid::addBuoyancy(float dt, ThreadPool& pool) {
+    unsigned int n = m_Size;
+    float scale = 0.5f * dt * m_Buoyancy;
+    forEachTile(n - 1, pool, [&](unsigned int row) {
+        unsigned int j = row + 1; // the wall faces stay at rest
+        const float* below = m_Density.data() + (size_t) (j - 1) * n;
+        const float* above = below + n;
+        float* v = m_V.data() + (size_t) j * n;
+        for (unsigned int i = 0; i < n; i++)
+            v[i] += scale * (below[i] + above[i]);
+    });
+}
+
+void GridFluid::advect(float dt, ThreadPool& pool) {
+    unsigned int n = m_Size;
+    float keep = std::max(1.0f - m_Dissipation * dt, 0.0f);
+    forEachTile(n, pool, [&](unsigned int j) {
+        for (unsigned int i = 0; i <= n; i++) {
+            float x, y;
+            traceBack((float) i, j + 0.5f, dt, x, y);
+            m_NewU[(size_t) j * (n + 1) + i] = sample(m_U, n + 1, n, 0.0f, 0.5f, x, y);
+        }
+        for (unsigned int i = 0; i < n; i++) {
+            float x, y;
+            traceBack(i + 0.5f, j + 0.5f, dt, x, y);
+            m_NewDensity[(size_t) j * n + i] = keep * sample(m_Density, n, n, 0.5f, 0.5f, x, y);
+        }
+    });
+    forEachTile(n + 1, pool, [&](unsigned int j) {
+        for (unsigned int i = 0; i < n; i++) {
+            float x, y;
+            traceBack(i + 0.5f, (float) j, dt, x, y);
+            m_NewV[(size_t) j * n + i] = sample(m_V, n, n + 1, 0.5f, 0.0f, x, y);
+        }
+    });
+    std::swap(m_U, m_NewU);
+    std::swap(m_V, m_NewV);
+    std::swap(m_Density, m_NewDensity);
+}
+
+void GridFluid::enforceWalls(ThreadPool& pool) {
+    unsigned int n = m_Size;
+    forEachTile(n, pool, [&](unsigned int j) {
+        m_U[(size_t) j * (n + 1)] = 0.0f;
+        m_U[(size_t) j * (n + 1) + n] = 0.0f;
+    });
+    std::fill(m_V.data(), m_V.data() + n, 0.0f);
+    std::fill(m_V.data() + (size_t) n * n, m_V.data() + (size_t) (n + 1) * n, 0.0f);
+}
+
+// Solves A q = -h^2 div u for q = pressure * dt / density, A being the unscaled
+// Laplacian of the multigrid solver, then subtracts grad q from the inner faces.
+void GridFluid::project(ThreadPool& pool) {
+    unsigned int n = m_Size;
+    float h = m_CellSize;
+    AlignedArray<float>& rhs = m_Pressure.getRightHandSide();
+    forEachTile(n, pool, [&](unsigned int j) {
+        const float* u = m_U.data() + (size_t) j * (n + 1);
+        const float* v = m_V.data() + (size_t) j * n;
+        float* b = rhs.data() + (size_t) j * n;
+        for (unsigned int i = 0; i < n; i++)
+            b[i] = -h * (u[i + 1] - u[i] + v[i + n] - v[i]);
+    });
+    m_Pressure.solve(pool);
+
+    const AlignedArray<float>& q = m_Pressure.getSolution();
+    float invH = 1.0f / h;
+    forEachTile(n, pool, [&](unsigned int j) {
+        const float* p = q.data() + (size_t) j * n;
+        float* u = m_U.data() + (size_t) j * (n + 1);
+        for (unsigned int i = 1; i < n; i++)
+            u[i] -= invH * (p[i] - p[i - 1]);
+        if (j == 0)
+            return;
+        const float* below = p - n;
+        float* v = m_V.data() + (size_t) j * n;
+        for (unsigned int i = 0; i < n; i++)
+            v[i] -= invH * (p[i] - below[i]);
+    });
+}
+
+void GridFluid::step(float dt, ThreadPool& pool) {
+    addBuoyancy(dt, pool);
+    advect(dt, pool);
+    emit();
+    enforceWalls(pool);
+    project(pool);
+    m_StepCount++;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <algorithm>
+#include "AlignedArray.h"
+#include "ThreadPool.h"
+#include "Multigrid.h"
+
+// Stable fluids on an n x n staggered grid over the square [-1, 1]^2 with
+// solid walls: x velocities live on the vertical cell faces ((n + 1) x n),
+// y velocities on the horizontal ones (n x (n + 1)) and the smoke density in
+// the cells. Every step buoyancy lifts the smoke, velocity and smoke are
+// advected semi-Lagrangian (midpoint backtrace, bilinear lookups), the
+// emitter injects smoke and velocity, the wall faces are zeroed, and the
+// pressure projection makes the velocity divergence free with the multigrid
+// Poisson solver, warm started from the previous step's pressure. All passes go over tiles of rows in
+// parallel; arrays are row major with x fastest.
+class GridFluid {
+public:
+	static constexpr unsigned int TileRows = 16;
+private:
+	unsigned int m_Size;
+	float m_CellSize;
+	AlignedArray<float> m_U, m_V, m_Density;
+	AlignedArray<float> m_NewU, m_NewV, m_NewDensity;
+	MultigridPoisson m_Pressure; // solves for pressure * dt / density
+	float m_Buoyancy; // upward acceleration per unit smoke density
+	float m_Dissipation; // fraction of smoke lost per second
+	float m_EmitterX, m_EmitterY, m_EmitterRadius, m_EmitterVelocity[2];
+	bool m_EmitterOn;
+	unsigned long long m_StepCount;
+
+	// bilinear lookup of a field of width x height samples, the first sitting at
+	// (originX, originY) in cell units; positions outside are clamped
+	float sample(const AlignedArray<float>& field, unsigned int width, unsigned int height, float originX, float originY, float x, float y) const;
+	// midpoint backtrace of the point (x, y) in cell units over dt
+	void traceBack(float x, float y, float dt, float& backX, float& backY) const;
+
+	template<typename F>
+	void forEachTile(unsigned int rows, ThreadPool& pool, F&& body) const {
+		size_t tiles = (rows + TileRows - 1) / TileRows;
+		pool.parallelFor(tiles, [&](size_t first, size_t last, unsigned int) {
+			for (unsigned int y = (unsigned int) first * TileRows; y < std::min(rows, (unsigned int) last * TileRows); y++)
+				body(y);
+		});
+	};
+
+	void emit();
+	void addBuoyancy(float dt, ThreadPool& pool);
+	void advect(float dt, ThreadPool& pool);
+	void enforceWalls(ThreadPool& pool);
+	void project(ThreadPool& pool);
+public:
+	GridFluid();
+
+	// n must be a power of two; clears the fluid
+	void resize(unsigned int n);
+	void step(float dt, ThreadPool& pool);
+
+	// a disc that keeps its cells full of smoke moving at (vx, vy)
+	void setEmitter(float x, float y, float radius, float vx, float vy);
+	void setEmitterEnabled(bool enabled);
+	void setBuoyancy(float buoyancy);
+	void setDissipation(float dissipation);
+	void setPressureTolerance(float tolerance, unsigned int maxCycles);
+
+	inline const AlignedArray<float>& getDensity() const { return m_Density; }; // n x n, row 0 at y = -1
+	inline unsigned int getSize() const { return m_Size; };
+	inline const MultigridPoisson& getPressureSolver() const { return m_Pressure; };
+	inline unsigned long long getStepCount() const { return m_StepCount; };
+};
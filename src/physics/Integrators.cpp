@@ -0,0 +1,68 @@
+#include "Integrators.h"
+#include "Cpu.h"
+
+IntegratorArrays::IntegratorArrays(ParticleStore& particles, size_t first, size_t last)
+    : p{ particles.px.data(), particles.py.data(), particles.pz.data() },
+      v{ particles.vx.data(), particles.vy.data(), particles.vz.data() },
+      f{ particles.fx.data(), particles.fy.data(), particles.fz.data() },
+      invMass(particles.invMass.data()), begin(first), end(last) {
+}
+
+void kickDriftScalar(const IntegratorArrays& arrays, float kickDt, float driftDt, const float gravity[3]) {
+    for (int c = 0; c < 3; c++) {
+        float* p = arrays.p[c];
+        float* v = arrays.v[c];
+        const float* f = arrays.f[c];
+        for (size_t i = arrays.begin; i < arrays.end; i++) {
+            float im = arrays.invMass[i];
+            float a = f[i] * im + (im > 0.0f ? gravity[c] : 0.0f);
+            v[i] += a * kickDt;
+            p[i] += v[i] * driftDt;
+        }
+    }
+}
+
+void kickScalar(const IntegratorArrays& arrays, float dt, const float gravity[3]) {
+    for (int c = 0; c < 3; c++) {
+        float* v = arrays.v[c];
+        const float* f = arrays.f[c];
+        for (size_t i = arrays.begin; i < arrays.end; i++) {
+            float im = arrays.invMass[i];
+            v[i] += (f[i] * im + (im > 0.0f ? gravity[c] : 0.0f)) * dt;
+        }
+    }
+}
+
+void kickDrift(const IntegratorArrays& arrays, float kickDt, float driftDt, const float gravity[3]) {
+    switch (getSimdLevel()) {
+#if defined(PHYS_X86)
+    case SimdLevel::AVX512:
+        kickDriftAVX512(arrays, kickDt, driftDt, gravity);
+        break;
+    case SimdLevel::AVX2:
+        kickDriftAVX2(arrays, kickDt, driftDt, gravity);
+        break;
+#endif
+    default:
+        kickDriftScalar(arrays, kickDt, driftDt, gravity);
+    }
+}
+
+void kick(const IntegratorArrays& arrays, float dt, const float gravity[3]) {
+    switch (getSimdLevel()) {
+#if defined(PHYS_X86)
+    case SimdLevel::AVX512:
+        kickAVX512(arrays, dt, gravity);
+        break;
+    case SimdLevel::AVX2:
+        kickAVX2(arrays, dt, gravity);
+        break;
+#endif
+    default:
+        kickScalar(arrays, dt, gravity);
+    }
+}
+
+void semiImplicitEulerStep(const IntegratorArrays& arrays, float dt, const float gravity[3]) {
+    kickDrift(arrays, dt, dt, gravity);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include "ParticleStore.h"
+
+enum class Integrator {
+	SemiImplicitEuler,
+	VelocityVerlet
+};
+
+// Raw views of the arrays an integrator touches, over particles [begin, end).
+struct IntegratorArrays {
+	float* p[3];
+	float* v[3];
+	const float* f[3];
+	const float* invMass;
+	size_t begin, end;
+
+	IntegratorArrays(ParticleStore& particles, size_t first, size_t last);
+};
+
+// v += (f / m + g) * kickDt, then x += v * driftDt. Static particles (invMass 0)
+// don't feel gravity. Dispatches to AVX-512, AVX2 or scalar code at runtime.
+void kickDrift(const IntegratorArrays& arrays, float kickDt, float driftDt, const float gravity[3]);
+// v += (f / m + g) * dt
+void kick(const IntegratorArrays& arrays, float dt, const float gravity[3]);
+
+// one full step of either integrator for forces that don't change during the
+// step; callers with position dependent forces split Verlet into kickDrift/kick
+// around their force evaluation
+void semiImplicitEulerStep(const IntegratorArrays& arrays, float dt, const float gravity[3]);
+
+// per instruction set kernels, only call the ones getSimdLevel() allows
+void kickDriftScalar(const IntegratorArrays& arrays, float kickDt, float driftDt, const float gravity[3]);
+void kickScalar(const IntegratorArrays& arrays, float dt, const float gravity[3]);
+void kickDriftAVX2(const IntegratorArrays& arrays, float kickDt, float driftDt, const float gravity[3]);
+void kickAVX2(const IntegratorArrays& arrays, float dt, const float gravity[3]);
+void kickDriftAVX512(const IntegratorArrays& arrays, float kickDt, float driftDt, const float gravity[3]);
+void kickAVX512(const IntegratorArrays& arrays, float dt, const float gravity[3]);
@@ -0,0 +1,50 @@
+#include "Integrators.h"
+#include "Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+PHYS_TARGET_AVX2 void kickDriftAVX2(const IntegratorArrays& arrays, float kickDt, float driftDt, const float gravity[3]) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 kdt = _mm256_set1_ps(kickDt);
+    const __m256 ddt = _mm256_set1_ps(driftDt);
+    size_t i = arrays.begin;
+    for (int c = 0; c < 3; c++) {
+        float* p = arrays.p[c];
+        float* v = arrays.v[c];
+        const float* f = arrays.f[c];
+        const __m256 g = _mm256_set1_ps(gravity[c]);
+        for (i = arrays.begin; i + 8 <= arrays.end; i += 8) {
+            __m256 im = _mm256_loadu_ps(arrays.invMass + i);
+            __m256 gMasked = _mm256_and_ps(_mm256_cmp_ps(im, zero, _CMP_GT_OQ), g);
+            __m256 a = _mm256_fmadd_ps(_mm256_loadu_ps(f + i), im, gMasked);
+            __m256 vel = _mm256_fmadd_ps(a, kdt, _mm256_loadu_ps(v + i));
+            _mm256_storeu_ps(v + i, vel);
+            _mm256_storeu_ps(p + i, _mm256_fmadd_ps(vel, ddt, _mm256_loadu_ps(p + i)));
+        }
+    }
+    IntegratorArrays tail = arrays;
+    tail.begin = i;
+    kickDriftScalar(tail, kickDt, driftDt, gravity);
+}
+
+PHYS_TARGET_AVX2 void kickAVX2(const IntegratorArrays& arrays, float dt, const float gravity[3]) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 vdt = _mm256_set1_ps(dt);
+    size_t i = arrays.begin;
+    for (int c = 0; c < 3; c++) {
+        float* v = arrays.v[c];
+        const float* f = arrays.f[c];
+        const __m256 g = _mm256_set1_ps(gravity[c]);
+        for (i = arrays.begin; i + 8 <= arrays.end; i += 8) {
+            __m256 im = _mm256_loadu_ps(arrays.invMass + i);
+            __m256 gMasked = _mm256_and_ps(_mm256_cmp_ps(im, zero, _CMP_GT_OQ), g);
+            __m256 a = _mm256_fmadd_ps(_mm256_loadu_ps(f + i), im, gMasked);
+            _mm256_storeu_ps(v + i, _mm256_fmadd_ps(a, vdt, _mm256_loadu_ps(v + i)));
+        }
+    }
+    IntegratorArrays tail = arrays;
+    tail.begin = i;
+    kickScalar(tail, dt, gravity);
+}
+
+#endif
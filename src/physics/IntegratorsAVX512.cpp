@@ -0,0 +1,49 @@
+#include "Integrators.h"
+#include "Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+// the tail is handled with a lane mask instead of a scalar loop
+PHYS_TARGET_AVX512 void kickDriftAVX512(const IntegratorArrays& arrays, float kickDt, float driftDt, const float gravity[3]) {
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 kdt = _mm512_set1_ps(kickDt);
+    const __m512 ddt = _mm512_set1_ps(driftDt);
+    for (int c = 0; c < 3; c++) {
+        float* p = arrays.p[c];
+        float* v = arrays.v[c];
+        const float* f = arrays.f[c];
+        const __m512 g = _mm512_set1_ps(gravity[c]);
+        for (size_t i = arrays.begin; i < arrays.end; i += 16) {
+            size_t left = arrays.end - i;
+            __mmask16 lanes = left >= 16 ? (__mmask16) 0xffff : (__mmask16) ((1u << left) - 1);
+            __m512 im = _mm512_maskz_loadu_ps(lanes, arrays.invMass + i);
+            __mmask16 dynamic = _mm512_cmp_ps_mask(im, zero, _CMP_GT_OQ);
+            __m512 fm = _mm512_mul_ps(_mm512_maskz_loadu_ps(lanes, f + i), im);
+            __m512 a = _mm512_mask_add_ps(fm, dynamic, fm, g);
+            __m512 vel = _mm512_fmadd_ps(a, kdt, _mm512_maskz_loadu_ps(lanes, v + i));
+            _mm512_mask_storeu_ps(v + i, lanes, vel);
+            _mm512_mask_storeu_ps(p + i, lanes, _mm512_fmadd_ps(vel, ddt, _mm512_maskz_loadu_ps(lanes, p + i)));
+        }
+    }
+}
+
+PHYS_TARGET_AVX512 void kickAVX512(const IntegratorArrays& arrays, float dt, const float gravity[3]) {
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 vdt = _mm512_set1_ps(dt);
+    for (int c = 0; c < 3; c++) {
+        float* v = arrays.v[c];
+        const float* f = arrays.f[c];
+        const __m512 g = _mm512_set1_ps(gravity[c]);
+        for (size_t i = arrays.begin; i < arrays.end; i += 16) {
+            size_t left = arrays.end - i;
+            __mmask16 lanes = left >= 16 ? (__mmask16) 0xffff : (__mmask16) ((1u << left) - 1);
+            __m512 im = _mm512_maskz_loadu_ps(lanes, arrays.invMass + i);
+            __mmask16 dynamic = _mm512_cmp_ps_mask(im, zero, _CMP_GT_OQ);
+            __m512 fm = _mm512_mul_ps(_mm512_maskz_loadu_ps(lanes, f + i), im);
+            __m512 a = _mm512_mask_add_ps(fm, dynamic, fm, g);
+            _mm512_mask_storeu_ps(v + i, lanes, _mm512_fmadd_ps(a, vdt, _mm512_maskz_loadu_ps(lanes, v + i)));
+        }
+    }
+}
+
+#endif
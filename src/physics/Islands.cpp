@@ -0,0 +1,196 @@
+#include <algorithm>
+#include "Islands.h"
+
+IslandManager::IslandManager()
+    : m_NextGroup(1), m_SleepingCount(0), m_SleepEnabled(true), m_SleepVelocity(0.1f), m_TimeToSleep(0.5f) {
+}
+
+void IslandManager::setSleepEnabled(bool enabled) {
+    m_SleepEnabled = enabled;
+    if (!enabled)
+        wakeAll();
+}
+
+void IslandManager::setSleepThresholds(float velocity, float time) {
+    m_SleepVelocity = velocity;
+    m_TimeToSleep = time;
+}
+
+void IslandManager::resize(size_t count) {
+    if (count == m_Group.size())
+        return;
+    // resize zero fills, which is Awake with an empty timer
+    m_Parent.resize(count);
+    m_Group.resize(count);
+    m_SleepTime.resize(count);
+    buildAwakeRuns();
+}
+
+void IslandManager::wakeAll() {
+    m_Group.fill(Awake);
+    m_SleepTime.fill(0.0f);
+    buildAwakeRuns();
+}
+
+void IslandManager::permute(const AlignedArray<uint32_t>& order) {
+    AlignedArray<uint32_t> group(m_Group.size());
+    AlignedArray<float> sleepTime(m_SleepTime.size());
+    for (size_t i = 0; i < group.size(); i++) {
+        group[i] = m_Group[order[i]];
+        sleepTime[i] = m_SleepTime[order[i]];
+    }
+    std::swap(m_Group, group);
+    std::swap(m_SleepTime, sleepTime);
+    buildAwakeRuns();
+}
+
+uint32_t IslandManager::find(uint32_t body) {
+    uint32_t root = body;
+    while (m_Parent[root] != root)
+        root = m_Parent[root];
+    while (m_Parent[body] != root) {
+        uint32_t next = m_Parent[body];
+        m_Parent[body] = root;
+        body = next;
+    }
+    return root;
+}
+
+void IslandManager::wakeGroups() {
+    if (m_WakeGroups.empty())
+        return;
+    std::sort(m_WakeGroups.begin(), m_WakeGroups.end());
+    m_WakeGroups.erase(std::unique(m_WakeGroups.begin(), m_WakeGroups.end()), m_WakeGroups.end());
+    for (size_t i = 0; i < m_Group.size(); i++) {
+        if (m_Group[i] != Awake && std::binary_search(m_WakeGroups.begin(), m_WakeGroups.end(), m_Group[i])) {
+            m_Group[i] = Awake;
+            m_SleepTime[i] = 0.0f;
+        }
+    }
+    m_WakeGroups.clear();
+    buildAwakeRuns();
+}
+
+void IslandManager::buildAwakeRuns() {
+    m_AwakeRuns.clear();
+    m_SleepingCount = 0;
+    unsigned int count = (unsigned int) m_Group.size();
+    unsigned int i = 0;
+    while (i < count) {
+        if (m_Group[i] != Awake) {
+            m_SleepingCount++;
+            i++;
+            continue;
+        }
+        unsigned int begin = i;
+        while (i < count && m_Group[i] == Awake && i - begin < MaxRunLength)
+            i++;
+        m_AwakeRuns.push_back({ begin, i });
+    }
+}
+
+uint32_t IslandManager::islandOf(const Contact& contact) const {
+    if (m_IslandOf[contact.a] != None)
+        return m_IslandOf[contact.a];
+    return contact.b != WorldBody ? m_IslandOf[contact.b] : None;
+}
+
+void IslandManager::build(const ParticleStore& particles, const std::vector<Contact>& contacts) {
+    resize(particles.size());
+    unsigned int count = (unsigned int) particles.size();
+    for (unsigned int i = 0; i < count; i++)
+        m_Parent[i] = i;
+
+    // only contacts with an awake dynamic body matter, the rest belong to sleeping islands
+    for (const Contact& contact : contacts) {
+        bool activeA = isActive(particles, contact.a);
+        bool activeB = isActive(particles, contact.b);
+        if (!activeA && !activeB)
+            continue;
+        bool dynamicA = isDynamic(particles, contact.a);
+        bool dynamicB = isDynamic(particles, contact.b);
+        if (dynamicA && dynamicB)
+            m_Parent[find(contact.a)] = find(contact.b);
+        if (!activeA && dynamicA)
+            m_WakeGroups.push_back(m_Group[contact.a]);
+        if (!activeB && dynamicB)
+            m_WakeGroups.push_back(m_Group[contact.b]);
+    }
+    wakeGroups();
+
+    // number the islands in body order so the layout doesn't depend on the contact order
+    m_IslandOf.assign(count, None);
+    m_BodyOffsets.clear();
+    for (unsigned int i = 0; i < count; i++) {
+        if (!isActive(particles, i))
+            continue;
+        uint32_t root = find(i);
+        if (m_IslandOf[root] == None) {
+            m_IslandOf[root] = (uint32_t) m_BodyOffsets.size();
+            m_BodyOffsets.push_back(0);
+        }
+        m_IslandOf[i] = m_IslandOf[root];
+        m_BodyOffsets[m_IslandOf[i]]++;
+    }
+    unsigned int islands = (unsigned int) m_BodyOffsets.size();
+    unsigned int offset = 0;
+    for (unsigned int island = 0; island < islands; island++) {
+        unsigned int size = m_BodyOffsets[island];
+        m_BodyOffsets[island] = offset;
+        offset += size;
+    }
+    m_BodyOffsets.push_back(offset);
+    m_Bodies.resize(offset);
+    std::vector<unsigned int> cursor(m_BodyOffsets.begin(), m_BodyOffsets.end() - 1);
+    for (unsigned int i = 0; i < count; i++) {
+        if (m_IslandOf[i] != None)
+            m_Bodies[cursor[m_IslandOf[i]]++] = i;
+    }
+
+    // contacts grouped by island, in contact order within an island
+    m_ContactOffsets.assign(islands + 1, 0);
+    for (const Contact& contact : contacts) {
+        uint32_t island = islandOf(contact);
+        if (island != None)
+            m_ContactOffsets[island + 1]++;
+    }
+    for (unsigned int island = 0; island < islands; island++)
+        m_ContactOffsets[island + 1] += m_ContactOffsets[island];
+    m_Contacts.resize(m_ContactOffsets[islands]);
+    cursor.assign(m_ContactOffsets.begin(), m_ContactOffsets.end() - 1);
+    for (const Contact& contact : contacts) {
+        uint32_t island = islandOf(contact);
+        if (island != None)
+            m_Contacts[cursor[island]++] = contact;
+    }
+}
+
+void IslandManager::updateSleep(ParticleStore& particles, float dt) {
+    if (!m_SleepEnabled)
+        return;
+    float* v[3] = { particles.vx.data(), particles.vy.data(), particles.vz.data() };
+    float threshold = m_SleepVelocity * m_SleepVelocity;
+    bool changed = false;
+    for (unsigned int island = 0; island < getIslandCount(); island++) {
+        unsigned int begin = m_BodyOffsets[island], end = m_BodyOffsets[island + 1];
+        float minTime = m_TimeToSleep;
+        for (unsigned int i = begin; i < end; i++) {
+            unsigned int body = m_Bodies[i];
+            float speed = v[0][body] * v[0][body] + v[1][body] * v[1][body] + v[2][body] * v[2][body];
+            m_SleepTime[body] = speed > threshold ? 0.0f : m_SleepTime[body] + dt;
+            minTime = std::min(minTime, m_SleepTime[body]);
+        }
+        if (minTime < m_TimeToSleep)
+            continue;
+        uint32_t group = m_NextGroup;
+        m_NextGroup = m_NextGroup == None - 1 ? 1 : m_NextGroup + 1;
+        for (unsigned int i = begin; i < end; i++) {
+            unsigned int body = m_Bodies[i];
+            m_Group[body] = group;
+            v[0][body] = v[1][body] = v[2][body] = 0.0f;
+        }
+        changed = true;
+    }
+    if (changed)
+        buildAwakeRuns();
+}
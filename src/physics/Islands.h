@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "AlignedArray.h"
+#include "ParticleStore.h"
+#include "Narrowphase.h"
+
+// Contiguous run of body indices, used to walk only the awake bodies.
+struct BodyRun {
+	unsigned int begin, end;
+};
+
+// Splits the contact graph into islands with union-find every step and puts
+// islands to sleep once all their bodies have been slow for long enough. Static
+// bodies never join an island, so a floor doesn't merge everything resting on
+// it. A sleeping island keeps its group id so touching any of its bodies wakes
+// the whole island, even when the contacts between its bodies weren't tested.
+class IslandManager {
+public:
+	static constexpr uint32_t Awake = 0;
+	static constexpr unsigned int MaxRunLength = 2048; // long runs are split so the thread pool can balance them
+private:
+	AlignedArray<uint32_t> m_Parent; // union-find forest over body indices
+	AlignedArray<uint32_t> m_Group; // per body, Awake or the id of the sleeping island it belongs to
+	AlignedArray<float> m_SleepTime; // per body, how long it has been below the velocity threshold
+	uint32_t m_NextGroup;
+
+	std::vector<uint32_t> m_IslandOf; // per body, index of its awake island this step or None
+	std::vector<unsigned int> m_BodyOffsets; // island i owns m_Bodies[m_BodyOffsets[i] .. m_BodyOffsets[i + 1])
+	std::vector<unsigned int> m_Bodies;
+	std::vector<unsigned int> m_ContactOffsets; // island i owns m_Contacts[m_ContactOffsets[i] .. m_ContactOffsets[i + 1])
+	std::vector<Contact> m_Contacts;
+	std::vector<BodyRun> m_AwakeRuns;
+	std::vector<uint32_t> m_WakeGroups;
+	unsigned int m_SleepingCount;
+
+	bool m_SleepEnabled;
+	float m_SleepVelocity; // speed below which a body counts as resting
+	float m_TimeToSleep;
+
+	uint32_t find(uint32_t body);
+	void wakeGroups();
+	void buildAwakeRuns();
+	uint32_t islandOf(const Contact& contact) const;
+public:
+	static constexpr uint32_t None = 0xffffffffu;
+
+	IslandManager();
+
+	// grows the per body state to the particle count, new bodies start awake
+	void resize(size_t count);
+	// Merges bodies along contacts that have at least one awake dynamic body,
+	// wakes sleeping islands touched by awake ones and groups the contacts of
+	// the awake islands for the solver.
+	void build(const ParticleStore& particles, const std::vector<Contact>& contacts);
+	// Advances the sleep timers with the post-solve velocities and puts islands
+	// whose slowest-to-settle body has rested for the time to sleep to sleep.
+	void updateSleep(ParticleStore& particles, float dt);
+	void wakeAll();
+	// keeps the per body state in step with ParticleStore::permute
+	void permute(const AlignedArray<uint32_t>& order);
+
+	void setSleepEnabled(bool enabled);
+	void setSleepThresholds(float velocity, float time);
+
+	// bodies that can collide this step: awake and dynamic
+	inline bool isActive(const ParticleStore& particles, unsigned int body) const { return body != WorldBody && m_Group[body] == Awake && particles.invMass[body] > 0.0f; };
+	inline bool isDynamic(const ParticleStore& particles, unsigned int body) const { return body != WorldBody && particles.invMass[body] > 0.0f; };
+	inline bool isAsleep(unsigned int body) const { return m_Group[body] != Awake; };
+	inline bool isSleepEnabled() const { return m_SleepEnabled; };
+	inline unsigned int getIslandCount() const { return m_BodyOffsets.empty() ? 0 : (unsigned int) m_BodyOffsets.size() - 1; };
+	inline unsigned int getSleepingCount() const { return m_SleepingCount; };
+	inline const std::vector<unsigned int>& getContactOffsets() const { return m_ContactOffsets; };
+	inline const std::vector<Contact>& getIslandContacts() const { return m_Contacts; };
+	inline const std::vector<BodyRun>& getAwakeRuns() const { return m_AwakeRuns; };
+};
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cmath>
+#include "MdKernels.h"
+#include "Cpu.h"
+
+void computePairForcesScalar(const PairLaw& law, const PeriodicBox& box, const MdParticles& particles,
+    const uint32_t* offsets, const uint32_t* neighbors, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        float xi = particles.x[i], yi = particles.y[i], zi = particles.z[i];
+        float fx = 0.0f, fy = 0.0f, fz = 0.0f, energy = 0.0f;
+        for (uint32_t k = offsets[i]; k < offsets[i + 1]; k++) {
+            uint32_t j = neighbors[k];
+            float dx = xi - particles.x[j], dy = yi - particles.y[j], dz = zi - particles.z[j];
+            dx = nearestImage(dx, box.length[0]);
+            dy = nearestImage(dy, box.length[1]);
+            dz = nearestImage(dz, box.length[2]);
+            float r2 = dx * dx + dy * dy + dz * dz;
+            if (r2 >= law.cutoffSq || r2 <= 0.0f)
+                continue;
+            // scale is -dV/dr / r, so the force on i is scale * d
+            float scale, potential;
+            if (law.potential == PairPotential::LennardJones) {
+                float invR2 = 1.0f / r2;
+                float s6 = law.sigmaSq * invR2;
+                s6 = s6 * s6 * s6;
+                scale = 24.0f * law.epsilon * invR2 * s6 * (2.0f * s6 - 1.0f);
+                potential = 4.0f * law.epsilon * s6 * (s6 - 1.0f);
+            }
+            else if (law.potential == PairPotential::Tabulated) {
+                float u = std::fmax((r2 - law.tableStart) * law.tableInvStep, 0.0f);
+                uint32_t segment = std::min((uint32_t) u, law.tableSegments - 1);
+                float t = u - (float) segment;
+                const float* c = law.table + (size_t) segment * 8;
+                scale = ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+                potential = ((c[7] * t + c[6]) * t + c[5]) * t + c[4];
+            }
+            else {
+                float r = std::sqrt(r2);
+                float e = std::exp(-law.width * (r - law.equilibrium));
+                scale = 2.0f * law.depth * law.width * e * (e - 1.0f) / r;
+                potential = law.depth * e * (e - 2.0f);
+            }
+            fx += scale * dx;
+            fy += scale * dy;
+            fz += scale * dz;
+            energy += potential - law.energyShift;
+        }
+        particles.fx[i] = fx;
+        particles.fy[i] = fy;
+        particles.fz[i] = fz;
+        particles.energy[i] = 0.5f * energy;
+    }
+}
+
+void computePairForces(const PairLaw& law, const PeriodicBox& box, const MdParticles& particles,
+    const uint32_t* offsets, const uint32_t* neighbors, size_t begin, size_t end) {
+    switch (getSimdLevel()) {
+#if defined(PHYS_X86)
+    case SimdLevel::AVX512:
+        computePairForcesAVX512(law, box, particles, offsets, neighbors, begin, end);
+        break;
+    case SimdLevel::AVX2:
+        computePairForcesAVX2(law, box, particles, offsets, neighbors, begin, end);
+        break;
+#endif
+    default:
+        computePairForcesScalar(law, box, particles, offsets, neighbors, begin, end);
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+enum class PairPotential {
+	LennardJones, // 4 eps ((s / r)^12 - (s / r)^6)
+	Morse, // D (1 - exp(-a (r - r0)))^2 - D
+	Tabulated // any V(r), looked up in a PairTable
+};
+
+// Pair force law, cut off and shifted so the energy is zero at the cutoff.
+struct PairLaw {
+	PairPotential potential;
+	float cutoffSq;
+	float epsilon, sigmaSq; // Lennard-Jones
+	float depth, width, equilibrium; // Morse D, a, r0
+	float energyShift; // V(cutoff), subtracted from every pair
+	// tabulated: PairTable coefficients, 8 floats per segment uniform in r^2
+	// from tableStart, already shifted (energyShift is 0)
+	const float* table;
+	float tableStart, tableInvStep;
+	uint32_t tableSegments;
+};
+
+// Periodic box [0, length) in every axis; separations are wrapped to the
+// nearest image, d - length * round(d / length).
+struct PeriodicBox {
+	float length[3];
+	float invLength[3];
+};
+
+// nearest image of a separation between two wrapped positions, |d| < length
+inline float nearestImage(float d, float length) {
+	if (d > 0.5f * length)
+		return d - length;
+	if (d < -0.5f * length)
+		return d + length;
+	return d;
+}
+
+struct MdParticles {
+	const float* x;
+	const float* y;
+	const float* z;
+	float* fx;
+	float* fy;
+	float* fz;
+	float* energy; // half of every pair's energy, per particle
+};
+
+// Forces on particles [begin, end) from their neighbor lists (CSR, both
+// directions stored): every particle sums its own pairs and writes only its
+// own force, so ranges can run in parallel without atomics and each pair is
+// evaluated once from either side. Vectorized over the neighbors of one
+// particle with gathers, nearest image included; dispatches to AVX-512, AVX2
+// or scalar code at runtime.
+void computePairForces(const PairLaw& law, const PeriodicBox& box, const MdParticles& particles,
+	const uint32_t* offsets, const uint32_t* neighbors, size_t begin, size_t end);
+
+// per instruction set kernels, only call the ones getSimdLevel() allows
+void computePairForcesScalar(const PairLaw& law, const PeriodicBox& box, const MdParticles& particles,
+	const uint32_t* offsets, const uint32_t* neighbors, size_t begin, size_t end);
+void computePairForcesAVX2(const PairLaw& law, const PeriodicBox& box, const MdParticles& particles,
+	const uint32_t* offsets, const uint32_t* neighbors, size_t begin, size_t end);
+void computePairForcesAVX512(const PairLaw& law, const PeriodicBox& box, const MdParticles& particles,
+	const uint32_t* offsets, const uint32_t* neighbors, size_t begin, size_t end);
@@ -0,0 +1,137 @@
+#include "MdKernels.h"
+#include "Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+// e^x to about 2 ulp: x = n ln2 + r with |r| <= ln2 / 2, a degree 6
+// polynomial for e^r, and 2^n built straight into the exponent bits
+PHYS_TARGET_AVX2 static inline __m256 exp256(__m256 x) {
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.0f)), _mm256_set1_ps(87.0f));
+    __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), r);
+    __m256 p = _mm256_set1_ps(1.9875691500e-4f);
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.3981999507e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.3334519073e-3f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.1665795894e-2f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.6666665459e-1f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(5.0000001201e-1f));
+    p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+    __m256i scale = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(scale));
+}
+
+// 4x4 transposes in both halves of four registers
+PHYS_TARGET_AVX2 static inline void transposeHalves(__m256* v) {
+    __m256 t0 = _mm256_unpacklo_ps(v[0], v[1]), t1 = _mm256_unpackhi_ps(v[0], v[1]);
+    __m256 t2 = _mm256_unpacklo_ps(v[2], v[3]), t3 = _mm256_unpackhi_ps(v[2], v[3]);
+    v[0] = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(t0), _mm256_castps_pd(t2)));
+    v[1] = _mm256_castpd_ps(_mm256_unpackhi_pd(_mm256_castps_pd(t0), _mm256_castps_pd(t2)));
+    v[2] = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(t1), _mm256_castps_pd(t3)));
+    v[3] = _mm256_castpd_ps(_mm256_unpackhi_pd(_mm256_castps_pd(t1), _mm256_castps_pd(t3)));
+}
+
+PHYS_TARGET_AVX2 static inline float sum256(__m256 v) {
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_movehdup_ps(half));
+    return _mm_cvtss_f32(half);
+}
+
+template<PairPotential P>
+PHYS_TARGET_AVX2 static void pairForcesAVX2(const PairLaw& law, const PeriodicBox& box, const MdParticles& particles,
+    const uint32_t* offsets, const uint32_t* neighbors, size_t begin, size_t end) {
+    // lanes below the tail length are on
+    alignas(32) static const int32_t ramp[16] = { -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0 };
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 lengthX = _mm256_set1_ps(box.length[0]), lengthY = _mm256_set1_ps(box.length[1]), lengthZ = _mm256_set1_ps(box.length[2]);
+    const __m256 invX = _mm256_set1_ps(box.invLength[0]), invY = _mm256_set1_ps(box.invLength[1]), invZ = _mm256_set1_ps(box.invLength[2]);
+    const __m256 cutoffSq = _mm256_set1_ps(law.cutoffSq);
+    const __m256 shift = _mm256_set1_ps(law.energyShift);
+    const __m256 sigmaSq = _mm256_set1_ps(law.sigmaSq);
+    const __m256 forceLj = _mm256_set1_ps(24.0f * law.epsilon), energyLj = _mm256_set1_ps(4.0f * law.epsilon);
+    const __m256 width = _mm256_set1_ps(law.width), equilibrium = _mm256_set1_ps(law.equilibrium);
+    const __m256 forceMorse = _mm256_set1_ps(2.0f * law.depth * law.width), depth = _mm256_set1_ps(law.depth);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 tableStart = _mm256_set1_ps(law.tableStart), tableInvStep = _mm256_set1_ps(law.tableInvStep);
+    const __m256i lastSegment = _mm256_set1_epi32((int) law.tableSegments - 1);
+    const int rounding = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+
+    for (size_t i = begin; i < end; i++) {
+        __m256 xi = _mm256_set1_ps(particles.x[i]), yi = _mm256_set1_ps(particles.y[i]), zi = _mm256_set1_ps(particles.z[i]);
+        __m256 fx = zero, fy = zero, fz = zero, energy = zero;
+        for (uint32_t k = offsets[i]; k < offsets[i + 1]; k += 8) {
+            uint32_t left = offsets[i + 1] - k;
+            __m256i lanes = left >= 8 ? _mm256_set1_epi32(-1) : _mm256_loadu_si256((const __m256i*) (ramp + 8 - left));
+            __m256i j = _mm256_maskload_epi32((const int*) (neighbors + k), lanes);
+            __m256 on = _mm256_castsi256_ps(lanes);
+            __m256 dx = _mm256_sub_ps(xi, _mm256_mask_i32gather_ps(zero, particles.x, j, on, 4));
+            __m256 dy = _mm256_sub_ps(yi, _mm256_mask_i32gather_ps(zero, particles.y, j, on, 4));
+            __m256 dz = _mm256_sub_ps(zi, _mm256_mask_i32gather_ps(zero, particles.z, j, on, 4));
+            dx = _mm256_fnmadd_ps(lengthX, _mm256_round_ps(_mm256_mul_ps(dx, invX), rounding), dx);
+            dy = _mm256_fnmadd_ps(lengthY, _mm256_round_ps(_mm256_mul_ps(dy, invY), rounding), dy);
+            dz = _mm256_fnmadd_ps(lengthZ, _mm256_round_ps(_mm256_mul_ps(dz, invZ), rounding), dz);
+            __m256 r2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dz, dz)));
+            __m256 valid = _mm256_and_ps(on, _mm256_and_ps(_mm256_cmp_ps(r2, cutoffSq, _CMP_LT_OQ), _mm256_cmp_ps(r2, zero, _CMP_GT_OQ)));
+            // lanes that are off compute on a harmless distance and are masked afterwards
+            r2 = _mm256_blendv_ps(one, r2, valid);
+            __m256 scale, potential;
+            if (P == PairPotential::LennardJones) {
+                __m256 invR2 = _mm256_div_ps(one, r2);
+                __m256 s6 = _mm256_mul_ps(sigmaSq, invR2);
+                s6 = _mm256_mul_ps(_mm256_mul_ps(s6, s6), s6);
+                scale = _mm256_mul_ps(_mm256_mul_ps(forceLj, invR2), _mm256_mul_ps(s6, _mm256_fmsub_ps(two, s6, one)));
+                potential = _mm256_mul_ps(energyLj, _mm256_mul_ps(s6, _mm256_sub_ps(s6, one)));
+            }
+            else if (P == PairPotential::Tabulated) {
+                // each lane's segment is two aligned 128 bit loads, lanes i and
+                // i + 4 share a register and four of those transpose to the
+                // coefficients
+                __m256 u = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(r2, tableStart), tableInvStep), zero);
+                __m256i segment = _mm256_min_epu32(_mm256_cvttps_epi32(u), lastSegment);
+                __m256 t = _mm256_sub_ps(u, _mm256_cvtepi32_ps(segment));
+                alignas(32) uint32_t index[8];
+                _mm256_store_si256((__m256i*) index, _mm256_slli_epi32(segment, 3));
+                __m256 f[4], e[4];
+                for (int lane = 0; lane < 4; lane++) {
+                    const float* c0 = law.table + index[lane];
+                    const float* c1 = law.table + index[lane + 4];
+                    f[lane] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(c0)), _mm_load_ps(c1), 1);
+                    e[lane] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(c0 + 4)), _mm_load_ps(c1 + 4), 1);
+                }
+                transposeHalves(f);
+                transposeHalves(e);
+                scale = _mm256_fmadd_ps(_mm256_fmadd_ps(_mm256_fmadd_ps(f[3], t, f[2]), t, f[1]), t, f[0]);
+                potential = _mm256_fmadd_ps(_mm256_fmadd_ps(_mm256_fmadd_ps(e[3], t, e[2]), t, e[1]), t, e[0]);
+            }
+            else {
+                __m256 r = _mm256_sqrt_ps(r2);
+                __m256 e = exp256(_mm256_mul_ps(width, _mm256_sub_ps(equilibrium, r)));
+                scale = _mm256_div_ps(_mm256_mul_ps(_mm256_mul_ps(forceMorse, e), _mm256_sub_ps(e, one)), r);
+                potential = _mm256_mul_ps(_mm256_mul_ps(depth, e), _mm256_sub_ps(e, two));
+            }
+            scale = _mm256_and_ps(valid, scale);
+            fx = _mm256_fmadd_ps(scale, dx, fx);
+            fy = _mm256_fmadd_ps(scale, dy, fy);
+            fz = _mm256_fmadd_ps(scale, dz, fz);
+            energy = _mm256_add_ps(energy, _mm256_and_ps(valid, _mm256_sub_ps(potential, shift)));
+        }
+        particles.fx[i] = sum256(fx);
+        particles.fy[i] = sum256(fy);
+        particles.fz[i] = sum256(fz);
+        particles.energy[i] = 0.5f * sum256(energy);
+    }
+}
+
+PHYS_TARGET_AVX2 void computePairForcesAVX2(const PairLaw& law, const PeriodicBox& box, const MdParticles& particles,
+    const uint32_t* offsets, const uint32_t* neighbors, size_t begin, size_t end) {
+    if (law.potential == PairPotential::LennardJones)
+        pairForcesAVX2<PairPotential::LennardJones>(law, box, particles, offsets, neighbors, begin, end);
+    else if (law.potential == PairPotential::Tabulated)
+        pairForcesAVX2<PairPotential::Tabulated>(law, box, particles, offsets, neighbors, begin, end);
+    else
+        pairForcesAVX2<PairPotential::Morse>(law, box, particles, offsets, neighbors, begin, end);
+}
+
+#endif
@@ -0,0 +1,127 @@
+#include "MdKernels.h"
+#include "Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+// e^x as in the AVX2 kernel, with scalef applying the 2^n
+PHYS_TARGET_AVX512 static inline __m512 exp512(__m512 x) {
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(-87.0f)), _mm512_set1_ps(87.0f));
+    __m512 n = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(1.44269504f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(0.693359375f), x);
+    r = _mm512_fnmadd_ps(n, _mm512_set1_ps(-2.12194440e-4f), r);
+    __m512 p = _mm512_set1_ps(1.9875691500e-4f);
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.3981999507e-3f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(8.3334519073e-3f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(4.1665795894e-2f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.6666665459e-1f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(5.0000001201e-1f));
+    p = _mm512_fmadd_ps(p, _mm512_mul_ps(r, r), _mm512_add_ps(r, _mm512_set1_ps(1.0f)));
+    return _mm512_scalef_ps(p, n);
+}
+
+// 4x4 transposes in all four quarters of four registers
+PHYS_TARGET_AVX512 static inline void transposeQuarters(__m512* v) {
+    __m512 t0 = _mm512_unpacklo_ps(v[0], v[1]), t1 = _mm512_unpackhi_ps(v[0], v[1]);
+    __m512 t2 = _mm512_unpacklo_ps(v[2], v[3]), t3 = _mm512_unpackhi_ps(v[2], v[3]);
+    v[0] = _mm512_castpd_ps(_mm512_unpacklo_pd(_mm512_castps_pd(t0), _mm512_castps_pd(t2)));
+    v[1] = _mm512_castpd_ps(_mm512_unpackhi_pd(_mm512_castps_pd(t0), _mm512_castps_pd(t2)));
+    v[2] = _mm512_castpd_ps(_mm512_unpacklo_pd(_mm512_castps_pd(t1), _mm512_castps_pd(t3)));
+    v[3] = _mm512_castpd_ps(_mm512_unpackhi_pd(_mm512_castps_pd(t1), _mm512_castps_pd(t3)));
+}
+
+template<PairPotential P>
+PHYS_TARGET_AVX512 static void pairForcesAVX512(const PairLaw& law, const PeriodicBox& box, const MdParticles& particles,
+    const uint32_t* offsets, const uint32_t* neighbors, size_t begin, size_t end) {
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 lengthX = _mm512_set1_ps(box.length[0]), lengthY = _mm512_set1_ps(box.length[1]), lengthZ = _mm512_set1_ps(box.length[2]);
+    const __m512 invX = _mm512_set1_ps(box.invLength[0]), invY = _mm512_set1_ps(box.invLength[1]), invZ = _mm512_set1_ps(box.invLength[2]);
+    const __m512 cutoffSq = _mm512_set1_ps(law.cutoffSq);
+    const __m512 shift = _mm512_set1_ps(law.energyShift);
+    const __m512 sigmaSq = _mm512_set1_ps(law.sigmaSq);
+    const __m512 forceLj = _mm512_set1_ps(24.0f * law.epsilon), energyLj = _mm512_set1_ps(4.0f * law.epsilon);
+    const __m512 width = _mm512_set1_ps(law.width), equilibrium = _mm512_set1_ps(law.equilibrium);
+    const __m512 forceMorse = _mm512_set1_ps(2.0f * law.depth * law.width), depth = _mm512_set1_ps(law.depth);
+    const __m512 two = _mm512_set1_ps(2.0f);
+    const __m512 tableStart = _mm512_set1_ps(law.tableStart), tableInvStep = _mm512_set1_ps(law.tableInvStep);
+    const __m512i lastSegment = _mm512_set1_epi32((int) law.tableSegments - 1);
+    const int rounding = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+
+    for (size_t i = begin; i < end; i++) {
+        __m512 xi = _mm512_set1_ps(particles.x[i]), yi = _mm512_set1_ps(particles.y[i]), zi = _mm512_set1_ps(particles.z[i]);
+        __m512 fx = zero, fy = zero, fz = zero, energy = zero;
+        for (uint32_t k = offsets[i]; k < offsets[i + 1]; k += 16) {
+            uint32_t left = offsets[i + 1] - k;
+            __mmask16 on = left >= 16 ? (__mmask16) 0xffff : (__mmask16) ((1u << left) - 1);
+            __m512i j = _mm512_maskz_loadu_epi32(on, neighbors + k);
+            __m512 dx = _mm512_sub_ps(xi, _mm512_mask_i32gather_ps(zero, on, j, particles.x, 4));
+            __m512 dy = _mm512_sub_ps(yi, _mm512_mask_i32gather_ps(zero, on, j, particles.y, 4));
+            __m512 dz = _mm512_sub_ps(zi, _mm512_mask_i32gather_ps(zero, on, j, particles.z, 4));
+            dx = _mm512_fnmadd_ps(lengthX, _mm512_roundscale_ps(_mm512_mul_ps(dx, invX), rounding), dx);
+            dy = _mm512_fnmadd_ps(lengthY, _mm512_roundscale_ps(_mm512_mul_ps(dy, invY), rounding), dy);
+            dz = _mm512_fnmadd_ps(lengthZ, _mm512_roundscale_ps(_mm512_mul_ps(dz, invZ), rounding), dz);
+            __m512 r2 = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dz, dz)));
+            __mmask16 valid = _mm512_mask_cmp_ps_mask(on, r2, cutoffSq, _CMP_LT_OQ) & _mm512_cmp_ps_mask(r2, zero, _CMP_GT_OQ);
+            // lanes that are off compute on a harmless distance and are masked afterwards
+            r2 = _mm512_mask_blend_ps(valid, one, r2);
+            __m512 scale, potential;
+            if (P == PairPotential::LennardJones) {
+                __m512 invR2 = _mm512_div_ps(one, r2);
+                __m512 s6 = _mm512_mul_ps(sigmaSq, invR2);
+                s6 = _mm512_mul_ps(_mm512_mul_ps(s6, s6), s6);
+                scale = _mm512_mul_ps(_mm512_mul_ps(forceLj, invR2), _mm512_mul_ps(s6, _mm512_fmsub_ps(two, s6, one)));
+                potential = _mm512_mul_ps(energyLj, _mm512_mul_ps(s6, _mm512_sub_ps(s6, one)));
+            }
+            else if (P == PairPotential::Tabulated) {
+                // loads and transposes as in the AVX2 kernel, lanes i, i + 4,
+                // i + 8 and i + 12 sharing a register
+                __m512 u = _mm512_max_ps(_mm512_mul_ps(_mm512_sub_ps(r2, tableStart), tableInvStep), zero);
+                __m512i segment = _mm512_min_epu32(_mm512_cvttps_epi32(u), lastSegment);
+                __m512 t = _mm512_sub_ps(u, _mm512_cvtepi32_ps(segment));
+                alignas(64) uint32_t index[16];
+                _mm512_store_si512(index, _mm512_slli_epi32(segment, 3));
+                __m512 f[4], e[4];
+                for (int lane = 0; lane < 4; lane++) {
+                    const float* c0 = law.table + index[lane];
+                    const float* c1 = law.table + index[lane + 4];
+                    const float* c2 = law.table + index[lane + 8];
+                    const float* c3 = law.table + index[lane + 12];
+                    f[lane] = _mm512_insertf32x4(_mm512_castps128_ps512(_mm_load_ps(c0)), _mm_load_ps(c1), 1);
+                    f[lane] = _mm512_insertf32x4(_mm512_insertf32x4(f[lane], _mm_load_ps(c2), 2), _mm_load_ps(c3), 3);
+                    e[lane] = _mm512_insertf32x4(_mm512_castps128_ps512(_mm_load_ps(c0 + 4)), _mm_load_ps(c1 + 4), 1);
+                    e[lane] = _mm512_insertf32x4(_mm512_insertf32x4(e[lane], _mm_load_ps(c2 + 4), 2), _mm_load_ps(c3 + 4), 3);
+                }
+                transposeQuarters(f);
+                transposeQuarters(e);
+                scale = _mm512_fmadd_ps(_mm512_fmadd_ps(_mm512_fmadd_ps(f[3], t, f[2]), t, f[1]), t, f[0]);
+                potential = _mm512_fmadd_ps(_mm512_fmadd_ps(_mm512_fmadd_ps(e[3], t, e[2]), t, e[1]), t, e[0]);
+            }
+            else {
+                __m512 r = _mm512_sqrt_ps(r2);
+                __m512 e = exp512(_mm512_mul_ps(width, _mm512_sub_ps(equilibrium, r)));
+                scale = _mm512_div_ps(_mm512_mul_ps(_mm512_mul_ps(forceMorse, e), _mm512_sub_ps(e, one)), r);
+                potential = _mm512_mul_ps(_mm512_mul_ps(depth, e), _mm512_sub_ps(e, two));
+            }
+            fx = _mm512_mask3_fmadd_ps(scale, dx, fx, valid);
+            fy = _mm512_mask3_fmadd_ps(scale, dy, fy, valid);
+            fz = _mm512_mask3_fmadd_ps(scale, dz, fz, valid);
+            energy = _mm512_mask_add_ps(energy, valid, energy, _mm512_sub_ps(potential, shift));
+        }
+        particles.fx[i] = _mm512_reduce_add_ps(fx);
+        particles.fy[i] = _mm512_reduce_add_ps(fy);
+        particles.fz[i] = _mm512_reduce_add_ps(fz);
+        particles.energy[i] = 0.5f * _mm512_reduce_add_ps(energy);
+    }
+}
+
+PHYS_TARGET_AVX512 void computePairForcesAVX512(const PairLaw& law, const PeriodicBox& box, const MdParticles& particles,
+    const uint32_t* offsets, const uint32_t* neighbors, size_t begin, size_t end) {
+    if (law.potential == PairPotential::LennardJones)
+        pairForcesAVX512<PairPotential::LennardJones>(law, box, particles, offsets, neighbors, begin, end);
+    else if (law.potential == PairPotential::Tabulated)
+        pairForcesAVX512<PairPotential::Tabulated>(law, box, particles, offsets, neighbors, begin, end);
+    else
+        pairForcesAVX512<PairPotential::Morse>(law, box, particles, offsets, neighbors, begin, end);
+}
+
+#endif
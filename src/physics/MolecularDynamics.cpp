@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "MolecularDynamics.h"
+#include "Integrators.h"
+
+MolecularDynamics::MolecularDynamics()
+    : m_Potential(PairPotential::LennardJones), m_TableInnerRadius(0.0f), m_TableSegments(2048), m_Tabulate(false),
+      m_Cutoff(2.5f), m_Skin(0.3f), m_TimeStep(0.005f), m_Cells{ 1, 1, 1 },
+      m_ListsValid(false), m_ForcesValid(false), m_PotentialEnergy(0.0), m_KineticEnergy(0.0),
+      m_Substeps(0), m_Rebuilds(0), m_StepCount(0) {
+    m_Law = { PairPotential::LennardJones, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, nullptr, 0.0f, 0.0f, 0 };
+    setBox(10.0f, 10.0f, 10.0f);
+    updateLaw();
+}
+
+unsigned int MolecularDynamics::addParticle(float x, float y, float z, float vx, float vy, float vz, float mass) {
+    // drawn at half the distance where the pair potential turns attractive
+    m_ListsValid = false;
+    m_ForcesValid = false;
+    return m_Particles.add(x, y, z, vx, vy, vz, mass, 0.5f * contactDistance());
+}
+
+void MolecularDynamics::clear() {
+    m_Particles.clear();
+    m_ListsValid = false;
+    m_ForcesValid = false;
+}
+
+void MolecularDynamics::setBox(float x, float y, float z) {
+    float lengths[3] = { x, y, z };
+    for (int axis = 0; axis < 3; axis++) {
+        m_Box.length[axis] = lengths[axis];
+        m_Box.invLength[axis] = 1.0f / lengths[axis];
+    }
+    m_ListsValid = false;
+    m_ForcesValid = false;
+}
+
+float MolecularDynamics::contactDistance() const {
+    if (m_Potential == PairPotential::LennardJones)
+        return std::sqrt(m_Law.sigmaSq);
+    if (m_Potential == PairPotential::Morse)
+        return m_Law.equilibrium;
+    // first knot where -V'(r) / r is no longer repulsive
+    const float* c = m_Table.getCoefficients();
+    for (unsigned int k = 0; k < m_Table.getSegments(); k++)
+        if (c[k * PairTable::Stride] <= 0.0f)
+            return std::sqrt(m_Table.getStart() + k / m_Table.getInvStep());
+    return 0.5f * m_Cutoff;
+}
+
+void MolecularDynamics::setLennardJones(float epsilon, float sigma) {
+    m_Potential = PairPotential::LennardJones;
+    m_Law.epsilon = epsilon;
+    m_Law.sigmaSq = sigma * sigma;
+    updateLaw();
+}
+
+void MolecularDynamics::setMorse(float depth, float width, float equilibrium) {
+    m_Potential = PairPotential::Morse;
+    m_Law.depth = depth;
+    m_Law.width = width;
+    m_Law.equilibrium = equilibrium;
+    updateLaw();
+}
+
+void MolecularDynamics::setTabulated(const std::function<double(double)>& potential, float innerRadius,
+    const std::function<double(double)>& force) {
+    m_Potential = PairPotential::Tabulated;
+    m_TablePotential = potential;
+    m_TableForce = force;
+    m_TableInnerRadius = innerRadius;
+    updateLaw();
+}
+
+void MolecularDynamics::setTabulation(bool tabulate) {
+    m_Tabulate = tabulate;
+    updateLaw();
+}
+
+void MolecularDynamics::setTableSegments(unsigned int segments) {
+    m_TableSegments = std::max(segments, 1u);
+    updateLaw();
+}
+
+void MolecularDynamics::setCutoff(float cutoff) {
+    m_Cutoff = cutoff;
+    updateLaw();
+}
+
+void MolecularDynamics::setSkin(float skin) {
+    m_Skin = std::max(skin, 0.0f);
+    m_ListsValid = false;
+}
+
+void MolecularDynamics::setTimeStep(float timeStep) {
+    m_TimeStep = timeStep;
+}
+
+void MolecularDynamics::updateLaw() {
+    m_Law.cutoffSq = m_Cutoff * m_Cutoff;
+    double r = m_Cutoff;
+    m_Law.potential = m_Potential;
+    if (m_Potential == PairPotential::LennardJones) {
+        double s6 = std::pow(m_Law.sigmaSq / (r * r), 3.0);
+        m_Law.energyShift = (float) (4.0 * m_Law.epsilon * s6 * (s6 - 1.0));
+    }
+    else if (m_Potential == PairPotential::Morse) {
+        double e = std::exp(-(double) m_Law.width * (r - m_Law.equilibrium));
+        m_Law.energyShift = (float) (m_Law.depth * e * (e - 2.0));
+    }
+
+    if (m_Potential == PairPotential::Tabulated)
+        m_Table.build(m_TablePotential, m_TableInnerRadius, m_Cutoff, m_TableSegments, m_TableForce);
+    else if (m_Tabulate) {
+        // the built in laws in double, from half their contact distance
+        double epsilon = m_Law.epsilon, sigmaSq = m_Law.sigmaSq;
+        double depth = m_Law.depth, width = m_Law.width, equilibrium = m_Law.equilibrium;
+        if (m_Potential == PairPotential::LennardJones)
+            m_Table.build([=](double r) {
+                double s6 = std::pow(sigmaSq / (r * r), 3.0);
+                return 4.0 * epsilon * s6 * (s6 - 1.0);
+            }, 0.5f * contactDistance(), m_Cutoff, m_TableSegments, [=](double r) {
+                double s6 = std::pow(sigmaSq / (r * r), 3.0);
+                return 24.0 * epsilon * s6 * (2.0 * s6 - 1.0) / r;
+            });
+        else
+            m_Table.build([=](double r) {
+                double e = std::exp(-width * (r - equilibrium));
+                return depth * e * (e - 2.0);
+            }, 0.5f * contactDistance(), m_Cutoff, m_TableSegments, [=](double r) {
+                double e = std::exp(-width * (r - equilibrium));
+                return 2.0 * depth * width * e * (e - 1.0);
+            });
+    }
+    if (m_Potential == PairPotential::Tabulated || m_Tabulate) {
+        m_Law.potential = PairPotential::Tabulated;
+        m_Law.energyShift = 0.0f;
+        m_Law.table = m_Table.getCoefficients();
+        m_Law.tableStart = m_Table.getStart();
+        m_Law.tableInvStep = m_Table.getInvStep();
+        m_Law.tableSegments = m_Table.getSegments();
+    }
+    m_ListsValid = false;
+    m_ForcesValid = false;
+}
+
+void MolecularDynamics::setTemperature(float temperature) {
+    size_t count = m_Particles.size();
+    if (count == 0)
+        return;
+    double momentum[3] = { 0.0, 0.0, 0.0 }, mass = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        momentum[0] += m_Particles.mass[i] * m_Particles.vx[i];
+        momentum[1] += m_Particles.mass[i] * m_Particles.vy[i];
+        momentum[2] += m_Particles.mass[i] * m_Particles.vz[i];
+        mass += m_Particles.mass[i];
+    }
+    float drift[3] = { (float) (momentum[0] / mass), (float) (momentum[1] / mass), (float) (momentum[2] / mass) };
+    for (size_t i = 0; i < count; i++) {
+        m_Particles.vx[i] -= drift[0];
+        m_Particles.vy[i] -= drift[1];
+        m_Particles.vz[i] -= drift[2];
+    }
+    double kinetic = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double v2 = (double) m_Particles.vx[i] * m_Particles.vx[i] + (double) m_Particles.vy[i] * m_Particles.vy[i] + (double) m_Particles.vz[i] * m_Particles.vz[i];
+        kinetic += 0.5 * m_Particles.mass[i] * v2;
+    }
+    if (kinetic <= 0.0)
+        return;
+    float scale = (float) std::sqrt(1.5 * count * temperature / kinetic);
+    for (size_t i = 0; i < count; i++) {
+        m_Particles.vx[i] *= scale;
+        m_Particles.vy[i] *= scale;
+        m_Particles.vz[i] *= scale;
+    }
+    m_KineticEnergy = 1.5 * count * temperature;
+}
+
+// sum of value(i) over all particles, in fixed blocks so the rounding doesn't
+// depend on the thread count
+template<typename F>
+static double sumBlocks(size_t count, std::vector<double>& blockSums, ThreadPool& pool, F&& value) {
+    size_t blocks = (count + MolecularDynamics::BlockSize - 1) / MolecularDynamics::BlockSize;
+    blockSums.assign(blocks, 0.0);
+    pool.parallelFor(blocks, [&](size_t first, size_t last, unsigned int) {
+        for (size_t block = first; block < last; block++) {
+            double sum = 0.0;
+            size_t end = std::min(count, (block + 1) * MolecularDynamics::BlockSize);
+            for (size_t i = block * MolecularDynamics::BlockSize; i < end; i++)
+                sum += value(i);
+            blockSums[block] = sum;
+        }
+    });
+    double total = 0.0;
+    for (double sum : blockSums)
+        total += sum;
+    return total;
+}
+
+double MolecularDynamics::sumKineticEnergy(ThreadPool& pool) {
+    const float* mass = m_Particles.mass.data();
+    const float* v[3] = { m_Particles.vx.data(), m_Particles.vy.data(), m_Particles.vz.data() };
+    return sumBlocks(m_Particles.size(), m_BlockSums, pool, [&](size_t i) {
+        return 0.5 * mass[i] * ((double) v[0][i] * v[0][i] + (double) v[1][i] * v[1][i] + (double) v[2][i] * v[2][i]);
+    });
+}
+
+void MolecularDynamics::wrapPositions(ThreadPool& pool) {
+    float* p[3] = { m_Particles.px.data(), m_Particles.py.data(), m_Particles.pz.data() };
+    pool.parallelFor(m_Particles.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (int axis = 0; axis < 3; axis++) {
+            float length = m_Box.length[axis], invLength = m_Box.invLength[axis];
+            for (size_t i = begin; i < end; i++) {
+                float x = p[axis][i] - length * std::floor(p[axis][i] * invLength);
+                p[axis][i] = x < length ? x : 0.0f; // -tiny + length rounds up to length
+            }
+        }
+    });
+}
+
+float MolecularDynamics::maxDisplacementSq(ThreadPool& pool) {
+    m_ThreadMax.assign(pool.getThreadCount(), 0.0f);
+    pool.parallelFor(m_Particles.size(), [&](size_t begin, size_t end, unsigned int t) {
+        float largest = 0.0f;
+        for (size_t i = begin; i < end; i++) {
+            float d[3] = { m_Particles.px[i] - m_BuildX[i], m_Particles.py[i] - m_BuildY[i], m_Particles.pz[i] - m_BuildZ[i] };
+            for (int axis = 0; axis < 3; axis++)
+                d[axis] = nearestImage(d[axis], m_Box.length[axis]);
+            largest = std::max(largest, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        }
+        m_ThreadMax[t] = largest;
+    });
+    return *std::max_element(m_ThreadMax.begin(), m_ThreadMax.end());
+}
+
+void MolecularDynamics::buildNeighbors(ThreadPool& pool) {
+    uint32_t count = (uint32_t) m_Particles.size();
+    float range = m_Cutoff + m_Skin;
+    float rangeSq = range * range;
+
+    // cells at least the list range wide, so all neighbors are in the 27 cells
+    // around; with fewer than 3 cells along an axis the wrapped neighbors would
+    // repeat a cell, so the axis gets a single cell instead
+    float cellScale[3];
+    for (int axis = 0; axis < 3; axis++) {
+        unsigned int cells = (unsigned int) std::floor(m_Box.length[axis] / range);
+        m_Cells[axis] = cells >= 3 ? std::min(cells, 1024u) : 1;
+        cellScale[axis] = m_Cells[axis] * m_Box.invLength[axis];
+    }
+    uint32_t nx = m_Cells[0], ny = m_Cells[1], nz = m_Cells[2];
+
+    m_CellKeys.resize(count);
+    m_Order.resize(count);
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            uint32_t cx = std::min((uint32_t) (m_Particles.px[i] * cellScale[0]), nx - 1);
+            uint32_t cy = std::min((uint32_t) (m_Particles.py[i] * cellScale[1]), ny - 1);
+            uint32_t cz = std::min((uint32_t) (m_Particles.pz[i] * cellScale[2]), nz - 1);
+            m_CellKeys[i] = (cz * ny + cy) * nx + cx;
+            m_Order[i] = (uint32_t) i;
+        }
+    });
+    m_Sorter.sort(m_CellKeys, m_Order, pool);
+    m_Particles.permute(m_Order);
+
+    uint32_t cellCount = nx * ny * nz;
+    m_CellStart.resize(0);
+    m_CellStart.resize(cellCount + 1);
+    for (uint32_t i = 0; i < count; i++)
+        m_CellStart[m_CellKeys[i] + 1]++;
+    for (uint32_t c = 0; c < cellCount; c++)
+        m_CellStart[c + 1] += m_CellStart[c];
+
+    m_NeighborOffsets.resize(count + 1);
+    m_ThreadNeighbors.resize(pool.getThreadCount());
+    for (AlignedArray<uint32_t>& list : m_ThreadNeighbors)
+        list.clear();
+    const float* p[3] = { m_Particles.px.data(), m_Particles.py.data(), m_Particles.pz.data() };
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int t) {
+        AlignedArray<uint32_t>& list = m_ThreadNeighbors[t];
+        for (uint32_t i = (uint32_t) begin; i < end; i++) {
+            size_t before = list.size();
+            uint32_t key = m_CellKeys[i];
+            int cx = (int) (key % nx), cy = (int) (key / nx % ny), cz = (int) (key / (nx * ny));
+            int reachX = nx > 1 ? 1 : 0, reachY = ny > 1 ? 1 : 0, reachZ = nz > 1 ? 1 : 0;
+            for (int dz = -reachZ; dz <= reachZ; dz++) {
+                uint32_t z = (uint32_t) ((cz + dz + (int) nz) % (int) nz);
+                for (int dy = -reachY; dy <= reachY; dy++) {
+                    uint32_t y = (uint32_t) ((cy + dy + (int) ny) % (int) ny);
+                    for (int dx = -reachX; dx <= reachX; dx++) {
+                        uint32_t cell = (z * ny + y) * nx + (uint32_t) ((cx + dx + (int) nx) % (int) nx);
+                        for (uint32_t j = m_CellStart[cell]; j < m_CellStart[cell + 1]; j++) {
+                            float d[3] = { p[0][i] - p[0][j], p[1][i] - p[1][j], p[2][i] - p[2][j] };
+                            for (int axis = 0; axis < 3; axis++)
+                                d[axis] = nearestImage(d[axis], m_Box.length[axis]);
+                            if (j != i && d[0] * d[0] + d[1] * d[1] + d[2] * d[2] < rangeSq)
+                                list.push_back(j);
+                        }
+                    }
+                }
+            }
+            m_NeighborOffsets[i + 1] = (uint32_t) (list.size() - before);
+        }
+    });
+    m_NeighborOffsets[0] = 0;
+    for (uint32_t i = 0; i < count; i++)
+        m_NeighborOffsets[i + 1] += m_NeighborOffsets[i];
+
+    // the chunks are contiguous and in thread order, so the lists concatenate in particle order
+    std::vector<size_t> starts(m_ThreadNeighbors.size() + 1, 0);
+    for (size_t t = 0; t < m_ThreadNeighbors.size(); t++)
+        starts[t + 1] = starts[t] + m_ThreadNeighbors[t].size();
+    m_Neighbors.resize(starts.back());
+    pool.parallelFor(m_ThreadNeighbors.size(), [&](size_t first, size_t last, unsigned int) {
+        for (size_t t = first; t < last; t++) {
+            if (!m_ThreadNeighbors[t].empty())
+                std::memcpy(m_Neighbors.data() + starts[t], m_ThreadNeighbors[t].data(), m_ThreadNeighbors[t].size() * sizeof(uint32_t));
+        }
+    });
+
+    m_BuildX.resize(count);
+    m_BuildY.resize(count);
+    m_BuildZ.resize(count);
+    std::memcpy(m_BuildX.data(), p[0], count * sizeof(float));
+    std::memcpy(m_BuildY.data(), p[1], count * sizeof(float));
+    std::memcpy(m_BuildZ.data(), p[2], count * sizeof(float));
+    m_ListsValid = true;
+    m_Rebuilds++;
+}
+
+void MolecularDynamics::computeForces(ThreadPool& pool) {
+    wrapPositions(pool);
+    float halfSkin = 0.5f * m_Skin;
+    if (!m_ListsValid || m_Skin <= 0.0f || maxDisplacementSq(pool) > halfSkin * halfSkin)
+        buildNeighbors(pool);
+
+    size_t count = m_Particles.size();
+    m_Energy.resize(count);
+    MdParticles particles = { m_Particles.px.data(), m_Particles.py.data(), m_Particles.pz.data(),
+        m_Particles.fx.data(), m_Particles.fy.data(), m_Particles.fz.data(), m_Energy.data() };
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        computePairForces(m_Law, m_Box, particles, m_NeighborOffsets.data(), m_Neighbors.data(), begin, end);
+    });
+    const float* energy = m_Energy.data();
+    m_PotentialEnergy = sumBlocks(count, m_BlockSums, pool, [&](size_t i) { return (double) energy[i]; });
+    m_ForcesValid = true;
+}
+
+// velocity Verlet: half kick and drift with the old forces, new forces, half kick
+void MolecularDynamics::substep(float dt, ThreadPool& pool) {
+    static const float noGravity[3] = { 0.0f, 0.0f, 0.0f };
+    if (!m_ForcesValid)
+        computeForces(pool);
+    size_t count = m_Particles.size();
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        kickDrift(IntegratorArrays(m_Particles, begin, end), 0.5f * dt, dt, noGravity);
+    });
+    computeForces(pool);
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        kick(IntegratorArrays(m_Particles, begin, end), 0.5f * dt, noGravity);
+    });
+}
+
+void MolecularDynamics::step(float dt, ThreadPool& pool) {
+    if (m_Particles.size() == 0)
+        return;
+    m_Substeps = std::min((unsigned int) std::ceil(dt / m_TimeStep), MaxSubsteps);
+    m_Substeps = std::max(m_Substeps, 1u);
+    for (unsigned int s = 0; s < m_Substeps; s++)
+        substep(dt / m_Substeps, pool);
+    m_KineticEnergy = sumKineticEnergy(pool);
+    m_StepCount++;
+}
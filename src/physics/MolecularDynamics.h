@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+#include "RadixSort.h"
+#include "MdKernels.h"
+#include "PairTable.h"
+
+// Molecular dynamics of one particle species in a periodic box, Lennard-Jones
+// or Morse pairs cut off at a fixed radius, integrated with velocity Verlet.
+// Neighbors come from Verlet lists: every particle keeps the particles within
+// cutoff + skin, found through a cell list of cells at least that wide, and
+// the lists are reused until some particle has moved more than half the skin
+// since they were built, as no pair can have come inside the cutoff before
+// then. A rebuild sorts the particles by cell so the lists gather from nearby
+// memory. Lists hold both directions of every pair and forces are computed
+// per particle, so the force pass needs no atomics and gives the same result
+// on any thread count. Reductions go over fixed blocks of particles for the
+// same reason. Any other law runs through a cubic spline table built from
+// it (see PairTable), which the built in laws can use too: the force loop
+// then costs the same whatever the potential.
+class MolecularDynamics {
+public:
+	static constexpr unsigned int BlockSize = 1024;
+	static constexpr unsigned int MaxSubsteps = 256;
+private:
+	ParticleStore m_Particles;
+	AlignedArray<float> m_Energy; // potential energy per particle
+	AlignedArray<float> m_BuildX, m_BuildY, m_BuildZ; // positions when the lists were built
+	AlignedArray<uint32_t> m_NeighborOffsets, m_Neighbors; // CSR, self excluded
+	std::vector<AlignedArray<uint32_t>> m_ThreadNeighbors;
+	AlignedArray<uint32_t> m_CellKeys, m_Order; // cell per particle, sorting permutation
+	AlignedArray<uint32_t> m_CellStart; // first sorted particle of each cell, one past the end last
+	RadixSorter m_Sorter;
+	std::vector<double> m_BlockSums;
+	std::vector<float> m_ThreadMax;
+
+	PairLaw m_Law; // as the kernels run it
+	PairPotential m_Potential; // as it was set
+	PairTable m_Table;
+	std::function<double(double)> m_TablePotential, m_TableForce;
+	float m_TableInnerRadius;
+	unsigned int m_TableSegments;
+	bool m_Tabulate;
+	PeriodicBox m_Box;
+	float m_Cutoff, m_Skin;
+	float m_TimeStep; // largest substep
+	unsigned int m_Cells[3];
+	bool m_ListsValid, m_ForcesValid;
+	double m_PotentialEnergy, m_KineticEnergy;
+	unsigned int m_Substeps, m_Rebuilds; // rebuilds are counted over the whole run
+	unsigned long long m_StepCount;
+
+	void updateLaw();
+	// where the force turns attractive, for drawing
+	float contactDistance() const;
+	// largest squared distance any particle has moved since the last build
+	float maxDisplacementSq(ThreadPool& pool);
+	void wrapPositions(ThreadPool& pool);
+	void buildNeighbors(ThreadPool& pool);
+	void computeForces(ThreadPool& pool);
+	double sumKineticEnergy(ThreadPool& pool);
+	void substep(float dt, ThreadPool& pool);
+public:
+	MolecularDynamics();
+
+	unsigned int addParticle(float x, float y, float z, float vx = 0.0f, float vy = 0.0f, float vz = 0.0f, float mass = 1.0f);
+	void clear();
+	// advances dt in substeps of at most the time step
+	void step(float dt, ThreadPool& pool);
+
+	// the box is [0, x) x [0, y) x [0, z); particles outside are wrapped in
+	void setBox(float x, float y, float z);
+	void setLennardJones(float epsilon, float sigma);
+	void setMorse(float depth, float width, float equilibrium);
+	// any V(r) through a table from the inner radius to the cutoff; force(r)
+	// is -dV/dr and is differenced from the potential when left empty
+	void setTabulated(const std::function<double(double)>& potential, float innerRadius,
+		const std::function<double(double)>& force = nullptr);
+	// runs Lennard-Jones and Morse through a table of themselves as well
+	void setTabulation(bool tabulate);
+	void setTableSegments(unsigned int segments);
+	// the cutoff has to stay under half the box
+	void setCutoff(float cutoff);
+	// 0 rebuilds the lists every substep
+	void setSkin(float skin);
+	void setTimeStep(float timeStep);
+	// rescales the velocities to a kinetic temperature (k_B = 1) and removes the drift
+	void setTemperature(float temperature);
+
+	inline const ParticleStore& getParticles() const { return m_Particles; };
+	inline PairPotential getPotential() const { return m_Potential; };
+	inline bool isTabulated() const { return m_Law.potential == PairPotential::Tabulated; };
+	inline const PairTable& getTable() const { return m_Table; }; // valid while tabulated
+	inline const PeriodicBox& getBox() const { return m_Box; };
+	inline float getCutoff() const { return m_Cutoff; };
+	inline float getSkin() const { return m_Skin; };
+	inline float getTimeStep() const { return m_TimeStep; };
+	inline unsigned int getParticleCount() const { return (unsigned int) m_Particles.size(); };
+	inline size_t getNeighborCount() const { return m_Neighbors.size(); };
+	inline double getPotentialEnergy() const { return m_PotentialEnergy; }; // after the last substep
+	inline double getKineticEnergy() const { return m_KineticEnergy; };
+	inline double getTemperature() const { return m_Particles.size() ? 2.0 * m_KineticEnergy / (3.0 * m_Particles.size()) : 0.0; };
+	inline unsigned int getSubsteps() const { return m_Substeps; }; // of the last step
+	inline unsigned int getRebuilds() const { return m_Rebuilds; };
+	inline unsigned long long getStepCount() const { return m_StepCount; };
+};
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cmath>
+#include "Multigrid.h"
+
+// The walls mirror each cell into its missing neighbors, which drops them from
+// the stencil, so the rows above and below the grid are the row itself and
+// only the first and last column need their own code.
+static inline float cellResidual(const float* up, const float* row, const float* down, const float* b, unsigned int i, unsigned int n) {
+    float left = i > 0 ? row[i - 1] : row[i];
+    float right = i + 1 < n ? row[i + 1] : row[i];
+    return b[i] + up[i] + down[i] + left + right - 4.0f * row[i];
+}
+
+static void rowResidual(const float* up, const float* row, const float* down, const float* b, float* r, unsigned int n) {
+    r[0] = cellResidual(up, row, down, b, 0, n);
+    for (unsigned int i = 1; i + 1 < n; i++)
+        r[i] = b[i] + up[i] + down[i] + row[i - 1] + row[i + 1] - 4.0f * row[i];
+    r[n - 1] = cellResidual(up, row, down, b, n - 1, n);
+}
+
+// one damped Jacobi update of a row, `vertical` is how many of up and down are real cells
+static void rowJacobi(const float* up, const float* row, const float* down, const float* b, float* out, unsigned int n, float vertical) {
+    out[0] = row[0] + MultigridPoisson::Damping * cellResidual(up, row, down, b, 0, n) / (vertical + 1.0f);
+    float weight = MultigridPoisson::Damping / (vertical + 2.0f);
+    for (unsigned int i = 1; i + 1 < n; i++)
+        out[i] = row[i] + weight * (b[i] + up[i] + down[i] + row[i - 1] + row[i + 1] - 4.0f * row[i]);
+    out[n - 1] = row[n - 1] + MultigridPoisson::Damping * cellResidual(up, row, down, b, n - 1, n) / (vertical + 1.0f);
+}
+
+MultigridPoisson::MultigridPoisson()
+    : m_PreSmoothing(2), m_PostSmoothing(2), m_MaxCycles(20), m_Tolerance(1e-4f), m_Cycles(0), m_Residual(0.0) {
+}
+
+void MultigridPoisson::resize(unsigned int n) {
+    m_Levels.clear();
+    for (unsigned int size = std::max(n, CoarsestSize); ; size /= 2) {
+        Level level;
+        level.size = size;
+        level.x.resize((size_t) size * size);
+        level.b.resize((size_t) size * size);
+        level.r.resize((size_t) size * size);
+        m_Levels.push_back(std::move(level));
+        if (size <= CoarsestSize || size % 2 != 0)
+            break;
+    }
+}
+
+void MultigridPoisson::setSmoothing(unsigned int pre, unsigned int post) {
+    m_PreSmoothing = pre;
+    m_PostSmoothing = post;
+}
+
+void MultigridPoisson::setTolerance(float tolerance, unsigned int maxCycles) {
+    m_Tolerance = tolerance;
+    m_MaxCycles = maxCycles;
+}
+
+void MultigridPoisson::removeMean(AlignedArray<float>& values, ThreadPool& pool) {
+    size_t count = values.size();
+    size_t tiles = (count + TileRows * m_Levels[0].size - 1) / (TileRows * m_Levels[0].size);
+    m_TileSums.assign(tiles, 0.0);
+    pool.parallelFor(tiles, [&](size_t first, size_t last, unsigned int) {
+        for (size_t tile = first; tile < last; tile++) {
+            double sum = 0.0;
+            for (size_t i = tile * TileRows * m_Levels[0].size; i < std::min(count, (tile + 1) * TileRows * m_Levels[0].size); i++)
+                sum += values[i];
+            m_TileSums[tile] = sum;
+        }
+    });
+    double total = 0.0;
+    for (double sum : m_TileSums)
+        total += sum;
+    float mean = (float) (total / (double) count);
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++)
+            values[i] -= mean;
+    });
+}
+
+void MultigridPoisson::smooth(Level& level, unsigned int sweeps, ThreadPool& pool) {
+    unsigned int n = level.size;
+    size_t tiles = (n + TileRows - 1) / TileRows;
+    for (unsigned int sweep = 0; sweep < sweeps; sweep++) {
+        pool.parallelFor(tiles, [&](size_t first, size_t last, unsigned int) {
+            for (unsigned int y = (unsigned int) first * TileRows; y < std::min(n, (unsigned int) last * TileRows); y++) {
+                const float* row = level.x.data() + (size_t) y * n;
+                const float* up = y > 0 ? row - n : row;
+                const float* down = y + 1 < n ? row + n : row;
+                float vertical = (float) ((y > 0) + (y + 1 < n));
+                rowJacobi(up, row, down, level.b.data() + (size_t) y * n, level.r.data() + (size_t) y * n, n, vertical);
+            }
+        });
+        std::swap(level.x, level.r);
+    }
+}
+
+void MultigridPoisson::computeResidual(Level& level, ThreadPool& pool) {
+    unsigned int n = level.size;
+    size_t tiles = (n + TileRows - 1) / TileRows;
+    pool.parallelFor(tiles, [&](size_t first, size_t last, unsigned int) {
+        for (unsigned int y = (unsigned int) first * TileRows; y < std::min(n, (unsigned int) last * TileRows); y++) {
+            const float* row = level.x.data() + (size_t) y * n;
+            const float* up = y > 0 ? row - n : row;
+            const float* down = y + 1 < n ? row + n : row;
+            rowResidual(up, row, down, level.b.data() + (size_t) y * n, level.r.data() + (size_t) y * n, n);
+        }
+    });
+}
+
+double MultigridPoisson::residualNorm(const Level& level, ThreadPool& pool) {
+    size_t count = level.r.size();
+    size_t tiles = (count + TileRows * level.size - 1) / (TileRows * level.size);
+    m_TileSums.assign(tiles, 0.0);
+    pool.parallelFor(tiles, [&](size_t first, size_t last, unsigned int) {
+        for (size_t tile = first; tile < last; tile++) {
+            double sum = 0.0;
+            for (size_t i = tile * TileRows * level.size; i < std::min(count, (tile + 1) * TileRows * level.size); i++)
+                sum += (double) level.r[i] * level.r[i];
+            m_TileSums[tile] = sum;
+        }
+    });
+    double total = 0.0;
+    for (double sum : m_TileSums)
+        total += sum;
+    return std::sqrt(total);
+}
+
+// the coarse cells are twice as wide, which scales the stencil by 1/4, so the
+// residual of the 4 children is summed rather than averaged
+void MultigridPoisson::restrictResidual(const Level& fine, Level& coarse, ThreadPool& pool) {
+    unsigned int n = coarse.size, fineSize = fine.size;
+    pool.parallelFor(n, [&](size_t first, size_t last, unsigned int) {
+        for (size_t y = first; y < last; y++) {
+            const float* row0 = fine.r.data() + 2 * y * fineSize;
+            const float* row1 = row0 + fineSize;
+            float* b = coarse.b.data() + y * n;
+            float* x = coarse.x.data() + y * n;
+            for (unsigned int i = 0; i < n; i++) {
+                b[i] = row0[2 * i] + row0[2 * i + 1] + row1[2 * i] + row1[2 * i + 1];
+                x[i] = 0.0f;
+            }
+        }
+    });
+}
+
+// bilinear: every fine cell takes 9/16 of its parent, 3/16 of the two coarse
+// cells beside it and 1/16 of the diagonal one, clamped at the walls
+void MultigridPoisson::prolongate(const Level& coarse, Level& fine, ThreadPool& pool) {
+    int n = (int) coarse.size;
+    unsigned int fineSize = fine.size;
+    pool.parallelFor(fineSize, [&](size_t first, size_t last, unsigned int) {
+        for (size_t fy = first; fy < last; fy++) {
+            int y = (int) fy / 2;
+            int ny = std::min(std::max(fy % 2 ? y + 1 : y - 1, 0), n - 1);
+            const float* row = coarse.x.data() + (size_t) y * n;
+            const float* side = coarse.x.data() + (size_t) ny * n;
+            float* out = fine.x.data() + fy * fineSize;
+            for (int x = 0; x < n; x++) {
+                int left = std::max(x - 1, 0), right = std::min(x + 1, n - 1);
+                out[2 * x] += 0.5625f * row[x] + 0.1875f * (row[left] + side[x]) + 0.0625f * side[left];
+                out[2 * x + 1] += 0.5625f * row[x] + 0.1875f * (row[right] + side[x]) + 0.0625f * side[right];
+            }
+        }
+    });
+}
+
+// a few dozen Gauss-Seidel sweeps on the tiny grid, then the free constant is
+// removed since walls all around leave the pressure defined up to one
+void MultigridPoisson::solveCoarsest(Level& level) {
+    unsigned int n = level.size;
+    float* x = level.x.data();
+    const float* b = level.b.data();
+    for (unsigned int sweep = 0; sweep < CoarsestSweeps; sweep++) {
+        for (unsigned int y = 0; y < n; y++) {
+            for (unsigned int i = 0; i < n; i++) {
+                float sum = b[y * n + i], k = 0.0f;
+                if (i > 0) { sum += x[y * n + i - 1]; k++; }
+                if (i + 1 < n) { sum += x[y * n + i + 1]; k++; }
+                if (y > 0) { sum += x[(y - 1) * n + i]; k++; }
+                if (y + 1 < n) { sum += x[(y + 1) * n + i]; k++; }
+                x[y * n + i] = sum / k;
+            }
+        }
+    }
+    double mean = 0.0;
+    for (size_t i = 0; i < level.x.size(); i++)
+        mean += x[i];
+    mean /= (double) level.x.size();
+    for (size_t i = 0; i < level.x.size(); i++)
+        x[i] -= (float) mean;
+}
+
+void MultigridPoisson::cycle(size_t depth, ThreadPool& pool) {
+    Level& level = m_Levels[depth];
+    if (depth + 1 == m_Levels.size()) {
+        solveCoarsest(level);
+        return;
+    }
+    smooth(level, m_PreSmoothing, pool);
+    computeResidual(level, pool);
+    restrictResidual(level, m_Levels[depth + 1], pool);
+    cycle(depth + 1, pool);
+    prolongate(m_Levels[depth + 1], level, pool);
+    smooth(level, m_PostSmoothing, pool);
+}
+
+unsigned int MultigridPoisson::solve(ThreadPool& pool) {
+    Level& top = m_Levels[0];
+    // rounding leaves the right hand side slightly off zero sum, which has no solution
+    removeMean(top.b, pool);
+
+    std::swap(top.b, top.r);
+    double rhsNorm = residualNorm(top, pool);
+    std::swap(top.b, top.r);
+    m_Cycles = 0;
+    m_Residual = 0.0;
+    if (rhsNorm == 0.0)
+        return 0;
+    for (;;) {
+        computeResidual(top, pool);
+        m_Residual = residualNorm(top, pool) / rhsNorm;
+        if (m_Residual <= m_Tolerance || m_Cycles >= m_MaxCycles)
+            break;
+        cycle(0, pool);
+        // keeps the free constant from growing and eating into float precision
+        removeMean(top.x, pool);
+        m_Cycles++;
+    }
+    return m_Cycles;
+}
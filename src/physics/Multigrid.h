@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+#include "AlignedArray.h"
+#include "ThreadPool.h"
+
+// Geometric multigrid for the pressure Poisson equation on an n x n cell
+// centered grid with solid (zero normal gradient) walls on every side. The
+// system is the unscaled 5 point Laplacian, (A x)_i = k_i x_i - sum of the k_i
+// neighbors, with a right hand side that must sum to zero. Each level halves
+// the grid: residuals are restricted by summing the 4 children, corrections
+// come back bilinearly, and damped Jacobi smooths before and after. The
+// smoothing and residual loops run over tiles of rows in parallel with
+// branch free inner loops the compiler vectorizes; norms are summed per tile
+// so the result doesn't depend on the thread count.
+class MultigridPoisson {
+public:
+	static constexpr unsigned int TileRows = 16;
+	static constexpr unsigned int CoarsestSize = 4;
+	static constexpr unsigned int CoarsestSweeps = 64;
+	static constexpr float Damping = 0.8f; // best Jacobi weight for the 2d 5 point stencil
+private:
+	struct Level {
+		unsigned int size;
+		AlignedArray<float> x, b, r; // solution, right hand side, residual and smoother scratch
+	};
+	std::vector<Level> m_Levels;
+	std::vector<double> m_TileSums;
+	unsigned int m_PreSmoothing, m_PostSmoothing;
+	unsigned int m_MaxCycles;
+	float m_Tolerance; // on the residual norm relative to the right hand side
+	unsigned int m_Cycles;
+	double m_Residual;
+
+	void removeMean(AlignedArray<float>& values, ThreadPool& pool); // only for top level arrays
+	void smooth(Level& level, unsigned int sweeps, ThreadPool& pool);
+	void computeResidual(Level& level, ThreadPool& pool);
+	double residualNorm(const Level& level, ThreadPool& pool);
+	void restrictResidual(const Level& fine, Level& coarse, ThreadPool& pool);
+	void prolongate(const Level& coarse, Level& fine, ThreadPool& pool);
+	void solveCoarsest(Level& level);
+	void cycle(size_t depth, ThreadPool& pool);
+public:
+	MultigridPoisson();
+
+	// n must be a power of two, at least CoarsestSize
+	void resize(unsigned int n);
+	// Runs V-cycles until the relative residual drops below the tolerance,
+	// starting from whatever is in the solution. Returns the cycles taken.
+	unsigned int solve(ThreadPool& pool);
+
+	void setSmoothing(unsigned int pre, unsigned int post);
+	void setTolerance(float tolerance, unsigned int maxCycles);
+
+	inline AlignedArray<float>& getSolution() { return m_Levels[0].x; };
+	inline AlignedArray<float>& getRightHandSide() { return m_Levels[0].b; };
+	inline unsigned int getSize() const { return m_Levels.empty() ? 0 : m_Levels[0].size; };
+	inline unsigned int getLevelCount() const { return (unsigned int) m_Levels.size(); };
+	inline unsigned int getCycles() const { return m_Cycles; }; // of the last solve
+	inline double getResidual() const { return m_Residual; }; // relative, after the last solve
+};
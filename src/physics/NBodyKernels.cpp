@@ -0,0 +1,52 @@
+#include <cmath>
+#include "NBodyKernels.h"
+#include "Cpu.h"
+
+void accumulateGravityJerkScalar(const NBodySources& sources, const NBodyTargets& targets, double softeningSq) {
+    for (size_t i = 0; i < targets.count; i++) {
+        double tx = targets.x[i], ty = targets.y[i], tz = targets.z[i];
+        double tvx = targets.vx[i], tvy = targets.vy[i], tvz = targets.vz[i];
+        double ax = 0.0, ay = 0.0, az = 0.0, jx = 0.0, jy = 0.0, jz = 0.0;
+        for (size_t j = 0; j < sources.count; j++) {
+            double dx = sources.x[j] - tx;
+            double dy = sources.y[j] - ty;
+            double dz = sources.z[j] - tz;
+            double r2 = dx * dx + dy * dy + dz * dz;
+            if (r2 == 0.0)
+                continue;
+            double dvx = sources.vx[j] - tvx;
+            double dvy = sources.vy[j] - tvy;
+            double dvz = sources.vz[j] - tvz;
+            double inv2 = 1.0 / (r2 + softeningSq);
+            double s = sources.mass[j] * inv2 * std::sqrt(inv2);
+            double rv = -3.0 * (dx * dvx + dy * dvy + dz * dvz) * inv2;
+            ax += dx * s;
+            ay += dy * s;
+            az += dz * s;
+            jx += (dvx + rv * dx) * s;
+            jy += (dvy + rv * dy) * s;
+            jz += (dvz + rv * dz) * s;
+        }
+        targets.ax[i] += ax;
+        targets.ay[i] += ay;
+        targets.az[i] += az;
+        targets.jx[i] += jx;
+        targets.jy[i] += jy;
+        targets.jz[i] += jz;
+    }
+}
+
+void accumulateGravityJerk(const NBodySources& sources, const NBodyTargets& targets, double softeningSq) {
+    switch (getSimdLevel()) {
+#if defined(PHYS_X86)
+    case SimdLevel::AVX512:
+        accumulateGravityJerkAVX512(sources, targets, softeningSq);
+        break;
+    case SimdLevel::AVX2:
+        accumulateGravityJerkAVX2(sources, targets, softeningSq);
+        break;
+#endif
+    default:
+        accumulateGravityJerkScalar(sources, targets, softeningSq);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+
+// Point masses with velocities, double precision structure of arrays.
+struct NBodySources {
+	const double* x;
+	const double* y;
+	const double* z;
+	const double* vx;
+	const double* vy;
+	const double* vz;
+	const double* mass;
+	size_t count;
+};
+
+// Bodies the acceleration and jerk are evaluated for, and their accumulators.
+struct NBodyTargets {
+	const double* x;
+	const double* y;
+	const double* z;
+	const double* vx;
+	const double* vy;
+	const double* vz;
+	double* ax;
+	double* ay;
+	double* az;
+	double* jx;
+	double* jy;
+	double* jz;
+	size_t count;
+};
+
+// Gravity per unit G and its time derivative: with d = s - t, v = v_s - v_t
+// and q = |d|^2 + softeningSq,
+//   a(t) += m_s d / q^(3/2)
+//   j(t) += m_s (v / q^(3/2) - 3 (d . v) d / q^(5/2))
+// Sources at exactly the target position are skipped, so a target may appear in
+// its own source list. Double precision throughout, since block time stepping
+// follows tight binaries orbiting far inside a float's resolution of the
+// cluster. Vectorized over the sources; dispatches to AVX-512, AVX2 or scalar
+// code at runtime.
+void accumulateGravityJerk(const NBodySources& sources, const NBodyTargets& targets, double softeningSq);
+
+// per instruction set kernels, only call the ones getSimdLevel() allows
+void accumulateGravityJerkScalar(const NBodySources& sources, const NBodyTargets& targets, double softeningSq);
+void accumulateGravityJerkAVX2(const NBodySources& sources, const NBodyTargets& targets, double softeningSq);
+void accumulateGravityJerkAVX512(const NBodySources& sources, const NBodyTargets& targets, double softeningSq);
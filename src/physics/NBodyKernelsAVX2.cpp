@@ -0,0 +1,73 @@
+#include "NBodyKernels.h"
+#include "Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+static PHYS_TARGET_AVX2 inline double horizontalSum(__m256d v) {
+    __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    sum = _mm_add_sd(sum, _mm_unpackhi_pd(sum, sum));
+    return _mm_cvtsd_f64(sum);
+}
+
+// full precision sqrt and division, the tail is loaded with a lane mask
+PHYS_TARGET_AVX2 void accumulateGravityJerkAVX2(const NBodySources& sources, const NBodyTargets& targets, double softeningSq) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d minusThree = _mm256_set1_pd(-3.0);
+    const __m256d eps = _mm256_set1_pd(softeningSq);
+    const __m256i laneIndex = _mm256_setr_epi64x(0, 1, 2, 3);
+    size_t full = sources.count & ~(size_t) 3;
+    size_t left = sources.count - full;
+    __m256i tailMask = _mm256_cmpgt_epi64(_mm256_set1_epi64x((long long) left), laneIndex);
+    for (size_t i = 0; i < targets.count; i++) {
+        __m256d tx = _mm256_set1_pd(targets.x[i]);
+        __m256d ty = _mm256_set1_pd(targets.y[i]);
+        __m256d tz = _mm256_set1_pd(targets.z[i]);
+        __m256d tvx = _mm256_set1_pd(targets.vx[i]);
+        __m256d tvy = _mm256_set1_pd(targets.vy[i]);
+        __m256d tvz = _mm256_set1_pd(targets.vz[i]);
+        __m256d ax = zero, ay = zero, az = zero, jx = zero, jy = zero, jz = zero;
+        for (size_t j = 0; j < sources.count; j += 4) {
+            __m256d dx, dy, dz, dvx, dvy, dvz, m;
+            if (j < full) {
+                dx = _mm256_sub_pd(_mm256_loadu_pd(sources.x + j), tx);
+                dy = _mm256_sub_pd(_mm256_loadu_pd(sources.y + j), ty);
+                dz = _mm256_sub_pd(_mm256_loadu_pd(sources.z + j), tz);
+                dvx = _mm256_sub_pd(_mm256_loadu_pd(sources.vx + j), tvx);
+                dvy = _mm256_sub_pd(_mm256_loadu_pd(sources.vy + j), tvy);
+                dvz = _mm256_sub_pd(_mm256_loadu_pd(sources.vz + j), tvz);
+                m = _mm256_loadu_pd(sources.mass + j);
+            }
+            else {
+                // masked lanes load zero mass and add nothing
+                dx = _mm256_sub_pd(_mm256_maskload_pd(sources.x + j, tailMask), tx);
+                dy = _mm256_sub_pd(_mm256_maskload_pd(sources.y + j, tailMask), ty);
+                dz = _mm256_sub_pd(_mm256_maskload_pd(sources.z + j, tailMask), tz);
+                dvx = _mm256_sub_pd(_mm256_maskload_pd(sources.vx + j, tailMask), tvx);
+                dvy = _mm256_sub_pd(_mm256_maskload_pd(sources.vy + j, tailMask), tvy);
+                dvz = _mm256_sub_pd(_mm256_maskload_pd(sources.vz + j, tailMask), tvz);
+                m = _mm256_maskload_pd(sources.mass + j, tailMask);
+            }
+            __m256d r2 = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dz, dz)));
+            __m256d nonzero = _mm256_cmp_pd(r2, zero, _CMP_GT_OQ);
+            __m256d inv2 = _mm256_div_pd(one, _mm256_add_pd(r2, eps));
+            __m256d s = _mm256_and_pd(nonzero, _mm256_mul_pd(m, _mm256_mul_pd(inv2, _mm256_sqrt_pd(inv2))));
+            __m256d rv = _mm256_fmadd_pd(dx, dvx, _mm256_fmadd_pd(dy, dvy, _mm256_mul_pd(dz, dvz)));
+            rv = _mm256_mul_pd(minusThree, _mm256_mul_pd(rv, inv2));
+            ax = _mm256_fmadd_pd(dx, s, ax);
+            ay = _mm256_fmadd_pd(dy, s, ay);
+            az = _mm256_fmadd_pd(dz, s, az);
+            jx = _mm256_fmadd_pd(_mm256_fmadd_pd(rv, dx, dvx), s, jx);
+            jy = _mm256_fmadd_pd(_mm256_fmadd_pd(rv, dy, dvy), s, jy);
+            jz = _mm256_fmadd_pd(_mm256_fmadd_pd(rv, dz, dvz), s, jz);
+        }
+        targets.ax[i] += horizontalSum(ax);
+        targets.ay[i] += horizontalSum(ay);
+        targets.az[i] += horizontalSum(az);
+        targets.jx[i] += horizontalSum(jx);
+        targets.jy[i] += horizontalSum(jy);
+        targets.jz[i] += horizontalSum(jz);
+    }
+}
+
+#endif
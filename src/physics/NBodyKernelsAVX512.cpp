@@ -0,0 +1,52 @@
+#include "NBodyKernels.h"
+#include "Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+// full precision sqrt and division, the tail is handled with a lane mask
+PHYS_TARGET_AVX512 void accumulateGravityJerkAVX512(const NBodySources& sources, const NBodyTargets& targets, double softeningSq) {
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d minusThree = _mm512_set1_pd(-3.0);
+    const __m512d eps = _mm512_set1_pd(softeningSq);
+    for (size_t i = 0; i < targets.count; i++) {
+        __m512d tx = _mm512_set1_pd(targets.x[i]);
+        __m512d ty = _mm512_set1_pd(targets.y[i]);
+        __m512d tz = _mm512_set1_pd(targets.z[i]);
+        __m512d tvx = _mm512_set1_pd(targets.vx[i]);
+        __m512d tvy = _mm512_set1_pd(targets.vy[i]);
+        __m512d tvz = _mm512_set1_pd(targets.vz[i]);
+        __m512d ax = zero, ay = zero, az = zero, jx = zero, jy = zero, jz = zero;
+        for (size_t j = 0; j < sources.count; j += 8) {
+            size_t left = sources.count - j;
+            __mmask8 lanes = left >= 8 ? (__mmask8) 0xff : (__mmask8) ((1u << left) - 1);
+            __m512d dx = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, sources.x + j), tx);
+            __m512d dy = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, sources.y + j), ty);
+            __m512d dz = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, sources.z + j), tz);
+            __m512d dvx = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, sources.vx + j), tvx);
+            __m512d dvy = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, sources.vy + j), tvy);
+            __m512d dvz = _mm512_sub_pd(_mm512_maskz_loadu_pd(lanes, sources.vz + j), tvz);
+            __m512d m = _mm512_maskz_loadu_pd(lanes, sources.mass + j);
+            __m512d r2 = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dz, dz)));
+            __mmask8 use = _mm512_mask_cmp_pd_mask(lanes, r2, zero, _CMP_GT_OQ);
+            __m512d inv2 = _mm512_div_pd(one, _mm512_add_pd(r2, eps));
+            __m512d s = _mm512_maskz_mul_pd(use, m, _mm512_mul_pd(inv2, _mm512_sqrt_pd(inv2)));
+            __m512d rv = _mm512_fmadd_pd(dx, dvx, _mm512_fmadd_pd(dy, dvy, _mm512_mul_pd(dz, dvz)));
+            rv = _mm512_mul_pd(minusThree, _mm512_mul_pd(rv, inv2));
+            ax = _mm512_fmadd_pd(dx, s, ax);
+            ay = _mm512_fmadd_pd(dy, s, ay);
+            az = _mm512_fmadd_pd(dz, s, az);
+            jx = _mm512_fmadd_pd(_mm512_fmadd_pd(rv, dx, dvx), s, jx);
+            jy = _mm512_fmadd_pd(_mm512_fmadd_pd(rv, dy, dvy), s, jy);
+            jz = _mm512_fmadd_pd(_mm512_fmadd_pd(rv, dz, dvz), s, jz);
+        }
+        targets.ax[i] += _mm512_reduce_add_pd(ax);
+        targets.ay[i] += _mm512_reduce_add_pd(ay);
+        targets.az[i] += _mm512_reduce_add_pd(az);
+        targets.jx[i] += _mm512_reduce_add_pd(jx);
+        targets.jy[i] += _mm512_reduce_add_pd(jy);
+        targets.jz[i] += _mm512_reduce_add_pd(jz);
+    }
+}
+
+#endif
@@ -0,0 +1,401 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "NBodySystem.h"
+#include "NBodyKernels.h"
+
+// fixed blocks summed in order, so the result doesn't depend on the thread count
+template<typename F>
+static double sumBlocks(size_t count, std::vector<double>& blockSums, ThreadPool& pool, F&& value) {
+    size_t blocks = (count + NBodySystem::BlockSize - 1) / NBodySystem::BlockSize;
+    blockSums.assign(blocks, 0.0);
+    pool.parallelFor(blocks, [&](size_t first, size_t last, unsigned int) {
+        for (size_t block = first; block < last; block++) {
+            double sum = 0.0;
+            size_t end = std::min(count, (block + 1) * NBodySystem::BlockSize);
+            for (size_t i = block * NBodySystem::BlockSize; i < end; i++)
+                sum += value(i);
+            blockSums[block] = sum;
+        }
+    });
+    double total = 0.0;
+    for (double sum : blockSums)
+        total += sum;
+    return total;
+}
+
+static inline double length(double x, double y, double z) {
+    return std::sqrt(x * x + y * y + z * z);
+}
+
+NBodySystem::NBodySystem()
+    : m_Integrator(NBodyIntegrator::Hermite), m_Constant(1.0), m_Softening(1e-4), m_Accuracy(0.02), m_Tolerance(1e-10),
+      m_BlockSteps(true), m_Started(false), m_Time(0.0), m_LevelCounts{}, m_DeepestLevel(0),
+      m_Evaluations(0), m_SharedEvaluations(0), m_Events(0), m_StepCount(0) {
+}
+
+unsigned int NBodySystem::addBody(double x, double y, double z, double vx, double vy, double vz, double mass) {
+    unsigned int index = (unsigned int) m_Mass.size();
+    m_X.push_back(x);
+    m_Y.push_back(y);
+    m_Z.push_back(z);
+    m_VX.push_back(vx);
+    m_VY.push_back(vy);
+    m_VZ.push_back(vz);
+    m_Mass.push_back(mass);
+    size_t count = m_Mass.size();
+    for (AlignedArray<double>* array : { &m_AX, &m_AY, &m_AZ, &m_JX, &m_JY, &m_JZ, &m_PX, &m_PY, &m_PZ, &m_PVX, &m_PVY, &m_PVZ, &m_Wanted })
+        array->resize(count);
+    m_Tick.resize(count);
+    m_Level.resize(count);
+    m_Started = false;
+    return index;
+}
+
+void NBodySystem::clear() {
+    for (AlignedArray<double>* array : { &m_X, &m_Y, &m_Z, &m_VX, &m_VY, &m_VZ, &m_AX, &m_AY, &m_AZ, &m_JX, &m_JY, &m_JZ,
+        &m_Mass, &m_PX, &m_PY, &m_PZ, &m_PVX, &m_PVY, &m_PVZ, &m_Wanted })
+        array->clear();
+    m_Tick.clear();
+    m_Level.clear();
+    m_Started = false;
+    m_Time = 0.0;
+    m_Evaluations = m_SharedEvaluations = m_Events = m_StepCount = 0;
+}
+
+void NBodySystem::setIntegrator(NBodyIntegrator integrator) {
+    m_Integrator = integrator;
+    m_Started = false;
+}
+
+void NBodySystem::setConstant(double constant) {
+    m_Constant = constant;
+    m_Started = false;
+}
+
+void NBodySystem::setSoftening(double softening) {
+    m_Softening = softening;
+    m_Started = false;
+}
+
+void NBodySystem::setAccuracy(double accuracy) {
+    m_Accuracy = accuracy;
+}
+
+void NBodySystem::setTolerance(double tolerance) {
+    m_Tolerance = tolerance;
+}
+
+void NBodySystem::setBlockSteps(bool enabled) {
+    m_BlockSteps = enabled;
+}
+
+unsigned int NBodySystem::levelFor(double wanted, double blockDt) const {
+    unsigned int level = 0;
+    double step = blockDt;
+    while (step > wanted && level < MaxLevel) {
+        step *= 0.5;
+        level++;
+    }
+    return level;
+}
+
+unsigned int NBodySystem::nextLevel(size_t i, uint32_t tick, double blockDt) const {
+    unsigned int wanted = levelFor(m_Wanted[i], blockDt);
+    unsigned int level = m_Level[i];
+    if (wanted >= level)
+        return wanted;
+    // grow by one at a time, and only where the doubled step starts
+    if (tick % stepTicks(level - 1) == 0)
+        return level - 1;
+    return level;
+}
+
+void NBodySystem::shareLevels() {
+    if (m_BlockSteps)
+        return;
+    // every body is active at every tick, so they all change together
+    uint8_t deepest = 0;
+    for (size_t i = 0; i < m_Level.size(); i++)
+        deepest = std::max(deepest, m_Level[i]);
+    std::fill(m_Level.begin(), m_Level.end(), deepest);
+}
+
+void NBodySystem::evaluate(const double* x, const double* y, const double* z,
+    const double* vx, const double* vy, const double* vz, ThreadPool& pool) {
+    size_t count = m_Active.size();
+    for (AlignedArray<double>* array : { &m_NewAX, &m_NewAY, &m_NewAZ, &m_NewJX, &m_NewJY, &m_NewJZ }) {
+        array->resize(0);
+        array->resize(count);
+    }
+    NBodySources sources = { x, y, z, vx, vy, vz, m_Mass.data(), m_Mass.size() };
+    size_t blocks = (count + TargetBlock - 1) / TargetBlock;
+    pool.parallelFor(blocks, [&](size_t first, size_t last, unsigned int) {
+        size_t begin = first * TargetBlock, end = std::min(count, last * TargetBlock);
+        NBodyTargets targets = { m_TX.data() + begin, m_TY.data() + begin, m_TZ.data() + begin,
+            m_TVX.data() + begin, m_TVY.data() + begin, m_TVZ.data() + begin,
+            m_NewAX.data() + begin, m_NewAY.data() + begin, m_NewAZ.data() + begin,
+            m_NewJX.data() + begin, m_NewJY.data() + begin, m_NewJZ.data() + begin, end - begin };
+        accumulateGravityJerk(sources, targets, m_Softening * m_Softening);
+        for (size_t k = begin; k < end; k++) {
+            m_NewAX[k] *= m_Constant;
+            m_NewAY[k] *= m_Constant;
+            m_NewAZ[k] *= m_Constant;
+            m_NewJX[k] *= m_Constant;
+            m_NewJY[k] *= m_Constant;
+            m_NewJZ[k] *= m_Constant;
+        }
+    });
+    m_Evaluations += count;
+}
+
+// copies the active bodies out of six state arrays into contiguous targets
+static void gather(const AlignedArray<uint32_t>& active, const double* const* from, AlignedArray<double>* const* to) {
+    for (int axis = 0; axis < 6; axis++) {
+        to[axis]->resize(active.size());
+        for (size_t k = 0; k < active.size(); k++)
+            (*to[axis])[k] = from[axis][active[k]];
+    }
+}
+
+void NBodySystem::start(ThreadPool& pool) {
+    size_t count = m_Mass.size();
+    m_Active.resize(count);
+    for (size_t i = 0; i < count; i++)
+        m_Active[i] = (uint32_t) i;
+    const double* state[6] = { m_X.data(), m_Y.data(), m_Z.data(), m_VX.data(), m_VY.data(), m_VZ.data() };
+    AlignedArray<double>* targets[6] = { &m_TX, &m_TY, &m_TZ, &m_TVX, &m_TVY, &m_TVZ };
+    gather(m_Active, state, targets);
+    evaluate(m_X.data(), m_Y.data(), m_Z.data(), m_VX.data(), m_VY.data(), m_VZ.data(), pool);
+    for (size_t i = 0; i < count; i++) {
+        m_AX[i] = m_NewAX[i];
+        m_AY[i] = m_NewAY[i];
+        m_AZ[i] = m_NewAZ[i];
+        m_JX[i] = m_NewJX[i];
+        m_JY[i] = m_NewJY[i];
+        m_JZ[i] = m_NewJZ[i];
+        // no history yet, both integrators start from |a| / |jerk|
+        double jerk = length(m_JX[i], m_JY[i], m_JZ[i]);
+        m_Wanted[i] = jerk > 0.0 ? m_Accuracy * length(m_AX[i], m_AY[i], m_AZ[i]) / jerk : HUGE_VAL;
+    }
+    m_Started = true;
+}
+
+void NBodySystem::step(double dt, ThreadPool& pool) {
+    if (m_Mass.size() == 0 || dt <= 0.0)
+        return;
+    m_DeepestLevel = 0;
+    if (m_Integrator == NBodyIntegrator::DormandPrince)
+        stepAdaptive(dt, pool);
+    else {
+        if (!m_Started)
+            start(pool);
+        // every step is aligned to its own size at the start of a block, so any level goes
+        for (size_t i = 0; i < m_Mass.size(); i++) {
+            m_Tick[i] = 0;
+            m_Level[i] = (uint8_t) levelFor(m_Wanted[i], dt);
+        }
+        shareLevels();
+        for (size_t i = 0; i < m_Level.size(); i++)
+            m_DeepestLevel = std::max(m_DeepestLevel, (unsigned int) m_Level[i]);
+        if (m_Integrator == NBodyIntegrator::Hermite)
+            stepHermite(dt, pool);
+        else
+            stepLeapfrog(dt, pool);
+        m_SharedEvaluations += (unsigned long long) m_Mass.size() << m_DeepestLevel;
+    }
+
+    std::fill(m_LevelCounts, m_LevelCounts + MaxLevel + 1, 0u);
+    for (size_t i = 0; i < m_Level.size(); i++)
+        m_LevelCounts[m_Level[i]]++;
+    m_Time += dt;
+    m_StepCount++;
+}
+
+// the earliest end of a step, and the bodies whose step ends there
+static uint32_t nextTick(const AlignedArray<uint32_t>& ticks, const AlignedArray<uint8_t>& levels, AlignedArray<uint32_t>& active) {
+    uint32_t next = UINT32_MAX;
+    for (size_t i = 0; i < ticks.size(); i++)
+        next = std::min(next, ticks[i] + (1u << (NBodySystem::MaxLevel - levels[i])));
+    active.clear();
+    for (size_t i = 0; i < ticks.size(); i++) {
+        if (ticks[i] + (1u << (NBodySystem::MaxLevel - levels[i])) == next)
+            active.push_back((uint32_t) i);
+    }
+    return next;
+}
+
+void NBodySystem::stepHermite(double dt, ThreadPool& pool) {
+    const uint32_t blockTicks = 1u << MaxLevel;
+    const double tickDt = dt / blockTicks;
+    const double* predicted[6] = { m_PX.data(), m_PY.data(), m_PZ.data(), m_PVX.data(), m_PVY.data(), m_PVZ.data() };
+    AlignedArray<double>* targets[6] = { &m_TX, &m_TY, &m_TZ, &m_TVX, &m_TVY, &m_TVZ };
+    uint32_t tick = 0;
+    while (tick < blockTicks) {
+        tick = nextTick(m_Tick, m_Level, m_Active);
+
+        // every body is a source, predicted to the tick from its own time
+        pool.parallelFor(m_Mass.size(), [&](size_t begin, size_t end, unsigned int) {
+            for (size_t i = begin; i < end; i++) {
+                double h = (tick - m_Tick[i]) * tickDt;
+                m_PX[i] = m_X[i] + h * (m_VX[i] + h * (0.5 * m_AX[i] + h * m_JX[i] / 6.0));
+                m_PY[i] = m_Y[i] + h * (m_VY[i] + h * (0.5 * m_AY[i] + h * m_JY[i] / 6.0));
+                m_PZ[i] = m_Z[i] + h * (m_VZ[i] + h * (0.5 * m_AZ[i] + h * m_JZ[i] / 6.0));
+                m_PVX[i] = m_VX[i] + h * (m_AX[i] + 0.5 * h * m_JX[i]);
+                m_PVY[i] = m_VY[i] + h * (m_AY[i] + 0.5 * h * m_JY[i]);
+                m_PVZ[i] = m_VZ[i] + h * (m_AZ[i] + 0.5 * h * m_JZ[i]);
+            }
+        });
+        gather(m_Active, predicted, targets);
+        evaluate(m_PX.data(), m_PY.data(), m_PZ.data(), m_PVX.data(), m_PVY.data(), m_PVZ.data(), pool);
+
+        pool.parallelFor(m_Active.size(), [&](size_t begin, size_t end, unsigned int) {
+            for (size_t k = begin; k < end; k++) {
+                uint32_t i = m_Active[k];
+                double h = (tick - m_Tick[i]) * tickDt;
+                double* x[3] = { &m_X[i], &m_Y[i], &m_Z[i] };
+                double* v[3] = { &m_VX[i], &m_VY[i], &m_VZ[i] };
+                double* a[3] = { &m_AX[i], &m_AY[i], &m_AZ[i] };
+                double* j[3] = { &m_JX[i], &m_JY[i], &m_JZ[i] };
+                double a1[3] = { m_NewAX[k], m_NewAY[k], m_NewAZ[k] };
+                double j1[3] = { m_NewJX[k], m_NewJY[k], m_NewJZ[k] };
+                double a2[3], a3[3];
+                for (int axis = 0; axis < 3; axis++) {
+                    double a0 = *a[axis], j0 = *j[axis], v0 = *v[axis];
+                    double v1 = v0 + 0.5 * h * (a0 + a1[axis]) + h * h * (j0 - j1[axis]) / 12.0;
+                    *x[axis] += 0.5 * h * (v0 + v1) + h * h * (a0 - a1[axis]) / 12.0;
+                    *v[axis] = v1;
+                    // second and third derivatives of the interpolant, the second at the end of the step
+                    a3[axis] = (12.0 * (a0 - a1[axis]) + 6.0 * h * (j0 + j1[axis])) / (h * h * h);
+                    a2[axis] = (-6.0 * (a0 - a1[axis]) - h * (4.0 * j0 + 2.0 * j1[axis])) / (h * h) + h * a3[axis];
+                    *a[axis] = a1[axis];
+                    *j[axis] = j1[axis];
+                }
+                double na = length(a1[0], a1[1], a1[2]), nj = length(j1[0], j1[1], j1[2]);
+                double n2 = length(a2[0], a2[1], a2[2]), n3 = length(a3[0], a3[1], a3[2]);
+                double below = nj * n3 + n2 * n2;
+                m_Wanted[i] = below > 0.0 ? std::sqrt(m_Accuracy * (na * n2 + nj * nj) / below) : HUGE_VAL;
+                m_Level[i] = (uint8_t) nextLevel(i, tick, dt);
+                m_Tick[i] = tick;
+            }
+        });
+        shareLevels();
+        for (uint32_t i : m_Active)
+            m_DeepestLevel = std::max(m_DeepestLevel, (unsigned int) m_Level[i]);
+        m_Events++;
+    }
+}
+
+void NBodySystem::stepLeapfrog(double dt, ThreadPool& pool) {
+    const uint32_t blockTicks = 1u << MaxLevel;
+    const double tickDt = dt / blockTicks;
+    const double* state[6] = { m_X.data(), m_Y.data(), m_Z.data(), m_VX.data(), m_VY.data(), m_VZ.data() };
+    AlignedArray<double>* targets[6] = { &m_TX, &m_TY, &m_TZ, &m_TVX, &m_TVY, &m_TVZ };
+    // opening half kicks with the accelerations from the end of the last block
+    for (size_t i = 0; i < m_Mass.size(); i++) {
+        double h = 0.5 * stepTicks(m_Level[i]) * tickDt;
+        m_VX[i] += h * m_AX[i];
+        m_VY[i] += h * m_AY[i];
+        m_VZ[i] += h * m_AZ[i];
+    }
+    uint32_t tick = 0;
+    while (tick < blockTicks) {
+        uint32_t last = tick;
+        tick = nextTick(m_Tick, m_Level, m_Active);
+        double h = (tick - last) * tickDt;
+        pool.parallelFor(m_Mass.size(), [&](size_t begin, size_t end, unsigned int) {
+            for (size_t i = begin; i < end; i++) {
+                m_X[i] += h * m_VX[i];
+                m_Y[i] += h * m_VY[i];
+                m_Z[i] += h * m_VZ[i];
+            }
+        });
+        // the jerk only feeds the step criterion, so half kicked velocities do
+        gather(m_Active, state, targets);
+        evaluate(m_X.data(), m_Y.data(), m_Z.data(), m_VX.data(), m_VY.data(), m_VZ.data(), pool);
+
+        pool.parallelFor(m_Active.size(), [&](size_t begin, size_t end, unsigned int) {
+            for (size_t k = begin; k < end; k++) {
+                uint32_t i = m_Active[k];
+                double close = 0.5 * (tick - m_Tick[i]) * tickDt;
+                m_VX[i] += close * m_NewAX[k];
+                m_VY[i] += close * m_NewAY[k];
+                m_VZ[i] += close * m_NewAZ[k];
+                m_AX[i] = m_NewAX[k];
+                m_AY[i] = m_NewAY[k];
+                m_AZ[i] = m_NewAZ[k];
+                m_JX[i] = m_NewJX[k];
+                m_JY[i] = m_NewJY[k];
+                m_JZ[i] = m_NewJZ[k];
+                double jerk = length(m_JX[i], m_JY[i], m_JZ[i]);
+                m_Wanted[i] = jerk > 0.0 ? m_Accuracy * length(m_AX[i], m_AY[i], m_AZ[i]) / jerk : HUGE_VAL;
+                m_Level[i] = (uint8_t) nextLevel(i, tick, dt);
+                m_Tick[i] = tick;
+            }
+        });
+        shareLevels();
+        // the block ends synchronized: the last kicks stay half closed until the next one
+        if (tick < blockTicks) {
+            for (uint32_t i : m_Active) {
+                double open = 0.5 * stepTicks(m_Level[i]) * tickDt;
+                m_VX[i] += open * m_AX[i];
+                m_VY[i] += open * m_AY[i];
+                m_VZ[i] += open * m_AZ[i];
+                m_DeepestLevel = std::max(m_DeepestLevel, (unsigned int) m_Level[i]);
+            }
+        }
+        m_Events++;
+    }
+}
+
+void NBodySystem::stepAdaptive(double dt, ThreadPool& pool) {
+    size_t count = m_Mass.size();
+    double* parts[6] = { m_X.data(), m_Y.data(), m_Z.data(), m_VX.data(), m_VY.data(), m_VZ.data() };
+    m_State.resize(6 * count);
+    for (int part = 0; part < 6; part++)
+        std::memcpy(m_State.data() + part * count, parts[part], count * sizeof(double));
+    if (!m_Started) {
+        m_Adaptive.reset();
+        m_Started = true;
+    }
+    m_Active.resize(count);
+    for (size_t i = 0; i < count; i++)
+        m_Active[i] = (uint32_t) i;
+    m_Level.fill(0);
+
+    // positions move with the velocities, velocities with the accelerations
+    AlignedArray<double>* targets[6] = { &m_TX, &m_TY, &m_TZ, &m_TVX, &m_TVY, &m_TVZ };
+    unsigned long long evaluations = m_Adaptive.getEvaluations();
+    m_Adaptive.setTolerance(m_Tolerance, m_Tolerance);
+    m_Adaptive.integrate(m_State.data(), 6 * count, m_Time, dt, [&](double, const double* y, double* rate) {
+        const double* state[6] = { y, y + count, y + 2 * count, y + 3 * count, y + 4 * count, y + 5 * count };
+        gather(m_Active, state, targets);
+        evaluate(state[0], state[1], state[2], state[3], state[4], state[5], pool);
+        std::memcpy(rate, state[3], 3 * count * sizeof(double));
+        std::memcpy(rate + 3 * count, m_NewAX.data(), count * sizeof(double));
+        std::memcpy(rate + 4 * count, m_NewAY.data(), count * sizeof(double));
+        std::memcpy(rate + 5 * count, m_NewAZ.data(), count * sizeof(double));
+    }, pool);
+    evaluations = m_Adaptive.getEvaluations() - evaluations;
+    m_Events += evaluations;
+    m_SharedEvaluations += evaluations * count;
+
+    for (int part = 0; part < 6; part++)
+        std::memcpy(parts[part], m_State.data() + part * count, count * sizeof(double));
+}
+
+double NBodySystem::computeEnergy(ThreadPool& pool) {
+    size_t count = m_Mass.size();
+    double softeningSq = m_Softening * m_Softening;
+    return sumBlocks(count, m_BlockSums, pool, [&](size_t i) {
+        double potential = 0.0;
+        for (size_t j = 0; j < count; j++) {
+            double dx = m_X[j] - m_X[i], dy = m_Y[j] - m_Y[i], dz = m_Z[j] - m_Z[i];
+            double r2 = dx * dx + dy * dy + dz * dz;
+            if (r2 > 0.0)
+                potential += m_Mass[j] / std::sqrt(r2 + softeningSq);
+        }
+        double speedSq = m_VX[i] * m_VX[i] + m_VY[i] * m_VY[i] + m_VZ[i] * m_VZ[i];
+        return m_Mass[i] * (0.5 * speedSq - 0.5 * m_Constant * potential);
+    });
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "AlignedArray.h"
+#include "ThreadPool.h"
+#include "../numerics/DormandPrince.h"
+
+enum class NBodyIntegrator {
+	Hermite, // fourth order predictor-corrector on the acceleration and its derivative
+	Leapfrog, // kick-drift-kick, second order and symplectic while the steps stay put
+	DormandPrince // adaptive Runge-Kutta 5(4) with one step for every body, no blocks
+};
+
+// Collisionless gravity between point masses with individual block time steps,
+// for clusters whose orbital periods span orders of magnitude (tight binaries
+// inside a cluster that takes thousands of their orbits to cross). Every call
+// to step advances one block of dt; inside it each body takes steps of dt / 2^k
+// for its own level k, so a binary can run at 2^12 steps per block while the
+// halo takes one. All steps are aligned to their own size, so at any moment
+// the bodies due for a step are the ones whose level divides the current tick,
+// and only those are pushed through the force kernel: the cost of a step is the
+// active bodies times all the sources, not every body times all the sources.
+// A body may shrink its step at any of its own steps but only doubles it when
+// the current time is a multiple of the doubled step, which keeps the schedule
+// aligned. Every body is synchronized at the end of a block.
+//
+// Hermite predicts every body to the current time from its last acceleration
+// and jerk, evaluates both for the active bodies and corrects them to fourth
+// order; the next step comes from the Aarseth criterion on the interpolated
+// higher derivatives. Leapfrog drifts every body to the current time, closes the
+// half kick of the active bodies with their new acceleration and opens the next
+// one with their new step, stepping by accuracy times |a| / |jerk|. State is in
+// double precision: a binary a ten thousandth of the cluster across is below
+// a float's resolution of the positions.
+//
+// DormandPrince ignores the levels and moves the positions and velocities of
+// all bodies as one state vector, with a shared step that the error estimate
+// shrinks around close encounters and grows again once they are over; it
+// suits smooth systems where no body needs a much shorter step than the rest.
+class NBodySystem {
+public:
+	static constexpr unsigned int MaxLevel = 24; // steps down to a block over 2^24
+	static constexpr unsigned int BlockSize = 1024; // bodies per energy block
+	static constexpr unsigned int TargetBlock = 64; // active bodies per force task
+private:
+	// at each body's own time for Hermite; current positions and
+	// half-kicked velocities for Leapfrog
+	AlignedArray<double> m_X, m_Y, m_Z, m_VX, m_VY, m_VZ;
+	AlignedArray<double> m_AX, m_AY, m_AZ, m_JX, m_JY, m_JZ;
+	AlignedArray<double> m_Mass;
+	AlignedArray<double> m_PX, m_PY, m_PZ, m_PVX, m_PVY, m_PVZ; // predicted to the current tick
+	AlignedArray<double> m_Wanted; // step the criterion asked for at the last step
+	AlignedArray<uint32_t> m_Tick; // of the last step, from the start of the block
+	AlignedArray<uint8_t> m_Level;
+	AlignedArray<uint32_t> m_Active;
+	// active bodies gathered for the force kernel, with their new acceleration and jerk
+	AlignedArray<double> m_TX, m_TY, m_TZ, m_TVX, m_TVY, m_TVZ;
+	AlignedArray<double> m_NewAX, m_NewAY, m_NewAZ, m_NewJX, m_NewJY, m_NewJZ;
+	std::vector<double> m_BlockSums;
+	DormandPrince m_Adaptive;
+	AlignedArray<double> m_State; // x, y, z, vx, vy, vz end to end for the adaptive integrator
+
+	NBodyIntegrator m_Integrator;
+	double m_Constant, m_Softening;
+	double m_Accuracy; // eta of the step criterion
+	double m_Tolerance; // of the adaptive integrator, absolute and relative
+	bool m_BlockSteps; // false gives every body the smallest step any of them wants
+	bool m_Started; // accelerations and jerks belong to the current positions
+	double m_Time;
+	unsigned int m_LevelCounts[MaxLevel + 1]; // bodies per level at the end of the last block
+	unsigned int m_DeepestLevel; // of the last block
+	unsigned long long m_Evaluations; // active bodies summed over all force evaluations
+	unsigned long long m_SharedEvaluations; // what a shared smallest step would have taken
+	unsigned long long m_Events; // ticks at which some body stepped, one force evaluation each
+	unsigned long long m_StepCount;
+
+	static inline uint32_t stepTicks(unsigned int level) { return 1u << (MaxLevel - level); };
+	unsigned int levelFor(double wanted, double blockDt) const;
+	unsigned int nextLevel(size_t i, uint32_t tick, double blockDt) const;
+	void evaluate(const double* x, const double* y, const double* z,
+		const double* vx, const double* vy, const double* vz, ThreadPool& pool);
+	void start(ThreadPool& pool);
+	void shareLevels();
+	void stepHermite(double dt, ThreadPool& pool);
+	void stepLeapfrog(double dt, ThreadPool& pool);
+	void stepAdaptive(double dt, ThreadPool& pool);
+public:
+	NBodySystem();
+
+	unsigned int addBody(double x, double y, double z, double vx, double vy, double vz, double mass);
+	void clear();
+	// advances one block of dt, every body synchronized at its end
+	void step(double dt, ThreadPool& pool);
+
+	void setIntegrator(NBodyIntegrator integrator);
+	void setConstant(double constant);
+	void setSoftening(double softening);
+	void setAccuracy(double accuracy);
+	void setTolerance(double tolerance);
+	void setBlockSteps(bool enabled);
+	// kinetic plus potential, direct sum in double; call between steps
+	double computeEnergy(ThreadPool& pool);
+
+	inline size_t size() const { return m_Mass.size(); };
+	inline const double* getX() const { return m_X.data(); };
+	inline const double* getY() const { return m_Y.data(); };
+	inline const double* getZ() const { return m_Z.data(); };
+	inline const double* getMass() const { return m_Mass.data(); };
+	inline NBodyIntegrator getIntegrator() const { return m_Integrator; };
+	inline double getSoftening() const { return m_Softening; };
+	inline double getAccuracy() const { return m_Accuracy; };
+	inline double getTolerance() const { return m_Tolerance; };
+	inline const DormandPrince& getAdaptive() const { return m_Adaptive; };
+	inline bool getBlockSteps() const { return m_BlockSteps; };
+	inline double getTime() const { return m_Time; };
+	inline unsigned int getLevelCount(unsigned int level) const { return m_LevelCounts[level]; };
+	inline unsigned int getDeepestLevel() const { return m_DeepestLevel; };
+	inline unsigned long long getEvaluations() const { return m_Evaluations; };
+	inline unsigned long long getSharedEvaluations() const { return m_SharedEvaluations; };
+	inline unsigned long long getEventCount() const { return m_Events; };
+	inline unsigned long long getStepCount() const { return m_StepCount; };
+};
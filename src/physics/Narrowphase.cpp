@@ -0,0 +1,70 @@
+#include <cmath>
+#include <algorithm>
+#include "Narrowphase.h"
+
+void collideSpheres(const ParticleStore& particles, const std::vector<BodyPair>& pairs, std::vector<Contact>& contacts, ThreadPool& pool) {
+    std::vector<std::vector<Contact>> threadContacts(pool.getThreadCount());
+    pool.parallelFor(pairs.size(), [&](size_t begin, size_t end, unsigned int t) {
+        std::vector<Contact>& local = threadContacts[t];
+        for (size_t i = begin; i < end; i++) {
+            unsigned int a = pairs[i].a, b = pairs[i].b;
+            if (particles.invMass[a] == 0.0f && particles.invMass[b] == 0.0f)
+                continue;
+            float dx = particles.px[b] - particles.px[a];
+            float dy = particles.py[b] - particles.py[a];
+            float dz = particles.pz[b] - particles.pz[a];
+            float r = particles.radius[a] + particles.radius[b];
+            float distanceSq = dx * dx + dy * dy + dz * dz;
+            if (distanceSq >= r * r)
+                continue;
+
+            Contact contact;
+            contact.a = a;
+            contact.b = b;
+            float distance = std::sqrt(distanceSq);
+            if (distance > 1e-6f) {
+                contact.normal[0] = dx / distance;
+                contact.normal[1] = dy / distance;
+                contact.normal[2] = dz / distance;
+            }
+            else {
+                // concentric, any direction will do
+                contact.normal[0] = 0.0f;
+                contact.normal[1] = 1.0f;
+                contact.normal[2] = 0.0f;
+            }
+            contact.depth = r - distance;
+            contact.feature = 0;
+            local.push_back(contact);
+        }
+    });
+
+    contacts.clear();
+    for (const std::vector<Contact>& local : threadContacts)
+        contacts.insert(contacts.end(), local.begin(), local.end());
+}
+
+void collideBounds(const ParticleStore& particles, size_t begin, size_t end, const float min[3], const float max[3], std::vector<Contact>& contacts) {
+    const float* p[3] = { particles.px.data(), particles.py.data(), particles.pz.data() };
+    for (size_t i = begin; i < end; i++) {
+        if (particles.invMass[i] == 0.0f)
+            continue;
+        float r = particles.radius[i];
+        for (int c = 0; c < 3; c++) {
+            for (int side = 0; side < 2; side++) {
+                // a little slack so bodies clamped onto the wall still count as touching
+                float depth = side == 0 ? min[c] - (p[c][i] - r) : (p[c][i] + r) - max[c];
+                if (depth < -0.01f * r)
+                    continue;
+                Contact contact;
+                contact.a = (unsigned int) i;
+                contact.b = WorldBody;
+                contact.normal[0] = contact.normal[1] = contact.normal[2] = 0.0f;
+                contact.normal[c] = side == 0 ? -1.0f : 1.0f;
+                contact.depth = std::max(depth, 0.0f);
+                contact.feature = (uint32_t) (2 * c + side);
+                contacts.push_back(contact);
+            }
+        }
+    }
+}
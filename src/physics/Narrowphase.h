@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Broadphase.h"
+
+// Contact::b of contacts against the world bounds, which act like a static body
+constexpr unsigned int WorldBody = 0xffffffffu;
+
+struct Contact {
+	unsigned int a, b;
+	float normal[3]; // unit vector from a towards b
+	float depth; // how far the spheres overlap along the normal
+	uint32_t feature; // which contact point of the pair this is: 0 for sphere pairs, the wall for world contacts
+};
+
+// Exact sphere-sphere test on the broadphase pairs. Pairs of two static bodies
+// are skipped. Contacts come out in pair order.
+void collideSpheres(const ParticleStore& particles, const std::vector<BodyPair>& pairs, std::vector<Contact>& contacts, ThreadPool& pool);
+
+// Contacts between the particles [begin, end) and the walls of the box [min, max],
+// appended to contacts. Bodies touching a wall get a contact of depth 0 so
+// the solver can hold them against it. The feature is 2 * axis + (1 for the max wall).
+void collideBounds(const ParticleStore& particles, size_t begin, size_t end, const float min[3], const float max[3], std::vector<Contact>& contacts);
@@ -0,0 +1,245 @@
+#include <cmath>
+#include <algorithm>
+#include "Octree.h"
+
+Octree::Octree()
+    : m_LeafSize(16), m_Origin{ 0.0f, 0.0f, 0.0f }, m_Extent(1.0f) {
+}
+
+void Octree::setLeafSize(unsigned int size) {
+    m_LeafSize = std::max(size, 1u);
+}
+
+// spreads the low 21 bits of v so there are two zero bits between each
+static inline uint64_t spreadBits(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8) & 0x100f00f00f00f00full;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+}
+
+static inline unsigned int digitAt(uint64_t code, unsigned int depth) {
+    return (unsigned int) (code >> (3 * (Octree::MaxDepth - 1 - depth))) & 7;
+}
+
+void Octree::computeBounds(const ParticleStore& particles, ThreadPool& pool) {
+    unsigned int threads = pool.getThreadCount();
+    std::vector<float> lo(3 * threads, INFINITY), hi(3 * threads, -INFINITY);
+    const float* p[3] = { particles.px.data(), particles.py.data(), particles.pz.data() };
+    pool.parallelFor(particles.size(), [&](size_t begin, size_t end, unsigned int t) {
+        for (int c = 0; c < 3; c++) {
+            float a = INFINITY, b = -INFINITY;
+            for (size_t i = begin; i < end; i++) {
+                a = std::min(a, p[c][i]);
+                b = std::max(b, p[c][i]);
+            }
+            lo[3 * t + c] = a;
+            hi[3 * t + c] = b;
+        }
+    });
+    float extent = 0.0f;
+    for (int c = 0; c < 3; c++) {
+        float a = INFINITY, b = -INFINITY;
+        for (unsigned int t = 0; t < threads; t++) {
+            a = std::min(a, lo[3 * t + c]);
+            b = std::max(b, hi[3 * t + c]);
+        }
+        m_Origin[c] = a;
+        extent = std::max(extent, b - a);
+    }
+    // a little larger so the far corner still quantizes inside the cube
+    m_Extent = std::max(extent * 1.0001f, 1e-6f);
+}
+
+void Octree::sortParticles(const ParticleStore& particles, const float* strength, ThreadPool& pool) {
+    size_t count = particles.size();
+    m_Codes.resize(count);
+    m_TreeCodes.resize(count);
+    m_KeysLow.resize(count);
+    m_KeysHigh.resize(count);
+    m_Order.resize(count);
+    m_X.resize(count);
+    m_Y.resize(count);
+    m_Z.resize(count);
+    m_Strength.resize(count);
+    const float scale = (float) (1u << MaxDepth) / m_Extent;
+    const float top = (float) ((1u << MaxDepth) - 1);
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            uint64_t cell[3];
+            float p[3] = { particles.px[i], particles.py[i], particles.pz[i] };
+            for (int c = 0; c < 3; c++)
+                cell[c] = (uint64_t) std::min(std::max((p[c] - m_Origin[c]) * scale, 0.0f), top);
+            m_Codes[i] = spreadBits(cell[0]) << 2 | spreadBits(cell[1]) << 1 | spreadBits(cell[2]);
+            m_KeysLow[i] = (uint32_t) m_Codes[i];
+            m_Order[i] = (uint32_t) i;
+        }
+    });
+
+    // 64 bit keys as two stable 32 bit sorts, low word first
+    m_Sorter.sort(m_KeysLow, m_Order, pool);
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++)
+            m_KeysHigh[i] = (uint32_t) (m_Codes[m_Order[i]] >> 32);
+    });
+    m_Sorter.sort(m_KeysHigh, m_Order, pool);
+
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            uint32_t source = m_Order[i];
+            m_TreeCodes[i] = m_Codes[source];
+            m_X[i] = particles.px[source];
+            m_Y[i] = particles.py[source];
+            m_Z[i] = particles.pz[source];
+            m_Strength[i] = strength[source];
+        }
+    });
+}
+
+uint32_t Octree::childEnd(uint32_t begin, uint32_t end, unsigned int depth, unsigned int digit) const {
+    const uint64_t* codes = m_TreeCodes.data();
+    return (uint32_t) (std::partition_point(codes + begin, codes + end, [&](uint64_t code) {
+        return digitAt(code, depth) <= digit;
+    }) - codes);
+}
+
+bool Octree::isSubtreeRoot(uint32_t begin, uint32_t end, unsigned int depth) const {
+    return depth == SplitDepth || end - begin <= m_LeafSize;
+}
+
+void Octree::collectSubtrees(uint32_t begin, uint32_t end, unsigned int depth) {
+    if (isSubtreeRoot(begin, end, depth)) {
+        m_Subtrees.push_back({ begin, end, depth });
+        return;
+    }
+    uint32_t childBegin = begin;
+    for (unsigned int digit = 0; digit < 8; digit++) {
+        uint32_t childStop = childEnd(childBegin, end, depth, digit);
+        if (childStop > childBegin)
+            collectSubtrees(childBegin, childStop, depth + 1);
+        childBegin = childStop;
+    }
+}
+
+// sums: strength, |strength|, and the |strength| weighted position
+void Octree::finishNode(OctreeNode& node, uint32_t begin, uint32_t end, unsigned int depth, const float sums[5]) const {
+    node.size = std::ldexp(m_Extent, -(int) depth);
+    node.first = begin;
+    node.count = end - begin;
+    node.strength = sums[0];
+    node.absStrength = sums[1];
+    if (sums[1] > 0.0f) {
+        for (int c = 0; c < 3; c++)
+            node.center[c] = sums[2 + c] / sums[1];
+    }
+    else {
+        node.center[0] = m_X[begin];
+        node.center[1] = m_Y[begin];
+        node.center[2] = m_Z[begin];
+    }
+}
+
+static inline void addChild(float sums[5], const OctreeNode& child) {
+    sums[0] += child.strength;
+    sums[1] += child.absStrength;
+    for (int c = 0; c < 3; c++)
+        sums[2 + c] += child.absStrength * child.center[c];
+}
+
+void Octree::buildSubtree(std::vector<OctreeNode>& nodes, uint32_t begin, uint32_t end, unsigned int depth) const {
+    uint32_t index = (uint32_t) nodes.size();
+    nodes.push_back(OctreeNode());
+    float sums[5] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    if (end - begin <= m_LeafSize || depth == MaxDepth) {
+        for (uint32_t i = begin; i < end; i++) {
+            float weight = std::fabs(m_Strength[i]);
+            sums[0] += m_Strength[i];
+            sums[1] += weight;
+            sums[2] += weight * m_X[i];
+            sums[3] += weight * m_Y[i];
+            sums[4] += weight * m_Z[i];
+        }
+    }
+    else {
+        uint32_t childBegin = begin;
+        for (unsigned int digit = 0; digit < 8; digit++) {
+            uint32_t childStop = childEnd(childBegin, end, depth, digit);
+            if (childStop > childBegin) {
+                uint32_t child = (uint32_t) nodes.size();
+                buildSubtree(nodes, childBegin, childStop, depth + 1);
+                addChild(sums, nodes[child]);
+            }
+            childBegin = childStop;
+        }
+    }
+    OctreeNode node;
+    finishNode(node, begin, end, depth, sums);
+    node.next = (uint32_t) nodes.size();
+    nodes[index] = node;
+}
+
+void Octree::layoutTop(uint32_t begin, uint32_t end, unsigned int depth, size_t& subtree) {
+    if (isSubtreeRoot(begin, end, depth)) {
+        // the root goes in now so the parent can read it, the rest is copied in parallel
+        uint32_t offset = (uint32_t) m_Nodes.size();
+        const std::vector<OctreeNode>& local = m_SubtreeNodes[subtree];
+        m_SubtreeRoots[subtree] = offset;
+        m_Nodes.resize(offset + local.size());
+        m_Nodes[offset] = local[0];
+        m_Nodes[offset].next += offset;
+        subtree++;
+        return;
+    }
+    uint32_t index = (uint32_t) m_Nodes.size();
+    m_Nodes.push_back(OctreeNode());
+    float sums[5] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    uint32_t childBegin = begin;
+    for (unsigned int digit = 0; digit < 8; digit++) {
+        uint32_t childStop = childEnd(childBegin, end, depth, digit);
+        if (childStop > childBegin) {
+            uint32_t child = (uint32_t) m_Nodes.size();
+            layoutTop(childBegin, childStop, depth + 1, subtree);
+            addChild(sums, m_Nodes[child]);
+        }
+        childBegin = childStop;
+    }
+    OctreeNode& node = m_Nodes[index];
+    finishNode(node, begin, end, depth, sums);
+    node.next = (uint32_t) m_Nodes.size();
+}
+
+void Octree::build(const ParticleStore& particles, const float* strength, ThreadPool& pool) {
+    m_Nodes.clear();
+    m_SubtreeRoots.clear();
+    uint32_t count = (uint32_t) particles.size();
+    if (count == 0)
+        return;
+    computeBounds(particles, pool);
+    sortParticles(particles, strength, pool);
+
+    m_Subtrees.clear();
+    collectSubtrees(0, count, 0);
+    m_SubtreeNodes.resize(m_Subtrees.size());
+    m_SubtreeRoots.resize(m_Subtrees.size());
+    pool.parallelFor(m_Subtrees.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t s = begin; s < end; s++) {
+            m_SubtreeNodes[s].clear();
+            buildSubtree(m_SubtreeNodes[s], m_Subtrees[s].begin, m_Subtrees[s].end, m_Subtrees[s].depth);
+        }
+    });
+    size_t subtree = 0;
+    layoutTop(0, count, 0, subtree);
+    pool.parallelFor(m_Subtrees.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t s = begin; s < end; s++) {
+            const std::vector<OctreeNode>& local = m_SubtreeNodes[s];
+            uint32_t offset = m_SubtreeRoots[s];
+            for (size_t k = 1; k < local.size(); k++) {
+                m_Nodes[offset + k] = local[k];
+                m_Nodes[offset + k].next += offset;
+            }
+        }
+    });
+}
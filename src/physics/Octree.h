@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "AlignedArray.h"
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+#include "RadixSort.h"
+
+// Octree node in depth-first order: the first child of a node with children is
+// the next node in the array and `next` skips the whole subtree, so the tree is
+// walked front to back without a stack. Children of node i are i + 1, then
+// each child's next, until the node's own next.
+struct OctreeNode {
+	float center[3]; // strength weighted center, weighted by |strength| so charges of both signs work
+	float strength; // sum of the particle strengths
+	float absStrength; // sum of their magnitudes
+	float size; // edge length of the node's cube
+	uint32_t next;
+	uint32_t first, count; // particles in tree order
+	inline bool isLeaf(uint32_t index) const { return next == index + 1; };
+};
+
+// Octree over the particles, rebuilt from scratch each step. The particles are
+// sorted along a 63 bit Morton curve and every node owns a contiguous range of
+// the sorted order. The top levels are cut into subtrees that are built in
+// parallel and then spliced into one flat array; each subtree is a contiguous
+// node range, which the force backends reuse as units of parallel work.
+class Octree {
+public:
+	static constexpr unsigned int MaxDepth = 21; // Morton bits per axis
+	static constexpr unsigned int SplitDepth = 3; // subtrees below this depth are built in parallel
+private:
+	struct Subtree {
+		uint32_t begin, end;
+		unsigned int depth;
+	};
+
+	unsigned int m_LeafSize;
+	float m_Origin[3], m_Extent; // root cube
+	AlignedArray<uint32_t> m_KeysLow, m_KeysHigh, m_Order;
+	AlignedArray<uint64_t> m_Codes; // Morton codes in particle order
+	AlignedArray<uint64_t> m_TreeCodes; // and in tree order
+	AlignedArray<float> m_X, m_Y, m_Z, m_Strength; // particles in tree order
+	RadixSorter m_Sorter;
+	std::vector<OctreeNode> m_Nodes;
+	std::vector<Subtree> m_Subtrees;
+	std::vector<std::vector<OctreeNode>> m_SubtreeNodes;
+	std::vector<uint32_t> m_SubtreeRoots;
+
+	void computeBounds(const ParticleStore& particles, ThreadPool& pool);
+	void sortParticles(const ParticleStore& particles, const float* strength, ThreadPool& pool);
+	uint32_t childEnd(uint32_t begin, uint32_t end, unsigned int depth, unsigned int digit) const;
+	bool isSubtreeRoot(uint32_t begin, uint32_t end, unsigned int depth) const;
+	void collectSubtrees(uint32_t begin, uint32_t end, unsigned int depth);
+	void finishNode(OctreeNode& node, uint32_t begin, uint32_t end, unsigned int depth, const float sums[5]) const;
+	void buildSubtree(std::vector<OctreeNode>& nodes, uint32_t begin, uint32_t end, unsigned int depth) const;
+	void layoutTop(uint32_t begin, uint32_t end, unsigned int depth, size_t& subtree);
+public:
+	Octree();
+
+	// strength holds one source strength per particle, e.g. the masses
+	void build(const ParticleStore& particles, const float* strength, ThreadPool& pool);
+	void setLeafSize(unsigned int size);
+
+	inline unsigned int getLeafSize() const { return m_LeafSize; };
+	inline const std::vector<OctreeNode>& getNodes() const { return m_Nodes; };
+	// first node of each parallel subtree, in node order; nodes before the first one and
+	// between subtrees are the shared top of the tree
+	inline const std::vector<uint32_t>& getSubtreeRoots() const { return m_SubtreeRoots; };
+	inline const AlignedArray<uint32_t>& getOrder() const { return m_Order; }; // tree slot -> particle index
+	inline const AlignedArray<float>& getX() const { return m_X; };
+	inline const AlignedArray<float>& getY() const { return m_Y; };
+	inline const AlignedArray<float>& getZ() const { return m_Z; };
+	inline const AlignedArray<float>& getStrength() const { return m_Strength; };
+};
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "PairTable.h"
+
+PairTable::PairTable()
+    : m_InnerRadius(0.0f), m_Cutoff(0.0f), m_Start(0.0f), m_InvStep(0.0f), m_Segments(0), m_Error{ 0.0, 0.0, 0.0f, 0.0f } {
+}
+
+void PairTable::build(const std::function<double(double)>& potential, float innerRadius, float cutoff,
+    unsigned int segments, const std::function<double(double)>& force) {
+    segments = std::max(segments, 1u);
+    m_InnerRadius = innerRadius;
+    m_Cutoff = cutoff;
+    m_Segments = segments;
+    double start = (double) innerRadius * innerRadius, end = (double) cutoff * cutoff;
+    double step = (end - start) / segments;
+    m_Start = (float) start;
+    m_InvStep = (float) (1.0 / step);
+
+    // -V'(r) / r, from the given force or a five point derivative of V
+    auto scaleAt = [&](double s) {
+        double r = std::sqrt(s);
+        if (force)
+            return force(r) / r;
+        double h = 1e-3 * r;
+        double slope = (potential(r - 2.0 * h) - 8.0 * potential(r - h) + 8.0 * potential(r + h) - potential(r + 2.0 * h)) / (12.0 * h);
+        return -slope / r;
+    };
+    double shift = potential(cutoff);
+
+    // knots 0..segments, plus two on either side for the force slopes; the
+    // ones inside r = 0 are never needed when the inner radius is sensible,
+    // and get clamped otherwise
+    std::vector<double> scale(segments + 5), energy(segments + 1);
+    for (unsigned int k = 0; k < segments + 5; k++) {
+        double s = std::max(start + ((double) k - 2.0) * step, 0.25 * start + 1e-12);
+        scale[k] = scaleAt(s);
+    }
+    for (unsigned int k = 0; k <= segments; k++)
+        energy[k] = potential(std::sqrt(start + k * step)) - shift;
+
+    m_Coefficients.resize(0);
+    m_Coefficients.resize((size_t) segments * Stride);
+    for (unsigned int k = 0; k < segments; k++) {
+        // slopes per unit t, i.e. d/ds times the step
+        double f0 = scale[k + 2], f1 = scale[k + 3];
+        double m0 = (scale[k] - 8.0 * scale[k + 1] + 8.0 * scale[k + 3] - scale[k + 4]) / 12.0;
+        double m1 = (scale[k + 1] - 8.0 * scale[k + 2] + 8.0 * scale[k + 4] - scale[k + 5]) / 12.0;
+        double e0 = energy[k], e1 = energy[k + 1];
+        double n0 = -0.5 * f0 * step, n1 = -0.5 * f1 * step;
+        float* c = m_Coefficients.data() + (size_t) k * Stride;
+        c[0] = (float) f0;
+        c[1] = (float) m0;
+        c[2] = (float) (3.0 * (f1 - f0) - 2.0 * m0 - m1);
+        c[3] = (float) (2.0 * (f0 - f1) + m0 + m1);
+        c[4] = (float) e0;
+        c[5] = (float) n0;
+        c[6] = (float) (3.0 * (e1 - e0) - 2.0 * n0 - n1);
+        c[7] = (float) (2.0 * (e0 - e1) + n0 + n1);
+    }
+
+    // error report against the exact law between the knots
+    const unsigned int samples = 8;
+    std::vector<double> exactScale((size_t) segments * samples), exactEnergy((size_t) segments * samples);
+    double largestScale = 0.0, largestEnergy = 0.0;
+    for (size_t n = 0; n < exactScale.size(); n++) {
+        double s = start + ((double) n + 0.5) / samples * step;
+        exactScale[n] = scaleAt(s);
+        exactEnergy[n] = potential(std::sqrt(s)) - shift;
+        largestScale = std::max(largestScale, std::fabs(exactScale[n]));
+        largestEnergy = std::max(largestEnergy, std::fabs(exactEnergy[n]));
+    }
+    m_Error = { 0.0, 0.0, 0.0f, 0.0f };
+    for (size_t n = 0; n < exactScale.size(); n++) {
+        double s = start + ((double) n + 0.5) / samples * step;
+        float tableScale, tableEnergy;
+        evaluate((float) s, tableScale, tableEnergy);
+        if (std::fabs(exactScale[n]) > 1e-6 * largestScale) {
+            double error = std::fabs(tableScale - exactScale[n]) / std::fabs(exactScale[n]);
+            if (error > m_Error.force) {
+                m_Error.force = error;
+                m_Error.forceRadius = (float) std::sqrt(s);
+            }
+        }
+        if (std::fabs(exactEnergy[n]) > 1e-6 * largestEnergy) {
+            double error = std::fabs(tableEnergy - exactEnergy[n]) / std::fabs(exactEnergy[n]);
+            if (error > m_Error.energy) {
+                m_Error.energy = error;
+                m_Error.energyRadius = (float) std::sqrt(s);
+            }
+        }
+    }
+}
+
+void PairTable::evaluate(float r2, float& scale, float& energy) const {
+    float u = std::min(std::max((r2 - m_Start) * m_InvStep, 0.0f), (float) m_Segments);
+    unsigned int k = std::min((unsigned int) u, m_Segments - 1);
+    float t = u - (float) k;
+    const float* c = m_Coefficients.data() + (size_t) k * Stride;
+    scale = ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+    energy = ((c[7] * t + c[6]) * t + c[5]) * t + c[4];
+}
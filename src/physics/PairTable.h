@@ -0,0 +1,51 @@
+#pragma once
+#include <functional>
+#include "AlignedArray.h"
+
+// Largest relative errors of a table against the law it was built from, and
+// where they happen. Samples where the exact value is below a millionth of
+// the largest one on the range are left out; relative errors mean nothing at
+// the zero crossings.
+struct PairTableError {
+	double force, energy;
+	float forceRadius, energyRadius;
+};
+
+// A pair force law tabulated once into cubic Hermite spline segments, so the
+// force loops read four coefficients instead of calling pow, exp or erfc.
+// Segments are uniform in s = r^2, which the loops have without a square
+// root. Each segment holds the cubic in t (its fractional position) of
+// -V'(r) / r, the factor that multiplies the separation, then the cubic of
+// V(r) - V(cutoff): eight floats, two segments per cache line. The energy
+// slopes are exact (dV/ds = -F / 2), the force slopes come from fourth order
+// differences of the force. Below the inner radius the first segment is
+// clamped to its start.
+class PairTable {
+public:
+	static constexpr unsigned int Stride = 8; // floats per segment
+private:
+	AlignedArray<float> m_Coefficients;
+	float m_InnerRadius, m_Cutoff;
+	float m_Start, m_InvStep; // in r^2
+	unsigned int m_Segments;
+	PairTableError m_Error;
+public:
+	PairTable();
+
+	// potential(r) is V(r); force(r) is -dV/dr, and is found by differencing
+	// the potential when it is left empty. The error report is measured at
+	// 8 points per segment.
+	void build(const std::function<double(double)>& potential, float innerRadius, float cutoff,
+		unsigned int segments = 2048, const std::function<double(double)>& force = nullptr);
+	// same lookup as the vectorized kernels: scale = -V'(r) / r, energy shifted to 0 at the cutoff
+	void evaluate(float r2, float& scale, float& energy) const;
+
+	inline const float* getCoefficients() const { return m_Coefficients.data(); };
+	inline float getStart() const { return m_Start; };
+	inline float getInvStep() const { return m_InvStep; };
+	inline unsigned int getSegments() const { return m_Segments; };
+	inline float getInnerRadius() const { return m_InnerRadius; };
+	inline float getCutoff() const { return m_Cutoff; };
+	inline size_t getBytes() const { return m_Coefficients.size() * sizeof(float); };
+	inline const PairTableError& getError() const { return m_Error; };
+};
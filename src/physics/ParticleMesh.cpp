@@ -0,0 +1,218 @@
+#include <cmath>
+#include <algorithm>
+#include "ParticleMesh.h"
+
+ParticleMesh::ParticleMesh()
+    : m_Assignment(MeshAssignment::TriangularShapedCloud), m_GridSize(64), m_Origin{ -0.5f, -0.5f, -0.5f }, m_BoxSize(1.0f), m_Dirty(true) {
+}
+
+void ParticleMesh::setBox(float x, float y, float z, float size) {
+    m_Origin[0] = x;
+    m_Origin[1] = y;
+    m_Origin[2] = z;
+    m_BoxSize = size;
+    m_Dirty = true;
+}
+
+void ParticleMesh::setGridSize(unsigned int size) {
+    unsigned int rounded = MinGridSize;
+    while (rounded < size)
+        rounded *= 2;
+    m_GridSize = rounded;
+    m_Dirty = true;
+}
+
+void ParticleMesh::setAssignment(MeshAssignment assignment) {
+    m_Assignment = assignment;
+    m_Dirty = true;
+}
+
+void ParticleMesh::rebuildTables() {
+    unsigned int n = m_GridSize;
+    m_Fft.init(n);
+    m_Wavenumbers.resize(n);
+    m_Deconvolution.resize(n);
+    int power = (int) getStencilSize();
+    for (unsigned int m = 0; m < n; m++) {
+        int frequency = m < n / 2 ? (int) m : (int) m - (int) n;
+        m_Wavenumbers[m] = 6.2831853f * frequency / m_BoxSize;
+        // the window of the assignment is sinc^p per axis, it is divided out twice:
+        // once for spreading onto the grid and once for interpolating back
+        double x = 3.14159265358979 * frequency / n;
+        double window = frequency == 0 ? 1.0 : std::pow(std::sin(x) / x, power);
+        // the gaussian cuts off the frequencies the deconvolution would blow up
+        double k = 6.283185307179586 * frequency / m_BoxSize;
+        double smoothing = SmoothingCells * m_BoxSize / n;
+        m_Deconvolution[m] = (float) (std::exp(-k * k * smoothing * smoothing) / (window * window));
+    }
+    size_t cells = (size_t) n * n * n;
+    m_Density.resize(cells);
+    for (AlignedArray<float>& field : m_Field)
+        field.resize(cells);
+    m_Potential.resize(m_Fft.getSpectrumSize());
+    m_Work.resize(m_Fft.getSpectrumSize());
+    m_Dirty = false;
+}
+
+// first cell touched along one axis and the weights of the cells from there on
+void ParticleMesh::stencil(float position, float origin, int& first, float weights[3]) const {
+    float n = (float) m_GridSize;
+    float u = (position - origin) * (n / m_BoxSize);
+    u -= std::floor(u / n) * n;
+    if (m_Assignment == MeshAssignment::CloudInCell) {
+        float s = u - 0.5f;
+        float base = std::floor(s);
+        float f = s - base;
+        first = (int) base;
+        weights[0] = 1.0f - f;
+        weights[1] = f;
+        weights[2] = 0.0f;
+    }
+    else {
+        float cell = std::floor(u);
+        float d = u - cell - 0.5f;
+        first = (int) cell - 1;
+        weights[0] = 0.5f * (0.5f - d) * (0.5f - d);
+        weights[1] = 0.75f - d * d;
+        weights[2] = 0.5f * (0.5f + d) * (0.5f + d);
+    }
+}
+
+void ParticleMesh::sortParticles(const ParticleStore& particles, ThreadPool& pool) {
+    size_t count = particles.size();
+    int mask = (int) m_GridSize - 1;
+    m_Planes.resize(count);
+    m_Order.resize(count);
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            int first;
+            float weights[3];
+            stencil(particles.pz[i], m_Origin[2], first, weights);
+            m_Planes[i] = (uint32_t) (first & mask);
+            m_Order[i] = (uint32_t) i;
+        }
+    });
+    m_Sorter.sort(m_Planes, m_Order, pool);
+
+    unsigned int slabs = m_GridSize / SlabPlanes;
+    m_SlabStarts.resize(slabs + 1);
+    for (unsigned int s = 0; s <= slabs; s++)
+        m_SlabStarts[s] = (uint32_t) (std::lower_bound(m_Planes.begin(), m_Planes.end(), s * SlabPlanes) - m_Planes.begin());
+}
+
+void ParticleMesh::deposit(const ParticleStore& particles, const float* strength, ThreadPool& pool) {
+    size_t n = m_GridSize;
+    int mask = (int) n - 1;
+    int size = (int) getStencilSize();
+    float cellVolume = std::pow(m_BoxSize / n, 3.0f);
+    pool.parallelFor(m_Density.size(), [&](size_t begin, size_t end, unsigned int) {
+        std::fill(m_Density.data() + begin, m_Density.data() + end, 0.0f);
+    });
+    // a slab only writes into itself and the next one, so slabs of one parity never overlap
+    unsigned int slabs = m_GridSize / SlabPlanes;
+    for (unsigned int parity = 0; parity < 2; parity++) {
+        pool.parallelFor(slabs / 2, [&](size_t first, size_t last, unsigned int) {
+            for (size_t k = first; k < last; k++) {
+                size_t slab = 2 * k + parity;
+                for (uint32_t j = m_SlabStarts[slab]; j < m_SlabStarts[slab + 1]; j++) {
+                    uint32_t i = m_Order[j];
+                    int cell[3];
+                    float weights[3][3];
+                    stencil(particles.px[i], m_Origin[0], cell[0], weights[0]);
+                    stencil(particles.py[i], m_Origin[1], cell[1], weights[1]);
+                    stencil(particles.pz[i], m_Origin[2], cell[2], weights[2]);
+                    float density = strength[i] / cellVolume;
+                    for (int dz = 0; dz < size; dz++) {
+                        for (int dy = 0; dy < size; dy++) {
+                            float weight = density * weights[2][dz] * weights[1][dy];
+                            float* row = m_Density.data() + ((size_t) ((cell[2] + dz) & mask) * n + ((cell[1] + dy) & mask)) * n;
+                            for (int dx = 0; dx < size; dx++)
+                                row[(cell[0] + dx) & mask] += weight * weights[0][dx];
+                        }
+                    }
+                }
+            }
+        });
+    }
+}
+
+// potential = 4 pi density / k^2 and field = grad potential = i k potential
+void ParticleMesh::solve(ThreadPool& pool) {
+    size_t n = m_GridSize, rowLength = n / 2 + 1;
+    m_Fft.forward(m_Density.data(), m_Potential.data(), pool);
+    float scale = 12.566371f / (float) (n * n * n); // the inverse transforms are unscaled
+    pool.parallelFor(n * n, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t row = begin; row < end; row++) {
+            size_t y = row % n, z = row / n;
+            FftComplex* potential = m_Potential.data() + row * rowLength;
+            for (size_t x = 0; x < rowLength; x++) {
+                float k2 = m_Wavenumbers[x] * m_Wavenumbers[x] + m_Wavenumbers[y] * m_Wavenumbers[y] + m_Wavenumbers[z] * m_Wavenumbers[z];
+                float green = k2 > 0.0f ? scale / k2 * m_Deconvolution[x] * m_Deconvolution[y] * m_Deconvolution[z] : 0.0f;
+                potential[x] *= green;
+            }
+        }
+    });
+    for (int axis = 0; axis < 3; axis++) {
+        pool.parallelFor(n * n, [&](size_t begin, size_t end, unsigned int) {
+            for (size_t row = begin; row < end; row++) {
+                size_t index[3] = { 0, row % n, row / n };
+                const FftComplex* potential = m_Potential.data() + row * rowLength;
+                FftComplex* work = m_Work.data() + row * rowLength;
+                for (size_t x = 0; x < rowLength; x++) {
+                    index[0] = x;
+                    // the Nyquist frequency has no sign, its derivative is dropped
+                    float k = index[axis] == n / 2 ? 0.0f : m_Wavenumbers[index[axis]];
+                    work[x] = FftComplex(-k * potential[x].imag(), k * potential[x].real());
+                }
+            }
+        });
+        m_Fft.inverse(m_Work.data(), m_Field[axis].data(), pool);
+    }
+}
+
+void ParticleMesh::interpolate(ParticleStore& particles, const float* strength, ThreadPool& pool) const {
+    size_t n = m_GridSize;
+    int mask = (int) n - 1;
+    int size = (int) getStencilSize();
+    float forceScale = getForceScale();
+    pool.parallelFor(particles.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t j = begin; j < end; j++) {
+            uint32_t i = m_Order[j];
+            int cell[3];
+            float weights[3][3];
+            stencil(particles.px[i], m_Origin[0], cell[0], weights[0]);
+            stencil(particles.py[i], m_Origin[1], cell[1], weights[1]);
+            stencil(particles.pz[i], m_Origin[2], cell[2], weights[2]);
+            float field[3] = { 0.0f, 0.0f, 0.0f };
+            for (int dz = 0; dz < size; dz++) {
+                for (int dy = 0; dy < size; dy++) {
+                    float weight = weights[2][dz] * weights[1][dy];
+                    size_t row = ((size_t) ((cell[2] + dz) & mask) * n + ((cell[1] + dy) & mask)) * n;
+                    for (int dx = 0; dx < size; dx++) {
+                        size_t index = row + ((cell[0] + dx) & mask);
+                        float w = weight * weights[0][dx];
+                        field[0] += w * m_Field[0][index];
+                        field[1] += w * m_Field[1][index];
+                        field[2] += w * m_Field[2][index];
+                    }
+                }
+            }
+            float scale = forceScale * strength[i];
+            particles.fx[i] += scale * field[0];
+            particles.fy[i] += scale * field[1];
+            particles.fz[i] += scale * field[2];
+        }
+    });
+}
+
+void ParticleMesh::accumulate(ParticleStore& particles, ThreadPool& pool) {
+    if (particles.size() == 0)
+        return;
+    if (m_Dirty)
+        rebuildTables();
+    const float* strength = getStrengths(particles);
+    sortParticles(particles, pool);
+    deposit(particles, strength, pool);
+    solve(pool);
+    interpolate(particles, strength, pool);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ForceProvider.h"
+#include "AlignedArray.h"
+#include "RadixSort.h"
+#include "Fft.h"
+
+enum class MeshAssignment {
+	CloudInCell, // trilinear, 2^3 cells
+	TriangularShapedCloud // quadratic, 3^3 cells, smoother forces
+};
+
+// Particle-mesh solver for periodic boxes. The strengths are spread onto an
+// n^3 grid, the Poisson equation is solved in Fourier space with the real FFT,
+// the field is taken as the spectral gradient and interpolated back with the
+// same assignment window, which is deconvolved in Fourier space. The k = 0
+// mode is dropped, i.e. the mean density is neutralized. A gaussian of 1.25
+// cells smooths the potential, so forces are exact beyond about five cells
+// and fall off below that, which takes the place of the softening length.
+// Deposits go in slabs of z planes sorted by particle, even slabs first and
+// then odd ones, so no two threads write the same cell and the result does
+// not depend on the thread count.
+class ParticleMesh : public ForceProvider {
+public:
+	static constexpr unsigned int SlabPlanes = 4; // wider than any stencil
+	static constexpr unsigned int MinGridSize = 8;
+	static constexpr double SmoothingCells = 1.25; // gaussian smoothing length of the mesh force
+private:
+	MeshAssignment m_Assignment;
+	unsigned int m_GridSize;
+	float m_Origin[3], m_BoxSize;
+	bool m_Dirty; // the Fourier space tables need rebuilding
+	RealFft3d m_Fft;
+	std::vector<float> m_Wavenumbers; // per frequency index
+	std::vector<float> m_Deconvolution; // smoothing / W(k)^2 per axis and frequency index
+	AlignedArray<float> m_Density;
+	AlignedArray<float> m_Field[3];
+	AlignedArray<FftComplex> m_Potential, m_Work;
+	AlignedArray<uint32_t> m_Planes, m_Order; // particles sorted by the first z plane they touch
+	RadixSorter m_Sorter;
+	std::vector<uint32_t> m_SlabStarts;
+
+	void rebuildTables();
+	void stencil(float position, float origin, int& first, float weights[3]) const;
+	void sortParticles(const ParticleStore& particles, ThreadPool& pool);
+	void deposit(const ParticleStore& particles, const float* strength, ThreadPool& pool);
+	void solve(ThreadPool& pool);
+	void interpolate(ParticleStore& particles, const float* strength, ThreadPool& pool) const;
+public:
+	ParticleMesh();
+
+	void accumulate(ParticleStore& particles, ThreadPool& pool) override;
+	inline const char* getName() const override { return "particle-mesh"; };
+
+	// cubic periodic box; particles outside it are wrapped in
+	void setBox(float x, float y, float z, float size);
+	// rounded up to a power of two, at least MinGridSize
+	void setGridSize(unsigned int size);
+	void setAssignment(MeshAssignment assignment);
+	inline unsigned int getGridSize() const { return m_GridSize; };
+	inline MeshAssignment getAssignment() const { return m_Assignment; };
+	inline float getBoxSize() const { return m_BoxSize; };
+	inline unsigned int getStencilSize() const { return m_Assignment == MeshAssignment::CloudInCell ? 2 : 3; };
+};
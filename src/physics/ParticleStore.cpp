@@ -0,0 +1,51 @@
+#include <cstring>
+#include "ParticleStore.h"
+
+unsigned int ParticleStore::add(float x, float y, float z, float velX, float velY, float velZ, float particleMass, float particleRadius, float particleCharge) {
+    px.push_back(x);
+    py.push_back(y);
+    pz.push_back(z);
+    vx.push_back(velX);
+    vy.push_back(velY);
+    vz.push_back(velZ);
+    fx.push_back(0.0f);
+    fy.push_back(0.0f);
+    fz.push_back(0.0f);
+    mass.push_back(particleMass);
+    invMass.push_back(particleMass > 0.0f ? 1.0f / particleMass : 0.0f);
+    radius.push_back(particleRadius);
+    charge.push_back(particleCharge);
+    return (unsigned int) px.size() - 1;
+}
+
+void ParticleStore::reserve(size_t count) {
+    AlignedArray<float>* arrays[] = { &px, &py, &pz, &vx, &vy, &vz, &fx, &fy, &fz, &mass, &invMass, &radius, &charge };
+    for (AlignedArray<float>* array : arrays)
+        array->reserve(count);
+}
+
+void ParticleStore::resize(size_t count) {
+    AlignedArray<float>* arrays[] = { &px, &py, &pz, &vx, &vy, &vz, &fx, &fy, &fz, &mass, &invMass, &radius, &charge };
+    for (AlignedArray<float>* array : arrays)
+        array->resize(count);
+}
+
+void ParticleStore::clear() {
+    resize(0);
+}
+
+void ParticleStore::clearForces() {
+    std::memset(fx.data(), 0, fx.size() * sizeof(float));
+    std::memset(fy.data(), 0, fy.size() * sizeof(float));
+    std::memset(fz.data(), 0, fz.size() * sizeof(float));
+}
+
+void ParticleStore::permute(const AlignedArray<uint32_t>& order) {
+    AlignedArray<float> scratch(size());
+    AlignedArray<float>* arrays[] = { &px, &py, &pz, &vx, &vy, &vz, &fx, &fy, &fz, &mass, &invMass, &radius, &charge };
+    for (AlignedArray<float>* array : arrays) {
+        for (size_t i = 0; i < scratch.size(); i++)
+            scratch[i] = (*array)[order[i]];
+        std::swap(*array, scratch);
+    }
+}
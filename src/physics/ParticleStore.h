@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include "AlignedArray.h"
+
+// Structure-of-arrays particle state. Each component lives in its own aligned
+// array so the integrators and force loops stream exactly the data they touch
+// and map one particle per SIMD lane.
+class ParticleStore {
+public:
+	AlignedArray<float> px, py, pz;
+	AlignedArray<float> vx, vy, vz;
+	AlignedArray<float> fx, fy, fz; // force accumulators, cleared every step
+	AlignedArray<float> mass;
+	AlignedArray<float> invMass; // 0 for static particles
+	AlignedArray<float> radius;
+	AlignedArray<float> charge;
+
+	unsigned int add(float x, float y, float z, float velX, float velY, float velZ, float particleMass, float particleRadius, float particleCharge = 0.0f);
+	void reserve(size_t count);
+	void resize(size_t count);
+	void clear();
+	void clearForces();
+	// particle i moves to the slot of the i'th entry of order: new[i] = old[order[i]]
+	void permute(const AlignedArray<uint32_t>& order);
+
+	inline size_t size() const { return px.size(); };
+};
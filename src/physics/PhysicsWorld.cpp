@@ -0,0 +1,273 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "PhysicsWorld.h"
+#include "UniformGrid.h"
+#include "DynamicTreeBroadphase.h"
+#include "SweepAndPrune.h"
+#include "DirectSum.h"
+#include "BarnesHut.h"
+#include "FastMultipole.h"
+#include "ParticleMesh.h"
+
+PhysicsWorld::PhysicsWorld()
+    : m_KeepPrevious(true), m_Integrator(Integrator::SemiImplicitEuler),
+      m_Gravity{ 0.0f, -9.81f, 0.0f },
+      m_Min{ -1.0f, -1.0f, -1.0f }, m_Max{ 1.0f, 1.0f, 1.0f },
+      m_Restitution(0.8f), m_Periodic(false), m_StepCount(0),
+      m_Pool(new ThreadPool()), m_BroadphaseType(BroadphaseType::None),
+      m_ForceType(ForceType::None), m_SortInterval(0) {
+    setBroadphase(BroadphaseType::UniformGrid);
+}
+
+unsigned int PhysicsWorld::addBody(const Body& body) {
+    unsigned int index = m_Particles.add(body.x, body.y, body.z, body.vx, body.vy, body.vz, body.mass, body.radius, body.charge);
+    m_PrevX.push_back(body.x);
+    m_PrevY.push_back(body.y);
+    m_PrevZ.push_back(body.z);
+    return index;
+}
+
+void PhysicsWorld::setGravity(float x, float y, float z) {
+    m_Gravity[0] = x;
+    m_Gravity[1] = y;
+    m_Gravity[2] = z;
+    wakeAll();
+}
+
+void PhysicsWorld::setBounds(float minX, float minY, float minZ, float maxX, float maxY, float maxZ) {
+    m_Min[0] = minX;
+    m_Min[1] = minY;
+    m_Min[2] = minZ;
+    m_Max[0] = maxX;
+    m_Max[1] = maxY;
+    m_Max[2] = maxZ;
+    wakeAll();
+}
+
+void PhysicsWorld::setPeriodic(bool periodic) {
+    m_Periodic = periodic;
+    wakeAll();
+}
+
+void PhysicsWorld::setRestitution(float restitution) {
+    m_Restitution = restitution;
+}
+
+void PhysicsWorld::setIntegrator(Integrator integrator) {
+    m_Integrator = integrator;
+}
+
+void PhysicsWorld::setKeepPreviousState(bool keep) {
+    m_KeepPrevious = keep;
+}
+
+void PhysicsWorld::setThreadCount(unsigned int threads) {
+    m_Pool.reset(new ThreadPool(threads));
+}
+
+void PhysicsWorld::setBroadphase(BroadphaseType type) {
+    m_BroadphaseType = type;
+    m_Pairs.clear();
+    m_Contacts.clear();
+    switch (type) {
+    case BroadphaseType::UniformGrid:
+        m_Broadphase.reset(new UniformGrid());
+        break;
+    case BroadphaseType::DynamicTree:
+        m_Broadphase.reset(new DynamicTreeBroadphase());
+        break;
+    case BroadphaseType::SweepAndPrune:
+        m_Broadphase.reset(new SweepAndPrune());
+        break;
+    default:
+        m_Broadphase.reset();
+    }
+}
+
+void PhysicsWorld::setForces(ForceType type) {
+    m_ForceType = type;
+    switch (type) {
+    case ForceType::Direct:
+        m_Forces.reset(new DirectSum());
+        break;
+    case ForceType::BarnesHut:
+        m_Forces.reset(new BarnesHut());
+        break;
+    case ForceType::FastMultipole:
+        m_Forces.reset(new FastMultipole());
+        break;
+    case ForceType::ParticleMesh:
+        m_Forces.reset(new ParticleMesh());
+        break;
+    default:
+        m_Forces.reset();
+    }
+}
+
+void PhysicsWorld::setSortInterval(unsigned int steps) {
+    m_SortInterval = steps;
+}
+
+void PhysicsWorld::setSolverMode(SolverMode mode) {
+    m_Solver.setMode(mode);
+}
+
+void PhysicsWorld::setSolverIterations(unsigned int iterations) {
+    m_Solver.setIterations(iterations);
+}
+
+void PhysicsWorld::setWarmStarting(bool enabled) {
+    m_Solver.setWarmStarting(enabled);
+}
+
+void PhysicsWorld::setSleeping(bool enabled) {
+    m_Islands.setSleepEnabled(enabled);
+}
+
+void PhysicsWorld::setSleepThresholds(float velocity, float time) {
+    m_Islands.setSleepThresholds(velocity, time);
+}
+
+void PhysicsWorld::wakeAll() {
+    m_Islands.resize(m_Particles.size());
+    m_Islands.wakeAll();
+}
+
+void PhysicsWorld::computeForces() {
+    m_Particles.clearForces();
+    if (m_Forces)
+        m_Forces->accumulate(m_Particles, *m_Pool);
+}
+
+void PhysicsWorld::wrapIntoBounds() {
+    float* p[3] = { m_Particles.px.data(), m_Particles.py.data(), m_Particles.pz.data() };
+    float* previous[3] = { m_PrevX.data(), m_PrevY.data(), m_PrevZ.data() };
+    forEachAwakeRun([&](size_t begin, size_t end) {
+        for (int c = 0; c < 3; c++) {
+            float size = m_Max[c] - m_Min[c];
+            for (size_t i = begin; i < end; i++) {
+                float shift = std::floor((p[c][i] - m_Min[c]) / size) * size;
+                if (shift != 0.0f) {
+                    p[c][i] -= shift;
+                    // moved along so interpolation doesn't sweep across the box
+                    previous[c][i] -= shift;
+                }
+            }
+        }
+    });
+}
+
+void PhysicsWorld::collideWithBounds() {
+    // keep bodies inside the walls and reflect the velocity that pushes into them.
+    // Like the contacts, slow impacts don't bounce; the wall contacts in the
+    // solver then hold resting bodies against the walls.
+    float* p[3] = { m_Particles.px.data(), m_Particles.py.data(), m_Particles.pz.data() };
+    float* v[3] = { m_Particles.vx.data(), m_Particles.vy.data(), m_Particles.vz.data() };
+    const float* radius = m_Particles.radius.data();
+    forEachAwakeRun([&](size_t begin, size_t end) {
+        for (int c = 0; c < 3; c++) {
+            for (size_t i = begin; i < end; i++) {
+                if (p[c][i] - radius[i] <= m_Min[c]) {
+                    p[c][i] = m_Min[c] + radius[i];
+                    if (v[c][i] < 0.0f)
+                        v[c][i] = v[c][i] < -BounceSpeed ? -v[c][i] * m_Restitution : 0.0f;
+                }
+                else if (p[c][i] + radius[i] >= m_Max[c]) {
+                    p[c][i] = m_Max[c] - radius[i];
+                    if (v[c][i] > 0.0f)
+                        v[c][i] = v[c][i] > BounceSpeed ? -v[c][i] * m_Restitution : 0.0f;
+                }
+            }
+        }
+    });
+}
+
+void PhysicsWorld::detectCollisions(float dt) {
+    m_Contacts.clear();
+    if (m_Broadphase)
+        collidePairs(dt);
+    if (m_Periodic)
+        return;
+    for (const BodyRun& run : m_Islands.getAwakeRuns())
+        collideBounds(m_Particles, run.begin, run.end, m_Min, m_Max, m_Contacts);
+}
+
+void PhysicsWorld::collidePairs(float dt) {
+    m_Broadphase->setTimeStep(dt);
+    m_Broadphase->update(m_Particles, *m_Pool);
+    m_Broadphase->findPairs(m_Pairs, *m_Pool);
+    if (m_Islands.getSleepingCount() > 0) {
+        // pairs inside sleeping islands don't need the narrowphase
+        m_Pairs.erase(std::remove_if(m_Pairs.begin(), m_Pairs.end(), [&](const BodyPair& pair) {
+            return !m_Islands.isActive(m_Particles, pair.a) && !m_Islands.isActive(m_Particles, pair.b);
+        }), m_Pairs.end());
+    }
+    collideSpheres(m_Particles, m_Pairs, m_Contacts, *m_Pool);
+}
+
+void PhysicsWorld::sortParticlesByCell(float dt) {
+    UniformGrid* grid = m_BroadphaseType == BroadphaseType::UniformGrid ? (UniformGrid*) m_Broadphase.get() : nullptr;
+    if (!grid || grid->getOrder().size() != m_Particles.size())
+        return;
+    const AlignedArray<uint32_t>& order = grid->getOrder();
+    m_Particles.permute(order);
+    m_Islands.permute(order);
+    // the cache is keyed by body index, one cold step is cheaper than remapping it
+    m_Solver.clearCache();
+    AlignedArray<float>* previous[] = { &m_PrevX, &m_PrevY, &m_PrevZ };
+    for (AlignedArray<float>* array : previous) {
+        AlignedArray<float> sorted(array->size());
+        for (size_t i = 0; i < sorted.size(); i++)
+            sorted[i] = (*array)[order[i]];
+        std::swap(*array, sorted);
+    }
+    // pairs and contacts refer to the old indices, rebuild them for the new layout
+    detectCollisions(dt);
+}
+
+void PhysicsWorld::step(float dt) {
+    size_t count = m_Particles.size();
+    m_Islands.resize(count);
+    if (m_KeepPrevious) {
+        std::memcpy(m_PrevX.data(), m_Particles.px.data(), count * sizeof(float));
+        std::memcpy(m_PrevY.data(), m_Particles.py.data(), count * sizeof(float));
+        std::memcpy(m_PrevZ.data(), m_Particles.pz.data(), count * sizeof(float));
+    }
+
+    if (m_Integrator == Integrator::VelocityVerlet) {
+        // the forces from the end of the last step are still in the accumulators
+        forEachAwakeRun([&](size_t begin, size_t end) {
+            kickDrift(IntegratorArrays(m_Particles, begin, end), dt * 0.5f, dt, m_Gravity);
+        });
+        computeForces();
+        forEachAwakeRun([&](size_t begin, size_t end) {
+            kick(IntegratorArrays(m_Particles, begin, end), dt * 0.5f, m_Gravity);
+        });
+    }
+    else {
+        computeForces();
+        forEachAwakeRun([&](size_t begin, size_t end) {
+            semiImplicitEulerStep(IntegratorArrays(m_Particles, begin, end), dt, m_Gravity);
+        });
+    }
+    if (m_Periodic)
+        wrapIntoBounds();
+    else
+        collideWithBounds();
+    detectCollisions(dt);
+    // resolve the contacts at the end of the step, the next step moves the bodies apart
+    m_Islands.build(m_Particles, m_Contacts);
+    m_Solver.prepare(m_Particles, m_Islands.getIslandContacts(), dt, &m_Islands.getContactOffsets());
+    m_Solver.solve(m_Particles, *m_Pool);
+    m_Islands.updateSleep(m_Particles, dt);
+    m_StepCount++;
+    if (m_SortInterval && m_StepCount % m_SortInterval == 0)
+        sortParticlesByCell(dt);
+}
+
+void PhysicsWorld::getInterpolatedPosition(unsigned int index, float alpha, float& x, float& y, float& z) const {
+    x = m_PrevX[index] + (m_Particles.px[index] - m_PrevX[index]) * alpha;
+    y = m_PrevY[index] + (m_Particles.py[index] - m_PrevY[index]) * alpha;
+    z = m_PrevZ[index] + (m_Particles.pz[index] - m_PrevZ[index]) * alpha;
+}
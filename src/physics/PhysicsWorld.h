@@ -0,0 +1,111 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "ParticleStore.h"
+#include "Integrators.h"
+#include "ThreadPool.h"
+#include "Broadphase.h"
+#include "Narrowphase.h"
+#include "ContactSolver.h"
+#include "Islands.h"
+#include "ForceProvider.h"
+
+// Description of a body to add to the world; its state then lives in the
+// world's ParticleStore.
+struct Body {
+	float x, y, z;
+	float vx, vy, vz;
+	float radius;
+	float mass; // 0 means the body is static
+	float charge = 0.0f; // only used by electrostatic forces
+};
+
+// Window-free simulation state. Nothing in here may touch GL or GLFW so the
+// same code can run on the renderer and on headless machines.
+class PhysicsWorld {
+public:
+	static constexpr float BounceSpeed = 1.0f; // wall impacts slower than this don't bounce
+private:
+	ParticleStore m_Particles;
+	AlignedArray<float> m_PrevX, m_PrevY, m_PrevZ; // positions before the last step, for render interpolation
+	bool m_KeepPrevious;
+	Integrator m_Integrator;
+	float m_Gravity[3];
+	float m_Min[3], m_Max[3]; // walls the bodies bounce off, or the periodic box
+	float m_Restitution;
+	bool m_Periodic; // the bounds wrap around instead of being walls
+	unsigned long long m_StepCount;
+
+	std::unique_ptr<ThreadPool> m_Pool;
+	BroadphaseType m_BroadphaseType;
+	std::unique_ptr<Broadphase> m_Broadphase;
+	ForceType m_ForceType;
+	std::unique_ptr<ForceProvider> m_Forces;
+	std::vector<BodyPair> m_Pairs;
+	std::vector<Contact> m_Contacts;
+	ContactSolver m_Solver;
+	IslandManager m_Islands;
+	unsigned int m_SortInterval; // steps between reordering particles into grid order, 0 = never
+
+	void computeForces();
+	void wrapIntoBounds();
+	void collideWithBounds();
+	void detectCollisions(float dt);
+	void collidePairs(float dt);
+	void sortParticlesByCell(float dt);
+
+	// calls body(begin, end) on the runs of awake bodies, spread over the thread pool
+	template<typename F>
+	void forEachAwakeRun(F&& body) {
+		const std::vector<BodyRun>& runs = m_Islands.getAwakeRuns();
+		m_Pool->parallelFor(runs.size(), [&](size_t first, size_t last, unsigned int) {
+			for (size_t r = first; r < last; r++)
+				body((size_t) runs[r].begin, (size_t) runs[r].end);
+		});
+	}
+public:
+	PhysicsWorld();
+
+	unsigned int addBody(const Body& body);
+	void step(float dt);
+
+	void getInterpolatedPosition(unsigned int index, float alpha, float& x, float& y, float& z) const;
+
+	void setGravity(float x, float y, float z);
+	void setBounds(float minX, float minY, float minZ, float maxX, float maxY, float maxZ);
+	// Opposite faces of the bounds are joined instead of being walls. Contacts
+	// are not found across the seam, this is meant for long range forces.
+	void setPeriodic(bool periodic);
+	void setRestitution(float restitution);
+	void setIntegrator(Integrator integrator);
+	void setKeepPreviousState(bool keep); // headless runs don't interpolate and can skip the copy
+	void setThreadCount(unsigned int threads); // 0 = one per hardware thread
+	void setBroadphase(BroadphaseType type);
+	// long range forces between all bodies, none by default
+	void setForces(ForceType type);
+	// Reorders the particle store into grid cell order every `steps` steps so
+	// neighbors sit close in memory. Body indices are not stable while this is on.
+	// Only has an effect with the uniform grid broadphase.
+	void setSortInterval(unsigned int steps);
+	void setSolverMode(SolverMode mode);
+	void setSolverIterations(unsigned int iterations);
+	void setWarmStarting(bool enabled);
+	// Islands whose bodies all stay slower than `velocity` for `time` seconds stop
+	// being integrated, collided and solved until an awake body touches them.
+	void setSleeping(bool enabled);
+	void setSleepThresholds(float velocity, float time);
+	void wakeAll();
+
+	inline ParticleStore& getParticles() { return m_Particles; };
+	inline const ParticleStore& getParticles() const { return m_Particles; };
+	inline const std::vector<BodyPair>& getPairs() const { return m_Pairs; };
+	inline const std::vector<Contact>& getContacts() const { return m_Contacts; };
+	inline Broadphase* getBroadphase() const { return m_Broadphase.get(); };
+	inline ForceProvider* getForces() const { return m_Forces.get(); };
+	inline ContactSolver& getSolver() { return m_Solver; };
+	inline const IslandManager& getIslands() const { return m_Islands; };
+	inline ThreadPool& getThreadPool() { return *m_Pool; };
+	inline bool isPeriodic() const { return m_Periodic; };
+	inline unsigned int getBodyCount() const { return (unsigned int) m_Particles.size(); };
+	inline unsigned long long getStepCount() const { return m_StepCount; };
+};
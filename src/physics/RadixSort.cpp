@@ -0,0 +1,74 @@
+#include <cstring>
+#include <algorithm>
+#include "RadixSort.h"
+
+void RadixSorter::sort(AlignedArray<uint32_t>& keys, AlignedArray<uint32_t>& values, ThreadPool& pool) {
+    size_t count = keys.size();
+    if (count < 2)
+        return;
+    unsigned int threads = pool.getThreadCount();
+    m_TmpKeys.resize(count);
+    m_TmpValues.resize(count);
+    m_Histograms.resize((size_t) threads * 256);
+
+    // bits that differ between keys; digits with no differing bits need no pass
+    std::vector<uint32_t> orBits(threads, 0), andBits(threads, ~0u);
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int t) {
+        uint32_t o = 0, a = ~0u;
+        for (size_t i = begin; i < end; i++) {
+            o |= keys[i];
+            a &= keys[i];
+        }
+        orBits[t] = o;
+        andBits[t] = a;
+    });
+    uint32_t allAnd = ~0u, allOr = 0;
+    for (unsigned int t = 0; t < threads; t++) {
+        allOr |= orBits[t];
+        allAnd &= andBits[t];
+    }
+    uint32_t differing = allOr ^ allAnd;
+
+    uint32_t* srcKeys = keys.data();
+    uint32_t* srcValues = values.data();
+    uint32_t* dstKeys = m_TmpKeys.data();
+    uint32_t* dstValues = m_TmpValues.data();
+    for (unsigned int shift = 0; shift < 32; shift += 8) {
+        if (((differing >> shift) & 0xff) == 0)
+            continue;
+
+        std::fill(m_Histograms.begin(), m_Histograms.end(), 0);
+        pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int t) {
+            size_t* histogram = &m_Histograms[(size_t) t * 256];
+            for (size_t i = begin; i < end; i++)
+                histogram[(srcKeys[i] >> shift) & 0xff]++;
+        });
+
+        // exclusive prefix over (digit, thread) so each thread scatters into its own
+        // slots and equal keys keep their order
+        size_t offset = 0;
+        for (unsigned int digit = 0; digit < 256; digit++) {
+            for (unsigned int t = 0; t < threads; t++) {
+                size_t n = m_Histograms[(size_t) t * 256 + digit];
+                m_Histograms[(size_t) t * 256 + digit] = offset;
+                offset += n;
+            }
+        }
+
+        pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int t) {
+            size_t* cursor = &m_Histograms[(size_t) t * 256];
+            for (size_t i = begin; i < end; i++) {
+                size_t slot = cursor[(srcKeys[i] >> shift) & 0xff]++;
+                dstKeys[slot] = srcKeys[i];
+                dstValues[slot] = srcValues[i];
+            }
+        });
+        std::swap(srcKeys, dstKeys);
+        std::swap(srcValues, dstValues);
+    }
+
+    if (srcKeys != keys.data()) {
+        std::memcpy(keys.data(), srcKeys, count * sizeof(uint32_t));
+        std::memcpy(values.data(), srcValues, count * sizeof(uint32_t));
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "AlignedArray.h"
+#include "ThreadPool.h"
+
+// Stable parallel LSD radix sort of (key, value) pairs, 8 bits per pass.
+// Passes whose digit is the same for every key are skipped, so small key
+// ranges cost fewer passes. Scratch space is kept between calls.
+class RadixSorter {
+private:
+	AlignedArray<uint32_t> m_TmpKeys, m_TmpValues;
+	std::vector<size_t> m_Histograms; // 256 buckets per thread
+public:
+	void sort(AlignedArray<uint32_t>& keys, AlignedArray<uint32_t>& values, ThreadPool& pool);
+};
@@ -0,0 +1,315 @@
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "Scenes.h"
+#include "ParticleMesh.h"
+#include "../math/Quat.h"
+
+void setupBoxScene(PhysicsWorld& world, unsigned int count, float radius, unsigned int seed) {
+    world.getParticles().reserve(world.getBodyCount() + count);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> position(-0.9f, 0.9f);
+    std::uniform_real_distribution<float> velocity(-1.0f, 1.0f);
+    for (unsigned int i = 0; i < count; i++)
+        world.addBody({ position(rng), position(rng), position(rng), velocity(rng), velocity(rng), velocity(rng), radius, 1.0f });
+}
+
+void setupDiskScene(PhysicsWorld& world, unsigned int count, unsigned int seed) {
+    world.setGravity(0.0f, 0.0f, 0.0f);
+    world.setBounds(-1000.0f, -1000.0f, -1000.0f, 1000.0f, 1000.0f, 1000.0f);
+    world.setBroadphase(BroadphaseType::None);
+    world.setSleeping(false); // bodies in free fall are never at rest, islands only know about contacts
+    world.setForces(ForceType::BarnesHut);
+    world.getForces()->setConstant(1.0f);
+    world.getForces()->setSoftening(0.01f);
+
+    world.getParticles().reserve(world.getBodyCount() + count);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> thickness(-0.01f, 0.01f);
+    float mass = 1.0f / count;
+    for (unsigned int i = 0; i < count; i++) {
+        // uniform in area, so the mass inside r is r^2 and the circular speed sqrt(r)
+        float r = std::sqrt(unit(rng));
+        float angle = 6.2831853f * unit(rng);
+        float c = std::cos(angle), s = std::sin(angle);
+        float speed = std::sqrt(r);
+        world.addBody({ r * c, r * s, thickness(rng), -speed * s, speed * c, 0.0f, 0.005f, mass });
+    }
+}
+
+void setupChargeScene(PhysicsWorld& world, unsigned int count, unsigned int seed) {
+    world.setGravity(0.0f, 0.0f, 0.0f);
+    world.setSleeping(false);
+    world.setForces(ForceType::FastMultipole);
+    world.getForces()->setLaw(ForceLaw::Electrostatic);
+    world.getForces()->setConstant(1.0f);
+    world.getForces()->setSoftening(0.01f);
+
+    world.getParticles().reserve(world.getBodyCount() + count);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> position(-0.9f, 0.9f);
+    float mass = 1.0f / count;
+    for (unsigned int i = 0; i < count; i++) {
+        float charge = i % 2 ? -mass : mass;
+        world.addBody({ position(rng), position(rng), position(rng), 0.0f, 0.0f, 0.0f, 0.005f, mass, charge });
+    }
+}
+
+void setupPeriodicScene(PhysicsWorld& world, unsigned int count, unsigned int gridSize, unsigned int seed) {
+    world.setGravity(0.0f, 0.0f, 0.0f);
+    world.setBounds(-0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f);
+    world.setPeriodic(true);
+    world.setBroadphase(BroadphaseType::None);
+    world.setSleeping(false);
+    world.setForces(ForceType::ParticleMesh);
+    ParticleMesh* mesh = static_cast<ParticleMesh*>(world.getForces());
+    mesh->setBox(-0.5f, -0.5f, -0.5f, 1.0f);
+    mesh->setGridSize(gridSize);
+    mesh->setConstant(1.0f);
+
+    world.getParticles().reserve(world.getBodyCount() + count);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> position(-0.5f, 0.5f);
+    float mass = 1.0f / count;
+    for (unsigned int i = 0; i < count; i++)
+        world.addBody({ position(rng), position(rng), position(rng), 0.0f, 0.0f, 0.0f, 0.002f, mass });
+}
+
+void setupDamBreak(SphFluid& fluid, unsigned int count) {
+    fluid.setBounds(-1.0f, -1.0f, -0.25f, 1.0f, 1.0f, 0.25f);
+    fluid.setGravity(0.0f, -9.81f, 0.0f);
+    fluid.setSpacing(std::cbrt(0.8f * 1.2f * 0.5f / std::max(count, 1u)));
+    fluid.addBlock(-1.0f, -1.0f, -0.25f, -0.2f, 0.2f, 0.25f);
+}
+
+void setupSloshing(SphFluid& fluid, unsigned int count) {
+    fluid.setBounds(-1.0f, -1.0f, -0.25f, 1.0f, 1.0f, 0.25f);
+    fluid.setGravity(0.0f, -9.81f, 0.0f);
+    fluid.setSpacing(std::cbrt(2.0f * 0.6f * 0.5f / std::max(count, 1u)));
+    fluid.addBlock(-1.0f, -1.0f, -0.25f, 1.0f, -0.4f, 0.25f);
+    // the first mode of a 2 m tank filled 0.6 m deep is at about 0.54 Hz
+    fluid.setShaking(2.0f, 0.5f);
+}
+
+void setupClothScene(XpbdSystem& cloth, unsigned int sheets, unsigned int resolution) {
+    cloth.setFloor(-1.0f);
+    for (unsigned int i = 0; i < sheets; i++) {
+        unsigned int row = i / 4, column = i % 4;
+        float origin[3] = { -0.95f + 0.5f * column, 0.9f - 0.6f * row, 0.2f };
+        float u[3] = { 0.4f, 0.0f, 0.0f };
+        float v[3] = { 0.0f, 0.0f, -0.4f };
+        unsigned int first = cloth.addSheet(origin, u, v, resolution, resolution, 0.1f, 0.0f, 1.0f);
+        cloth.pin(first);
+        cloth.pin(first + resolution - 1);
+    }
+    cloth.build();
+}
+
+void setupRopeScene(XpbdSystem& cloth, unsigned int ropes, unsigned int segments) {
+    cloth.setFloor(-1.0f);
+    cloth.setSphere(0.0f, -0.4f, 0.0f, 0.3f);
+    for (unsigned int i = 0; i < ropes; i++) {
+        float z = ropes > 1 ? -0.25f + 0.5f * i / (ropes - 1) : 0.0f;
+        float start[3] = { -0.9f, 0.5f, z };
+        float end[3] = { 0.7f, 0.5f, z };
+        unsigned int first = cloth.addRope(start, end, segments, 0.05f, 0.0f, 0.1f);
+        cloth.pin(first);
+    }
+    cloth.build();
+}
+
+void setupSoftBodyScene(SoftBody& body, unsigned int bodies, unsigned int resolution) {
+    body.reset(3);
+    body.setMaterial(1e6f, 0.3f, 1000.0f);
+    body.setFloor(-1.0f, 0.5f);
+    resolution = std::max(resolution, 1u);
+    for (unsigned int i = 0; i < bodies; i++) {
+        unsigned int row = i / 4, column = i % 4;
+        float origin[3] = { -0.95f + 0.5f * column, -0.5f + 0.4f * row + 0.1f * column, -0.15f };
+        float size[3] = { 0.3f, 0.3f, 0.3f };
+        unsigned int cells[3] = { resolution, resolution, resolution };
+        body.addBox(origin, size, cells);
+    }
+    body.build();
+}
+
+void setupBeamScene(SoftBody& body, unsigned int beams, unsigned int resolution) {
+    body.reset(2);
+    body.setMaterial(5e7f, 0.3f, 1000.0f);
+    body.setFloor(-1.0f, 0.5f);
+    resolution = std::max(resolution, 2u);
+    unsigned int thickness = std::max(resolution / 8, 1u);
+    for (unsigned int i = 0; i < beams; i++) {
+        // longer beams further down sag more
+        float length = beams > 1 ? 0.6f + 0.8f * i / (beams - 1) : 1.0f;
+        float origin[3] = { -0.9f, 0.8f - 1.6f * (i + 1) / (beams + 1), 0.0f };
+        float size[3] = { length, 0.1f, 0.0f };
+        unsigned int cells[3] = { resolution, thickness, 0 };
+        unsigned int first = body.addBox(origin, size, cells);
+        for (unsigned int j = 0; j <= thickness; j++)
+            body.pin(first + j * (resolution + 1));
+    }
+    body.build();
+}
+
+void setupMolecularScene(MolecularDynamics& md, unsigned int count, PairPotential potential, unsigned int seed) {
+    unsigned int cells = std::max((unsigned int) std::lround(std::cbrt(count / 4.0)), 3u);
+    float lattice = std::cbrt(4.0f / 0.8442f);
+    float length = cells * lattice;
+    md.clear();
+    md.setBox(length, length, length);
+    md.setCutoff(2.5f);
+    // the nearest fcc neighbors are lattice / sqrt(2) apart
+    if (potential == PairPotential::Morse)
+        md.setMorse(1.0f, 5.0f, lattice / std::sqrt(2.0f));
+    else
+        md.setLennardJones(1.0f, 1.0f);
+
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> velocity(0.0f, 1.0f);
+    const float basis[4][3] = { { 0.0f, 0.0f, 0.0f }, { 0.5f, 0.5f, 0.0f }, { 0.5f, 0.0f, 0.5f }, { 0.0f, 0.5f, 0.5f } };
+    for (unsigned int z = 0; z < cells; z++) {
+        for (unsigned int y = 0; y < cells; y++) {
+            for (unsigned int x = 0; x < cells; x++) {
+                for (int b = 0; b < 4; b++) {
+                    md.addParticle((x + basis[b][0] + 0.25f) * lattice, (y + basis[b][1] + 0.25f) * lattice, (z + basis[b][2] + 0.25f) * lattice,
+                        velocity(rng), velocity(rng), velocity(rng));
+                }
+            }
+        }
+    }
+    md.setTemperature(potential == PairPotential::Morse ? 0.3f : 1.5f);
+}
+
+void setupHopperScene(DemSystem& dem, unsigned int count, ContactModel model, unsigned int seed) {
+    const float width = 0.5f, height = 1.2f, depth = 0.1f, outletHeight = 0.4f;
+    const float slope = 60.0f * 3.14159265f / 180.0f;
+    float s = std::sin(slope), c = std::cos(slope);
+    dem.clear();
+    dem.setBox(width, height, depth);
+    dem.setModel(model);
+
+    // the grains start above where the hopper walls meet the sides, on a
+    // simple cubic lattice 2.2 radii apart
+    float fillBottom = outletHeight + 0.5f * width * std::tan(slope);
+    float volume = width * (height - fillBottom) * depth;
+    float radius = std::cbrt(volume / std::max(count, 1u)) / 2.2f;
+    float outlet = std::min(std::max(0.06f, 16.0f * radius), 0.2f);
+    dem.addWall({ { s, c, 0.0f }, s * 0.5f * (width - outlet) + c * outletHeight, outletHeight, height });
+    dem.addWall({ { -s, c, 0.0f }, -s * 0.5f * (width + outlet) + c * outletHeight, outletHeight, height });
+    // softened so overlaps under the full column stay near a percent of the radius
+    dem.setElasticity(1e7f, 0.3f);
+    dem.setStiffness(4e5f * radius);
+    dem.setRestitution(0.5f);
+    dem.setFriction(0.5f, 0.3f);
+    dem.setDensity(2500.0f);
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> jitter(-0.05f * radius, 0.05f * radius);
+    float spacing = 2.2f * radius;
+    unsigned int nx = (unsigned int) ((width - 2.0f * radius) / spacing) + 1;
+    unsigned int nz = std::max((unsigned int) ((depth - 2.0f * radius) / spacing) + 1, 1u);
+    unsigned int added = 0;
+    for (float y = fillBottom + radius; added < count && y < height - radius; y += spacing) {
+        for (unsigned int z = 0; z < nz && added < count; z++) {
+            for (unsigned int x = 0; x < nx && added < count; x++) {
+                dem.addParticle(radius + x * spacing + jitter(rng), y + jitter(rng), radius + z * spacing + jitter(rng), radius);
+                added++;
+            }
+        }
+    }
+}
+
+void setupClusterScene(NBodySystem& nbody, unsigned int count, unsigned int binaries, unsigned int seed) {
+    nbody.clear();
+    nbody.setConstant(1.0);
+    nbody.setSoftening(1e-5);
+    binaries = std::min(binaries, count / 2);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    auto direction = [&](double* d) {
+        double z = 2.0 * unit(rng) - 1.0, angle = 6.283185307179586 * unit(rng);
+        double s = std::sqrt(1.0 - z * z);
+        d[0] = s * std::cos(angle);
+        d[1] = s * std::sin(angle);
+        d[2] = z;
+    };
+
+    // Plummer sphere of scale a = 3 pi / 16, radii from the inverted mass
+    // profile and speeds by rejection from q^2 (1 - q^2)^(7/2) of the escape speed
+    const double scale = 3.0 * 3.141592653589793 / 16.0;
+    unsigned int centers = count - binaries;
+    double mass = 1.0 / count;
+    std::vector<double> state(6 * (size_t) centers);
+    double center[6] = {};
+    for (unsigned int i = 0; i < centers; i++) {
+        double m = std::min(unit(rng), 0.999), r = scale / std::sqrt(std::pow(m, -2.0 / 3.0) - 1.0);
+        double q = 0.0;
+        do {
+            q = unit(rng);
+        } while (0.1 * unit(rng) > q * q * std::pow(1.0 - q * q, 3.5));
+        double speed = q * std::sqrt(2.0 / scale) * std::pow(1.0 + r * r / (scale * scale), -0.25);
+        double* s = &state[6 * (size_t) i];
+        direction(s);
+        direction(s + 3);
+        for (int axis = 0; axis < 3; axis++) {
+            s[axis] *= r;
+            s[3 + axis] *= speed;
+            double weight = i < binaries ? 2.0 : 1.0; // binaries weigh two bodies
+            center[axis] += weight * s[axis] / count;
+            center[3 + axis] += weight * s[3 + axis] / count;
+        }
+    }
+
+    for (unsigned int i = 0; i < centers; i++) {
+        double* s = &state[6 * (size_t) i];
+        for (int axis = 0; axis < 6; axis++)
+            s[axis] -= center[axis];
+        if (i >= binaries) {
+            nbody.addBody(s[0], s[1], s[2], s[3], s[4], s[5], mass);
+            continue;
+        }
+        // circular orbit in a random plane around the center of mass
+        double separation = 3e-4 * std::pow(10.0, binaries > 1 ? (double) i / (binaries - 1) : 0.0);
+        double speed = std::sqrt(2.0 * mass / separation);
+        double axis1[3], axis2[3], normal[3];
+        direction(axis1);
+        direction(normal);
+        axis2[0] = normal[1] * axis1[2] - normal[2] * axis1[1];
+        axis2[1] = normal[2] * axis1[0] - normal[0] * axis1[2];
+        axis2[2] = normal[0] * axis1[1] - normal[1] * axis1[0];
+        double length = std::sqrt(axis2[0] * axis2[0] + axis2[1] * axis2[1] + axis2[2] * axis2[2]);
+        for (int side = -1; side <= 1; side += 2) {
+            double h = 0.5 * side;
+            nbody.addBody(s[0] + h * separation * axis1[0], s[1] + h * separation * axis1[1], s[2] + h * separation * axis1[2],
+                s[3] + h * speed * axis2[0] / length, s[4] + h * speed * axis2[1] / length, s[5] + h * speed * axis2[2] / length, mass);
+        }
+    }
+}
+
+void setupOrbitScene(FieldSystem& field, unsigned int count, StepScheme scheme, unsigned int dimensions, unsigned int seed) {
+    FieldParameters parameters = field.getParameters();
+    parameters.attractorMass = 1.0f;
+    parameters.softening = 0.01f;
+    field.clear();
+    field.configure(scheme, dimensions, FieldLaw::PointMass, parameters);
+    field.reserve(count);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (unsigned int i = 0; i < count; i++) {
+        // uniform in area between the radii
+        float r = std::sqrt(0.04f + unit(rng) * (0.81f - 0.04f));
+        float angle = 6.2831853f * unit(rng);
+        float speed = std::sqrt(parameters.attractorMass / r) * (0.9f + 0.2f * unit(rng));
+        Vec3 x(r * std::cos(angle), r * std::sin(angle), 0.0f);
+        Vec3 v(-speed * std::sin(angle), speed * std::cos(angle), 0.0f);
+        if (field.getDimensions() == 3) {
+            // tilt about the radius so the orbit still passes through x
+            float tilt = 0.5235988f * (2.0f * unit(rng) - 1.0f);
+            v = Quat::fromAxisAngle(x * (1.0f / r), tilt).rotate(v);
+        }
+        field.addParticle(x.x, x.y, x.z, v.x, v.y, v.z);
+    }
+}
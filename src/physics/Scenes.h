@@ -0,0 +1,73 @@
+#pragma once
+#include "PhysicsWorld.h"
+#include "SphFluid.h"
+#include "XpbdSystem.h"
+#include "SoftBody.h"
+#include "MolecularDynamics.h"
+#include "DemSystem.h"
+#include "NBodySystem.h"
+#include "FieldSystem.h"
+
+// Ready made scenes shared by the renderer and the headless driver. Each one
+// adds its bodies and sets up the world for them; callers can still change the
+// settings afterwards.
+
+// `count` spheres of `radius` at random positions and velocities in the unit box
+void setupBoxScene(PhysicsWorld& world, unsigned int count, float radius, unsigned int seed);
+// Self-gravitating disk of total mass 1 and radius 1 in the xy plane, G = 1,
+// every body on a circular orbit. No walls, contacts or uniform gravity, and
+// Barnes-Hut forces.
+void setupDiskScene(PhysicsWorld& world, unsigned int count, unsigned int seed);
+// Neutral cloud of equal and opposite charges in the unit box, total |charge|
+// and mass 1, at rest with no uniform gravity. Electrostatic forces through the
+// fast multipole method; opposite charges pair up and bounce off each other.
+void setupChargeScene(PhysicsWorld& world, unsigned int count, unsigned int seed);
+// Periodic unit box of total mass 1, G = 1, bodies at rest at random
+// positions that clump under their own gravity. Particle-mesh forces on a
+// `gridSize`^3 mesh, no contacts.
+void setupPeriodicScene(PhysicsWorld& world, unsigned int count, unsigned int gridSize, unsigned int seed);
+// Dam break: a block of about `count` fluid particles in the left part of a
+// 2 x 2 x 0.5 tank collapses under gravity. The particle spacing follows from
+// the block volume and count.
+void setupDamBreak(SphFluid& fluid, unsigned int count);
+// The bottom 0.6 of the same tank filled with about `count` particles, shaken
+// along x close to the first sloshing mode.
+void setupSloshing(SphFluid& fluid, unsigned int count);
+// `sheets` square cloths of resolution x resolution particles in rows of four,
+// each starting flat and pinned at its two back corners so it swings down.
+void setupClothScene(XpbdSystem& cloth, unsigned int sheets, unsigned int resolution);
+// `ropes` ropes of `segments` pieces pinned at one end, starting horizontal,
+// with a sphere below them to drape over.
+void setupRopeScene(XpbdSystem& cloth, unsigned int ropes, unsigned int segments);
+// `bodies` soft cubes of side 0.3 meshed with resolution^3 cells of
+// tetrahedra, dropped from staggered heights onto the floor. Stiff enough
+// (E = 1e6) that explicit steps would need well under a millisecond.
+void setupSoftBodyScene(SoftBody& body, unsigned int bodies, unsigned int resolution);
+// `beams` 2d cantilevers 0.1 thick meshed with triangles, `resolution` cells
+// along the length, clamped at their left ends and sagging under gravity;
+// each beam is longer than the one above it.
+void setupBeamScene(SoftBody& body, unsigned int beams, unsigned int resolution);
+// About `count` atoms (rounded to a whole fcc lattice of at least 3^3 cells)
+// in a periodic box at the Lennard-Jones triple point density 0.8442, reduced
+// units. Lennard-Jones atoms start at temperature 1.5 and melt; Morse atoms
+// sit at their equilibrium spacing and stay a warm crystal at 0.3.
+void setupMolecularScene(MolecularDynamics& md, unsigned int count, PairPotential potential, unsigned int seed);
+// Slot hopper discharge: about `count` spheres (the radius follows from the
+// count) dropped from a loose lattice into a 0.5 x 1.2 x 0.1 m box whose
+// upper part narrows at 60 degrees to a slot 0.4 m above the floor, which
+// lets them pour out onto the floor below. Grains of 2500 kg/m^3, softened
+// (E = 1e7 Pa) for time steps of tens of microseconds.
+void setupHopperScene(DemSystem& dem, unsigned int count, ContactModel model, unsigned int seed);
+// Star cluster for block time steps: `count` equal masses in a Plummer
+// sphere in Henon units (G = M = 1, virial radius 1, crossing time about 2.8),
+// `binaries` of them paired up into circular binaries with separations spread
+// evenly in log between 3e-4 and 3e-3; at 1000 bodies their periods are
+// between a four thousandth and a hundredth of the crossing time. Softened
+// by 1e-5, well inside the tightest binary.
+void setupClusterScene(NBodySystem& nbody, unsigned int count, unsigned int binaries, unsigned int seed);
+// `count` test particles around a point mass of G M = 1 at the origin,
+// softened by 0.01, on slightly eccentric orbits (speeds within 10% of
+// circular) between radii 0.2 and 0.9; orbital periods run from about 0.56
+// to 5.4. In 2d the orbits lie in the xy plane, in 3d their planes are tilted
+// up to 30 degrees. Configures the system with `scheme` and `dimensions`.
+void setupOrbitScene(FieldSystem& field, unsigned int count, StepScheme scheme, unsigned int dimensions, unsigned int seed);
@@ -0,0 +1,511 @@
+#include <cmath>
+#include <algorithm>
+#include "SoftBody.h"
+
+// 3 x 3 matrices are row major
+static void quaternionToMatrix(const float* q, float* m) {
+    float w = q[0], x = q[1], y = q[2], z = q[3];
+    m[0] = 1.0f - 2.0f * (y * y + z * z);
+    m[1] = 2.0f * (x * y - w * z);
+    m[2] = 2.0f * (x * z + w * y);
+    m[3] = 2.0f * (x * y + w * z);
+    m[4] = 1.0f - 2.0f * (x * x + z * z);
+    m[5] = 2.0f * (y * z - w * x);
+    m[6] = 2.0f * (x * z - w * y);
+    m[7] = 2.0f * (y * z + w * x);
+    m[8] = 1.0f - 2.0f * (x * x + y * y);
+}
+
+// Rotational part of f by the iteration of Mueller et al. ("A robust method
+// to extract the rotational part of deformations"): rotates q about the axis
+// that best aligns its columns with those of f. Starting from last step's q
+// it converges in a few iterations and stays sane for degenerate or
+// inverted elements, where a polar decomposition by inversion would not.
+static void extractRotation(const float* f, float* q, unsigned int iterations) {
+    for (unsigned int iteration = 0; iteration < iterations; iteration++) {
+        float r[9];
+        quaternionToMatrix(q, r);
+        float omega[3] = { 0.0f, 0.0f, 0.0f };
+        float alignment = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            float rx = r[c], ry = r[3 + c], rz = r[6 + c];
+            float fx = f[c], fy = f[3 + c], fz = f[6 + c];
+            omega[0] += ry * fz - rz * fy;
+            omega[1] += rz * fx - rx * fz;
+            omega[2] += rx * fy - ry * fx;
+            alignment += rx * fx + ry * fy + rz * fz;
+        }
+        float scale = 1.0f / (std::fabs(alignment) + 1e-9f);
+        float angle = scale * std::sqrt(omega[0] * omega[0] + omega[1] * omega[1] + omega[2] * omega[2]);
+        if (angle < 1e-9f)
+            break;
+        float s = std::sin(0.5f * angle) * scale / angle;
+        float dw = std::cos(0.5f * angle), dx = s * omega[0], dy = s * omega[1], dz = s * omega[2];
+        float w = q[0], x = q[1], y = q[2], z = q[3];
+        q[0] = dw * w - dx * x - dy * y - dz * z;
+        q[1] = dw * x + dx * w + dy * z - dz * y;
+        q[2] = dw * y - dx * z + dy * w + dz * x;
+        q[3] = dw * z + dx * y - dy * x + dz * w;
+        float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        for (int k = 0; k < 4; k++)
+            q[k] /= length;
+    }
+}
+
+SoftBody::SoftBody()
+    : m_Dimension(3), m_PreconditionerType(PreconditionerType::IncompleteCholesky), m_Built(true), m_YoungsModulus(1e5f), m_PoissonRatio(0.3f), m_Density(1000.0f),
+      m_MassDamping(0.1f), m_StiffnessDamping(0.01f), m_Gravity{ 0.0f, -9.81f, 0.0f }, m_FloorY(-1.0f), m_Friction(0.5f),
+      m_StepCount(0) {
+    m_Solver.setTolerance(1e-4f, 1000);
+    m_Preconditioner = createPreconditioner(m_PreconditionerType, m_Dimension);
+}
+
+void SoftBody::reset(unsigned int dimension) {
+    m_Dimension = dimension == 2 ? 2 : 3;
+    m_Preconditioner = createPreconditioner(m_PreconditionerType, m_Dimension);
+    m_X.clear();
+    m_Y.clear();
+    m_Z.clear();
+    m_RestX.clear();
+    m_RestY.clear();
+    m_RestZ.clear();
+    m_Pinned.clear();
+    m_Corners.clear();
+    m_Lines.clear();
+    m_Velocity.resize(0);
+    m_Built = false;
+}
+
+unsigned int SoftBody::addNode(float x, float y, float z) {
+    if (m_Dimension == 2)
+        z = 0.0f;
+    m_X.push_back(x);
+    m_Y.push_back(y);
+    m_Z.push_back(z);
+    m_RestX.push_back(x);
+    m_RestY.push_back(y);
+    m_RestZ.push_back(z);
+    m_Pinned.push_back(0);
+    for (unsigned int c = 0; c < m_Dimension; c++)
+        m_Velocity.push_back(0.0f);
+    m_Built = false;
+    return (unsigned int) m_X.size() - 1;
+}
+
+void SoftBody::addElement(const unsigned int* nodes) {
+    for (unsigned int a = 0; a <= m_Dimension; a++)
+        m_Corners.push_back(nodes[a]);
+    m_Built = false;
+}
+
+unsigned int SoftBody::addBox(const float origin[3], const float size[3], const unsigned int cells[3]) {
+    unsigned int nx = std::max(cells[0], 1u), ny = std::max(cells[1], 1u);
+    unsigned int nz = m_Dimension == 2 ? 0 : std::max(cells[2], 1u);
+    unsigned int first = getNodeCount();
+    for (unsigned int k = 0; k <= nz; k++) {
+        for (unsigned int j = 0; j <= ny; j++) {
+            for (unsigned int i = 0; i <= nx; i++) {
+                float z = nz ? origin[2] + size[2] * k / nz : origin[2];
+                addNode(origin[0] + size[0] * i / nx, origin[1] + size[1] * j / ny, z);
+            }
+        }
+    }
+    auto index = [&](unsigned int i, unsigned int j, unsigned int k) { return first + (k * (ny + 1) + j) * (nx + 1) + i; };
+    if (m_Dimension == 2) {
+        for (unsigned int j = 0; j < ny; j++) {
+            for (unsigned int i = 0; i < nx; i++) {
+                unsigned int lower[3] = { index(i, j, 0), index(i + 1, j, 0), index(i + 1, j + 1, 0) };
+                unsigned int upper[3] = { index(i, j, 0), index(i + 1, j + 1, 0), index(i, j + 1, 0) };
+                addElement(lower);
+                addElement(upper);
+            }
+        }
+        return first;
+    }
+    // every cube is cut into the 6 tetrahedra around its main diagonal, one per
+    // order of stepping along the axes, which matches up across neighbors
+    const unsigned int orders[6][3] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 } };
+    for (unsigned int k = 0; k < nz; k++) {
+        for (unsigned int j = 0; j < ny; j++) {
+            for (unsigned int i = 0; i < nx; i++) {
+                for (const unsigned int* order : orders) {
+                    unsigned int corner[3] = { i, j, k };
+                    unsigned int nodes[4];
+                    nodes[0] = index(corner[0], corner[1], corner[2]);
+                    for (int step = 0; step < 3; step++) {
+                        corner[order[step]]++;
+                        nodes[step + 1] = index(corner[0], corner[1], corner[2]);
+                    }
+                    addElement(nodes);
+                }
+            }
+        }
+    }
+    return first;
+}
+
+void SoftBody::pin(unsigned int node) {
+    m_Pinned[node] = 1;
+    m_Built = false;
+}
+
+void SoftBody::build() {
+    unsigned int d = m_Dimension;
+    unsigned int corners = d + 1;
+    size_t nodes = m_X.size();
+    size_t elements = m_Corners.size() / corners;
+    float lambda = m_YoungsModulus * m_PoissonRatio / ((1.0f + m_PoissonRatio) * (1.0f - 2.0f * m_PoissonRatio));
+    float mu = m_YoungsModulus / (2.0f * (1.0f + m_PoissonRatio));
+
+    m_Mass.resize(0);
+    m_Mass.resize(nodes);
+    m_Gradient.resize(elements * corners * 3);
+    m_Stiffness.resize(elements * corners * corners * 9);
+    m_RotatedStiffness.resize(elements * corners * corners * 9);
+    m_ElasticForce.resize(elements * corners * 3);
+    m_Rotation.resize(elements * 4);
+    for (size_t e = 0; e < elements; e++) {
+        const uint32_t* element = m_Corners.data() + e * corners;
+        float* q = m_Rotation.data() + e * 4;
+        q[0] = 1.0f;
+        q[1] = q[2] = q[3] = 0.0f;
+
+        // edge matrix with columns x_a - x_0, and its inverse, whose rows are the
+        // gradients of the shape functions of corners 1..d
+        float edges[3][3] = {};
+        for (unsigned int a = 1; a < corners; a++) {
+            edges[0][a - 1] = m_RestX[element[a]] - m_RestX[element[0]];
+            edges[1][a - 1] = m_RestY[element[a]] - m_RestY[element[0]];
+            edges[2][a - 1] = m_RestZ[element[a]] - m_RestZ[element[0]];
+        }
+        if (d == 2)
+            edges[2][2] = 1.0f;
+        float minors[3][3];
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++) {
+                int r0 = (r + 1) % 3, r1 = (r + 2) % 3, c0 = (c + 1) % 3, c1 = (c + 2) % 3;
+                minors[r][c] = edges[r0][c0] * edges[r1][c1] - edges[r0][c1] * edges[r1][c0];
+            }
+        }
+        float det = edges[0][0] * minors[0][0] + edges[0][1] * minors[0][1] + edges[0][2] * minors[0][2];
+        float volume = std::fabs(det) / (d == 3 ? 6.0f : 2.0f);
+        float* gradient = m_Gradient.data() + e * corners * 3;
+        for (int c = 0; c < 3; c++)
+            gradient[c] = 0.0f;
+        for (unsigned int a = 1; a < corners; a++) {
+            for (unsigned int c = 0; c < 3; c++) {
+                // inverse[a - 1][c] is the cofactor of edges[c][a - 1] over det
+                gradient[a * 3 + c] = c < d && det != 0.0f ? minors[c][a - 1] / det : 0.0f;
+                gradient[c] -= gradient[a * 3 + c];
+            }
+        }
+
+        // K_ab = V (lambda g_a g_b^T + mu g_b g_a^T + mu (g_a . g_b) I)
+        float* stiffness = m_Stiffness.data() + e * corners * corners * 9;
+        for (unsigned int a = 0; a < corners; a++) {
+            const float* ga = gradient + a * 3;
+            for (unsigned int b = 0; b < corners; b++) {
+                const float* gb = gradient + b * 3;
+                float* block = stiffness + (a * corners + b) * 9;
+                float dot = ga[0] * gb[0] + ga[1] * gb[1] + ga[2] * gb[2];
+                for (int i = 0; i < 3; i++) {
+                    for (int j = 0; j < 3; j++)
+                        block[i * 3 + j] = volume * (lambda * ga[i] * gb[j] + mu * ga[j] * gb[i] + (i == j ? mu * dot : 0.0f));
+                }
+            }
+            m_Mass[element[a]] += m_Density * volume / corners;
+        }
+    }
+
+    // neighbors of every node, itself included, sorted
+    std::vector<std::vector<uint32_t>> neighbors(nodes);
+    std::vector<uint32_t> incidenceCounts(nodes, 0);
+    for (size_t e = 0; e < elements; e++) {
+        const uint32_t* element = m_Corners.data() + e * corners;
+        for (unsigned int a = 0; a < corners; a++) {
+            incidenceCounts[element[a]]++;
+            for (unsigned int b = 0; b < corners; b++)
+                neighbors[element[a]].push_back(element[b]);
+        }
+    }
+    m_NeighborOffsets.assign(nodes + 1, 0);
+    m_SelfSlots.resize(nodes);
+    for (size_t i = 0; i < nodes; i++) {
+        neighbors[i].push_back((uint32_t) i);
+        std::sort(neighbors[i].begin(), neighbors[i].end());
+        neighbors[i].erase(std::unique(neighbors[i].begin(), neighbors[i].end()), neighbors[i].end());
+        m_SelfSlots[i] = (uint32_t) (std::lower_bound(neighbors[i].begin(), neighbors[i].end(), (uint32_t) i) - neighbors[i].begin());
+        m_NeighborOffsets[i + 1] = m_NeighborOffsets[i] + (uint32_t) neighbors[i].size();
+    }
+
+    // node i owns rows i * d .. i * d + d - 1, each with d columns per neighbor
+    std::vector<uint32_t> rowOffsets(nodes * d + 1, 0);
+    std::vector<uint32_t> columnIndices;
+    columnIndices.reserve((size_t) m_NeighborOffsets[nodes] * d * d);
+    for (size_t i = 0; i < nodes; i++) {
+        for (unsigned int c = 0; c < d; c++) {
+            for (uint32_t neighbor : neighbors[i]) {
+                for (unsigned int k = 0; k < d; k++)
+                    columnIndices.push_back(neighbor * d + k);
+            }
+            rowOffsets[i * d + c + 1] = (uint32_t) columnIndices.size();
+        }
+    }
+    m_Matrix.setPattern((unsigned int) (nodes * d), rowOffsets, columnIndices);
+    m_RightHandSide.resize(nodes * d);
+    m_Held.resize(nodes * d);
+
+    // incidences in element order, so assembly sums in a fixed order
+    m_IncidenceOffsets.assign(nodes + 1, 0);
+    for (size_t i = 0; i < nodes; i++)
+        m_IncidenceOffsets[i + 1] = m_IncidenceOffsets[i] + incidenceCounts[i];
+    m_Incidences.resize(m_IncidenceOffsets[nodes]);
+    m_IncidenceSlots.resize((size_t) m_IncidenceOffsets[nodes] * MaxCorners);
+    std::vector<uint32_t> cursor(m_IncidenceOffsets.begin(), m_IncidenceOffsets.end() - 1);
+    for (size_t e = 0; e < elements; e++) {
+        const uint32_t* element = m_Corners.data() + e * corners;
+        for (unsigned int a = 0; a < corners; a++) {
+            uint32_t node = element[a];
+            uint32_t incidence = cursor[node]++;
+            m_Incidences[incidence] = (uint32_t) e * MaxCorners + a;
+            for (unsigned int b = 0; b < corners; b++) {
+                const std::vector<uint32_t>& list = neighbors[node];
+                m_IncidenceSlots[(size_t) incidence * MaxCorners + b] = (uint32_t) (std::lower_bound(list.begin(), list.end(), element[b]) - list.begin());
+            }
+        }
+    }
+
+    // unique edges for drawing
+    std::vector<uint64_t> edges;
+    for (size_t e = 0; e < elements; e++) {
+        const uint32_t* element = m_Corners.data() + e * corners;
+        for (unsigned int a = 0; a < corners; a++) {
+            for (unsigned int b = a + 1; b < corners; b++) {
+                uint64_t low = std::min(element[a], element[b]), high = std::max(element[a], element[b]);
+                edges.push_back(low << 32 | high);
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    m_Lines.clear();
+    for (uint64_t edge : edges) {
+        m_Lines.push_back((uint32_t) (edge >> 32));
+        m_Lines.push_back((uint32_t) edge);
+    }
+    m_Built = true;
+}
+
+void SoftBody::setMaterial(float youngsModulus, float poissonRatio, float density) {
+    m_YoungsModulus = youngsModulus;
+    m_PoissonRatio = std::min(poissonRatio, 0.49f);
+    m_Density = density;
+    m_Built = false;
+}
+
+void SoftBody::setDamping(float massDamping, float stiffnessDamping) {
+    m_MassDamping = massDamping;
+    m_StiffnessDamping = stiffnessDamping;
+}
+
+void SoftBody::setGravity(float x, float y, float z) {
+    m_Gravity[0] = x;
+    m_Gravity[1] = y;
+    m_Gravity[2] = z;
+}
+
+void SoftBody::setFloor(float y, float friction) {
+    m_FloorY = y;
+    m_Friction = friction;
+}
+
+void SoftBody::setSolverTolerance(float tolerance, unsigned int maxIterations) {
+    m_Solver.setTolerance(tolerance, maxIterations);
+}
+
+void SoftBody::setPreconditioner(PreconditionerType type) {
+    m_PreconditionerType = type;
+    m_Preconditioner = createPreconditioner(type, m_Dimension);
+}
+
+// Per element: the rotation R, the rotated blocks R K_ab R^T and the elastic
+// forces -sum_b R K_ab (R^T (x_b - x_0) - (X_b - X_0)).
+void SoftBody::computeElementForces(ThreadPool& pool) {
+    unsigned int d = m_Dimension;
+    unsigned int corners = d + 1;
+    size_t elements = m_Corners.size() / corners;
+    pool.parallelFor(elements, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t e = begin; e < end; e++) {
+            const uint32_t* element = m_Corners.data() + e * corners;
+            const float* gradient = m_Gradient.data() + e * corners * 3;
+            float local[MaxCorners][3], rest[MaxCorners][3];
+            for (unsigned int a = 0; a < corners; a++) {
+                local[a][0] = m_X[element[a]] - m_X[element[0]];
+                local[a][1] = m_Y[element[a]] - m_Y[element[0]];
+                local[a][2] = m_Z[element[a]] - m_Z[element[0]];
+                rest[a][0] = m_RestX[element[a]] - m_RestX[element[0]];
+                rest[a][1] = m_RestY[element[a]] - m_RestY[element[0]];
+                rest[a][2] = m_RestZ[element[a]] - m_RestZ[element[0]];
+            }
+
+            // deformation gradient F = sum_a x_a g_a^T
+            float f[9] = {};
+            for (unsigned int a = 1; a < corners; a++) {
+                for (int i = 0; i < 3; i++) {
+                    for (int j = 0; j < 3; j++)
+                        f[i * 3 + j] += local[a][i] * gradient[a * 3 + j];
+                }
+            }
+            float* q = m_Rotation.data() + e * 4;
+            if (d == 2) {
+                float angle = std::atan2(f[3] - f[1], f[0] + f[4]);
+                q[0] = std::cos(0.5f * angle);
+                q[1] = q[2] = 0.0f;
+                q[3] = std::sin(0.5f * angle);
+            }
+            else
+                extractRotation(f, q, 8);
+            float r[9];
+            quaternionToMatrix(q, r);
+
+            // unrotated displacements R^T (x_a - x_0) - (X_a - X_0)
+            float u[MaxCorners][3];
+            for (unsigned int a = 0; a < corners; a++) {
+                for (int i = 0; i < 3; i++)
+                    u[a][i] = r[i] * local[a][0] + r[3 + i] * local[a][1] + r[6 + i] * local[a][2] - rest[a][i];
+            }
+
+            const float* stiffness = m_Stiffness.data() + e * corners * corners * 9;
+            float* rotated = m_RotatedStiffness.data() + e * corners * corners * 9;
+            float* force = m_ElasticForce.data() + e * corners * 3;
+            for (unsigned int a = 0; a < corners; a++) {
+                float restForce[3] = { 0.0f, 0.0f, 0.0f };
+                for (unsigned int b = 0; b < corners; b++) {
+                    const float* block = stiffness + (a * corners + b) * 9;
+                    float* out = rotated + (a * corners + b) * 9;
+                    float kr[9]; // K R^T
+                    for (int i = 0; i < 3; i++) {
+                        restForce[i] -= block[i * 3] * u[b][0] + block[i * 3 + 1] * u[b][1] + block[i * 3 + 2] * u[b][2];
+                        for (int j = 0; j < 3; j++)
+                            kr[i * 3 + j] = block[i * 3] * r[j * 3] + block[i * 3 + 1] * r[j * 3 + 1] + block[i * 3 + 2] * r[j * 3 + 2];
+                    }
+                    for (int i = 0; i < 3; i++) {
+                        for (int j = 0; j < 3; j++)
+                            out[i * 3 + j] = r[i * 3] * kr[j] + r[i * 3 + 1] * kr[3 + j] + r[i * 3 + 2] * kr[6 + j];
+                    }
+                }
+                for (int i = 0; i < 3; i++)
+                    force[a * 3 + i] = r[i * 3] * restForce[0] + r[i * 3 + 1] * restForce[1] + r[i * 3 + 2] * restForce[2];
+            }
+        }
+    });
+}
+
+// Two passes over the nodes. The first sums each node's forces into the
+// right hand side and decides which of its velocity components are held at
+// zero: all of them for pinned nodes, and the vertical one for nodes on the
+// floor that are being pushed into it. The second writes the matrix rows;
+// every node owns its rows, which are contiguous in the CSR arrays, so they
+// are cleared and then summed from the node's incidences. Held components
+// keep only their diagonal and are left out of the other rows.
+void SoftBody::assemble(float dt, ThreadPool& pool) {
+    unsigned int d = m_Dimension;
+    unsigned int corners = d + 1;
+    float massScale = 1.0f + dt * m_MassDamping;
+    float stiffnessScale = dt * dt + dt * m_StiffnessDamping;
+    float* values = m_Matrix.getValues();
+    float* velocity = m_Velocity.data();
+    float* rhs = m_RightHandSide.data();
+    uint8_t* held = m_Held.data();
+    pool.parallelFor(m_X.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            float mass = m_Mass[i] > 0.0f ? m_Mass[i] : 1.0f;
+            float force[3];
+            for (unsigned int c = 0; c < d; c++)
+                force[c] = mass * m_Gravity[c];
+            for (uint32_t incidence = m_IncidenceOffsets[i]; incidence < m_IncidenceOffsets[i + 1]; incidence++) {
+                uint32_t e = m_Incidences[incidence] / MaxCorners, a = m_Incidences[incidence] % MaxCorners;
+                for (unsigned int c = 0; c < d; c++)
+                    force[c] += m_ElasticForce[((size_t) e * corners + a) * 3 + c];
+            }
+            for (unsigned int c = 0; c < d; c++) {
+                rhs[i * d + c] = mass * velocity[i * d + c] + dt * force[c];
+                held[i * d + c] = m_Pinned[i];
+            }
+            if (m_Y[i] <= m_FloorY && rhs[i * d + 1] < 0.0f)
+                held[i * d + 1] = 1;
+            for (unsigned int c = 0; c < d; c++) {
+                if (held[i * d + c]) {
+                    velocity[i * d + c] = 0.0f;
+                    rhs[i * d + c] = 0.0f;
+                }
+            }
+        }
+    });
+
+    pool.parallelFor(m_X.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            uint32_t degree = m_NeighborOffsets[i + 1] - m_NeighborOffsets[i];
+            float* rows = values + (size_t) m_NeighborOffsets[i] * d * d;
+            std::fill(rows, rows + (size_t) degree * d * d, 0.0f);
+            float mass = m_Mass[i] > 0.0f ? m_Mass[i] : 1.0f;
+            for (unsigned int c = 0; c < d; c++)
+                rows[(size_t) c * degree * d + m_SelfSlots[i] * d + c] = massScale * mass;
+            for (uint32_t incidence = m_IncidenceOffsets[i]; incidence < m_IncidenceOffsets[i + 1]; incidence++) {
+                uint32_t e = m_Incidences[incidence] / MaxCorners, a = m_Incidences[incidence] % MaxCorners;
+                const uint32_t* element = m_Corners.data() + (size_t) e * corners;
+                const float* rotated = m_RotatedStiffness.data() + (size_t) e * corners * corners * 9;
+                const uint32_t* slots = m_IncidenceSlots.data() + (size_t) incidence * MaxCorners;
+                for (unsigned int b = 0; b < corners; b++) {
+                    const float* block = rotated + (a * corners + b) * 9;
+                    const uint8_t* heldColumns = held + (size_t) element[b] * d;
+                    for (unsigned int c = 0; c < d; c++) {
+                        if (held[i * d + c])
+                            continue;
+                        float* out = rows + (size_t) c * degree * d + slots[b] * d;
+                        for (unsigned int k = 0; k < d; k++) {
+                            if (!heldColumns[k])
+                                out[k] += stiffnessScale * block[c * 3 + k];
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+void SoftBody::integrate(float dt, ThreadPool& pool) {
+    unsigned int d = m_Dimension;
+    float* velocity = m_Velocity.data();
+    // the same loss per unit time whatever the step
+    float kept = std::pow(m_Friction, dt / FrictionDt);
+    pool.parallelFor(m_X.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            float* v = velocity + i * d;
+            m_X[i] += dt * v[0];
+            m_Y[i] += dt * v[1];
+            if (d == 3)
+                m_Z[i] += dt * v[2];
+            if (m_Y[i] < m_FloorY) {
+                m_Y[i] = m_FloorY;
+                v[1] = std::max(v[1], 0.0f);
+            }
+            if (m_Y[i] <= m_FloorY) {
+                v[0] *= kept;
+                if (d == 3)
+                    v[2] *= kept;
+            }
+        }
+    });
+}
+
+void SoftBody::step(float dt, ThreadPool& pool) {
+    if (!m_Built)
+        build();
+    computeElementForces(pool);
+    assemble(dt, pool);
+    m_Preconditioner->setup(m_Matrix, pool);
+    m_Solver.solve(m_Matrix, *m_Preconditioner, m_RightHandSide.data(), m_Velocity.data(), pool);
+    integrate(dt, pool);
+    m_StepCount++;
+}
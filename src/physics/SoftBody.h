@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "AlignedArray.h"
+#include "ThreadPool.h"
+#include "../numerics/SparseMatrix.h"
+#include "../numerics/Preconditioners.h"
+#include "../numerics/ConjugateGradient.h"
+
+// Corotated linear finite elements for soft bodies, either triangles in the
+// xy plane (dimension 2, plane strain) or tetrahedra (dimension 3). Every
+// element keeps its linear stiffness from the rest shape and each step
+// rotates it by the element's current rotation, found by polar decomposition
+// of the deformation gradient, so large rotations don't inflate the mesh.
+// Steps are linearized backward Euler in the velocities:
+//   ((1 + h a) M + (h^2 + h b) K) v' = M v + h (f_ext + f_elastic)
+// with Rayleigh damping a, b. build() fixes the sparsity pattern of that
+// matrix and, for every element corner, where its blocks land in the CSR
+// values; each step then computes the rotated element blocks in parallel and
+// assembles the rows of each node in parallel, gathering from the elements
+// around it, so no two threads write the same value. The system is solved
+// by preconditioned conjugate gradient warm started from the old velocities,
+// incomplete Cholesky by default (see numerics/Preconditioners.h).
+// Pinned nodes keep zero velocity, and nodes pressed into the floor plane
+// zero vertical velocity, inside the solve: those components' columns are
+// left out of the other rows, which is exact since they multiply a zero.
+class SoftBody {
+public:
+	static constexpr unsigned int MaxCorners = 4;
+	static constexpr float FrictionDt = 1.0f / 60.0f; // step the floor friction is given for
+private:
+	unsigned int m_Dimension;
+	AlignedArray<float> m_X, m_Y, m_Z;
+	AlignedArray<float> m_RestX, m_RestY, m_RestZ;
+	AlignedArray<float> m_Velocity; // interleaved, dimension values per node; the solver's unknown
+	AlignedArray<float> m_Mass; // lumped
+	AlignedArray<uint8_t> m_Pinned;
+
+	// elements, dimension + 1 corners each
+	AlignedArray<uint32_t> m_Corners;
+	AlignedArray<float> m_Gradient; // rest shape function gradients, 3 per corner
+	AlignedArray<float> m_Stiffness; // rest stiffness, 3 x 3 blocks for every corner pair
+	AlignedArray<float> m_Rotation; // quaternion per element, warm starts the polar decomposition
+	AlignedArray<float> m_RotatedStiffness; // R K R^T, same layout as m_Stiffness
+	AlignedArray<float> m_ElasticForce; // 3 per corner
+
+	// node to element corner incidences and where each corner pair's block goes
+	std::vector<uint32_t> m_IncidenceOffsets;
+	std::vector<uint32_t> m_Incidences; // element * MaxCorners + corner
+	std::vector<uint32_t> m_IncidenceSlots; // per incidence and other corner, that node's place among the row's neighbors
+	std::vector<uint32_t> m_NeighborOffsets; // neighbors per node, itself included
+	std::vector<uint32_t> m_SelfSlots; // a node's own place among its neighbors
+	CsrMatrix m_Matrix;
+	AlignedArray<float> m_RightHandSide;
+	AlignedArray<uint8_t> m_Held; // per velocity component, 1 when the step keeps it at zero
+	std::unique_ptr<Preconditioner> m_Preconditioner;
+	PreconditionerType m_PreconditionerType;
+	ConjugateGradient m_Solver;
+	bool m_Built;
+
+	std::vector<uint32_t> m_Lines; // unique element edges for drawing
+
+	float m_YoungsModulus, m_PoissonRatio, m_Density;
+	float m_MassDamping, m_StiffnessDamping;
+	float m_Gravity[3];
+	float m_FloorY;
+	float m_Friction; // tangential velocity kept by nodes on the floor per FrictionDt
+	unsigned long long m_StepCount;
+
+	void computeElementForces(ThreadPool& pool);
+	void assemble(float dt, ThreadPool& pool);
+	void integrate(float dt, ThreadPool& pool);
+public:
+	SoftBody();
+
+	// clears the body and sets whether elements are triangles (2) or tetrahedra (3)
+	void reset(unsigned int dimension);
+	unsigned int addNode(float x, float y, float z);
+	// dimension + 1 node indices
+	void addElement(const unsigned int* nodes);
+	// regular mesh of the box from origin to origin + size, cells[i] cells
+	// along each axis, each cell split into 6 tetrahedra (2 triangles in 2d,
+	// where z is ignored); returns the first node, stored x fastest
+	unsigned int addBox(const float origin[3], const float size[3], const unsigned int cells[3]);
+	void pin(unsigned int node);
+	// computes rest stiffness, masses and the matrix pattern; step calls it
+	// when elements were added since
+	void build();
+	void step(float dt, ThreadPool& pool);
+
+	void setMaterial(float youngsModulus, float poissonRatio, float density);
+	void setDamping(float massDamping, float stiffnessDamping);
+	void setGravity(float x, float y, float z);
+	// friction is the fraction of tangential velocity kept per 1/60 s on the floor
+	void setFloor(float y, float friction);
+	void setSolverTolerance(float tolerance, unsigned int maxIterations);
+	void setPreconditioner(PreconditionerType type);
+
+	inline const AlignedArray<float>& getX() const { return m_X; };
+	inline const AlignedArray<float>& getY() const { return m_Y; };
+	inline const AlignedArray<float>& getZ() const { return m_Z; };
+	inline const std::vector<uint32_t>& getLines() const { return m_Lines; };
+	inline unsigned int getDimension() const { return m_Dimension; };
+	inline unsigned int getNodeCount() const { return (unsigned int) m_X.size(); };
+	inline unsigned int getElementCount() const { return (unsigned int) (m_Corners.size() / (m_Dimension + 1)); };
+	inline const CsrMatrix& getMatrix() const { return m_Matrix; };
+	inline const ConjugateGradient& getSolver() const { return m_Solver; };
+	inline const Preconditioner& getPreconditioner() const { return *m_Preconditioner; };
+	inline unsigned long long getStepCount() const { return m_StepCount; };
+};
@@ -0,0 +1,442 @@
+#include <cstring>
+#include <algorithm>
+#include "SphFluid.h"
+#include "Integrators.h"
+
+SphFluid::SphFluid()
+    : m_Solver(SphSolver::DivergenceFree), m_Spacing(0.02f), m_SupportRadius(0.04f), m_RestDensity(1000.0f),
+      m_SoundSpeed(20.0f), m_Viscosity(0.005f), m_MaxDensityError(0.001f), m_MaxDivergenceError(0.01f),
+      m_KernelScale(0.0f), m_GradientScale(0.0f),
+      m_Gravity{ 0.0f, -9.81f, 0.0f }, m_Min{ -1.0f, -1.0f, -1.0f }, m_Max{ 1.0f, 1.0f, 1.0f },
+      m_ShakeAmplitude(0.0f), m_ShakeFrequency(0.0f), m_Time(0.0),
+      m_Substeps(0), m_DensityIterations(0), m_DivergenceIterations(0), m_StepCount(0) {
+    updateKernel();
+}
+
+void SphFluid::updateKernel() {
+    m_SupportRadius = 2.0f * m_Spacing;
+    float h3 = m_SupportRadius * m_SupportRadius * m_SupportRadius;
+    m_KernelScale = 8.0f / (3.14159265f * h3);
+    m_GradientScale = 48.0f / (3.14159265f * h3);
+    m_Grid.setCellSize(m_SupportRadius);
+
+    // A half space of fluid below a wall at distance d contributes
+    // sum m_b W = rho0 * integral_d^h area(z) dz with area(z) = 2 pi integral_z^h W(r) r dr,
+    // and the gradient of that sum is rho0 * area(d) along the wall normal.
+    // Both integrals are accumulated from the edge of the support inwards.
+    const unsigned int steps = WallSamples * 16;
+    float dz = m_SupportRadius / steps;
+    std::vector<double> area(steps + 1, 0.0), density(steps + 1, 0.0);
+    for (unsigned int k = steps; k-- > 0;) {
+        float r0 = k * dz, r1 = (k + 1) * dz;
+        area[k] = area[k + 1] + 3.14159265358979 * dz * (kernel(r0) * r0 + kernel(r1) * r1);
+        density[k] = density[k + 1] + 0.5 * dz * (area[k] + area[k + 1]);
+    }
+    m_WallDensity.resize(WallSamples + 1);
+    m_WallGradient.resize(WallSamples + 1);
+    for (unsigned int k = 0; k <= WallSamples; k++) {
+        m_WallDensity[k] = (float) density[k * 16];
+        m_WallGradient[k] = (float) area[k * 16];
+    }
+}
+
+void SphFluid::wallContribution(size_t i, float& density, float gradient[3]) const {
+    const float* p[3] = { m_Particles.px.data(), m_Particles.py.data(), m_Particles.pz.data() };
+    float scale = WallSamples / m_SupportRadius;
+    density = 0.0f;
+    for (int c = 0; c < 3; c++) {
+        gradient[c] = 0.0f;
+        // the kernel gradient points towards the wall: -c for the lower one, +c for the upper
+        float distances[2] = { p[c][i] - m_Min[c], m_Max[c] - p[c][i] };
+        for (int side = 0; side < 2; side++) {
+            float x = std::max(distances[side], 0.0f) * scale;
+            if (x >= (float) WallSamples)
+                continue;
+            unsigned int k = (unsigned int) x;
+            float f = x - k;
+            density += m_RestDensity * ((1.0f - f) * m_WallDensity[k] + f * m_WallDensity[k + 1]);
+            float g = m_RestDensity * ((1.0f - f) * m_WallGradient[k] + f * m_WallGradient[k + 1]);
+            gradient[c] += side == 0 ? -g : g;
+        }
+    }
+}
+
+void SphFluid::setSpacing(float spacing) {
+    m_Spacing = spacing;
+    updateKernel();
+}
+
+unsigned int SphFluid::addParticle(float x, float y, float z, float vx, float vy, float vz) {
+    float mass = m_RestDensity * m_Spacing * m_Spacing * m_Spacing;
+    return m_Particles.add(x, y, z, vx, vy, vz, mass, 0.5f * m_Spacing);
+}
+
+void SphFluid::addBlock(float minX, float minY, float minZ, float maxX, float maxY, float maxZ) {
+    int counts[3] = {
+        std::max((int) std::floor((maxX - minX) / m_Spacing), 0),
+        std::max((int) std::floor((maxY - minY) / m_Spacing), 0),
+        std::max((int) std::floor((maxZ - minZ) / m_Spacing), 0)
+    };
+    m_Particles.reserve(m_Particles.size() + (size_t) counts[0] * counts[1] * counts[2]);
+    for (int z = 0; z < counts[2]; z++) {
+        for (int y = 0; y < counts[1]; y++) {
+            for (int x = 0; x < counts[0]; x++)
+                addParticle(minX + (x + 0.5f) * m_Spacing, minY + (y + 0.5f) * m_Spacing, minZ + (z + 0.5f) * m_Spacing);
+        }
+    }
+}
+
+void SphFluid::setSolver(SphSolver solver) {
+    m_Solver = solver;
+}
+
+void SphFluid::setGravity(float x, float y, float z) {
+    m_Gravity[0] = x;
+    m_Gravity[1] = y;
+    m_Gravity[2] = z;
+}
+
+void SphFluid::setBounds(float minX, float minY, float minZ, float maxX, float maxY, float maxZ) {
+    m_Min[0] = minX;
+    m_Min[1] = minY;
+    m_Min[2] = minZ;
+    m_Max[0] = maxX;
+    m_Max[1] = maxY;
+    m_Max[2] = maxZ;
+}
+
+void SphFluid::setRestDensity(float density) {
+    m_RestDensity = density;
+}
+
+void SphFluid::setSoundSpeed(float speed) {
+    m_SoundSpeed = speed;
+}
+
+void SphFluid::setViscosity(float viscosity) {
+    m_Viscosity = viscosity;
+}
+
+void SphFluid::setTolerances(float densityError, float divergenceError) {
+    m_MaxDensityError = densityError;
+    m_MaxDivergenceError = divergenceError;
+}
+
+void SphFluid::setShaking(float amplitude, float frequency) {
+    m_ShakeAmplitude = amplitude;
+    m_ShakeFrequency = frequency;
+}
+
+// largest substep the CFL condition allows: no particle may cross more than a
+// fraction of its spacing, and pressure waves travel at the speed of sound
+float SphFluid::computeSubstep(float dt, ThreadPool& pool) const {
+    size_t count = m_Particles.size();
+    size_t blocks = (count + BlockSize - 1) / BlockSize;
+    std::vector<float> speeds(blocks, 0.0f);
+    pool.parallelFor(blocks, [&](size_t first, size_t last, unsigned int) {
+        for (size_t block = first; block < last; block++) {
+            float largest = 0.0f;
+            for (size_t i = block * BlockSize; i < std::min(count, (block + 1) * BlockSize); i++) {
+                float v2 = m_Particles.vx[i] * m_Particles.vx[i] + m_Particles.vy[i] * m_Particles.vy[i] + m_Particles.vz[i] * m_Particles.vz[i];
+                largest = std::max(largest, v2);
+            }
+            speeds[block] = largest;
+        }
+    });
+    float speed = std::sqrt(blocks ? *std::max_element(speeds.begin(), speeds.end()) : 0.0f);
+    if (m_Solver == SphSolver::WeaklyCompressible)
+        speed += m_SoundSpeed;
+    return speed > 0.0f ? CflFactor * m_Spacing / speed : dt;
+}
+
+void SphFluid::findNeighbors(ThreadPool& pool) {
+    m_Grid.update(m_Particles, pool);
+    m_Particles.permute(m_Grid.getOrder());
+
+    // after the permute particle i sits in sorted slot i of the grid
+    uint32_t count = (uint32_t) m_Particles.size();
+    float h2 = m_SupportRadius * m_SupportRadius;
+    m_NeighborOffsets.resize(count + 1);
+    m_ThreadNeighbors.resize(pool.getThreadCount());
+    for (AlignedArray<uint32_t>& list : m_ThreadNeighbors)
+        list.clear();
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int t) {
+        AlignedArray<uint32_t>& list = m_ThreadNeighbors[t];
+        for (uint32_t i = (uint32_t) begin; i < end; i++) {
+            size_t before = list.size();
+            m_Grid.forEachNeighbor(i, [&](uint32_t j) {
+                float dx = m_Particles.px[i] - m_Particles.px[j];
+                float dy = m_Particles.py[i] - m_Particles.py[j];
+                float dz = m_Particles.pz[i] - m_Particles.pz[j];
+                if (j != i && dx * dx + dy * dy + dz * dz < h2)
+                    list.push_back(j);
+            });
+            m_NeighborOffsets[i + 1] = (uint32_t) (list.size() - before);
+        }
+    });
+    m_NeighborOffsets[0] = 0;
+    for (uint32_t i = 0; i < count; i++)
+        m_NeighborOffsets[i + 1] += m_NeighborOffsets[i];
+
+    // the chunks are contiguous and in thread order, so the lists concatenate in particle order
+    std::vector<size_t> starts(m_ThreadNeighbors.size() + 1, 0);
+    for (size_t t = 0; t < m_ThreadNeighbors.size(); t++)
+        starts[t + 1] = starts[t] + m_ThreadNeighbors[t].size();
+    m_Neighbors.resize(starts.back());
+    pool.parallelFor(m_ThreadNeighbors.size(), [&](size_t first, size_t last, unsigned int) {
+        for (size_t t = first; t < last; t++) {
+            if (!m_ThreadNeighbors[t].empty())
+                std::memcpy(m_Neighbors.data() + starts[t], m_ThreadNeighbors[t].data(), m_ThreadNeighbors[t].size() * sizeof(uint32_t));
+        }
+    });
+}
+
+void SphFluid::computeDensity(ThreadPool& pool) {
+    m_Density.resize(m_Particles.size());
+    const float* mass = m_Particles.mass.data();
+    float self = kernel(0.0f);
+    pool.parallelFor(m_Particles.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (uint32_t i = (uint32_t) begin; i < end; i++) {
+            float density = mass[i] * self;
+            forEachNeighbor(i, [&](uint32_t j, const float*, float r) {
+                density += mass[j] * kernel(r);
+            });
+            float wall, wallGradient[3];
+            wallContribution(i, wall, wallGradient);
+            m_Density[i] = density + wall;
+        }
+    });
+}
+
+// alpha_i = rho_i / (|sum m_j grad W_ij|^2 + sum |m_j grad W_ij|^2)
+void SphFluid::computeFactors(ThreadPool& pool) {
+    m_Factor.resize(m_Particles.size());
+    const float* mass = m_Particles.mass.data();
+    pool.parallelFor(m_Particles.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (uint32_t i = (uint32_t) begin; i < end; i++) {
+            float sum[3], squares = 0.0f, wall;
+            wallContribution(i, wall, sum);
+            forEachNeighbor(i, [&](uint32_t j, const float* d, float r) {
+                float gradient[3];
+                kernelGradient(d, r, gradient);
+                for (int c = 0; c < 3; c++) {
+                    float g = mass[j] * gradient[c];
+                    sum[c] += g;
+                    squares += g * g;
+                }
+            });
+            float denominator = sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2] + squares;
+            m_Factor[i] = denominator > 1e-6f ? m_Density[i] / denominator : 0.0f;
+        }
+    });
+}
+
+void SphFluid::computePressureForces(ThreadPool& pool) {
+    size_t count = m_Particles.size();
+    m_Pressure.resize(count);
+    const float* mass = m_Particles.mass.data();
+    // Tait equation with gamma = 7, clamped so the free surface doesn't pull particles together
+    float stiffness = m_RestDensity * m_SoundSpeed * m_SoundSpeed / 7.0f;
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            float ratio = m_Density[i] / m_RestDensity;
+            float ratio2 = ratio * ratio;
+            m_Pressure[i] = std::max(stiffness * (ratio2 * ratio2 * ratio2 * ratio - 1.0f), 0.0f);
+        }
+    });
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (uint32_t i = (uint32_t) begin; i < end; i++) {
+            float term = m_Pressure[i] / (m_Density[i] * m_Density[i]);
+            float wall, force[3];
+            wallContribution(i, wall, force);
+            for (int c = 0; c < 3; c++)
+                force[c] *= -term;
+            forEachNeighbor(i, [&](uint32_t j, const float* d, float r) {
+                float gradient[3];
+                kernelGradient(d, r, gradient);
+                float scale = mass[j] * (term + m_Pressure[j] / (m_Density[j] * m_Density[j]));
+                for (int c = 0; c < 3; c++)
+                    force[c] -= scale * gradient[c];
+            });
+            m_Particles.fx[i] += mass[i] * force[0];
+            m_Particles.fy[i] += mass[i] * force[1];
+            m_Particles.fz[i] += mass[i] * force[2];
+        }
+    });
+}
+
+// laminar viscosity, a_i = 2 (d + 2) nu sum m_j / rho_j (v_ij . x_ij) / (r^2 + 0.01 h^2) grad W_ij
+void SphFluid::addViscosity(ThreadPool& pool) {
+    if (m_Viscosity <= 0.0f)
+        return;
+    const float* mass = m_Particles.mass.data();
+    const float* v[3] = { m_Particles.vx.data(), m_Particles.vy.data(), m_Particles.vz.data() };
+    float regularization = 0.01f * m_SupportRadius * m_SupportRadius;
+    pool.parallelFor(m_Particles.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (uint32_t i = (uint32_t) begin; i < end; i++) {
+            float acceleration[3] = { 0.0f, 0.0f, 0.0f };
+            forEachNeighbor(i, [&](uint32_t j, const float* d, float r) {
+                float gradient[3];
+                kernelGradient(d, r, gradient);
+                float dot = (v[0][i] - v[0][j]) * d[0] + (v[1][i] - v[1][j]) * d[1] + (v[2][i] - v[2][j]) * d[2];
+                float scale = 10.0f * m_Viscosity * mass[j] / m_Density[j] * dot / (r * r + regularization);
+                for (int c = 0; c < 3; c++)
+                    acceleration[c] += scale * gradient[c];
+            });
+            m_Particles.fx[i] += mass[i] * acceleration[0];
+            m_Particles.fy[i] += mass[i] * acceleration[1];
+            m_Particles.fz[i] += mass[i] * acceleration[2];
+        }
+    });
+}
+
+// Sets kappa from the density change rate sum m_j (v_i - v_j) . grad W_ij. With
+// predict, the source is the predicted density error after dt, otherwise the
+// change rate itself; only compression counts. Returns the mean source.
+double SphFluid::computeDensityChange(float dt, bool predict, ThreadPool& pool) {
+    size_t count = m_Particles.size();
+    size_t blocks = (count + BlockSize - 1) / BlockSize;
+    m_Kappa.resize(count);
+    m_Source.resize(count);
+    m_BlockSums.assign(blocks, 0.0);
+    const float* mass = m_Particles.mass.data();
+    const float* v[3] = { m_Particles.vx.data(), m_Particles.vy.data(), m_Particles.vz.data() };
+    float scale = predict ? 1.0f / (dt * dt) : 1.0f / dt;
+    pool.parallelFor(blocks, [&](size_t first, size_t last, unsigned int) {
+        for (size_t block = first; block < last; block++) {
+            double sum = 0.0;
+            for (uint32_t i = (uint32_t) (block * BlockSize); i < std::min(count, (block + 1) * BlockSize); i++) {
+                // the walls are at rest
+                float wall, wallGradient[3];
+                wallContribution(i, wall, wallGradient);
+                float change = v[0][i] * wallGradient[0] + v[1][i] * wallGradient[1] + v[2][i] * wallGradient[2];
+                forEachNeighbor(i, [&](uint32_t j, const float* d, float r) {
+                    float gradient[3];
+                    kernelGradient(d, r, gradient);
+                    change += mass[j] * ((v[0][i] - v[0][j]) * gradient[0] + (v[1][i] - v[1][j]) * gradient[1] + (v[2][i] - v[2][j]) * gradient[2]);
+                });
+                float source = predict ? m_Density[i] + dt * change - m_RestDensity : change;
+                source = std::max(source, 0.0f);
+                m_Source[i] = source;
+                m_Kappa[i] = source * scale * m_Factor[i];
+                sum += source;
+            }
+            m_BlockSums[block] = sum;
+        }
+    });
+    double total = 0.0;
+    for (double sum : m_BlockSums)
+        total += sum;
+    return count ? total / count : 0.0;
+}
+
+// v_i -= dt sum m_j (kappa_i / rho_i + kappa_j / rho_j) grad W_ij
+void SphFluid::applyKappa(float dt, ThreadPool& pool) {
+    const float* mass = m_Particles.mass.data();
+    pool.parallelFor(m_Particles.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (uint32_t i = (uint32_t) begin; i < end; i++) {
+            float own = m_Kappa[i] / m_Density[i];
+            float wall, dv[3];
+            wallContribution(i, wall, dv);
+            for (int c = 0; c < 3; c++)
+                dv[c] *= own;
+            forEachNeighbor(i, [&](uint32_t j, const float* d, float r) {
+                float gradient[3];
+                kernelGradient(d, r, gradient);
+                float scale = mass[j] * (own + m_Kappa[j] / m_Density[j]);
+                for (int c = 0; c < 3; c++)
+                    dv[c] += scale * gradient[c];
+            });
+            m_Particles.vx[i] -= dt * dv[0];
+            m_Particles.vy[i] -= dt * dv[1];
+            m_Particles.vz[i] -= dt * dv[2];
+        }
+    });
+}
+
+unsigned int SphFluid::solveDivergence(float dt, ThreadPool& pool) {
+    unsigned int iteration = 0;
+    for (; iteration < MaxIterations; iteration++) {
+        double error = computeDensityChange(dt, false, pool) * dt / m_RestDensity;
+        if (error <= m_MaxDivergenceError)
+            break;
+        applyKappa(dt, pool);
+    }
+    return iteration;
+}
+
+unsigned int SphFluid::solveDensity(float dt, ThreadPool& pool) {
+    unsigned int iteration = 0;
+    for (; iteration < MaxIterations; iteration++) {
+        double error = computeDensityChange(dt, true, pool) / m_RestDensity;
+        if (error <= m_MaxDensityError)
+            break;
+        applyKappa(dt, pool);
+    }
+    return iteration;
+}
+
+void SphFluid::collideWithBounds(ThreadPool& pool) {
+    float* p[3] = { m_Particles.px.data(), m_Particles.py.data(), m_Particles.pz.data() };
+    float* v[3] = { m_Particles.vx.data(), m_Particles.vy.data(), m_Particles.vz.data() };
+    float radius = 0.5f * m_Spacing;
+    pool.parallelFor(m_Particles.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (int c = 0; c < 3; c++) {
+            for (size_t i = begin; i < end; i++) {
+                if (p[c][i] < m_Min[c] + radius) {
+                    p[c][i] = m_Min[c] + radius;
+                    v[c][i] = std::max(v[c][i], 0.0f);
+                }
+                else if (p[c][i] > m_Max[c] - radius) {
+                    p[c][i] = m_Max[c] - radius;
+                    v[c][i] = std::min(v[c][i], 0.0f);
+                }
+            }
+        }
+    });
+}
+
+void SphFluid::substep(float dt, ThreadPool& pool) {
+    float gravity[3] = { m_Gravity[0], m_Gravity[1], m_Gravity[2] };
+    gravity[0] += m_ShakeAmplitude * (float) std::sin(6.283185307179586 * m_ShakeFrequency * m_Time);
+    size_t count = m_Particles.size();
+
+    findNeighbors(pool);
+    computeDensity(pool);
+    if (m_Solver == SphSolver::WeaklyCompressible) {
+        m_Particles.clearForces();
+        computePressureForces(pool);
+        addViscosity(pool);
+        pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+            semiImplicitEulerStep(IntegratorArrays(m_Particles, begin, end), dt, gravity);
+        });
+    }
+    else {
+        // the velocities are made divergence free first, then the non-pressure
+        // forces act and the density solve corrects the predicted compression
+        computeFactors(pool);
+        m_DivergenceIterations = solveDivergence(dt, pool);
+        m_Particles.clearForces();
+        addViscosity(pool);
+        pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+            kick(IntegratorArrays(m_Particles, begin, end), dt, gravity);
+        });
+        m_DensityIterations = solveDensity(dt, pool);
+        pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+            kickDrift(IntegratorArrays(m_Particles, begin, end), 0.0f, dt, gravity);
+        });
+    }
+    collideWithBounds(pool);
+    m_Time += dt;
+}
+
+void SphFluid::step(float dt, ThreadPool& pool) {
+    if (m_Particles.size() == 0)
+        return;
+    float limit = computeSubstep(dt, pool);
+    m_Substeps = std::min((unsigned int) std::ceil(dt / limit), MaxSubsteps);
+    m_Substeps = std::max(m_Substeps, 1u);
+    for (unsigned int s = 0; s < m_Substeps; s++)
+        substep(dt / m_Substeps, pool);
+    m_StepCount++;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include "ParticleStore.h"
+#include "ThreadPool.h"
+#include "UniformGrid.h"
+
+enum class SphSolver {
+	WeaklyCompressible, // Tait equation of state, explicit pressure forces
+	DivergenceFree // DFSPH: iterative density and divergence solves
+};
+
+// Smoothed particle hydrodynamics fluid in a box. Every substep the particles
+// are reordered into the cells of a uniform grid one support radius wide, and
+// the neighbors of each particle within the support radius are collected once
+// into a CSR list (offsets + indices) that all later passes of the substep
+// iterate over: density, pressure or the DFSPH solves, and viscosity. Kernels
+// are the cubic spline. The step is split into substeps that respect the CFL
+// condition. Reductions go over fixed blocks of particles so the results don't
+// depend on the thread count. The walls of the box act as a half space of
+// fluid at rest density: their density and kernel gradient sums are integrated
+// once per kernel into tables over the distance to the wall, so particles next
+// to a wall see full support without boundary particles.
+class SphFluid {
+public:
+	static constexpr unsigned int BlockSize = 1024;
+	static constexpr float CflFactor = 0.4f;
+	static constexpr unsigned int MaxSubsteps = 256;
+	static constexpr unsigned int MaxIterations = 100; // per DFSPH solve
+	static constexpr unsigned int WallSamples = 64; // table entries over one support radius
+private:
+	ParticleStore m_Particles; // radius is half the particle spacing
+	AlignedArray<float> m_Density, m_Pressure;
+	AlignedArray<float> m_Factor; // DFSPH alpha
+	AlignedArray<float> m_Kappa, m_Source; // DFSPH stiffness and density error or change per particle
+	AlignedArray<uint32_t> m_NeighborOffsets, m_Neighbors; // CSR, self excluded
+	std::vector<AlignedArray<uint32_t>> m_ThreadNeighbors;
+	std::vector<double> m_BlockSums;
+	UniformGrid m_Grid;
+
+	SphSolver m_Solver;
+	float m_Spacing, m_SupportRadius, m_RestDensity;
+	float m_SoundSpeed; // sets the stiffness of the weakly compressible solver
+	float m_Viscosity; // kinematic
+	float m_MaxDensityError, m_MaxDivergenceError; // relative, for the DFSPH solves
+	float m_KernelScale, m_GradientScale;
+	// per unit rest density, at wall distances 0 to the support radius
+	std::vector<float> m_WallDensity, m_WallGradient;
+	float m_Gravity[3];
+	float m_Min[3], m_Max[3];
+	float m_ShakeAmplitude, m_ShakeFrequency;
+	double m_Time;
+	unsigned int m_Substeps, m_DensityIterations, m_DivergenceIterations;
+	unsigned long long m_StepCount;
+
+	inline float kernel(float r) const {
+		float q = r / m_SupportRadius;
+		if (q > 1.0f)
+			return 0.0f;
+		if (q <= 0.5f)
+			return m_KernelScale * (6.0f * q * q * (q - 1.0f) + 1.0f);
+		float f = 1.0f - q;
+		return m_KernelScale * 2.0f * f * f * f;
+	};
+	// gradient of the kernel at d = x_i - x_j, |d| = r
+	inline void kernelGradient(const float d[3], float r, float gradient[3]) const {
+		float q = r / m_SupportRadius;
+		float scale = 0.0f;
+		if (r > 1e-9f && q <= 1.0f) {
+			float f = q <= 0.5f ? q * (3.0f * q - 2.0f) : -(1.0f - q) * (1.0f - q);
+			scale = m_GradientScale * f / (r * m_SupportRadius);
+		}
+		gradient[0] = scale * d[0];
+		gradient[1] = scale * d[1];
+		gradient[2] = scale * d[2];
+	};
+	// calls body(j, d, r) for every neighbor j of i, d = x_i - x_j
+	template<typename F>
+	inline void forEachNeighbor(uint32_t i, F&& body) const {
+		for (uint32_t k = m_NeighborOffsets[i]; k < m_NeighborOffsets[i + 1]; k++) {
+			uint32_t j = m_Neighbors[k];
+			float d[3] = { m_Particles.px[i] - m_Particles.px[j], m_Particles.py[i] - m_Particles.py[j], m_Particles.pz[i] - m_Particles.pz[j] };
+			body(j, d, std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+		}
+	};
+
+	void updateKernel();
+	// density of the walls around particle i and their sum of m_b grad W_ib
+	void wallContribution(size_t i, float& density, float gradient[3]) const;
+	float computeSubstep(float dt, ThreadPool& pool) const;
+	void findNeighbors(ThreadPool& pool);
+	void computeDensity(ThreadPool& pool);
+	void computeFactors(ThreadPool& pool);
+	void computePressureForces(ThreadPool& pool);
+	void addViscosity(ThreadPool& pool);
+	double computeDensityChange(float dt, bool predict, ThreadPool& pool);
+	void applyKappa(float dt, ThreadPool& pool);
+	unsigned int solveDivergence(float dt, ThreadPool& pool);
+	unsigned int solveDensity(float dt, ThreadPool& pool);
+	void collideWithBounds(ThreadPool& pool);
+	void substep(float dt, ThreadPool& pool);
+public:
+	SphFluid();
+
+	// particles sit `spacing` apart at rest; the support radius is twice that
+	void setSpacing(float spacing);
+	unsigned int addParticle(float x, float y, float z, float vx = 0.0f, float vy = 0.0f, float vz = 0.0f);
+	// fills the box [min, max] with particles on a cubic lattice
+	void addBlock(float minX, float minY, float minZ, float maxX, float maxY, float maxZ);
+	void step(float dt, ThreadPool& pool);
+
+	void setSolver(SphSolver solver);
+	void setGravity(float x, float y, float z);
+	void setBounds(float minX, float minY, float minZ, float maxX, float maxY, float maxZ);
+	void setRestDensity(float density);
+	void setSoundSpeed(float speed);
+	void setViscosity(float viscosity);
+	void setTolerances(float densityError, float divergenceError);
+	// shakes the tank along x: acceleration amplitude * sin(2 pi frequency t) is added to gravity
+	void setShaking(float amplitude, float frequency);
+
+	inline const ParticleStore& getParticles() const { return m_Particles; };
+	inline const AlignedArray<float>& getDensity() const { return m_Density; };
+	inline SphSolver getSolver() const { return m_Solver; };
+	inline float getSpacing() const { return m_Spacing; };
+	inline float getSupportRadius() const { return m_SupportRadius; };
+	inline unsigned int getParticleCount() const { return (unsigned int) m_Particles.size(); };
+	inline size_t getNeighborCount() const { return m_Neighbors.size(); };
+	inline unsigned int getSubsteps() const { return m_Substeps; }; // of the last step
+	inline unsigned int getDensityIterations() const { return m_DensityIterations; }; // of the last substep
+	inline unsigned int getDivergenceIterations() const { return m_DivergenceIterations; };
+	inline unsigned long long getStepCount() const { return m_StepCount; };
+};
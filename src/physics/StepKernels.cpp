@@ -0,0 +1,28 @@
+#include "StepKernels.h"
+#include "Cpu.h"
+
+template<typename Scheme, int Dim, typename Law, typename Precision>
+struct ScalarPreset {
+    static PHYS_FLATTEN void step(const FieldArrays& arrays, float dt, const FieldParameters& parameters) {
+        advanceParticles<Scheme, Dim, Law, typename Precision::Scalar, Precision::Offset>(arrays, dt, Law(parameters));
+    }
+};
+
+PHYS_STEP_PRESETS(ScalarPreset)
+
+StepKernel selectStepKernelScalar(StepScheme scheme, unsigned int dimensions, FieldLaw law, StatePrecision precision) {
+    return selectPreset<ScalarPreset>(scheme, dimensions, law, precision);
+}
+
+StepKernel selectStepKernel(StepScheme scheme, unsigned int dimensions, FieldLaw law, StatePrecision precision) {
+    switch (getSimdLevel()) {
+#if defined(PHYS_BATCH_AVX)
+    case SimdLevel::AVX512:
+        return selectStepKernelAVX512(scheme, dimensions, law, precision);
+    case SimdLevel::AVX2:
+        return selectStepKernelAVX2(scheme, dimensions, law, precision);
+#endif
+    default:
+        return selectStepKernelScalar(scheme, dimensions, law, precision);
+    }
+}
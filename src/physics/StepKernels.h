@@ -0,0 +1,339 @@
+#pragma once
+#include <cmath>
+#include "Integrators.h"
+#include "Cpu.h"
+#include "../math/Batch.h"
+
+// Integrator, dimension and force law as template parameters of one stepping
+// kernel, for particles moving in an external field. Every combination is a
+// separate function with the law and the scheme inlined into the particle
+// loop: no virtual calls and no switches per particle. The laws and schemes
+// are written against the lane types of math/Batch.h, so the same code steps
+// one particle at a time or 8 / 16 per AVX2 / AVX-512 register. Each
+// instruction set instantiates all presets explicitly in its own translation
+// unit (StepKernels.cpp, StepKernelsAVX2.cpp, StepKernelsAVX512.cpp), and
+// selectStepKernel picks one when a scene is set up.
+//
+// Precision is a policy of the preset as well. Positions and velocities are
+// always stored as floats, so a step moves the same bytes either way.
+// SinglePrecision steps them in float lanes. MixedPrecision widens them to
+// double lanes on load, accumulates forces and integrates in double, and
+// rounds back to float on store; its positions are float offsets from a
+// double origin per block of particles, so they round to the resolution of
+// the offset instead of the whole coordinate. Velocities have no origin and
+// still round to a float each step, which is what limits mixed precision.
+
+enum class StepScheme {
+	ExplicitEuler, // x += v dt, v += a dt from the old state; drifts, for comparison
+	SemiImplicitEuler, // v += a dt, then x += v dt
+	VelocityVerlet, // half kick, drift, half kick with the new acceleration
+	RungeKutta4 // classic fourth order, four field evaluations
+};
+
+enum class FieldLaw {
+	Uniform, // a = g
+	PointMass, // a = -G M x / (|x|^2 + softening^2)^(3/2), attractor at the origin
+	Harmonic // a = -k x - c v
+};
+
+enum class StatePrecision {
+	Single, // float storage, float arithmetic
+	Mixed // float storage, double arithmetic
+};
+
+// lane types of each instruction set for one precision, and whether its
+// positions are offsets from the block origin
+struct SinglePrecision {
+	static constexpr bool Offset = false;
+	using Scalar = Floatx1;
+#if defined(PHYS_X86)
+	using AVX2 = Floatx8;
+	using AVX512 = Floatx16;
+#endif
+};
+
+struct MixedPrecision {
+	static constexpr bool Offset = true;
+	using Scalar = Doublex1;
+#if defined(PHYS_X86)
+	using AVX2 = Doublex4;
+	using AVX512 = Doublex8;
+#endif
+};
+
+// Parameters of every law, the selected one reads its own. Accelerations are
+// per unit mass; static particles (invMass 0) don't feel the field.
+struct FieldParameters {
+	float gravity[3]; // Uniform
+	float attractorMass, softening; // PointMass, G M and the softening length
+	float stiffness, damping; // Harmonic
+};
+
+// calls f(0) .. f(Dim - 1) unrolled; plain loops over 3 axes stay rolled at -O2
+template<int Dim, typename F>
+inline void forAxes(F&& f) {
+	if constexpr (Dim > 0) {
+		forAxes<Dim - 1>(f);
+		f(Dim - 1);
+	}
+}
+
+struct UniformField {
+	float g[3];
+
+	explicit UniformField(const FieldParameters& parameters)
+		: g{ parameters.gravity[0], parameters.gravity[1], parameters.gravity[2] } {}
+
+	template<int Dim, typename T>
+	inline void acceleration(const T*, const T*, T* a) const {
+		forAxes<Dim>([&](int d) { a[d] = T(g[d]); });
+	}
+	template<int Dim, typename T>
+	inline T potential(const T* x) const {
+		T energy = T(0.0f);
+		forAxes<Dim>([&](int d) { energy = energy - T(g[d]) * x[d]; });
+		return energy;
+	}
+};
+
+struct PointMassField {
+	float gm, softeningSq;
+
+	explicit PointMassField(const FieldParameters& parameters)
+		: gm(parameters.attractorMass), softeningSq(parameters.softening * parameters.softening) {}
+
+	template<int Dim, typename T>
+	inline void acceleration(const T* x, const T*, T* a) const {
+		T r2 = T(softeningSq);
+		forAxes<Dim>([&](int d) { r2 = r2 + x[d] * x[d]; });
+		T inv = rsqrt(r2);
+		T s = T(-gm) * inv * inv * inv;
+		forAxes<Dim>([&](int d) { a[d] = s * x[d]; });
+	}
+	template<int Dim, typename T>
+	inline T potential(const T* x) const {
+		T r2 = T(softeningSq);
+		forAxes<Dim>([&](int d) { r2 = r2 + x[d] * x[d]; });
+		return T(-gm) * rsqrt(r2);
+	}
+};
+
+struct HarmonicField {
+	float stiffness, damping;
+
+	explicit HarmonicField(const FieldParameters& parameters)
+		: stiffness(parameters.stiffness), damping(parameters.damping) {}
+
+	template<int Dim, typename T>
+	inline void acceleration(const T* x, const T* v, T* a) const {
+		forAxes<Dim>([&](int d) { a[d] = T(-stiffness) * x[d] - T(damping) * v[d]; });
+	}
+	template<int Dim, typename T>
+	inline T potential(const T* x) const {
+		T r2 = T(0.0f);
+		forAxes<Dim>([&](int d) { r2 = r2 + x[d] * x[d]; });
+		return T(0.5f * stiffness) * r2;
+	}
+};
+
+// field times feel plus the force accumulator over the mass, held over the step
+template<int Dim, typename T, typename Law>
+inline void fieldAcceleration(const Law& law, const T* x, const T* v, const T* forceAcc, const T& feel, T* a) {
+	law.template acceleration<Dim>(x, v, a);
+	forAxes<Dim>([&](int d) { a[d] = a[d] * feel + forceAcc[d]; });
+}
+
+struct ExplicitEulerScheme {
+	template<int Dim, typename T, typename Law>
+	static inline void advance(T* x, T* v, const T* forceAcc, const T& feel, const T& dt, const Law& law) {
+		T a[Dim];
+		fieldAcceleration<Dim>(law, x, v, forceAcc, feel, a);
+		forAxes<Dim>([&](int d) {
+			x[d] = x[d] + v[d] * dt;
+			v[d] = v[d] + a[d] * dt;
+		});
+	}
+};
+
+struct SemiImplicitEulerScheme {
+	template<int Dim, typename T, typename Law>
+	static inline void advance(T* x, T* v, const T* forceAcc, const T& feel, const T& dt, const Law& law) {
+		T a[Dim];
+		fieldAcceleration<Dim>(law, x, v, forceAcc, feel, a);
+		forAxes<Dim>([&](int d) {
+			v[d] = v[d] + a[d] * dt;
+			x[d] = x[d] + v[d] * dt;
+		});
+	}
+};
+
+// the closing kick sees the half kicked velocity, exact for laws without damping
+struct VelocityVerletScheme {
+	template<int Dim, typename T, typename Law>
+	static inline void advance(T* x, T* v, const T* forceAcc, const T& feel, const T& dt, const Law& law) {
+		T half = T(0.5f) * dt;
+		T a[Dim];
+		fieldAcceleration<Dim>(law, x, v, forceAcc, feel, a);
+		forAxes<Dim>([&](int d) {
+			v[d] = v[d] + a[d] * half;
+			x[d] = x[d] + v[d] * dt;
+		});
+		fieldAcceleration<Dim>(law, x, v, forceAcc, feel, a);
+		forAxes<Dim>([&](int d) { v[d] = v[d] + a[d] * half; });
+	}
+};
+
+struct RungeKutta4Scheme {
+	template<int Dim, typename T, typename Law>
+	static inline void advance(T* x, T* v, const T* forceAcc, const T& feel, const T& dt, const Law& law) {
+		T half = T(0.5f) * dt, sixth = dt * T(1.0 / 6.0);
+		T a1[Dim], a2[Dim], a3[Dim], a4[Dim];
+		T x2[Dim], v2[Dim], x3[Dim], v3[Dim], x4[Dim], v4[Dim];
+		fieldAcceleration<Dim>(law, x, v, forceAcc, feel, a1);
+		forAxes<Dim>([&](int d) {
+			x2[d] = x[d] + v[d] * half;
+			v2[d] = v[d] + a1[d] * half;
+		});
+		fieldAcceleration<Dim>(law, x2, v2, forceAcc, feel, a2);
+		forAxes<Dim>([&](int d) {
+			x3[d] = x[d] + v2[d] * half;
+			v3[d] = v[d] + a2[d] * half;
+		});
+		fieldAcceleration<Dim>(law, x3, v3, forceAcc, feel, a3);
+		forAxes<Dim>([&](int d) {
+			x4[d] = x[d] + v3[d] * dt;
+			v4[d] = v[d] + a3[d] * dt;
+		});
+		fieldAcceleration<Dim>(law, x4, v4, forceAcc, feel, a4);
+		forAxes<Dim>([&](int d) {
+			x[d] = x[d] + (v[d] + T(2.0f) * (v2[d] + v3[d]) + v4[d]) * sixth;
+			v[d] = v[d] + (a1[d] + T(2.0f) * (a2[d] + a3[d]) + a4[d]) * sixth;
+		});
+	}
+};
+
+// The particles a preset steps: the integrator's arrays and the origin the
+// mixed presets add to the stored positions (unused by the single ones).
+struct FieldArrays : IntegratorArrays {
+	double origin[3];
+
+	FieldArrays(ParticleStore& particles, size_t first, size_t last)
+		: IntegratorArrays(particles, first, last), origin{ 0.0, 0.0, 0.0 } {}
+};
+
+template<typename F, bool Partial>
+inline F loadLanes(const float* p, size_t count) {
+	return Partial ? F::loadFloatPartial(p, count) : F::loadFloat(p);
+}
+
+template<typename F, bool Partial>
+inline void storeLanes(const F& x, float* p, size_t count) {
+	if (Partial)
+		x.storeFloatPartial(p, count);
+	else
+		x.storeFloat(p);
+}
+
+template<typename Scheme, int Dim, typename Law, typename F, bool Offset, bool Partial>
+inline void advanceLanes(const FieldArrays& arrays, size_t i, size_t count, const F& dt, const Law& law) {
+	F x[Dim], v[Dim], forceAcc[Dim];
+	F invMass = loadLanes<F, Partial>(arrays.invMass + i, count);
+	forAxes<Dim>([&](int d) {
+		x[d] = loadLanes<F, Partial>(arrays.p[d] + i, count);
+		if constexpr (Offset)
+			x[d] = x[d] + F(arrays.origin[d]);
+		v[d] = loadLanes<F, Partial>(arrays.v[d] + i, count);
+		forceAcc[d] = loadLanes<F, Partial>(arrays.f[d] + i, count) * invMass;
+	});
+	F feel = select(invMass > F(0.0f), F(1.0f), F(0.0f));
+	Scheme::template advance<Dim>(x, v, forceAcc, feel, dt, law);
+	forAxes<Dim>([&](int d) {
+		if constexpr (Offset)
+			x[d] = x[d] - F(arrays.origin[d]);
+		storeLanes<F, Partial>(x[d], arrays.p[d] + i, count);
+		storeLanes<F, Partial>(v[d], arrays.v[d] + i, count);
+	});
+}
+
+// Steps particles [begin, end) by dt, F::Lanes at a time and the rest masked.
+// 2d kernels read and write only x and y. F may be wider than the float
+// storage (a double lane), which then converts on every load and store;
+// with Offset the stored positions are offsets from arrays.origin.
+template<typename Scheme, int Dim, typename Law, typename F, bool Offset>
+inline void advanceParticles(const FieldArrays& arrays, float dt, const Law& law) {
+	F step(dt);
+	size_t i = arrays.begin;
+	for (; i + F::Lanes <= arrays.end; i += F::Lanes)
+		advanceLanes<Scheme, Dim, Law, F, Offset, false>(arrays, i, F::Lanes, step, law);
+	if (i < arrays.end)
+		advanceLanes<Scheme, Dim, Law, F, Offset, true>(arrays, i, arrays.end - i, step, law);
+}
+
+using StepKernel = void (*)(const FieldArrays& arrays, float dt, const FieldParameters& parameters);
+
+// the preset for a combination on the best instruction set getSimdLevel() allows
+StepKernel selectStepKernel(StepScheme scheme, unsigned int dimensions, FieldLaw law, StatePrecision precision = StatePrecision::Single);
+
+// per instruction set presets, only call the ones getSimdLevel() allows
+StepKernel selectStepKernelScalar(StepScheme scheme, unsigned int dimensions, FieldLaw law, StatePrecision precision);
+StepKernel selectStepKernelAVX2(StepScheme scheme, unsigned int dimensions, FieldLaw law, StatePrecision precision);
+StepKernel selectStepKernelAVX512(StepScheme scheme, unsigned int dimensions, FieldLaw law, StatePrecision precision);
+
+// Picks Preset<Scheme, Dim, Law, Precision>::step, where Preset is one
+// instruction set's family of presets, a class template whose static step
+// builds the law from the parameters and calls advanceParticles with the lane
+// type the precision policy names for that instruction set.
+template<template<typename, int, typename, typename> class Preset, typename Precision, typename Scheme, int Dim>
+StepKernel selectPresetLaw(FieldLaw law) {
+	switch (law) {
+	case FieldLaw::Uniform:
+		return &Preset<Scheme, Dim, UniformField, Precision>::step;
+	case FieldLaw::PointMass:
+		return &Preset<Scheme, Dim, PointMassField, Precision>::step;
+	default:
+		return &Preset<Scheme, Dim, HarmonicField, Precision>::step;
+	}
+}
+
+template<template<typename, int, typename, typename> class Preset, typename Precision, typename Scheme>
+StepKernel selectPresetDimensions(unsigned int dimensions, FieldLaw law) {
+	return dimensions == 2 ? selectPresetLaw<Preset, Precision, Scheme, 2>(law) : selectPresetLaw<Preset, Precision, Scheme, 3>(law);
+}
+
+template<template<typename, int, typename, typename> class Preset, typename Precision>
+StepKernel selectPresetScheme(StepScheme scheme, unsigned int dimensions, FieldLaw law) {
+	switch (scheme) {
+	case StepScheme::ExplicitEuler:
+		return selectPresetDimensions<Preset, Precision, ExplicitEulerScheme>(dimensions, law);
+	case StepScheme::SemiImplicitEuler:
+		return selectPresetDimensions<Preset, Precision, SemiImplicitEulerScheme>(dimensions, law);
+	case StepScheme::VelocityVerlet:
+		return selectPresetDimensions<Preset, Precision, VelocityVerletScheme>(dimensions, law);
+	default:
+		return selectPresetDimensions<Preset, Precision, RungeKutta4Scheme>(dimensions, law);
+	}
+}
+
+template<template<typename, int, typename, typename> class Preset>
+StepKernel selectPreset(StepScheme scheme, unsigned int dimensions, FieldLaw law, StatePrecision precision) {
+	if (precision == StatePrecision::Mixed)
+		return selectPresetScheme<Preset, MixedPrecision>(scheme, dimensions, law);
+	return selectPresetScheme<Preset, SinglePrecision>(scheme, dimensions, law);
+}
+
+// explicit instantiation of every preset of one family
+#define PHYS_STEP_PRESETS_LAWS(Preset, Scheme, Precision) \
+	template struct Preset<Scheme, 2, UniformField, Precision>; \
+	template struct Preset<Scheme, 3, UniformField, Precision>; \
+	template struct Preset<Scheme, 2, PointMassField, Precision>; \
+	template struct Preset<Scheme, 3, PointMassField, Precision>; \
+	template struct Preset<Scheme, 2, HarmonicField, Precision>; \
+	template struct Preset<Scheme, 3, HarmonicField, Precision>;
+#define PHYS_STEP_PRESETS_OF(Preset, Precision) \
+	PHYS_STEP_PRESETS_LAWS(Preset, ExplicitEulerScheme, Precision) \
+	PHYS_STEP_PRESETS_LAWS(Preset, SemiImplicitEulerScheme, Precision) \
+	PHYS_STEP_PRESETS_LAWS(Preset, VelocityVerletScheme, Precision) \
+	PHYS_STEP_PRESETS_LAWS(Preset, RungeKutta4Scheme, Precision)
+#define PHYS_STEP_PRESETS(Preset) \
+	PHYS_STEP_PRESETS_OF(Preset, SinglePrecision) \
+	PHYS_STEP_PRESETS_OF(Preset, MixedPrecision)
@@ -0,0 +1,18 @@
+#include "StepKernels.h"
+#include "Cpu.h"
+#if defined(PHYS_BATCH_AVX)
+
+template<typename Scheme, int Dim, typename Law, typename Precision>
+struct AVX2Preset {
+    static PHYS_TARGET_AVX2 PHYS_FLATTEN void step(const FieldArrays& arrays, float dt, const FieldParameters& parameters) {
+        advanceParticles<Scheme, Dim, Law, typename Precision::AVX2, Precision::Offset>(arrays, dt, Law(parameters));
+    }
+};
+
+PHYS_STEP_PRESETS(AVX2Preset)
+
+StepKernel selectStepKernelAVX2(StepScheme scheme, unsigned int dimensions, FieldLaw law, StatePrecision precision) {
+    return selectPreset<AVX2Preset>(scheme, dimensions, law, precision);
+}
+
+#endif
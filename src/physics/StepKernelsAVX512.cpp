@@ -0,0 +1,18 @@
+#include "StepKernels.h"
+#include "Cpu.h"
+#if defined(PHYS_BATCH_AVX)
+
+template<typename Scheme, int Dim, typename Law, typename Precision>
+struct AVX512Preset {
+    static PHYS_TARGET_AVX512 PHYS_FLATTEN void step(const FieldArrays& arrays, float dt, const FieldParameters& parameters) {
+        advanceParticles<Scheme, Dim, Law, typename Precision::AVX512, Precision::Offset>(arrays, dt, Law(parameters));
+    }
+};
+
+PHYS_STEP_PRESETS(AVX512Preset)
+
+StepKernel selectStepKernelAVX512(StepScheme scheme, unsigned int dimensions, FieldLaw law, StatePrecision precision) {
+    return selectPreset<AVX512Preset>(scheme, dimensions, law, precision);
+}
+
+#endif
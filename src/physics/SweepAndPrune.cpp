@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <iterator>
+#include "SweepAndPrune.h"
+
+static inline uint64_t pairKey(uint32_t a, uint32_t b) {
+    return a < b ? (uint64_t) a << 32 | b : (uint64_t) b << 32 | a;
+}
+
+SweepAndPrune::SweepAndPrune()
+    : m_BodyCount(0) {
+}
+
+void SweepAndPrune::rebuild(ThreadPool& pool) {
+    // full sort of every axis, then a sweep along x
+    uint32_t count = (uint32_t) m_BodyCount;
+    pool.parallelFor(3, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t axis = begin; axis < end; axis++) {
+            std::vector<Endpoint>& endpoints = m_Axes[axis];
+            endpoints.resize((size_t) count * 2);
+            for (uint32_t i = 0; i < count; i++) {
+                endpoints[2 * i] = { m_Lo[axis][i], i << 1 };
+                endpoints[2 * i + 1] = { m_Hi[axis][i], i << 1 | 1 };
+            }
+            std::sort(endpoints.begin(), endpoints.end());
+        }
+    });
+
+    // every box overlapping body's box on x starts between body's two x endpoints,
+    // so scanning forward from each min end finds each pair once
+    const std::vector<Endpoint>& xs = m_Axes[0];
+    std::vector<std::vector<uint64_t>> threadPairs(pool.getThreadCount());
+    pool.parallelFor(xs.size(), [&](size_t begin, size_t end, unsigned int t) {
+        std::vector<uint64_t>& local = threadPairs[t];
+        for (size_t i = begin; i < end; i++) {
+            if (xs[i].isMax())
+                continue;
+            uint32_t body = xs[i].body();
+            for (size_t j = i + 1; xs[j].body() != body; j++) {
+                if (!xs[j].isMax() && overlaps(m_Lo, m_Hi, body, xs[j].body()))
+                    local.push_back(pairKey(body, xs[j].body()));
+            }
+        }
+    });
+    m_Pairs.clear();
+    for (const std::vector<uint64_t>& local : threadPairs)
+        m_Pairs.insert(m_Pairs.end(), local.begin(), local.end());
+    std::sort(m_Pairs.begin(), m_Pairs.end());
+    m_Added = m_Pairs;
+    m_Removed.clear();
+}
+
+void SweepAndPrune::sortAxis(int axis) {
+    std::vector<Endpoint>& endpoints = m_Axes[axis];
+    std::vector<uint64_t>& changed = m_Changed[axis];
+    changed.clear();
+    for (size_t i = 0; i < endpoints.size(); i++) {
+        Endpoint& e = endpoints[i];
+        e.value = e.isMax() ? m_Hi[axis][e.body()] : m_Lo[axis][e.body()];
+    }
+
+    for (size_t i = 1; i < endpoints.size(); i++) {
+        Endpoint key = endpoints[i];
+        size_t j = i;
+        while (j > 0 && key < endpoints[j - 1]) {
+            const Endpoint& passed = endpoints[j - 1];
+            // only a min end crossing a max end can change whether two boxes overlap
+            if (key.isMax() != passed.isMax() && key.body() != passed.body()) {
+                uint32_t a = key.body(), b = passed.body();
+                if (overlaps(m_Lo, m_Hi, a, b) != overlaps(m_PrevLo, m_PrevHi, a, b))
+                    changed.push_back(pairKey(a, b));
+            }
+            endpoints[j] = passed;
+            j--;
+        }
+        endpoints[j] = key;
+    }
+}
+
+void SweepAndPrune::update(const ParticleStore& particles, ThreadPool& pool) {
+    size_t count = particles.size();
+    for (int axis = 0; axis < 3; axis++) {
+        std::swap(m_Lo[axis], m_PrevLo[axis]);
+        std::swap(m_Hi[axis], m_PrevHi[axis]);
+        m_Lo[axis].resize(count);
+        m_Hi[axis].resize(count);
+    }
+    const float* position[3] = { particles.px.data(), particles.py.data(), particles.pz.data() };
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (int axis = 0; axis < 3; axis++) {
+            for (size_t i = begin; i < end; i++) {
+                m_Lo[axis][i] = position[axis][i] - particles.radius[i];
+                m_Hi[axis][i] = position[axis][i] + particles.radius[i];
+            }
+        }
+    });
+
+    if (count != m_BodyCount) {
+        m_BodyCount = count;
+        rebuild(pool);
+        return;
+    }
+
+    // the axes are independent, sort them side by side
+    pool.parallelFor(3, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t axis = begin; axis < end; axis++)
+            sortAxis((int) axis);
+    });
+
+    // a pair that crossed on several axes shows up once per axis
+    m_Scratch.clear();
+    for (int axis = 0; axis < 3; axis++)
+        m_Scratch.insert(m_Scratch.end(), m_Changed[axis].begin(), m_Changed[axis].end());
+    std::sort(m_Scratch.begin(), m_Scratch.end());
+    m_Scratch.erase(std::unique(m_Scratch.begin(), m_Scratch.end()), m_Scratch.end());
+
+    m_Added.clear();
+    m_Removed.clear();
+    for (uint64_t key : m_Scratch) {
+        if (overlaps(m_Lo, m_Hi, (uint32_t) (key >> 32), (uint32_t) (key & 0xffffffffu)))
+            m_Added.push_back(key);
+        else
+            m_Removed.push_back(key);
+    }
+    if (m_Scratch.empty())
+        return;
+
+    // patch the sorted pair set: drop removed keys, merge added keys in
+    m_Scratch.clear();
+    std::set_difference(m_Pairs.begin(), m_Pairs.end(), m_Removed.begin(), m_Removed.end(), std::back_inserter(m_Scratch));
+    m_Pairs.clear();
+    std::merge(m_Scratch.begin(), m_Scratch.end(), m_Added.begin(), m_Added.end(), std::back_inserter(m_Pairs));
+}
+
+void SweepAndPrune::findPairs(std::vector<BodyPair>& pairs, ThreadPool& pool) {
+    pairs.resize(m_Pairs.size());
+    pool.parallelFor(m_Pairs.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++)
+            pairs[i] = unpack(m_Pairs[i]);
+    });
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Broadphase.h"
+
+// Sort and sweep broadphase. Box endpoints are kept sorted along each axis from
+// one step to the next and re-sorted with insertion sort, which is close to
+// linear when bodies move little. Only pairs whose endpoints swapped can have
+// started or stopped overlapping; comparing their old and new boxes on the spot
+// gives the add/remove events, and the persistent pair set is patched with them.
+class SweepAndPrune : public Broadphase {
+private:
+	struct Endpoint {
+		float value;
+		uint32_t id; // body << 1 | 1 for the max end
+
+		inline uint32_t body() const { return id >> 1; };
+		inline bool isMax() const { return (id & 1) != 0; };
+		// min ends sort before max ends at the same value, so touching boxes overlap
+		inline bool operator<(const Endpoint& other) const {
+			return value < other.value || (value == other.value && (id & 1) < (other.id & 1));
+		};
+	};
+
+	std::vector<Endpoint> m_Axes[3];
+	std::vector<uint64_t> m_Changed[3]; // pairs whose overlap changed, found while sorting each axis
+	AlignedArray<float> m_Lo[3], m_Hi[3]; // current box of every body
+	AlignedArray<float> m_PrevLo[3], m_PrevHi[3]; // boxes at the previous update
+	std::vector<uint64_t> m_Pairs; // sorted (a << 32 | b)
+	std::vector<uint64_t> m_Added, m_Removed;
+	std::vector<uint64_t> m_Scratch;
+	size_t m_BodyCount;
+
+	void rebuild(ThreadPool& pool);
+	void sortAxis(int axis);
+	static inline bool overlaps(const AlignedArray<float>* lo, const AlignedArray<float>* hi, uint32_t a, uint32_t b) {
+		return lo[0][a] <= hi[0][b] && lo[0][b] <= hi[0][a] &&
+			lo[1][a] <= hi[1][b] && lo[1][b] <= hi[1][a] &&
+			lo[2][a] <= hi[2][b] && lo[2][b] <= hi[2][a];
+	};
+public:
+	SweepAndPrune();
+
+	void update(const ParticleStore& particles, ThreadPool& pool) override;
+	void findPairs(std::vector<BodyPair>& pairs, ThreadPool& pool) override;
+	inline const char* getName() const override { return "sweep and prune"; };
+
+	// pairs that started or stopped overlapping in the last update, sorted
+	inline const std::vector<uint64_t>& getAddedPairs() const { return m_Added; };
+	inline const std::vector<uint64_t>& getRemovedPairs() const { return m_Removed; };
+	static inline BodyPair unpack(uint64_t key) { return { (unsigned int) (key >> 32), (unsigned int) (key & 0xffffffffu) }; };
+};
@@ -0,0 +1,59 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+    : m_Job(nullptr), m_Generation(0), m_Pending(0), m_Stop(false) {
+    if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+        threadCount = 1;
+    for (unsigned int i = 1; i < threadCount; i++)
+        m_Workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_WorkReady.notify_all();
+    for (std::thread& worker : m_Workers)
+        worker.join();
+}
+
+void ThreadPool::workerLoop(unsigned int threadIndex) {
+    unsigned long long seen = 0;
+    while (true) {
+        const std::function<void(unsigned int)>* job;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WorkReady.wait(lock, [&] { return m_Stop || m_Generation != seen; });
+            if (m_Stop)
+                return;
+            seen = m_Generation;
+            job = m_Job;
+        }
+        (*job)(threadIndex);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (--m_Pending == 0)
+                m_WorkDone.notify_one();
+        }
+    }
+}
+
+void ThreadPool::run(const std::function<void(unsigned int)>& job) {
+    if (m_Workers.empty()) {
+        job(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Job = &job;
+        m_Pending = (unsigned int) m_Workers.size();
+        m_Generation++;
+    }
+    m_WorkReady.notify_all();
+    job(0);
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_WorkDone.wait(lock, [&] { return m_Pending == 0; });
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstddef>
+
+// Fixed set of worker threads that all run the same job, fork-join style.
+// Work is split into contiguous chunks by thread index, so anything written
+// per chunk and concatenated in chunk order comes out the same as a serial run.
+class ThreadPool {
+private:
+	std::vector<std::thread> m_Workers;
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkReady;
+	std::condition_variable m_WorkDone;
+	const std::function<void(unsigned int)>* m_Job;
+	unsigned long long m_Generation;
+	unsigned int m_Pending;
+	bool m_Stop;
+
+	void workerLoop(unsigned int threadIndex);
+public:
+	explicit ThreadPool(unsigned int threadCount = 0); // 0 picks the hardware thread count
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// runs job(threadIndex) once on every thread, the caller acts as thread 0.
+	// Jobs must not call back into the same pool.
+	void run(const std::function<void(unsigned int)>& job);
+
+	// splits [0, count) into one contiguous chunk per thread and calls body(begin, end, threadIndex)
+	template<typename F>
+	void parallelFor(size_t count, F&& body) {
+		unsigned int threads = getThreadCount();
+		if (threads == 1 || count < 2) {
+			body((size_t) 0, count, 0u);
+			return;
+		}
+		run([&](unsigned int t) {
+			size_t begin, end;
+			chunk(count, t, begin, end);
+			if (begin < end)
+				body(begin, end, t);
+		});
+	}
+
+	inline void chunk(size_t count, unsigned int threadIndex, size_t& begin, size_t& end) const {
+		size_t threads = getThreadCount();
+		begin = count * threadIndex / threads;
+		end = count * (threadIndex + 1) / threads;
+	};
+	inline unsigned int getThreadCount() const { return (unsigned int) m_Workers.size() + 1; };
+};
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include "UniformGrid.h"
+
+UniformGrid::UniformGrid(float cellSize)
+    : m_CellSize(1.0f), m_InvCellSize(1.0f), m_AutoCellSize(true), m_TableMask(0) {
+    setCellSize(cellSize);
+}
+
+void UniformGrid::setCellSize(float cellSize) {
+    m_AutoCellSize = cellSize <= 0.0f;
+    if (!m_AutoCellSize) {
+        m_CellSize = cellSize;
+        m_InvCellSize = 1.0f / cellSize;
+    }
+}
+
+unsigned int UniformGrid::neighborKeys(int x, int y, int z, uint32_t keys[27]) const {
+    // the table has at least 64 slots, so every axis keeps at least 2 bits of the
+    // cell coordinate and the 27 neighbors never alias onto the same key
+    unsigned int count = 0;
+    for (int dz = -1; dz <= 1; dz++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++)
+                keys[count++] = hashCell(x + dx, y + dy, z + dz);
+        }
+    }
+    return count;
+}
+
+unsigned int UniformGrid::forwardKeys(int x, int y, int z, uint32_t keys[13]) const {
+    unsigned int count = 0;
+    for (int dz = -1; dz <= 1; dz++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dz > 0 || (dz == 0 && (dy > 0 || (dy == 0 && dx > 0))))
+                    keys[count++] = hashCell(x + dx, y + dy, z + dz);
+            }
+        }
+    }
+    return count;
+}
+
+void UniformGrid::update(const ParticleStore& particles, ThreadPool& pool) {
+    size_t count = particles.size();
+    unsigned int threads = pool.getThreadCount();
+
+    if (m_AutoCellSize) {
+        std::vector<float> largest(threads, 0.0f);
+        pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int t) {
+            float r = 0.0f;
+            for (size_t i = begin; i < end; i++)
+                r = std::max(r, particles.radius[i]);
+            largest[t] = r;
+        });
+        float diameter = 2.0f * *std::max_element(largest.begin(), largest.end());
+        m_CellSize = diameter > 0.0f ? diameter : 1.0f;
+        m_InvCellSize = 1.0f / m_CellSize;
+    }
+
+    uint32_t tableSize = 64;
+    while (tableSize < count * 2)
+        tableSize <<= 1;
+    m_TableMask = tableSize - 1;
+
+    m_Keys.resize(count);
+    m_Order.resize(count);
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            m_Keys[i] = hashCell(cellCoord(particles.px[i]), cellCoord(particles.py[i]), cellCoord(particles.pz[i]));
+            m_Order[i] = (uint32_t) i;
+        }
+    });
+    m_Sorter.sort(m_Keys, m_Order, pool);
+
+    m_Cells.resize(tableSize);
+    m_X.resize(count);
+    m_Y.resize(count);
+    m_Z.resize(count);
+    m_Radius.resize(count);
+    pool.parallelFor(tableSize, [&](size_t begin, size_t end, unsigned int) {
+        std::fill(m_Cells.data() + begin, m_Cells.data() + end, CellRange{ EmptyCell, EmptyCell });
+    });
+    pool.parallelFor(count, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t s = begin; s < end; s++) {
+            uint32_t key = m_Keys[s];
+            if (s == 0 || m_Keys[s - 1] != key)
+                m_Cells[key].start = (uint32_t) s;
+            if (s + 1 == count || m_Keys[s + 1] != key)
+                m_Cells[key].end = (uint32_t) s + 1;
+            uint32_t body = m_Order[s];
+            m_X[s] = particles.px[body];
+            m_Y[s] = particles.py[body];
+            m_Z[s] = particles.pz[body];
+            m_Radius[s] = particles.radius[body];
+        }
+    });
+}
+
+void UniformGrid::findPairs(std::vector<BodyPair>& pairs, ThreadPool& pool) {
+    m_ThreadPairs.resize(pool.getThreadCount());
+    for (std::vector<BodyPair>& local : m_ThreadPairs)
+        local.clear();
+
+    pool.parallelFor(m_Order.size(), [&](size_t begin, size_t end, unsigned int t) {
+        std::vector<BodyPair>& local = m_ThreadPairs[t];
+        forEachPairInSlots((uint32_t) begin, (uint32_t) end, [&](uint32_t s, uint32_t n) {
+            if (boxesOverlap(m_X[s], m_Y[s], m_Z[s], m_Radius[s], m_X[n], m_Y[n], m_Z[n], m_Radius[n])) {
+                uint32_t a = m_Order[s], b = m_Order[n];
+                local.push_back(a < b ? BodyPair{ a, b } : BodyPair{ b, a });
+            }
+        });
+    });
+
+    // chunks are contiguous and in order, so this matches a single threaded run
+    pairs.clear();
+    for (const std::vector<BodyPair>& local : m_ThreadPairs)
+        pairs.insert(pairs.end(), local.begin(), local.end());
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include "Broadphase.h"
+#include "RadixSort.h"
+
+// Spatial hash broadphase. Every body gets the hashed key of the cell its center
+// is in, bodies are radix sorted by key, and a start/end table gives the range
+// of sorted slots for each key. Keys are Morton codes of the cell coordinates
+// masked to the table size, so the table wraps around in every axis and nearby
+// cells land near each other in the table and in sorted order. Positions are
+// gathered into sorted order as well, so neighbor loops read contiguous memory.
+class UniformGrid : public Broadphase {
+public:
+	struct CellRange {
+		uint32_t start, end; // start is EmptyCell when no body has this key
+	};
+private:
+	static constexpr uint32_t EmptyCell = 0xffffffffu;
+
+	float m_CellSize;
+	float m_InvCellSize;
+	bool m_AutoCellSize; // cell size = largest body diameter
+	uint32_t m_TableMask;
+
+	AlignedArray<uint32_t> m_Keys; // cell key per sorted slot
+	AlignedArray<uint32_t> m_Order; // body index per sorted slot
+	AlignedArray<CellRange> m_Cells; // sorted slot range per key
+	AlignedArray<float> m_X, m_Y, m_Z, m_Radius; // body data in sorted order
+	RadixSorter m_Sorter;
+	std::vector<std::vector<BodyPair>> m_ThreadPairs;
+
+	inline int cellCoord(float p) const { return (int) std::floor(p * m_InvCellSize); };
+	// interleaves the low 10 bits of each coordinate (Morton order) so cells that
+	// are close in space get keys that are close in the table and in sorted order
+	static inline uint32_t spreadBits(uint32_t v) {
+		v &= 0x3ff;
+		v = (v | (v << 16)) & 0x030000ff;
+		v = (v | (v << 8)) & 0x0300f00f;
+		v = (v | (v << 4)) & 0x030c30c3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	};
+	inline uint32_t hashCell(int x, int y, int z) const {
+		return (spreadBits((uint32_t) x) | (spreadBits((uint32_t) y) << 1) | (spreadBits((uint32_t) z) << 2)) & m_TableMask;
+	};
+	// keys of the 27 cells around (x, y, z), all distinct
+	unsigned int neighborKeys(int x, int y, int z, uint32_t keys[27]) const;
+	// keys of the 13 neighbors that come after (x, y, z) in (z, y, x) order; a pair of
+	// bodies in different cells is found only from the cell that has the other one forward
+	unsigned int forwardKeys(int x, int y, int z, uint32_t keys[13]) const;
+public:
+	explicit UniformGrid(float cellSize = 0.0f); // 0 sizes cells from the bodies every update
+
+	void update(const ParticleStore& particles, ThreadPool& pool) override;
+	void findPairs(std::vector<BodyPair>& pairs, ThreadPool& pool) override;
+	inline const char* getName() const override { return "uniform grid"; };
+
+	// calls fn(sortedSlot) for every body in the cells around sortedSlot's cell, itself included
+	template<typename F>
+	void forEachNeighbor(uint32_t sortedSlot, F&& fn) const {
+		uint32_t keys[27];
+		unsigned int count = neighborKeys(cellCoord(m_X[sortedSlot]), cellCoord(m_Y[sortedSlot]), cellCoord(m_Z[sortedSlot]), keys);
+		for (unsigned int k = 0; k < count; k++) {
+			CellRange cell = m_Cells[keys[k]];
+			if (cell.start == EmptyCell)
+				continue;
+			for (uint32_t t = cell.start; t < cell.end; t++)
+				fn(t);
+		}
+	};
+
+	// calls fn(bodyA, bodyB) once per pair of bodies in neighboring cells, serially
+	template<typename F>
+	void forEachPair(F&& fn) const {
+		forEachPairInSlots(0, (uint32_t) m_Order.size(), [&](uint32_t s, uint32_t t) {
+			fn(m_Order[s], m_Order[t]);
+		});
+	};
+
+	// pairs (s, t) of sorted slots for s in [begin, end), in a fixed order
+	template<typename F>
+	void forEachPairInSlots(uint32_t begin, uint32_t end, F&& fn) const {
+		uint32_t keys[13];
+		uint32_t rangeStart[13], rangeEnd[13];
+		unsigned int ranges = 0;
+		uint32_t cachedKey = EmptyCell;
+		for (uint32_t s = begin; s < end; s++) {
+			uint32_t key = m_Keys[s];
+			if (key != cachedKey) {
+				// bodies in the same cell share their neighbor ranges, look them up once
+				cachedKey = key;
+				ranges = 0;
+				unsigned int count = forwardKeys(cellCoord(m_X[s]), cellCoord(m_Y[s]), cellCoord(m_Z[s]), keys);
+				for (unsigned int k = 0; k < count; k++) {
+					CellRange cell = m_Cells[keys[k]];
+					if (cell.start == EmptyCell)
+						continue;
+					rangeStart[ranges] = cell.start;
+					rangeEnd[ranges] = cell.end;
+					ranges++;
+				}
+			}
+			for (uint32_t t = s + 1; t < m_Cells[key].end; t++)
+				fn(s, t);
+			for (unsigned int r = 0; r < ranges; r++) {
+				for (uint32_t t = rangeStart[r]; t < rangeEnd[r]; t++)
+					fn(s, t);
+			}
+		}
+	};
+
+	void setCellSize(float cellSize); // 0 switches back to automatic sizing
+
+	inline float getCellSize() const { return m_CellSize; };
+	inline const AlignedArray<uint32_t>& getOrder() const { return m_Order; };
+	inline const AlignedArray<float>& getSortedX() const { return m_X; };
+	inline const AlignedArray<float>& getSortedY() const { return m_Y; };
+	inline const AlignedArray<float>& getSortedZ() const { return m_Z; };
+	inline const AlignedArray<float>& getSortedRadius() const { return m_Radius; };
+};
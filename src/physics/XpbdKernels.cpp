@@ -0,0 +1,42 @@
+#include <cmath>
+#include "XpbdKernels.h"
+#include "Cpu.h"
+
+void projectDistancesScalar(const DistanceBatch& batch, const XpbdParticles& particles, float invDtSq) {
+    for (size_t i = 0; i < batch.count; i++) {
+        uint32_t a = batch.a[i], b = batch.b[i];
+        float dx = particles.x[a] - particles.x[b];
+        float dy = particles.y[a] - particles.y[b];
+        float dz = particles.z[a] - particles.z[b];
+        float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+        float wa = particles.invMass[a], wb = particles.invMass[b];
+        float alpha = batch.compliance[i] * invDtSq;
+        float denominator = wa + wb + alpha;
+        if (length < 1e-9f || denominator <= 0.0f)
+            continue;
+        float delta = (batch.restLength[i] - length - alpha * batch.lambda[i]) / denominator;
+        batch.lambda[i] += delta;
+        float s = delta / length;
+        particles.x[a] += wa * s * dx;
+        particles.y[a] += wa * s * dy;
+        particles.z[a] += wa * s * dz;
+        particles.x[b] -= wb * s * dx;
+        particles.y[b] -= wb * s * dy;
+        particles.z[b] -= wb * s * dz;
+    }
+}
+
+void projectDistances(const DistanceBatch& batch, const XpbdParticles& particles, float invDtSq) {
+    switch (getSimdLevel()) {
+#if defined(PHYS_X86)
+    case SimdLevel::AVX512:
+        projectDistancesAVX512(batch, particles, invDtSq);
+        break;
+    case SimdLevel::AVX2:
+        projectDistancesAVX2(batch, particles, invDtSq);
+        break;
+#endif
+    default:
+        projectDistancesScalar(batch, particles, invDtSq);
+    }
+}
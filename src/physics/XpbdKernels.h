@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Distance constraints of one batch, structure of arrays. No two constraints
+// of a batch share a particle, so they can be projected in any order and in
+// parallel without changing the result.
+struct DistanceBatch {
+	const uint32_t* a;
+	const uint32_t* b;
+	const float* restLength;
+	const float* compliance; // inverse stiffness, 0 is rigid
+	float* lambda; // accumulated multiplier of the substep
+	size_t count;
+};
+
+struct XpbdParticles {
+	float* x;
+	float* y;
+	float* z;
+	const float* invMass;
+};
+
+// One XPBD projection of every constraint in the batch:
+// dlambda = (-C - compliance / h^2 * lambda) / (w_a + w_b + compliance / h^2),
+// applied along the constraint gradient weighted by the inverse masses.
+// Vectorized over the constraints with gathers; dispatches to AVX-512, AVX2 or
+// scalar code at runtime.
+void projectDistances(const DistanceBatch& batch, const XpbdParticles& particles, float invDtSq);
+
+// per instruction set kernels, only call the ones getSimdLevel() allows
+void projectDistancesScalar(const DistanceBatch& batch, const XpbdParticles& particles, float invDtSq);
+void projectDistancesAVX2(const DistanceBatch& batch, const XpbdParticles& particles, float invDtSq);
+void projectDistancesAVX512(const DistanceBatch& batch, const XpbdParticles& particles, float invDtSq);
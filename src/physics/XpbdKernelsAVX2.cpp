@@ -0,0 +1,54 @@
+#include "XpbdKernels.h"
+#include "Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+// AVX2 has gathers but no scatter, the corrections are written back lane by lane
+PHYS_TARGET_AVX2 void projectDistancesAVX2(const DistanceBatch& batch, const XpbdParticles& particles, float invDtSq) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 tiny = _mm256_set1_ps(1e-9f);
+    const __m256 scale = _mm256_set1_ps(invDtSq);
+    size_t full = batch.count & ~(size_t) 7;
+    alignas(32) float ca[3][8], cb[3][8];
+    alignas(32) uint32_t ia[8], ib[8];
+    for (size_t i = 0; i < full; i += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (batch.a + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*) (batch.b + i));
+        __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(particles.x, a, 4), _mm256_i32gather_ps(particles.x, b, 4));
+        __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(particles.y, a, 4), _mm256_i32gather_ps(particles.y, b, 4));
+        __m256 dz = _mm256_sub_ps(_mm256_i32gather_ps(particles.z, a, 4), _mm256_i32gather_ps(particles.z, b, 4));
+        __m256 wa = _mm256_i32gather_ps(particles.invMass, a, 4);
+        __m256 wb = _mm256_i32gather_ps(particles.invMass, b, 4);
+        __m256 length = _mm256_sqrt_ps(_mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dz, dz))));
+        __m256 alpha = _mm256_mul_ps(_mm256_loadu_ps(batch.compliance + i), scale);
+        __m256 denominator = _mm256_add_ps(_mm256_add_ps(wa, wb), alpha);
+        __m256 valid = _mm256_and_ps(_mm256_cmp_ps(length, tiny, _CMP_GE_OQ), _mm256_cmp_ps(denominator, zero, _CMP_GT_OQ));
+        __m256 lambda = _mm256_loadu_ps(batch.lambda + i);
+        __m256 delta = _mm256_div_ps(_mm256_fnmadd_ps(alpha, lambda, _mm256_sub_ps(_mm256_loadu_ps(batch.restLength + i), length)), denominator);
+        delta = _mm256_and_ps(valid, delta);
+        _mm256_storeu_ps(batch.lambda + i, _mm256_add_ps(lambda, delta));
+        // invalid lanes divide by a tiny or zero length, the mask drops them again
+        __m256 s = _mm256_and_ps(valid, _mm256_div_ps(delta, length));
+        __m256 sa = _mm256_mul_ps(wa, s), sb = _mm256_mul_ps(wb, s);
+        _mm256_store_ps(ca[0], _mm256_mul_ps(sa, dx));
+        _mm256_store_ps(ca[1], _mm256_mul_ps(sa, dy));
+        _mm256_store_ps(ca[2], _mm256_mul_ps(sa, dz));
+        _mm256_store_ps(cb[0], _mm256_mul_ps(sb, dx));
+        _mm256_store_ps(cb[1], _mm256_mul_ps(sb, dy));
+        _mm256_store_ps(cb[2], _mm256_mul_ps(sb, dz));
+        _mm256_store_si256((__m256i*) ia, a);
+        _mm256_store_si256((__m256i*) ib, b);
+        for (int lane = 0; lane < 8; lane++) {
+            particles.x[ia[lane]] += ca[0][lane];
+            particles.y[ia[lane]] += ca[1][lane];
+            particles.z[ia[lane]] += ca[2][lane];
+            particles.x[ib[lane]] -= cb[0][lane];
+            particles.y[ib[lane]] -= cb[1][lane];
+            particles.z[ib[lane]] -= cb[2][lane];
+        }
+    }
+    DistanceBatch tail = { batch.a + full, batch.b + full, batch.restLength + full, batch.compliance + full, batch.lambda + full, batch.count - full };
+    projectDistancesScalar(tail, particles, invDtSq);
+}
+
+#endif
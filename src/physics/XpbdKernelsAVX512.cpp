@@ -0,0 +1,45 @@
+#include "XpbdKernels.h"
+#include "Cpu.h"
+#if defined(PHYS_X86)
+#include <immintrin.h>
+
+// gathers and scatters; a batch never repeats a particle so the scatters can't collide
+PHYS_TARGET_AVX512 void projectDistancesAVX512(const DistanceBatch& batch, const XpbdParticles& particles, float invDtSq) {
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 tiny = _mm512_set1_ps(1e-9f);
+    const __m512 scale = _mm512_set1_ps(invDtSq);
+    for (size_t i = 0; i < batch.count; i += 16) {
+        size_t left = batch.count - i;
+        __mmask16 lanes = left >= 16 ? (__mmask16) 0xffff : (__mmask16) ((1u << left) - 1);
+        __m512i a = _mm512_maskz_loadu_epi32(lanes, batch.a + i);
+        __m512i b = _mm512_maskz_loadu_epi32(lanes, batch.b + i);
+        __m512 xa = _mm512_mask_i32gather_ps(zero, lanes, a, particles.x, 4);
+        __m512 ya = _mm512_mask_i32gather_ps(zero, lanes, a, particles.y, 4);
+        __m512 za = _mm512_mask_i32gather_ps(zero, lanes, a, particles.z, 4);
+        __m512 xb = _mm512_mask_i32gather_ps(zero, lanes, b, particles.x, 4);
+        __m512 yb = _mm512_mask_i32gather_ps(zero, lanes, b, particles.y, 4);
+        __m512 zb = _mm512_mask_i32gather_ps(zero, lanes, b, particles.z, 4);
+        __m512 wa = _mm512_mask_i32gather_ps(zero, lanes, a, particles.invMass, 4);
+        __m512 wb = _mm512_mask_i32gather_ps(zero, lanes, b, particles.invMass, 4);
+        __m512 dx = _mm512_sub_ps(xa, xb), dy = _mm512_sub_ps(ya, yb), dz = _mm512_sub_ps(za, zb);
+        __m512 length = _mm512_sqrt_ps(_mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dz, dz))));
+        __m512 alpha = _mm512_mul_ps(_mm512_maskz_loadu_ps(lanes, batch.compliance + i), scale);
+        __m512 denominator = _mm512_add_ps(_mm512_add_ps(wa, wb), alpha);
+        __mmask16 valid = _mm512_mask_cmp_ps_mask(lanes, length, tiny, _CMP_GE_OQ);
+        valid = _mm512_mask_cmp_ps_mask(valid, denominator, zero, _CMP_GT_OQ);
+        __m512 lambda = _mm512_maskz_loadu_ps(lanes, batch.lambda + i);
+        __m512 c = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, batch.restLength + i), length);
+        __m512 delta = _mm512_maskz_div_ps(valid, _mm512_fnmadd_ps(alpha, lambda, c), denominator);
+        _mm512_mask_storeu_ps(batch.lambda + i, lanes, _mm512_add_ps(lambda, delta));
+        __m512 s = _mm512_maskz_div_ps(valid, delta, length);
+        __m512 sa = _mm512_mul_ps(wa, s), sb = _mm512_mul_ps(wb, s);
+        _mm512_mask_i32scatter_ps(particles.x, valid, a, _mm512_fmadd_ps(sa, dx, xa), 4);
+        _mm512_mask_i32scatter_ps(particles.y, valid, a, _mm512_fmadd_ps(sa, dy, ya), 4);
+        _mm512_mask_i32scatter_ps(particles.z, valid, a, _mm512_fmadd_ps(sa, dz, za), 4);
+        _mm512_mask_i32scatter_ps(particles.x, valid, b, _mm512_fnmadd_ps(sb, dx, xb), 4);
+        _mm512_mask_i32scatter_ps(particles.y, valid, b, _mm512_fnmadd_ps(sb, dy, yb), 4);
+        _mm512_mask_i32scatter_ps(particles.z, valid, b, _mm512_fnmadd_ps(sb, dz, zb), 4);
+    }
+}
+
+#endif
@@ -0,0 +1,321 @@
+#include <cmath>
+#include <algorithm>
+#include "XpbdSystem.h"
+
+XpbdSystem::XpbdSystem()
+    : m_OverflowCount(0), m_Built(true), m_Gravity{ 0.0f, -9.81f, 0.0f }, m_Substeps(10), m_Damping(0.1f), m_FloorY(-1.0f),
+      m_Sphere{ 0.0f, 0.0f, 0.0f, 0.0f }, m_StepCount(0) {
+}
+
+unsigned int XpbdSystem::addParticle(float x, float y, float z, float mass) {
+    m_X.push_back(x);
+    m_Y.push_back(y);
+    m_Z.push_back(z);
+    m_PrevX.push_back(x);
+    m_PrevY.push_back(y);
+    m_PrevZ.push_back(z);
+    m_VX.push_back(0.0f);
+    m_VY.push_back(0.0f);
+    m_VZ.push_back(0.0f);
+    m_InvMass.push_back(mass > 0.0f ? 1.0f / mass : 0.0f);
+    return (unsigned int) m_X.size() - 1;
+}
+
+void XpbdSystem::addDistance(unsigned int a, unsigned int b, float compliance) {
+    float dx = m_X[a] - m_X[b], dy = m_Y[a] - m_Y[b], dz = m_Z[a] - m_Z[b];
+    m_A.push_back(a);
+    m_B.push_back(b);
+    m_RestLength.push_back(std::sqrt(dx * dx + dy * dy + dz * dz));
+    m_Compliance.push_back(compliance);
+    m_Lambda.push_back(0.0f);
+    m_Built = false;
+}
+
+unsigned int XpbdSystem::addSheet(const float origin[3], const float u[3], const float v[3], unsigned int rows, unsigned int columns,
+    float mass, float stretchCompliance, float bendCompliance) {
+    rows = std::max(rows, 2u);
+    columns = std::max(columns, 2u);
+    unsigned int first = getParticleCount();
+    float particleMass = mass / (rows * columns);
+    for (unsigned int r = 0; r < rows; r++) {
+        float t = (float) r / (rows - 1);
+        for (unsigned int c = 0; c < columns; c++) {
+            float s = (float) c / (columns - 1);
+            addParticle(origin[0] + s * u[0] + t * v[0], origin[1] + s * u[1] + t * v[1], origin[2] + s * u[2] + t * v[2], particleMass);
+        }
+    }
+    auto index = [&](unsigned int r, unsigned int c) { return first + r * columns + c; };
+    for (unsigned int r = 0; r < rows; r++) {
+        for (unsigned int c = 0; c < columns; c++) {
+            if (c + 1 < columns) {
+                addDistance(index(r, c), index(r, c + 1), stretchCompliance);
+                m_Lines.push_back(index(r, c));
+                m_Lines.push_back(index(r, c + 1));
+            }
+            if (r + 1 < rows) {
+                addDistance(index(r, c), index(r + 1, c), stretchCompliance);
+                m_Lines.push_back(index(r, c));
+                m_Lines.push_back(index(r + 1, c));
+            }
+            // shear
+            if (r + 1 < rows && c + 1 < columns) {
+                addDistance(index(r, c), index(r + 1, c + 1), stretchCompliance);
+                addDistance(index(r, c + 1), index(r + 1, c), stretchCompliance);
+            }
+            // bending across the next vertex
+            if (c + 2 < columns)
+                addDistance(index(r, c), index(r, c + 2), bendCompliance);
+            if (r + 2 < rows)
+                addDistance(index(r, c), index(r + 2, c), bendCompliance);
+        }
+    }
+    return first;
+}
+
+unsigned int XpbdSystem::addRope(const float start[3], const float end[3], unsigned int segments, float mass,
+    float stretchCompliance, float bendCompliance) {
+    segments = std::max(segments, 1u);
+    unsigned int first = getParticleCount();
+    float particleMass = mass / (segments + 1);
+    for (unsigned int i = 0; i <= segments; i++) {
+        float t = (float) i / segments;
+        addParticle(start[0] + t * (end[0] - start[0]), start[1] + t * (end[1] - start[1]), start[2] + t * (end[2] - start[2]), particleMass);
+    }
+    for (unsigned int i = 0; i < segments; i++) {
+        addDistance(first + i, first + i + 1, stretchCompliance);
+        m_Lines.push_back(first + i);
+        m_Lines.push_back(first + i + 1);
+    }
+    for (unsigned int i = 0; i + 1 < segments; i++)
+        addDistance(first + i, first + i + 2, bendCompliance);
+    return first;
+}
+
+void XpbdSystem::pin(unsigned int particle) {
+    m_InvMass[particle] = 0.0f;
+    m_Built = false;
+}
+
+void XpbdSystem::buildTethers() {
+    // pieces are the connected components of the constraint graph
+    size_t count = m_X.size();
+    std::vector<uint32_t> parent(count);
+    for (size_t i = 0; i < count; i++)
+        parent[i] = (uint32_t) i;
+    auto find = [&](uint32_t i) {
+        while (parent[i] != i)
+            i = parent[i] = parent[parent[i]];
+        return i;
+    };
+    for (size_t i = 0; i < m_A.size(); i++)
+        parent[find(m_A[i])] = find(m_B[i]);
+
+    std::vector<std::vector<uint32_t>> pins(count);
+    for (size_t i = 0; i < count; i++) {
+        if (m_InvMass[i] == 0.0f)
+            pins[find((uint32_t) i)].push_back((uint32_t) i);
+    }
+    m_TetherAnchor.resize(count);
+    m_TetherLength.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        m_TetherAnchor[i] = NoTether;
+        if (m_InvMass[i] == 0.0f)
+            continue;
+        float best = INFINITY;
+        for (uint32_t anchor : pins[find((uint32_t) i)]) {
+            float dx = m_X[i] - m_X[anchor], dy = m_Y[i] - m_Y[anchor], dz = m_Z[i] - m_Z[anchor];
+            float d = std::sqrt(dx * dx + dy * dy + dz * dz);
+            if (d < best) {
+                best = d;
+                m_TetherAnchor[i] = anchor;
+                m_TetherLength[i] = d;
+            }
+        }
+    }
+}
+
+void XpbdSystem::build() {
+    // greedy in the order the constraints were added, which is deterministic;
+    // pinned particles count too since the kernels write them back unchanged
+    size_t count = m_A.size();
+    std::vector<uint64_t> particleColors(m_X.size(), 0);
+    std::vector<uint8_t> colors(count);
+    std::vector<unsigned int> counts(MaxColors + 1, 0);
+    for (size_t i = 0; i < count; i++) {
+        uint64_t taken = particleColors[m_A[i]] | particleColors[m_B[i]];
+        unsigned int colorIndex = MaxColors;
+        if (~taken != 0) {
+            colorIndex = 0;
+            while (taken & ((uint64_t) 1 << colorIndex))
+                colorIndex++;
+            particleColors[m_A[i]] |= (uint64_t) 1 << colorIndex;
+            particleColors[m_B[i]] |= (uint64_t) 1 << colorIndex;
+        }
+        colors[i] = (uint8_t) colorIndex;
+        counts[colorIndex]++;
+    }
+
+    // stable counting sort by color; empty colors are dropped from the batch list
+    m_BatchOffsets.clear();
+    std::vector<unsigned int> cursor(MaxColors + 1, 0);
+    unsigned int offset = 0;
+    for (unsigned int colorIndex = 0; colorIndex <= MaxColors; colorIndex++) {
+        cursor[colorIndex] = offset;
+        if (counts[colorIndex] == 0)
+            continue;
+        m_BatchOffsets.push_back(offset);
+        offset += counts[colorIndex];
+    }
+    m_BatchOffsets.push_back(offset);
+    m_OverflowCount = counts[MaxColors];
+
+    AlignedArray<uint32_t> a(count), b(count);
+    AlignedArray<float> restLength(count), compliance(count);
+    for (size_t i = 0; i < count; i++) {
+        unsigned int slot = cursor[colors[i]]++;
+        a[slot] = m_A[i];
+        b[slot] = m_B[i];
+        restLength[slot] = m_RestLength[i];
+        compliance[slot] = m_Compliance[i];
+    }
+    m_A = std::move(a);
+    m_B = std::move(b);
+    m_RestLength = std::move(restLength);
+    m_Compliance = std::move(compliance);
+    m_Lambda.resize(count);
+    buildTethers();
+    m_Built = true;
+}
+
+void XpbdSystem::setGravity(float x, float y, float z) {
+    m_Gravity[0] = x;
+    m_Gravity[1] = y;
+    m_Gravity[2] = z;
+}
+
+void XpbdSystem::setSubsteps(unsigned int substeps) {
+    m_Substeps = std::max(substeps, 1u);
+}
+
+void XpbdSystem::setDamping(float damping) {
+    m_Damping = damping;
+}
+
+void XpbdSystem::setFloor(float y) {
+    m_FloorY = y;
+}
+
+void XpbdSystem::setSphere(float x, float y, float z, float radius) {
+    m_Sphere[0] = x;
+    m_Sphere[1] = y;
+    m_Sphere[2] = z;
+    m_Sphere[3] = radius;
+}
+
+void XpbdSystem::predict(float dt, ThreadPool& pool) {
+    float keep = std::max(1.0f - m_Damping * dt, 0.0f);
+    pool.parallelFor(m_X.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            m_PrevX[i] = m_X[i];
+            m_PrevY[i] = m_Y[i];
+            m_PrevZ[i] = m_Z[i];
+            if (m_InvMass[i] == 0.0f)
+                continue;
+            m_VX[i] = keep * (m_VX[i] + dt * m_Gravity[0]);
+            m_VY[i] = keep * (m_VY[i] + dt * m_Gravity[1]);
+            m_VZ[i] = keep * (m_VZ[i] + dt * m_Gravity[2]);
+            m_X[i] += dt * m_VX[i];
+            m_Y[i] += dt * m_VY[i];
+            m_Z[i] += dt * m_VZ[i];
+        }
+    });
+}
+
+void XpbdSystem::projectConstraints(float dt, ThreadPool& pool) {
+    XpbdParticles particles = { m_X.data(), m_Y.data(), m_Z.data(), m_InvMass.data() };
+    float invDtSq = 1.0f / (dt * dt);
+    m_Lambda.fill(0.0f);
+    unsigned int batches = getBatchCount();
+    for (unsigned int batch = 0; batch < batches; batch++) {
+        size_t begin = m_BatchOffsets[batch], end = m_BatchOffsets[batch + 1];
+        auto project = [&](size_t first, size_t last) {
+            DistanceBatch constraints = { m_A.data() + first, m_B.data() + first, m_RestLength.data() + first,
+                m_Compliance.data() + first, m_Lambda.data() + first, last - first };
+            projectDistances(constraints, particles, invDtSq);
+        };
+        if (batch + 1 == batches && m_OverflowCount > 0) {
+            // the overflow batch may share particles, one constraint at a time
+            for (size_t i = begin; i < end; i++)
+                project(i, i + 1);
+            continue;
+        }
+        size_t chunks = (end - begin + ChunkSize - 1) / ChunkSize;
+        pool.parallelFor(chunks, [&](size_t first, size_t last, unsigned int) {
+            project(begin + first * ChunkSize, std::min(end, begin + last * ChunkSize));
+        });
+    }
+}
+
+void XpbdSystem::projectTethers(ThreadPool& pool) {
+    pool.parallelFor(m_X.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            uint32_t anchor = m_TetherAnchor[i];
+            if (anchor == NoTether)
+                continue;
+            float dx = m_X[i] - m_X[anchor], dy = m_Y[i] - m_Y[anchor], dz = m_Z[i] - m_Z[anchor];
+            float d2 = dx * dx + dy * dy + dz * dz;
+            if (d2 <= m_TetherLength[i] * m_TetherLength[i])
+                continue;
+            float s = m_TetherLength[i] / std::sqrt(d2);
+            m_X[i] = m_X[anchor] + s * dx;
+            m_Y[i] = m_Y[anchor] + s * dy;
+            m_Z[i] = m_Z[anchor] + s * dz;
+        }
+    });
+}
+
+void XpbdSystem::collide(ThreadPool& pool) {
+    pool.parallelFor(m_X.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            if (m_InvMass[i] == 0.0f)
+                continue;
+            if (m_Y[i] < m_FloorY)
+                m_Y[i] = m_FloorY;
+            if (m_Sphere[3] > 0.0f) {
+                float dx = m_X[i] - m_Sphere[0], dy = m_Y[i] - m_Sphere[1], dz = m_Z[i] - m_Sphere[2];
+                float d2 = dx * dx + dy * dy + dz * dz;
+                if (d2 < m_Sphere[3] * m_Sphere[3] && d2 > 0.0f) {
+                    float s = m_Sphere[3] / std::sqrt(d2);
+                    m_X[i] = m_Sphere[0] + s * dx;
+                    m_Y[i] = m_Sphere[1] + s * dy;
+                    m_Z[i] = m_Sphere[2] + s * dz;
+                }
+            }
+        }
+    });
+}
+
+void XpbdSystem::updateVelocities(float dt, ThreadPool& pool) {
+    float invDt = 1.0f / dt;
+    pool.parallelFor(m_X.size(), [&](size_t begin, size_t end, unsigned int) {
+        for (size_t i = begin; i < end; i++) {
+            m_VX[i] = (m_X[i] - m_PrevX[i]) * invDt;
+            m_VY[i] = (m_Y[i] - m_PrevY[i]) * invDt;
+            m_VZ[i] = (m_Z[i] - m_PrevZ[i]) * invDt;
+        }
+    });
+}
+
+void XpbdSystem::step(float dt, ThreadPool& pool) {
+    if (!m_Built)
+        build();
+    float h = dt / m_Substeps;
+    for (unsigned int s = 0; s < m_Substeps; s++) {
+        predict(h, pool);
+        projectConstraints(h, pool);
+        projectTethers(pool);
+        collide(pool);
+        updateVelocities(h, pool);
+    }
+    m_StepCount++;
+}
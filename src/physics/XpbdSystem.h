@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "AlignedArray.h"
+#include "ThreadPool.h"
+#include "XpbdKernels.h"
+
+// Extended position based dynamics for cloth and ropes. Everything is a
+// distance constraint with a compliance: stretch and shear along the mesh
+// edges, and bending as distances across every second vertex, which are
+// softer. build() colors the constraints greedily so no two in a color share
+// a particle, and stores them grouped by color; every step reuses those
+// batches. A step is split into substeps of one projection sweep each (the
+// multipliers restart every substep), which converges better than iterating
+// one big step. Colors run one after another, the constraints of a color in
+// parallel and with SIMD, so results don't depend on the thread count.
+// Every free particle is also tethered to the nearest pinned particle of its
+// piece (long range attachment): it may not get farther from it than at
+// build time, which stops hanging cloth from stretching out under its own
+// weight when a few sweeps can't carry the pin's pull across the mesh.
+// Particles collide with a floor plane and an optional sphere.
+class XpbdSystem {
+public:
+	static constexpr unsigned int MaxColors = 64;
+	static constexpr unsigned int ChunkSize = 256; // constraints per parallel task, keeps SIMD runs whole
+	static constexpr uint32_t NoTether = 0xffffffffu;
+private:
+	AlignedArray<float> m_X, m_Y, m_Z;
+	AlignedArray<float> m_PrevX, m_PrevY, m_PrevZ;
+	AlignedArray<float> m_VX, m_VY, m_VZ;
+	AlignedArray<float> m_InvMass; // 0 pins a particle
+
+	// constraints as added, and grouped by color after build()
+	AlignedArray<uint32_t> m_A, m_B;
+	AlignedArray<float> m_RestLength, m_Compliance, m_Lambda;
+	std::vector<unsigned int> m_BatchOffsets; // batch c is [m_BatchOffsets[c], m_BatchOffsets[c + 1])
+	unsigned int m_OverflowCount; // constraints in the last batch that didn't fit MaxColors, projected serially
+	bool m_Built;
+
+	AlignedArray<uint32_t> m_TetherAnchor; // per particle, NoTether when it has no pin to hang from
+	AlignedArray<float> m_TetherLength;
+
+	std::vector<uint32_t> m_Lines; // vertex pairs for drawing: mesh edges and rope segments
+
+	float m_Gravity[3];
+	unsigned int m_Substeps;
+	float m_Damping; // fraction of the velocity lost per second
+	float m_FloorY;
+	float m_Sphere[4]; // x, y, z, radius; radius 0 turns it off
+	unsigned long long m_StepCount;
+
+	void predict(float dt, ThreadPool& pool);
+	void buildTethers();
+	void projectConstraints(float dt, ThreadPool& pool);
+	void projectTethers(ThreadPool& pool);
+	void collide(ThreadPool& pool);
+	void updateVelocities(float dt, ThreadPool& pool);
+public:
+	XpbdSystem();
+
+	unsigned int addParticle(float x, float y, float z, float mass); // mass 0 pins it
+	// rest length is the current distance between a and b
+	void addDistance(unsigned int a, unsigned int b, float compliance);
+	// rows x columns cloth spanning origin to origin + u and origin + v, total
+	// mass spread evenly; returns the first particle, stored row by row
+	unsigned int addSheet(const float origin[3], const float u[3], const float v[3], unsigned int rows, unsigned int columns,
+		float mass, float stretchCompliance, float bendCompliance);
+	// rope of `segments` pieces from start to end; returns the first particle
+	unsigned int addRope(const float start[3], const float end[3], unsigned int segments, float mass,
+		float stretchCompliance, float bendCompliance);
+	void pin(unsigned int particle);
+	// partitions the constraints into batches and attaches the tethers; step
+	// calls it when constraints or pins were added since
+	void build();
+	void step(float dt, ThreadPool& pool);
+
+	void setGravity(float x, float y, float z);
+	void setSubsteps(unsigned int substeps);
+	void setDamping(float damping);
+	void setFloor(float y);
+	void setSphere(float x, float y, float z, float radius);
+
+	inline const AlignedArray<float>& getX() const { return m_X; };
+	inline const AlignedArray<float>& getY() const { return m_Y; };
+	inline const AlignedArray<float>& getZ() const { return m_Z; };
+	inline const std::vector<uint32_t>& getLines() const { return m_Lines; };
+	inline unsigned int getParticleCount() const { return (unsigned int) m_X.size(); };
+	inline unsigned int getConstraintCount() const { return (unsigned int) m_A.size(); };
+	inline unsigned int getBatchCount() const { return m_BatchOffsets.empty() ? 0 : (unsigned int) m_BatchOffsets.size() - 1; };
+	inline unsigned int getSubsteps() const { return m_Substeps; };
+	inline unsigned long long getStepCount() const { return m_StepCount; };
+};